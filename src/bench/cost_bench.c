@@ -0,0 +1,198 @@
+/*
+ * GraphPass:
+ * A utility to filter networks and provide a default visualization output
+ * for Gephi or SigmaJS.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** @file cost_bench.c
+ @brief Measures each metric against the cost model in cost.c.
+
+ Loads each file, then computes every metric and the layout in a forked
+ child, timing it and reading the child's peak memory.  For each it prints
+ the operations metric_cost counts, the nanoseconds per operation that fit
+ the measured time next to the value in NS_PER_OP, and the measured and
+ predicted scratch memory.  Run it on graphs like the ones you filter.
+
+ Last it prints NS_PER_OP, COST_NS_LOAD_BYTE and COST_MEASURED as they
+ would be written in cost.c, each the largest value fitted on any of the
+ graphs, under a comment naming the machine and the graphs.  Metrics it does not time keep
+ their values from cost.c.
+
+ Usage: ./cost_bench [graphml files]
+ */
+
+#include "graphpass.h"
+#include <sys/resource.h>
+#include <sys/utsname.h>
+#include <sys/wait.h>
+
+/** The largest ns/op fitted for each metric, or 0 if it was not timed. */
+static double fitted[MET_SIZE + 1];
+static double fitted_load;
+
+static double elapsed_ms(struct timespec *start, struct timespec *end) {
+  return (end->tv_sec - start->tv_sec) * 1000.0
+    + (end->tv_nsec - start->tv_nsec) / 1000000.0;
+}
+
+/** The resident memory of this process, in bytes. */
+static double resident_bytes() {
+  long pages = 0, resident = 0;
+  FILE *fp = fopen("/proc/self/statm", "r");
+  if (fp != NULL) {
+    if (fscanf(fp, "%ld %ld", &pages, &resident) != 2) {
+      resident = 0;
+    }
+    fclose(fp);
+  }
+  return (double) resident * sysconf(_SC_PAGESIZE);
+}
+
+/** Computes one metric of g in a child and prints its row. */
+static void bench_metric(metric_t metric, long n, long m) {
+  struct timespec start, end;
+  struct rusage usage;
+  double ms = -1.0, ops, bytes;
+  int pipefd[2];
+  /* what the metric is computed from is not part of its cost */
+  metric_plan_t deps = plan_missing(&g, plan_closure(PLAN(metric)) & ~PLAN(metric));
+  if (deps != 0) {
+    analysis_planned(&g, deps);
+  }
+  if (pipe(pipefd) == -1) {
+    return;
+  }
+  double before = resident_bytes();
+  fflush(stdout);
+  pid_t pid = fork();
+  if (pid == 0) {
+    close(pipefd[0]);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (metric == MET_LAYOUT) {
+      layout_graph(&g, LAYOUT_DEFAULT_CHAR);
+    } else {
+      analysis_planned(&g, PLAN(metric));
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    ms = elapsed_ms(&start, &end);
+    ssize_t sent = write(pipefd[1], &ms, sizeof(ms));
+    close(pipefd[1]);
+    _exit(sent == sizeof(ms) ? EXIT_SUCCESS : EXIT_FAILURE);
+  }
+  close(pipefd[1]);
+  if (pid == -1) {
+    close(pipefd[0]);
+    return;
+  }
+  if (read(pipefd[0], &ms, sizeof(ms)) != sizeof(ms)) {
+    ms = -1.0;
+  }
+  close(pipefd[0]);
+  wait4(pid, NULL, 0, &usage);
+  double peak = usage.ru_maxrss * 1024.0 - before;
+  metric_cost(metric, n, m, &ops, &bytes);
+  if (ms >= 0 && ops > 0 && ms * 1e6 / ops > fitted[metric]) {
+    fitted[metric] = ms * 1e6 / ops;
+  }
+  printf("| %-26s| %-12.3g| %-10.2f| %-10.3f| %-10.3f| %-10.2f| %-10.2f|\n",
+         metric_name(metric), ops, ms, ops > 0 ? ms * 1e6 / ops : 0.0, metric_ns(metric),
+         (peak > 0 ? peak : 0) / 1048576.0, bytes / 1048576.0);
+}
+
+static void bench_file(char *path) {
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  if (load_graph(path) != 0) {
+    printf("%s: could not load\n", path);
+    return;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  long n = igraph_vcount(&g);
+  long m = igraph_ecount(&g);
+  long bytes = input_size(path);
+  if (bytes > 0 && elapsed_ms(&start, &end) * 1e6 / bytes > fitted_load) {
+    fitted_load = elapsed_ms(&start, &end) * 1e6 / bytes;
+  }
+  printf("\n%s: %li nodes, %li edges, %li bytes, loaded in %.2f ms (%.2f ns/byte), "
+         "graph %.2f MB\n\n", path, n, m, bytes, elapsed_ms(&start, &end),
+         bytes > 0 ? elapsed_ms(&start, &end) * 1e6 / bytes : 0.0,
+         graph_memory(&g) / 1048576.0);
+  printf("| Metric                    | Ops         | ms        | ns/op     | Model     | MB        | Model MB  |\n");
+  printf("|---------------------------|-------------|-----------|-----------|-----------|-----------|-----------|\n");
+  for (int metric=0; metric<=MET_RECIPROCITY; metric++) {
+    if (PLAN_HAS(PLAN_ANALYSIS_ALL, metric)) {
+      bench_metric((metric_t) metric, n, m);
+    }
+  }
+  bench_metric(MET_LAYOUT, n, m);
+  igraph_destroy(&g);
+}
+
+/** The processor model from /proc/cpuinfo, or "unknown". */
+static void cpu_model(char *model, size_t size) {
+  char line[256];
+  snprintf(model, size, "unknown");
+  FILE *fp = fopen("/proc/cpuinfo", "r");
+  if (fp == NULL) {
+    return;
+  }
+  while (fgets(line, sizeof(line), fp) != NULL) {
+    char *colon = strchr(line, ':');
+    if (strncmp(line, "model name", 10) == 0 && colon != NULL) {
+      snprintf(model, size, "%s", colon + 2);
+      model[strcspn(model, "\n")] = '\0';
+      break;
+    }
+  }
+  fclose(fp);
+}
+
+/** Prints the fitted values in the form cost.c declares them. */
+static void print_fitted(char **paths, int count) {
+  struct utsname host;
+  char model[128];
+  cpu_model(model, sizeof(model));
+  if (uname(&host) != 0) {
+    snprintf(host.sysname, sizeof(host.sysname), "unknown");
+    host.release[0] = host.machine[0] = '\0';
+  }
+  printf("\n/* Measured by cost_bench on %s, %ld cores, %s %s %s, from", model,
+         sysconf(_SC_NPROCESSORS_ONLN), host.sysname, host.release, host.machine);
+  for (int i=0; i<count; i++) {
+    printf(" %s", paths[i]);
+  }
+  printf(". */\n#define COST_MEASURED 1\n#define COST_NS_LOAD_BYTE %.1f\n\n", fitted_load);
+  printf("static const double NS_PER_OP[] = {\n");
+  for (int metric=0; metric<=MET_SIZE; metric++) {
+    double ns = fitted[metric] > 0 ? fitted[metric] : metric_ns((metric_t) metric);
+    printf("  %.3f%s /* %s%s */\n", ns, metric < MET_SIZE ? "," : " ",
+           metric_name((metric_t) metric), fitted[metric] > 0 ? "" : ", not timed");
+  }
+  printf("};\n");
+}
+
+int main (int argc, char *argv[]) {
+  char *defaults[] = {"src/resources/cpp2.graphml", "src/resources/snowden.graphml",
+                      "src/resources/idlenomore.graphml"};
+  char **paths = argc > 1 ? argv + 1 : defaults;
+  int count = argc > 1 ? argc - 1 : (int) (sizeof(defaults) / sizeof(defaults[0]));
+  ug_TEST = true;
+  igraph_i_set_attribute_table(&igraph_cattribute_table);
+  for (int i=0; i<count; i++) {
+    bench_file(paths[i]);
+  }
+  print_fitted(paths, count);
+  return 0;
+}
@@ -0,0 +1,84 @@
+/*
+ * GraphPass:
+ * A utility to filter networks and provide a default visualization output
+ * for Gephi or SigmaJS.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** @file gexf_bench.c
+ @brief Measures the throughput of the GEXF writer in gexf.c and of the
+ SigmaJS writer in sigma.c.
+
+ Loads a graph (idlenomore.graphml by default), adds the attributes a
+ full analysis produces, then writes it BENCH_RUNS times to a temporary
+ file as GEXF on one thread and on every core, and as SigmaJS JSON with
+ no attributes and with all of them.  Reports the size, best time and MB/s
+ of each.
+
+ Usage: ./gexf_bench [graphml file]
+ */
+
+#include "graphpass.h"
+
+#define BENCH_RUNS 10
+
+static double elapsed_ms(struct timespec *start, struct timespec *end) {
+  return (end->tv_sec - start->tv_sec) * 1000.0
+    + (end->tv_nsec - start->tv_nsec) / 1000000.0;
+}
+
+int main (int argc, char *argv[]) {
+  char *path = argc > 1 ? argv[1] : "src/resources/idlenomore.graphml";
+  long threads[] = {1, 0, 1, 1};
+  char *formats[] = {"gexf", "gexf", "sigma viz", "sigma full"};
+  ug_TEST = true;
+  if (load_graph(path) != 0) {
+    fprintf(stderr, "Could not load %s\n", path);
+    return 1;
+  }
+  analysis_all(&g);
+  char *name = strrchr(path, '/') ? strrchr(path, '/') + 1 : path;
+  printf("| Input                   | Format    | Threads | Nodes   | Bytes      | Best ms     | MB/s     |\n");
+  printf("|-------------------------|-----------|---------|---------|------------|-------------|----------|\n");
+  for (int t=0; t<4; t++) {
+    struct timespec t0, t1;
+    double best = -1;
+    long bytes = 0;
+    ug_threads = threads[t];
+    for (int run=0; run<BENCH_RUNS; run++) {
+      FILE *out = tmpfile();
+      if (out == NULL) {
+        fprintf(stderr, "Could not open a temporary file\n");
+        return 1;
+      }
+      clock_gettime(CLOCK_MONOTONIC, &t0);
+      if (t < 2) {
+        igraph_write_graph_gexf(&g, out, 1);
+      } else {
+        write_graph_sigma(&g, out, t == 3 ? ATTRS_FULL : ATTRS_VIZ);
+      }
+      fflush(out);
+      clock_gettime(CLOCK_MONOTONIC, &t1);
+      bytes = ftell(out);
+      fclose(out);
+      double ms = elapsed_ms(&t0, &t1);
+      best = (best < 0 || ms < best) ? ms : best;
+    }
+    printf("| %-24s| %-10s| %-8s| %-8li| %-11li| %-12.3f| %-9.1f|\n", name,
+           formats[t], threads[t] ? "1" : "all", (long) igraph_vcount(&g), bytes, best,
+           best > 0 ? (bytes / 1048576.0) / (best / 1000.0) : 0.0);
+  }
+  igraph_destroy(&g);
+  return 0;
+}
@@ -0,0 +1,162 @@
+/*
+ * GraphPass:
+ * A utility to filter networks and provide a default visualization output
+ * for Gephi or SigmaJS.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** @file load_bench.c
+ @brief Compares the mmap GraphML loader in graphml.c with igraph's reader,
+ and with reloading the graph from a snapshot (snapshot.c).
+
+ Loads each file with all three, reports the best of BENCH_RUNS load times
+ and checks that the graphs, edges and attributes are the same.
+
+ Usage: ./load_bench [graphml files]
+ */
+
+#include "graphpass.h"
+
+#define BENCH_RUNS 5
+#define BENCH_SNAPSHOT "load_bench.gpsnap"
+
+static double elapsed_ms(struct timespec *start, struct timespec *end) {
+  return (end->tv_sec - start->tv_sec) * 1000.0
+    + (end->tv_nsec - start->tv_nsec) / 1000000.0;
+}
+
+/** Returns true if both graphs have the same structure and attributes. */
+static bool same_graph(igraph_t *a, igraph_t *b) {
+  if (igraph_vcount(a) != igraph_vcount(b) || igraph_ecount(a) != igraph_ecount(b)
+      || igraph_is_directed(a) != igraph_is_directed(b)) {
+    return false;
+  }
+  igraph_vector_t ea, eb;
+  igraph_vector_init(&ea, 0);
+  igraph_vector_init(&eb, 0);
+  igraph_get_edgelist(a, &ea, 0);
+  igraph_get_edgelist(b, &eb, 0);
+  bool same = igraph_vector_all_e(&ea, &eb);
+  igraph_vector_destroy(&ea);
+  igraph_vector_destroy(&eb);
+  igraph_attribute_elemtype_t kinds[] = {IGRAPH_ATTRIBUTE_VERTEX, IGRAPH_ATTRIBUTE_EDGE};
+  for (int k=0; k<2 && same; k++) {
+    struct AttrTable ta, tb;
+    attr_table_init(&ta, a, kinds[k]);
+    attr_table_init(&tb, b, kinds[k]);
+    same = (ta.count == tb.count);
+    for (long i=0; i<ta.count && same; i++) {
+      struct AttrColumn *ca = &ta.cols[i];
+      struct AttrColumn *cb = &tb.cols[i];
+      same = strcmp(ca->name, cb->name) == 0 && ca->type == cb->type;
+      for (long j=0; j<ta.length && same; j++) {
+        if (ca->type == IGRAPH_ATTRIBUTE_NUMERIC) {
+          igraph_real_t x = VECTOR(ca->num)[j];
+          igraph_real_t y = VECTOR(cb->num)[j];
+          same = (x == y) || (isnan(x) && isnan(y));
+        } else if (ca->type == IGRAPH_ATTRIBUTE_STRING) {
+          same = strcmp(STR(ca->str, j), STR(cb->str, j)) == 0;
+        }
+      }
+    }
+    attr_table_destroy(&ta);
+    attr_table_destroy(&tb);
+  }
+  return same;
+}
+
+/** Returns the best snapshot load time of graph, and whether it reloads the same. */
+static double bench_snapshot(igraph_t *graph, bool *same) {
+  struct timespec t0, t1;
+  double best = -1;
+  *same = false;
+  if (save_snapshot(graph, BENCH_SNAPSHOT, false) != 0) {
+    return best;
+  }
+  for (int run=0; run<BENCH_RUNS; run++) {
+    igraph_t copy;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    int loaded = load_snapshot(BENCH_SNAPSHOT, &copy, NULL, false);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    if (loaded != 0) {
+      break;
+    }
+    double ms = elapsed_ms(&t0, &t1);
+    best = (best < 0 || ms < best) ? ms : best;
+    if (run == BENCH_RUNS - 1) {
+      *same = same_graph(graph, &copy);
+    }
+    igraph_destroy(&copy);
+  }
+  remove(BENCH_SNAPSHOT);
+  return best;
+}
+
+static void bench_file(char *path) {
+  struct timespec t0, t1;
+  double best_libxml = -1, best_mmap = -1;
+  igraph_t slow, fast;
+  int loaded = 0;
+  for (int run=0; run<BENCH_RUNS; run++) {
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    load_graphml_libxml(path, &slow);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double ms = elapsed_ms(&t0, &t1);
+    best_libxml = (best_libxml < 0 || ms < best_libxml) ? ms : best_libxml;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    loaded = load_graphml_mmap(path, &fast);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    ms = elapsed_ms(&t0, &t1);
+    best_mmap = (best_mmap < 0 || ms < best_mmap) ? ms : best_mmap;
+    if (run < BENCH_RUNS - 1 || loaded != 0) {
+      igraph_destroy(&slow);
+      if (loaded == 0) {
+        igraph_destroy(&fast);
+      }
+    }
+    if (loaded != 0) {
+      break;
+    }
+  }
+  char *name = strrchr(path, '/') ? strrchr(path, '/') + 1 : path;
+  if (loaded != 0) {
+    printf("| %-24s| %-8s| %-12.3f| %-12s| %-8s| %-12s| %-5s|\n", name, "-", best_libxml,
+           "fallback", "-", "-", "-");
+    return;
+  }
+  bool snapshot_same;
+  double best_snapshot = bench_snapshot(&fast, &snapshot_same);
+  printf("| %-24s| %-8li| %-12.3f| %-12.3f| %-8.1fx| %-12.3f| %-5s|\n", name,
+         (long) igraph_vcount(&fast), best_libxml, best_mmap,
+         best_mmap > 0 ? best_libxml / best_mmap : 0.0, best_snapshot,
+         same_graph(&slow, &fast) && snapshot_same ? "yes" : "NO");
+  igraph_destroy(&slow);
+  igraph_destroy(&fast);
+}
+
+int main (int argc, char *argv[]) {
+  char *defaults[] = {"src/resources/cpp2.graphml", "src/resources/snowden.graphml",
+                      "src/resources/idlenomore.graphml", "src/resources/anarchist.graphml",
+                      "src/resources/albertahealth.graphml"};
+  char **paths = argc > 1 ? argv + 1 : defaults;
+  int count = argc > 1 ? argc - 1 : (int) (sizeof(defaults) / sizeof(defaults[0]));
+  ug_TEST = true;
+  igraph_i_set_attribute_table(&igraph_cattribute_table);
+  printf("| Input                   | Nodes   | igraph ms   | mmap ms     | Speedup  | snapshot ms | Same |\n");
+  printf("|-------------------------|---------|-------------|-------------|----------|-------------|------|\n");
+  for (int i=0; i<count; i++) {
+    bench_file(paths[i]);
+  }
+  return 0;
+}
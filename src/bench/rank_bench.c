@@ -0,0 +1,114 @@
+/*
+ * GraphPass:
+ * A utility to filter networks and provide a default visualization output
+ * for Gephi or SigmaJS.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** @file rank_bench.c
+ @brief Compares the argsort ranking in rank.c with the former quadratic
+ produceRank.
+
+ Ranks the Degree scores of a graph (idlenomore.graphml by default), then
+ the same scores tiled up to 50,000 values to show how both scale.
+
+ Usage: ./rank_bench [graphml file]
+ */
+
+#include "graphpass.h"
+
+#define BENCH_TILED_SIZE 50000
+
+/** The quadratic produceRank that rank.c replaced, kept for comparison. */
+static int quadratic_rank(igraph_vector_t *source, igraph_vector_t *v) {
+  long int source_size;
+  source_size = igraph_vector_size(source);
+  igraph_vector_t source_cpy, rank_vals;
+  igraph_vector_init(&rank_vals, source_size);
+  igraph_vector_copy(&source_cpy, source);
+  igraph_vector_sort(&source_cpy);
+  igraph_vector_reverse(&source_cpy);
+  for (long int i=0; i < source_size; i++){
+    if (i == 0) {
+      VECTOR(rank_vals)[0] = 1;
+    } else if (VECTOR(source_cpy)[i] == VECTOR(source_cpy)[i-1]) {
+      VECTOR(rank_vals)[i] = VECTOR(rank_vals)[i-1];
+    } else {
+      VECTOR(rank_vals)[i] = i+1;
+    }
+  }
+  for (long int i=0; i < source_size; i++) {
+    for (long int j=0; j < source_size; j++) {
+      if (igraph_vector_e(source, i) == igraph_vector_e(&source_cpy,j)) {
+        VECTOR(*v)[i] = VECTOR(rank_vals)[j];
+        break;
+      }
+    }
+  }
+  igraph_vector_destroy(&rank_vals);
+  igraph_vector_destroy(&source_cpy);
+  return 0;
+}
+
+static double elapsed_ms(struct timespec *start, struct timespec *end) {
+  return (end->tv_sec - start->tv_sec) * 1000.0
+    + (end->tv_nsec - start->tv_nsec) / 1000000.0;
+}
+
+static void bench_vector(char *name, igraph_vector_t *scores) {
+  struct timespec t0, t1, t2;
+  igraph_vector_t slow, fast;
+  long int n = igraph_vector_size(scores);
+  igraph_vector_init(&slow, n);
+  igraph_vector_init(&fast, n);
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  quadratic_rank(scores, &slow);
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  rank_vector(scores, &fast, RANK_COMPETITION);
+  clock_gettime(CLOCK_MONOTONIC, &t2);
+  double quad = elapsed_ms(&t0, &t1);
+  double argsort = elapsed_ms(&t1, &t2);
+  printf("| %-24s| %-8li| %-12.3f| %-12.3f| %-8.1fx| %-5s|\n", name, n, quad,
+         argsort, argsort > 0 ? quad / argsort : 0.0,
+         igraph_vector_all_e(&slow, &fast) ? "yes" : "NO");
+  igraph_vector_destroy(&slow);
+  igraph_vector_destroy(&fast);
+}
+
+int main (int argc, char *argv[]) {
+  char *path = argc > 1 ? argv[1] : "src/resources/idlenomore.graphml";
+  ug_TEST = true;
+  if (load_graph(path) != 0) {
+    fprintf(stderr, "Could not load %s\n", path);
+    return 1;
+  }
+  calc_degree(&g, 'd');
+  igraph_vector_t deg, tiled;
+  igraph_vector_init(&deg, igraph_vcount(&g));
+  VANV(&g, "Degree", &deg);
+  igraph_vector_init(&tiled, BENCH_TILED_SIZE);
+  for (long int i=0; i<BENCH_TILED_SIZE; i++) {
+    /* offset each tile so values are not all repeats of one graph */
+    VECTOR(tiled)[i] = VECTOR(deg)[i % igraph_vector_size(&deg)]
+      + (i / igraph_vector_size(&deg));
+  }
+  printf("| Input                   | Values  | Quadratic ms| Argsort ms  | Speedup  | Same |\n");
+  printf("|-------------------------|---------|-------------|-------------|----------|------|\n");
+  bench_vector("Degree", &deg);
+  bench_vector("Degree (tiled)", &tiled);
+  igraph_vector_destroy(&deg);
+  igraph_vector_destroy(&tiled);
+  igraph_destroy(&g);
+  return 0;
+}
@@ -30,9 +30,28 @@
 #include <unistd.h>
 #include <errno.h>
 #include <getopt.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <pthread.h>
+#include "libgraphpass.h"
 
 typedef enum { false, true } bool;
 typedef enum { FAIL, WARN, COMM } broadcast;
+typedef enum { RANK_COMPETITION, RANK_DENSE, RANK_FRACTIONAL } rank_ties_t;
+typedef enum { BETWEENNESS_EXACT, BETWEENNESS_SAMPLE, BETWEENNESS_EPSILON } betweenness_mode_t;
+typedef enum { COMPRESSION_NONE, COMPRESSION_GZIP, COMPRESSION_ZSTD } compression_t;
+typedef enum { FORMAT_GRAPHML, FORMAT_GEXF, FORMAT_SIGMA } output_format_t;
+/** Metrics known to the planner (see planner.c). */
+typedef enum {
+  MET_AUTHORITY, MET_BETWEENNESS, MET_DEGREE, MET_DEGREE_RANK, MET_HUB,
+  MET_INDEGREE, MET_OUTDEGREE, MET_EIGENVECTOR, MET_PAGERANK, MET_MODULARITY,
+  MET_C_AUTHORITY, MET_C_BETWEENNESS, MET_C_DEGREE, MET_C_HUB, MET_C_INDEGREE,
+  MET_C_OUTDEGREE, MET_C_EIGENVECTOR, MET_C_PAGERANK,
+  MET_PATH_LENGTH, MET_DIAMETER, MET_CLUSTERING, MET_ASSORTATIVITY,
+  MET_DEGREE_ASSORTATIVITY, MET_DENSITY, MET_RECIPROCITY,
+  MET_LAYOUT, MET_COLORS, MET_SIZE
+} metric_t;
+typedef uint64_t metric_plan_t; /**< A set of metric_t, see PLAN(). */
 
 igraph_t g;
 igraph_attribute_table_t att;
@@ -47,17 +66,43 @@ char* ug_OUTPATH; /**< Path to output folder. */
 char* ug_OUTPUT; /**< Filename extracted from outpath, if it exists. */
 char* ug_OUTARG; /**< Filepath entered as ARG. */
 char* ug_DIRECTORY; /**< Directory extracted from ug_PATH. */
+char* ug_CACHE; /**< Metric cache file, NULL unless --cache is set. */
+bool ug_convert; /**< "graphpass convert": write a snapshot instead of filtering. */
+uint64_t ug_snapshot_metrics; /**< Analysis fingerprint of a loaded snapshot, 0 if none. */
 bool ug_TEST; /**< Flags a test (ignores some expected FAIL messages). */
 igraph_integer_t NODESIZE; /**< Number of Nodes in original graph. */
 igraph_integer_t EDGESIZE; /**< Number of Edges in original graph. */
 float ug_percent; /**< Filtering percentage 0.0 by default. */
-long ug_maxnodes; /**< user-defined max nodes for processing, default MAX_NODES. */
-long ug_maxedges; /**< user-defined maxiumum edges for processing default MAX_EDGES. */
+long ug_maxnodes; /**< user-defined max nodes for processing, 0 for no cap. */
+long ug_maxedges; /**< user-defined maxiumum edges for processing, 0 for no cap. */
+double ug_memory_budget; /**< Bytes a run may be predicted to use (--memory-budget), 0 for no limit. */
+double ug_time_budget; /**< Seconds a run may be predicted to take (--time-budget), 0 for no limit. */
 bool ug_report; /**< Include a report?. */
-bool ug_gformat; /**< Graph format - true is "GEXF" false is "GRAPHML." */
+output_format_t ug_format; /**< Output format (--format), GraphML by default. */
+char* ug_attrs; /**< Attributes written to output (--attrs), NULL for the format's default. */
 bool ug_quickrun; /**< Lightweight visualization run. */
 bool ug_save; /**< If false, does not save graphs at all (for reports). */
 bool ug_verbose; //**< Verbose mode (default off). */
+/* Concurrency: igraph 0.7 keeps its error handler, its error and cleanup
+   (IGRAPH_FINALLY) stacks and its attribute table in process-wide globals,
+   as GraphPass keeps its run state in the ug_ globals.  Work that calls into
+   igraph therefore runs in forked worker processes, which share the loaded
+   graph copy-on-write and keep a crash away from the parent: the filter
+   methods (run_parallel), batch entries and served requests.  Threads only
+   parse or format plain arrays fetched beforehand, and never call igraph. */
+long ug_jobs; /**< Number of filter methods run concurrently, default all cores. */
+int ug_failing_workers; /**< Tests only: the workers for this many methods exit without reporting. */
+long ug_threads; /**< Threads reading CSV shards and formatting GraphML and GEXF files, default all cores. */
+compression_t ug_compress; /**< Compression of output files (--compress). */
+int ug_compress_level; /**< Compression level, 0 for the library default. */
+long ug_write_queue; /**< Output files written in the background at once (--write-queue), 0 to write in place. */
+FILE* ug_stream; /**< --serve connection output files are sent to, NULL to write files. */
+betweenness_mode_t ug_bmode; /**< Exact or sampled betweenness (--betweenness). */
+long ug_bsamples; /**< Sources sampled in BETWEENNESS_SAMPLE mode. */
+double ug_bepsilon; /**< Error bound in BETWEENNESS_EPSILON mode. */
+int ug_anf_bits; /**< log2 HyperANF registers for path lengths, 0 for exact (--distances). */
+metric_plan_t ug_plan; /**< Metrics computed on the original graph, 0 for all. */
+metric_plan_t ug_derived_plan; /**< Metrics computed on filtered graphs, 0 for all. */
 bool CALC_WEIGHTS;
 igraph_vector_t WEIGHTED; /**< If greater than 0, conducts weighted analysis. */
 
@@ -86,9 +131,46 @@ igraph_vector_t WEIGHTED; /**< If greater than 0, conducts weighted analysis. */
 #define SIZE_DEFAULT_CHAR 'd'
 #define COLOR_BASE "WalkTrapModularity"
 #define PAGERANK_DAMPING 0.85 /**< chance random walk will not restart. */
+#define WALKTRAP_STEPS 4 /**< length of random walks for walktrap modularity. */
+#define BETWEENNESS_DELTA 0.1 /**< failure probability of the --betweenness=eps bound. */
+#define ANF_MIN_BITS 4 /**< smallest --distances=anf:b, 16 registers. */
+#define ANF_MAX_BITS 16
+#define ANF_DEFAULT_BITS 6 /**< 64 registers, about 13% error per counter. */
+#define NODE_KEY_DIGITS 32 /**< hex digits of a node id load_graphml_mmap packs (see ids.c). */
+#define NODE_KEY_PARTS 3 /**< numeric vertex columns a packed id is stored in. */
+#define GRAPHML_UNSUPPORTED 1 /**< load_graphml_mmap cannot read the file, use igraph's reader. */
+#define ARENA_ALIGN 16 /**< alignment of every arena allocation. */
+#define ARENA_MIN_BLOCK (64 << 10) /**< smallest block an arena allocates. */
+#define FILTER_SCRATCH_BYTES(n, m) ((size_t) (n) * (4 * sizeof(igraph_real_t) + 2 * sizeof(int) + 3 * sizeof(long) + 1) \
+  + (size_t) (m) * (2 * sizeof(igraph_real_t) + sizeof(long)) + ARENA_MIN_BLOCK) /**< arena space one filter method uses on n vertices and m edges. */
+#define OUT_BUFFER_SIZE (1 << 20) /**< bytes an OutBuffer collects before each fwrite. */
+#define OUT_CHUNK_SIZE 4096 /**< nodes or edges a writer thread formats at a time. */
+#define GZIP_EXT ".gz"
+#define ZSTD_EXT ".zst"
+#define CACHE_EXT ".gpcache" /**< extension added to the input path for --cache. */
+#define SNAPSHOT_EXT ".gpsnap" /**< default extension of "graphpass convert" output. */
+#define SNAPSHOT_NONE 2 /**< load_snapshot: the file is not a snapshot. */
+#define ATTRS_VIZ "viz" /**< --attrs preset: label, position, size, colour and weight. */
+#define ATTRS_FULL "full" /**< --attrs preset: every attribute. */
+#define SERVE_CACHE_MB 1024 /**< default --serve-cache, megabytes of loaded graphs. */
+#define BATCH_REPORT "batch_report.md" /**< --batch summary, written to the output folder. */
+#define BATCH_OK 0 /**< run_batch: the graph was filtered and written. */
+#define BATCH_LOAD_FAILED 1
+#define BATCH_TOO_LARGE 2 /**< over a budget, --max-nodes or --max-edges (see cost_check). */
+#define BATCH_SAME_PATH 3 /**< the output folder is the input's folder. */
+#define BATCH_WRITE_FAILED 4
 #define LAYOUT_DEFAULT_CHAR 'f'
-#define MAX_NODES 50000 /**< default number of nodes in graph before shut down. */
-#define MAX_EDGES 500000 /**< default number of edges in graph before shut down. */
+#define PLAN(m) ((metric_plan_t) 1 << (m)) /**< plan holding only metric m. */
+#define PLAN_HAS(plan, m) (((plan) & PLAN(m)) != 0)
+/** Everything analysis_all computes. */
+#define PLAN_ANALYSIS_ALL ((PLAN(MET_RECIPROCITY + 1) - 1) & ~PLAN(MET_DEGREE_ASSORTATIVITY))
+/** Everything filter_by_cut computes. */
+#define PLAN_DERIVATIVE_ALL ((PLAN(MET_SIZE + 1) - 1) & ~PLAN(MET_ASSORTATIVITY))
+/** Metrics filter_by_cut can compute on a GraphView without building the graph. */
+#define PLAN_VIEW (PLAN(MET_DEGREE) | PLAN(MET_INDEGREE) | PLAN(MET_OUTDEGREE) \
+  | PLAN(MET_DEGREE_RANK) | PLAN(MET_DENSITY) | PLAN(MET_RECIPROCITY) | PLAN(MET_C_DEGREE))
+#define COST_MEMORY_SHARE 0.8 /**< default --memory-budget, as a share of physical memory. */
+#define COST_MAX_ROWS (MAX_METHODS + 32) /**< rows of a CostEstimate. */
 #define MAX_USER_EDGES 1000000000
 #define MAX_USER_NODES 1000000000
 
@@ -98,6 +180,8 @@ igraph_vector_t WEIGHTED; /**< If greater than 0, conducts weighted analysis. */
 #define TEST_FILENAME_SIZE 9
 
 #define NELEMS(x)  (sizeof(x) / sizeof((x)[0]))
+#define FNV_OFFSET 14695981039346656037ULL /**< the empty FNV-1a hash, see fnv_hash. */
+#define FNV_PRIME 1099511628211ULL
 
 struct Argument {
   char* val;
@@ -110,6 +194,152 @@ struct Node {
   struct Node *next;
 };
 
+/** @struct CostRow
+ @brief The predicted time and memory of one phase of a run (see cost.c).
+ */
+struct CostRow {
+  char name[48];
+  double seconds;
+  double bytes; /**< memory the phase holds beyond the loaded graph. */
+};
+
+/** @struct CostEstimate
+ @brief The predicted cost of a run, phase by phase.
+ */
+struct CostEstimate {
+  struct CostRow rows[COST_MAX_ROWS];
+  int count;
+  double seconds; /**< predicted wall time. */
+  double peak_bytes; /**< predicted peak resident memory, workers included. */
+  char reason[160]; /**< why cost_check rejected the run. */
+};
+
+/** @struct FilterResult
+ @brief Graph-level values measured on one filtered graph, used by the report.
+ */
+struct FilterResult {
+  igraph_real_t assort;
+  igraph_real_t edges;
+  igraph_real_t density;
+  igraph_real_t diameter;
+  igraph_real_t pathlength;
+  igraph_real_t clustering;
+  igraph_real_t betcent;
+  igraph_real_t degcent;
+  igraph_real_t idegcent;
+  igraph_real_t odegcent;
+  igraph_real_t eigcent;
+  igraph_real_t pagecent;
+  igraph_real_t reciprocity;
+  igraph_real_t pv;
+  igraph_real_t ts;
+  bool write_failed; /**< the filtered graph could not be written. */
+};
+
+/** @struct AttrColumn
+ @brief One attribute of every vertex (or edge), fetched as a whole column.
+ */
+struct AttrColumn {
+  char* name;
+  igraph_attribute_type_t type; /**< selects which of the columns is set. */
+  igraph_vector_t num;
+  igraph_strvector_t str;
+  igraph_vector_bool_t boolv;
+};
+
+/** @struct NodeKey
+ @brief A node id of NODE_KEY_DIGITS hex digits, as a 128-bit number (see ids.c).
+ */
+struct NodeKey {
+  uint64_t hi; /**< the first 16 digits. */
+  uint64_t lo; /**< the last 16 digits. */
+};
+
+/** @struct AttrTable
+ @brief A snapshot of a graph's vertex or edge attributes (see attrs.c).
+ */
+struct AttrTable {
+  long count; /**< number of columns, in attribute handler order. */
+  long length; /**< values per column. */
+  struct AttrColumn *cols;
+  long nslots; /**< size of the name hash, a power of two. */
+  long *slots; /**< column index per hash slot, -1 if empty. */
+};
+
+/** @struct ArenaBlock
+ @brief One allocation of an Arena, used from the bottom up.
+ */
+struct ArenaBlock {
+  struct ArenaBlock *next; /**< the block below this one. */
+  size_t size;
+  size_t used;
+  char data[] __attribute__((aligned(ARENA_ALIGN)));
+};
+
+/** @struct Arena
+ @brief A stack of blocks that scratch buffers are carved from (see arena.c).
+ A zeroed Arena is empty and ready to use.
+ */
+struct Arena {
+  struct ArenaBlock *head; /**< the block allocations come from. */
+  long blocks;
+  size_t reserved; /**< bytes in all blocks. */
+  size_t used; /**< bytes handed out. */
+  size_t peak; /**< the most bytes handed out at once. */
+};
+
+/** @struct ArenaMark
+ @brief A position in an Arena to release back to.
+ */
+struct ArenaMark {
+  struct ArenaBlock *block;
+  size_t used;
+  size_t total;
+};
+
+struct Arena ug_scratch; /**< Scratch space of the filter path (see arena.c). */
+
+/** @struct GraphView
+ @brief A graph with some vertices cut, read through its parent (see view.c).
+ */
+struct GraphView {
+  const igraph_t *parent;
+  long vcount; /**< vertices left. */
+  long ecount; /**< edges with both ends left. */
+  long *index; /**< view id of each parent vertex, -1 if cut. */
+  long *parent_of; /**< parent id of each view vertex. */
+};
+
+/** @struct OutBuffer
+ @brief An append buffer flushed to a stream in large writes (see buffer.c).
+ */
+struct OutBuffer {
+  FILE *stream; /**< NULL to grow in memory instead of flushing. */
+  char *data;
+  size_t len;
+  size_t cap;
+  bool failed; /**< set by the first failed write or allocation. */
+};
+
+/** Formats elements from (inclusive) to to (exclusive) of a file section
+ into buf (see out_buffer_ranges).  Returns 0 or an igraph error code. */
+typedef int (*out_format_range)(const void *arg, long from, long to, struct OutBuffer *buf);
+
+/** @struct CompressStream
+ @brief A compressed output file fed through a pipe (see compress.c).
+ */
+struct CompressStream {
+  compression_t type;
+  FILE *out; /**< the write end of the pipe, where callers write. */
+  int pipe_in; /**< the read end, drained by the worker. */
+  pthread_t worker;
+  bool started;
+  bool failed; /**< set by the worker on a failed write. */
+  void *gz; /**< the gzFile for COMPRESSION_GZIP. */
+  void *zc; /**< the ZSTD_CCtx for COMPRESSION_ZSTD. */
+  FILE *file; /**< the output file for COMPRESSION_ZSTD. */
+};
+
 /** @struct RankNode
  @brief Unimplemented struct for holding the top 20 rankids for the graph.
  */
@@ -149,9 +379,45 @@ int push(struct Node** head_ref, igraph_real_t value, char* attr);
 int pushRank (struct RankNode** head_ref, int rankids[20]);
 int igraph_i_xml_escape(char* src, char** dest);
 int pushArg (struct Argument** arg, char *value);
+void freeArgs (struct Argument** arg);
 
+int attr_table_init(struct AttrTable *table, const igraph_t *graph,
+                    igraph_attribute_elemtype_t kind);
+struct AttrColumn* attr_table_get(const struct AttrTable *table, const char *name);
+igraph_vector_t* attr_table_numeric(const struct AttrTable *table, const char *name);
+igraph_strvector_t* attr_table_string(const struct AttrTable *table, const char *name);
+void attr_table_destroy(struct AttrTable *table);
+int arena_reserve(struct Arena *arena, size_t bytes);
+void* arena_alloc(struct Arena *arena, size_t bytes);
+void* arena_calloc(struct Arena *arena, size_t count, size_t size);
+int arena_vector(struct Arena *arena, igraph_vector_t *v, long length);
+struct ArenaMark arena_mark(struct Arena *arena);
+void arena_release(struct Arena *arena, struct ArenaMark mark);
+int arena_reset(struct Arena *arena);
+void arena_free(struct Arena *arena);
+int view_init(struct GraphView *view, const igraph_t *parent, const double *cut, long cutsize);
+int view_degree(const struct GraphView *view, igraph_neimode_t mode, igraph_vector_t *res);
+igraph_real_t view_density(const struct GraphView *view);
+igraph_real_t view_reciprocity(const struct GraphView *view);
+igraph_real_t view_centralization(const struct GraphView *view, igraph_vector_t *scores);
+int view_materialize(const struct GraphView *view, igraph_t *res, const char *attrs);
+int view_output(const struct GraphView *view, igraph_t *res, const char *attrs);
+void out_buffer_init(struct OutBuffer *buf, FILE *stream);
+void out_buffer_write(struct OutBuffer *buf, const char *data, size_t len);
+void out_buffer_puts(struct OutBuffer *buf, const char *s);
+void out_buffer_printf(struct OutBuffer *buf, const char *format, ...);
+void out_buffer_long(struct OutBuffer *buf, long value);
+void out_buffer_g(struct OutBuffer *buf, igraph_real_t value);
+void out_buffer_f(struct OutBuffer *buf, igraph_real_t value);
+int out_buffer_xml(struct OutBuffer *buf, const char *s);
+void out_buffer_json(struct OutBuffer *buf, const char *s);
+int out_buffer_flush(struct OutBuffer *buf);
+int out_buffer_destroy(struct OutBuffer *buf);
+int out_buffer_ranges(struct OutBuffer *buf, long count, long threads,
+                      out_format_range format, const void *arg);
 int igraph_write_graph_gexf(const igraph_t *graph, FILE *outstream,
                             igraph_bool_t prefixattr);
+int write_graph_sigma(const igraph_t *graph, FILE *outstream, const char *attrs);
 igraph_real_t mean_vector (igraph_vector_t *v1);
 igraph_real_t variance_vector (igraph_vector_t *v1);
 igraph_real_t std_vector(igraph_vector_t *v1);
@@ -159,7 +425,12 @@ igraph_real_t std_error_vector(igraph_vector_t *v1);
 igraph_real_t t_stat_vector(igraph_vector_t *v1);
 igraph_real_t t_test_vector(igraph_vector_t *v1, igraph_real_t df);
 
-int rankCompare(igraph_t *g1, igraph_t *g2, char* attr, igraph_real_t* result_pv, igraph_real_t* result_ts );
+int idref_index(const igraph_t *graph, long int size, igraph_vector_long_t *index);
+int rank_compare_vectors(const igraph_vector_t *largeRank, const igraph_vector_t *idRef,
+                         igraph_vector_t *smallRank, const igraph_vector_long_t *index,
+                         igraph_real_t *result_pv, igraph_real_t *result_ts);
+int rankCompare(igraph_t *g1, igraph_t *g2, char* attr, igraph_vector_long_t *index,
+                igraph_real_t* result_pv, igraph_real_t* result_ts );
 /** Writes the report. **/
 int write_report(igraph_t *graph);
 int colors (igraph_t *graph);
@@ -167,12 +438,63 @@ int layout_graph(igraph_t *graph, char layout);
 int set_size(igraph_t *graph, igraph_vector_t *v, int max);
 
 int strip_ext(char *fname);
+long io_threads();
+uint64_t fnv_hash(uint64_t hash, const void *data, size_t len);
+double now_ms();
 int load_graph (char* filename);
+bool is_csv_input(const char *path);
+int load_csv(const char *path, igraph_t *graph);
+int load_graphml_mmap(const char *filename, igraph_t *graph);
+int load_graphml_libxml(const char *filename, igraph_t *graph);
+int load_graphml_buffer(const char *data, size_t size, igraph_t *graph);
+int write_graph_graphml(const igraph_t *graph, FILE *outstream, igraph_bool_t prefixattr);
+int parse_compression(char *arg);
+const char* compression_ext(compression_t type);
+int detect_compression(const char *filename);
+int decompress_file(const char *filename, compression_t type, char **data,
+                    size_t *size);
+FILE* compress_stream_open(struct CompressStream *cs, const char *path,
+                           compression_t type, int level);
+int compress_stream_close(struct CompressStream *cs);
+int parse_format(char *arg);
+const char* output_attrs();
+bool attr_is_viz(const char *name, igraph_attribute_elemtype_t kind);
+bool attr_wanted(const char *attrs, const char *name, igraph_attribute_elemtype_t kind);
+int parse_attrs(char *arg);
+int project_attributes(const igraph_t *graph, igraph_t *res, const char *attrs);
+int node_key_parse(const char *text, long len, struct NodeKey *key);
+void node_key_format(const struct NodeKey *key, char *text);
+bool is_node_key_attr(const char *name);
+bool has_node_keys(const igraph_t *graph);
+int set_node_keys(igraph_t *graph, const struct NodeKey *keys, long n);
+int get_node_keys(const igraph_t *graph, struct NodeKey *keys);
+int copy_node_ids(const igraph_t *from, igraph_t *to, const long *keep, long count);
+FILE* open_output(const char *path, struct CompressStream *cs);
+int close_output(FILE *fp, struct CompressStream *cs);
+int format_graph(igraph_t *graph, FILE *fp);
 int write_graph(igraph_t *graph, char *attr);
+int write_queue_push(const char *path, char *data, size_t size);
+int write_queue_finish();
+int run_batch(char *list, char *outdir, bool cache);
+long input_size(const char *path);
+size_t graph_memory(igraph_t *graph);
+void metric_cost(metric_t metric, long n, long m, double *ops, double *bytes);
+double metric_ns(metric_t metric);
+int estimate_cost(igraph_t *graph, long input_bytes, struct CostEstimate *est);
+int cost_check(igraph_t *graph, const char *input, struct CostEstimate *est);
+void print_cost(FILE *fp, const struct CostEstimate *est);
+int run_server(char *socket_path, long cache_mb, bool cache);
+int stream_output(FILE *out, const char *name, const char *data, size_t size);
 int produceRank(igraph_vector_t *source, igraph_vector_t *vector);
+int rank_vector(const igraph_vector_t *source, igraph_vector_t *ranks, rank_ties_t ties);
+int rank_attribute(igraph_t *graph, char *attr, rank_ties_t ties);
 int create_graph_csv(char* filepath, int start, int perc);
+int sweep_graph(int start, int end, int step);
 int paired_t_stat (igraph_vector_t *v1, igraph_vector_t *v2, igraph_real_t *pv, igraph_real_t *ts);
 int calc_betweenness(igraph_t *graph);
+int parse_betweenness_mode(char *arg);
+long betweenness_samples(const igraph_t *graph);
+long betweenness_sources(long n);
 int calc_authority(igraph_t *graph);
 int calc_hub(igraph_t *graph);
 int calc_pagerank(igraph_t *graph);
@@ -183,12 +505,51 @@ int calc_degree(igraph_t *graph, char type);
 int calc_modularity(igraph_t *graph);
 int centralization(igraph_t *graph, char* attr);
 int analysis_all (igraph_t *graph);
+int parse_distance_mode(char *arg);
+int anf_neighbourhood(const igraph_t *graph, int bits, igraph_vector_t *nf);
+int anf_path_stats(const igraph_t *graph, int bits, igraph_real_t *avg,
+                   igraph_real_t *effective, igraph_integer_t *lower,
+                   igraph_vector_t *dist);
+char* anf_format_distribution(igraph_vector_t *dist);
+int estimate_distances(igraph_t *graph, igraph_real_t *avg, igraph_real_t *diameter);
+int analysis_planned (igraph_t *graph, metric_plan_t plan);
+metric_plan_t plan_closure(metric_plan_t plan);
+metric_plan_t plan_method(char method);
+const char* metric_name(metric_t metric);
+metric_plan_t plan_base(char* methods, bool save, bool report, bool compare);
+metric_plan_t plan_derivative(bool save, bool report, bool compare);
+int plan_run(bool compare);
+metric_plan_t plan_missing(const igraph_t *graph, metric_plan_t plan);
+int plan_drop_stale(igraph_t *graph, metric_plan_t plan);
+uint64_t graph_fingerprint(const igraph_t *graph);
+int save_metric_cache(const igraph_t *graph, char *path);
+int load_metric_cache(igraph_t *graph, char *path);
+char* snapshot_path(const char *input, const char *output);
+int save_snapshot(const igraph_t *graph, const char *path, bool metrics);
+int load_snapshot(const char *filename, igraph_t *graph, uint64_t *metrics, bool verify);
+int convert_graph(char *path);
 int quickrunGraph();
 
 float fix_percentile();
-int create_filtered_graph(igraph_t *graph, double cutoff, int cutsize, char* attr);
-int shrink (igraph_t *graph, int cutsize, char* attr);
+int create_filtered_graph(igraph_t *graph, double cutoff, int cutsize, char* attr,
+                          struct FilterResult *result);
+int select_cut(igraph_t *graph, double cutoff, int cutsize, char* attr, double *cut);
+int filter_by_cut(igraph_t *graph, double *cut, int cutsize, char* attr,
+                  struct FilterResult *result);
+int prepare_method_orders(igraph_t *graph, char* methods);
+int clear_method_orders();
+int build_filter_index(igraph_t *graph, double *cut, int cutsize, igraph_vector_long_t *index);
+int shrink (igraph_t *graph, int cutsize, char* attr, struct FilterResult *result);
+int push_result(struct FilterResult *result, char* attr);
+int clear_report();
 int runFilters (igraph_t *graph, int cutsize);
+int filter_cutsize();
+long filter_jobs (int count);
+char* method_attr (char method);
+int analyze_base_graph();
+int filter_analyze();
+int filter_run();
+int filter_report();
 int filter_graph();
 
 #endif
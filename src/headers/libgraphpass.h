@@ -0,0 +1,68 @@
+/*
+ * GraphPass:
+ * A utility to filter networks and provide a default visualization output
+ * for Gephi or SigmaJS.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** @file libgraphpass.h
+ @brief The embedding API of libgraphpass (see libgraphpass.c).
+
+ A gp_context owns a graph and every option and result of the runs made on
+ it.  Options take the names and values of the graphpass command line
+ flags, without the dashes:
+
+     gp_context *ctx = gp_create();
+     gp_set(ctx, "methods", "dp");
+     gp_set(ctx, "percent", "20");
+     if (gp_load(ctx, "in.graphml", "out/") != 0
+         || gp_analyze(ctx) != 0 || gp_filter(ctx) != 0 || gp_write(ctx) != 0) {
+       fprintf(stderr, "%s\n", gp_error(ctx));
+     }
+     gp_destroy(ctx);
+
+ Every function returns 0 on success and -1 on failure, with the reason
+ in gp_error.  Contexts give isolation, not concurrency: any number may
+ exist at once and none sees another's state between calls, but calls
+ on them run one at a time, because the modules and igraph 0.7 keep their
+ state in globals.  A context can be called any number of times; setting
+ an option again replaces its value.  Filtering several graphs at the same time needs several
+ processes (gp_batch).  The graphpass binary uses nothing but this API.
+ */
+
+#ifndef LIBGRAPHPASS_H
+#define LIBGRAPHPASS_H
+
+#include <stdio.h>
+#include <igraph.h>
+
+typedef struct gp_context gp_context;
+
+gp_context* gp_create(void);
+void gp_destroy(gp_context *ctx);
+int gp_set(gp_context *ctx, const char *option, const char *value);
+const char* gp_error(const gp_context *ctx);
+const char* gp_output(const gp_context *ctx);
+int gp_load(gp_context *ctx, const char *input, const char *output);
+igraph_t* gp_graph(gp_context *ctx);
+int gp_check(gp_context *ctx, FILE *estimate);
+int gp_analyze(gp_context *ctx);
+int gp_filter(gp_context *ctx);
+int gp_write(gp_context *ctx);
+int gp_sweep(gp_context *ctx, int start, int end, int step);
+int gp_convert(gp_context *ctx, const char *input, const char *snapshot);
+int gp_batch(gp_context *ctx, const char *list, const char *outdir);
+int gp_serve(gp_context *ctx, const char *socket, long cache_mb);
+
+#endif
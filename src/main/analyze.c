@@ -219,9 +219,159 @@ int paired_t_stat (igraph_vector_t *v1, igraph_vector_t *v2, igraph_real_t *pv,
 }
 
 
+/** Parses the --betweenness argument into ug_bmode.
+
+ Accepts "exact", "approx:k" (sample k source vertices) or "eps:e" (sample
+ enough sources that normalized betweenness is within e of the exact value
+ with probability 1 - BETWEENNESS_DELTA).
+
+ @param arg - the option argument.
+ @return 0, or -1 if arg is not understood.
+ */
+int parse_betweenness_mode(char *arg) {
+  long k;
+  double eps;
+  if (strcmp(arg, "exact") == 0) {
+    ug_bmode = BETWEENNESS_EXACT;
+    return 0;
+  }
+  if (sscanf(arg, "approx:%ld", &k) == 1 && k > 0) {
+    ug_bmode = BETWEENNESS_SAMPLE;
+    ug_bsamples = k;
+    return 0;
+  }
+  if (sscanf(arg, "eps:%lf", &eps) == 1 && eps > 0 && eps < 1) {
+    ug_bmode = BETWEENNESS_EPSILON;
+    ug_bepsilon = eps;
+    return 0;
+  }
+  return -1;
+}
+
+/** Returns the number of source vertices calc_betweenness samples for graph.
+
+ @param graph - the graph to be measured.
+ @return see betweenness_sources.
+ */
+long betweenness_samples(const igraph_t *graph) {
+  return betweenness_sources(igraph_vcount(graph));
+}
+
+/** Returns the number of source vertices calc_betweenness samples for a
+ graph of n vertices.
+
+ In eps mode this is the Hoeffding bound ln(2n/delta) / (2 eps^2): each
+ source contributes a dependency of at most n-2 to a vertex, so the mean
+ over that many sources puts every vertex (union bound over n) within eps
+ of its normalized betweenness with probability 1 - delta.
+
+ @param n - the number of vertices.
+ @return the number of sources, or n if sampling would not save anything
+ (in which case the exact algorithm is used).
+ */
+long betweenness_sources(long n) {
+  long k = n;
+  if (ug_bmode == BETWEENNESS_SAMPLE) {
+    k = ug_bsamples;
+  } else if (ug_bmode == BETWEENNESS_EPSILON && n > 0) {
+    k = (long) ceil(log(2.0 * n / BETWEENNESS_DELTA)
+                    / (2.0 * ug_bepsilon * ug_bepsilon));
+  }
+  return k < n ? k : n;
+}
+
+/** Estimates betweenness from k randomly sampled sources (Brandes-Pich).
+
+ Runs the Brandes dependency accumulation from each sampled source over
+ unweighted shortest paths and scales the sums by n/k, so the estimate is
+ unbiased and equal to igraph_betweenness when k = n.
+
+ @param graph - the graph to be measured.
+ @param k - the number of sources to sample.
+ @param res - an initialized vector of size vcount, receives the estimate.
+ @return 0 unless an error occurs.
+ */
+static int betweenness_sampled(const igraph_t *graph, long k, igraph_vector_t *res) {
+  long n = igraph_vcount(graph);
+  igraph_adjlist_t adj;
+  igraph_adjlist_init(graph, &adj, IGRAPH_OUT);
+  long *sources = (long*) malloc(n * sizeof(long));
+  long *order = (long*) malloc(n * sizeof(long));
+  long *dist = (long*) malloc(n * sizeof(long));
+  double *sigma = (double*) malloc(n * sizeof(double));
+  double *delta = (double*) malloc(n * sizeof(double));
+  if (!sources || !order || !dist || !sigma || !delta) {
+    free(sources); free(order); free(dist); free(sigma); free(delta);
+    igraph_adjlist_destroy(&adj);
+    IGRAPH_ERROR("Cannot allocate betweenness buffers", IGRAPH_ENOMEM);
+  }
+  igraph_vector_null(res);
+  for (long i=0; i<n; i++) {
+    sources[i] = i;
+  }
+  /* partial Fisher-Yates: the first k entries are the sample */
+  RNG_BEGIN();
+  for (long i=0; i<k; i++) {
+    long j = RNG_INTEGER(i, n-1);
+    long tmp = sources[i];
+    sources[i] = sources[j];
+    sources[j] = tmp;
+  }
+  RNG_END();
+  for (long si=0; si<k; si++) {
+    long s = sources[si];
+    for (long i=0; i<n; i++) {
+      dist[i] = -1;
+      sigma[i] = 0;
+      delta[i] = 0;
+    }
+    dist[s] = 0;
+    sigma[s] = 1;
+    long head = 0, tail = 0;
+    order[tail++] = s;
+    while (head < tail) {
+      long v = order[head++];
+      igraph_vector_int_t *neis = igraph_adjlist_get(&adj, v);
+      long nlen = igraph_vector_int_size(neis);
+      for (long j=0; j<nlen; j++) {
+        long w = VECTOR(*neis)[j];
+        if (dist[w] < 0) {
+          dist[w] = dist[v] + 1;
+          order[tail++] = w;
+        }
+        if (dist[w] == dist[v] + 1) {
+          sigma[w] += sigma[v];
+        }
+      }
+    }
+    /* BFS order reversed visits every vertex after its successors */
+    for (long i=tail-1; i>=0; i--) {
+      long v = order[i];
+      igraph_vector_int_t *neis = igraph_adjlist_get(&adj, v);
+      long nlen = igraph_vector_int_size(neis);
+      for (long j=0; j<nlen; j++) {
+        long w = VECTOR(*neis)[j];
+        if (dist[w] == dist[v] + 1) {
+          delta[v] += sigma[v] / sigma[w] * (1 + delta[w]);
+        }
+      }
+      if (v != s) {
+        VECTOR(*res)[v] += delta[v];
+      }
+    }
+  }
+  /* undirected paths are counted once from each end */
+  double scale = (double) n / k / (igraph_is_directed(graph) ? 1.0 : 2.0);
+  igraph_vector_scale(res, scale);
+  free(sources); free(order); free(dist); free(sigma); free(delta);
+  igraph_adjlist_destroy(&adj);
+  return 0;
+}
+
 /** Calculates betweenness scores for the individual nodes in a graph
 
-  Betweenness is measured
+  Betweenness is measured exactly, or estimated from sampled sources when
+  --betweenness asks for approx:k or eps:e (see betweenness_samples).
 
   @param graph - the graph for which to record the scores.
   @return 0 unless error occurs.
@@ -230,7 +380,12 @@ extern int calc_betweenness(igraph_t *graph){
   char *attr = "Betweenness";
   igraph_vector_t v;
   igraph_vector_init(&v, igraph_vcount(graph));
-  igraph_betweenness(graph, &v, igraph_vss_all(), igraph_is_directed(graph), NULL, 1);
+  long k = betweenness_samples(graph);
+  if (ug_bmode != BETWEENNESS_EXACT && k < igraph_vcount(graph)) {
+    betweenness_sampled(graph, k, &v);
+  } else {
+    igraph_betweenness(graph, &v, igraph_vss_all(), igraph_is_directed(graph), NULL, 1);
+  }
   SETVANV(graph, attr, &v);
   igraph_vector_destroy(&v);
   return 0;
@@ -285,7 +440,7 @@ extern int calc_pagerank(igraph_t *graph){
   igraph_vector_t v;
   igraph_vector_init(&v, igraph_vcount(graph));
   igraph_pagerank(graph, IGRAPH_PAGERANK_ALGO_PRPACK, &v, 0,
-                  igraph_vss_all(), 1, 0.85, 0, 0);
+                  igraph_vss_all(), 1, PAGERANK_DAMPING, 0, 0);
   SETVANV(graph, attr, &v);
   igraph_vector_destroy(&v);
   return 0;
@@ -364,7 +519,7 @@ extern int calc_modularity(igraph_t *graph) {
   igraph_vector_init(&classes, 0);
   igraph_vector_init(&v, 0);
   igraph_matrix_init(&merges, 0, 0);
-  igraph_community_walktrap(graph, 0 /* no weights */, 4 /* steps */, &merges,
+  igraph_community_walktrap(graph, 0 /* no weights */, WALKTRAP_STEPS, &merges,
     &v, &classes);
   SETVANV(graph, attr, &classes);
   igraph_vector_destroy(&v);
@@ -405,46 +560,6 @@ extern int centralization(igraph_t *graph, char* attr) {
   return 0;
 }
 
-/** Creates a rank-order from a vector of values
-
- produceRank taks a source vector and produces ranks for the values in the
- that they occur in source.
- @param source - An igraph vector containing the source data to rank.
- @param vector - An initialized igraph_vector_t to contain the ranks.
- **/
-
-int produceRank(igraph_vector_t *source, igraph_vector_t *v) {
-  long int source_size;
-  source_size = igraph_vector_size(source);
-  igraph_vector_t source_cpy, rank_vals;
-  igraph_vector_init(&rank_vals, source_size);
-  igraph_vector_copy(&source_cpy, source);
-  igraph_vector_sort(&source_cpy);
-  igraph_vector_reverse(&source_cpy);
-  for (long int i=0; i < source_size; i++){
-    if (i == 0) {
-      VECTOR(rank_vals)[0] = 1;
-    } else if (VECTOR(source_cpy)[i] == VECTOR(source_cpy)[i-1]) {
-      VECTOR(rank_vals)[i] = VECTOR(rank_vals)[i-1];
-    } else {
-      VECTOR(rank_vals)[i] = i+1;
-    }
-  }
-  for (long int i=0; i < source_size; i++) {
-    for (long int j=0; j < source_size; j++) {
-      if (igraph_vector_e(source, i) == igraph_vector_e(&source_cpy,j)) {
-        //igraph_vector_set(v, i, VECTOR(rank_vals)[j]);
-        VECTOR(*v)[i] = VECTOR(rank_vals)[j];
-        break;
-      }
-    }
-  }
-  igraph_vector_destroy(&rank_vals);
-  igraph_vector_destroy(&source_cpy);
-  return 0;
-}
-
-
 /** Calculates the main analysis scores for the graph
 
  analysis_all conducts all available graph, node and edge scores available
@@ -454,80 +569,190 @@ int produceRank(igraph_vector_t *source, igraph_vector_t *v) {
  @param graph - the graph for which to record the scores.
  */
 extern int analysis_all (igraph_t *graph) {
-  calc_authority(graph);
-  calc_betweenness(graph);
-  calc_degree(graph, 'd');
-  igraph_vector_t deg, rank;
-  igraph_vector_init(&deg, igraph_vcount(graph));
-  igraph_vector_init(&rank, igraph_vcount(graph));
-  VANV(graph, "Degree", &deg);
-  produceRank(&deg, &rank);
-  SETVANV(graph, "DegreeRank", &rank);
-  igraph_vector_destroy(&deg);
-  igraph_vector_destroy(&rank);
-  calc_hub(graph);
-  calc_degree(graph, 'i');
-  calc_degree(graph, 'o');
-  calc_eigenvector(graph);
-  calc_pagerank (graph);
-  igraph_real_t pathl, cluster, assort, dens, recip;
-  igraph_integer_t dia;
-  igraph_vector_t mod;
-  igraph_vector_init (&mod, igraph_vcount(graph));
-  igraph_average_path_length(graph, &pathl, 1, 1);
-  igraph_diameter(graph, &dia, NULL, NULL, NULL ,1, 1);
-  igraph_transitivity_undirected(graph, &cluster, IGRAPH_TRANSITIVITY_ZERO);
-  calc_modularity(graph);
-  VANV(graph, "WalkTrapModularity", &mod);
-  igraph_assortativity_nominal(graph, &mod, &assort, 1);
-  igraph_density(graph, &dens, 0);
-  igraph_reciprocity(graph, &recip, 1, IGRAPH_RECIPROCITY_DEFAULT);
+  return analysis_planned(graph, PLAN_ANALYSIS_ALL);
+}
+
+/** Calculates the scores in a plan (see planner.c).
+
+ Computes the same scores as analysis_all, in the same order, but skips
+ those not in plan.  The plan should already include its dependencies
+ (see plan_closure).
+
+ @param graph - the graph for which to record the scores.
+ @param plan - the metrics to compute.
+ */
+int analysis_planned (igraph_t *graph, metric_plan_t plan) {
+  if (PLAN_HAS(plan, MET_AUTHORITY)) {
+    calc_authority(graph);
+  }
+  if (PLAN_HAS(plan, MET_BETWEENNESS)) {
+    calc_betweenness(graph);
+  }
+  if (PLAN_HAS(plan, MET_DEGREE)) {
+    calc_degree(graph, 'd');
+  }
+  if (PLAN_HAS(plan, MET_DEGREE_RANK)) {
+    rank_attribute(graph, "Degree", RANK_COMPETITION);
+  }
+  if (PLAN_HAS(plan, MET_HUB)) {
+    calc_hub(graph);
+  }
+  if (PLAN_HAS(plan, MET_INDEGREE)) {
+    calc_degree(graph, 'i');
+  }
+  if (PLAN_HAS(plan, MET_OUTDEGREE)) {
+    calc_degree(graph, 'o');
+  }
+  if (PLAN_HAS(plan, MET_EIGENVECTOR)) {
+    calc_eigenvector(graph);
+  }
+  if (PLAN_HAS(plan, MET_PAGERANK)) {
+    calc_pagerank (graph);
+  }
+  igraph_real_t pathl, cluster, assort, dens, recip, dia;
+  if (ug_anf_bits > 0 && (PLAN_HAS(plan, MET_PATH_LENGTH) || PLAN_HAS(plan, MET_DIAMETER))) {
+    estimate_distances(graph, &pathl, &dia);
+  } else {
+    if (PLAN_HAS(plan, MET_PATH_LENGTH)) {
+      igraph_average_path_length(graph, &pathl, 1, 1);
+    }
+    if (PLAN_HAS(plan, MET_DIAMETER)) {
+      igraph_integer_t d;
+      igraph_diameter(graph, &d, NULL, NULL, NULL ,1, 1);
+      dia = d;
+    }
+  }
+  if (PLAN_HAS(plan, MET_CLUSTERING)) {
+    igraph_transitivity_undirected(graph, &cluster, IGRAPH_TRANSITIVITY_ZERO);
+  }
+  if (PLAN_HAS(plan, MET_MODULARITY)) {
+    calc_modularity(graph);
+  }
+  if (PLAN_HAS(plan, MET_ASSORTATIVITY)) {
+    igraph_vector_t mod;
+    igraph_vector_init (&mod, igraph_vcount(graph));
+    VANV(graph, "WalkTrapModularity", &mod);
+    igraph_assortativity_nominal(graph, &mod, &assort, 1);
+    igraph_vector_destroy(&mod);
+  }
+  if (PLAN_HAS(plan, MET_DENSITY)) {
+    igraph_density(graph, &dens, 0);
+  }
+  if (PLAN_HAS(plan, MET_RECIPROCITY)) {
+    igraph_reciprocity(graph, &recip, 1, IGRAPH_RECIPROCITY_DEFAULT);
+  }
   SETGAN(graph, "NODES", igraph_vcount(graph));
   SETGAN(graph, "EDGES", igraph_ecount(graph));
-  SETGAN(graph, "AVG_PATH_LENGTH", pathl);
-  SETGAN(graph, "DIAMETER", dia);
-  SETGAN(graph, "OVERALL_CLUSTERING", cluster);
-  SETGAN(graph, "ASSORTATIVITY", assort);
-  SETGAN(graph, "DENSITY", dens);
-  SETGAN(graph, "RECIPROCITY", recip);
-  centralization(graph, "Authority");
-  centralization(graph, "Betweenness");
-  centralization(graph, "Degree");
-  centralization(graph, "Hub");
-  centralization(graph, "Indegree");
-  centralization(graph, "Outdegree");
-  centralization(graph, "Eigenvector");
-  centralization(graph, "PageRank");
-  igraph_vector_destroy(&mod);
-  igraph_vector_destroy(&rank);
+  if (PLAN_HAS(plan, MET_PATH_LENGTH)) {
+    SETGAN(graph, "AVG_PATH_LENGTH", pathl);
+  }
+  if (PLAN_HAS(plan, MET_DIAMETER)) {
+    SETGAN(graph, "DIAMETER", dia);
+  }
+  if (PLAN_HAS(plan, MET_CLUSTERING)) {
+    SETGAN(graph, "OVERALL_CLUSTERING", cluster);
+  }
+  if (PLAN_HAS(plan, MET_ASSORTATIVITY)) {
+    SETGAN(graph, "ASSORTATIVITY", assort);
+  }
+  if (PLAN_HAS(plan, MET_DENSITY)) {
+    SETGAN(graph, "DENSITY", dens);
+  }
+  if (PLAN_HAS(plan, MET_RECIPROCITY)) {
+    SETGAN(graph, "RECIPROCITY", recip);
+  }
+  if (PLAN_HAS(plan, MET_C_AUTHORITY)) {
+    centralization(graph, "Authority");
+  }
+  if (PLAN_HAS(plan, MET_C_BETWEENNESS)) {
+    centralization(graph, "Betweenness");
+  }
+  if (PLAN_HAS(plan, MET_C_DEGREE)) {
+    centralization(graph, "Degree");
+  }
+  if (PLAN_HAS(plan, MET_C_HUB)) {
+    centralization(graph, "Hub");
+  }
+  if (PLAN_HAS(plan, MET_C_INDEGREE)) {
+    centralization(graph, "Indegree");
+  }
+  if (PLAN_HAS(plan, MET_C_OUTDEGREE)) {
+    centralization(graph, "Outdegree");
+  }
+  if (PLAN_HAS(plan, MET_C_EIGENVECTOR)) {
+    centralization(graph, "Eigenvector");
+  }
+  if (PLAN_HAS(plan, MET_C_PAGERANK)) {
+    centralization(graph, "PageRank");
+  }
   return 0;
 }
 
-int create_graph_csv(char* filepath, int start, int perc) {
+/** Appends the Degree rank p-value of each method to GRAPH/graph_report.csv
+ for a range of percentages.
+
+ The global graph is analyzed once and each method's vertices are sorted
+ once (see prepare_method_orders); each percentage then only filters and
+ analyzes the derivative graphs.
+
+ @param start - the first percentage.
+ @param end - the last percentage (inclusive).
+ @param step - the distance between percentages.
+ @return 0 unless an error occurs.
+ */
+int sweep_graph(int start, int end, int step) {
   struct stat st = {0};
+  if (step < 1) {
+    step = 1;
+  }
   if (stat("GRAPH/", &st) == -1) {
     mkdir("GRAPH/", 0700);
   }
   FILE *fs;
   fs = fopen("GRAPH/graph_report.csv", "a");
+  if (fs == NULL) {
+    if (!ug_TEST) {
+      fprintf(stderr, ">>> FAILURE - Could not open GRAPH/graph_report.csv.\n");
+    }
+    return -1;
+  }
   fprintf(fs, "| perc       | Authority  | Betweenness | Degree      | Eigenvector | Hub         | Indegree    | OutDegree   | PageRank    |  Random      |\n");
-
-  for (int i=start; i<perc; i++) {
-    ug_report = false;
-    ug_save = false;
+  ug_report = false;
+  ug_save = false;
+  ug_methods = ALL_METHODS;
+  ug_OUTPUT = "GRAPH/";
+  plan_run(true);
+  analyze_base_graph();
+  arena_reserve(&ug_scratch, FILTER_SCRATCH_BYTES(NODESIZE, igraph_ecount(&g)));
+  prepare_method_orders(&g, ug_methods);
+  for (int i=start; i<=end; i+=step) {
     ug_percent = i;
-    ug_methods = ALL_METHODS;
-    ug_OUTPUT = "GRAPH/";
-    load_graph(filepath);
-    filter_graph();
+    runFilters(&g, filter_cutsize());
     fprintf(fs, "|%-5i|", i);
-    while (pv != NULL) {
-      fprintf(fs, "%-13f|", pv->val);
-      pv = pv->next;
+    for (struct Node* node = pv; node != NULL; node = node->next) {
+      fprintf(fs, "%-13f|", node->val);
     }
     fprintf(fs, "\n");
-    pv = EmptyNode;
+    clear_report();
   }
+  clear_method_orders();
+  arena_free(&ug_scratch);
   fclose(fs);
   return 0;
 }
+
+/** Loads a graph and sweeps percentages start to perc - 1 (see sweep_graph).
+
+ @param filepath - the graph to load.
+ @param start - the first percentage.
+ @param perc - one past the last percentage.
+ @return 0 unless an error occurs.
+ */
+int create_graph_csv(char* filepath, int start, int perc) {
+  if (load_graph(filepath) != 0) {
+    return -1;
+  }
+  sweep_graph(start, perc - 1, 1);
+  igraph_destroy(&g);
+  return 0;
+}
@@ -0,0 +1,253 @@
+/*
+ * GraphPass:
+ * A utility to filter networks and provide a default visualization output
+ * for Gephi or SigmaJS.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** @file anf.c
+ @brief Estimates path lengths with the HyperANF neighbourhood function.
+
+ Every vertex keeps a HyperLogLog counter of the vertices it can reach.  At
+ step t each counter is merged with those of its out-neighbours, so it then
+ counts the ball of radius t around the vertex.  Summing the counters gives
+ the neighbourhood function N(t), the number of pairs within distance t,
+ from which the distance distribution, average path length and diameter
+ follow.  Each step is O(m * 2^bits), and the number of steps is the
+ diameter, so this is near-linear where igraph's all-pairs BFS is O(nm).
+
+ With 2^bits registers the relative standard error of each counter is about
+ 1.04 / sqrt(2^bits).  See Boldi, Rosa and Vigna, "HyperANF: Approximating
+ the Neighbourhood Function of Very Large Graphs on a Budget" (2011).
+ */
+
+#include <graphpass.h>
+
+/** Mixes a vertex id into a well-distributed 64-bit hash (splitmix64). */
+static uint64_t anf_hash(uint64_t x) {
+  x += 0x9e3779b97f4a7c15ULL;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+/** Estimates the size of the set held by one counter. */
+static double anf_count(const uint8_t *reg, long m) {
+  double alpha = m == 16 ? 0.673 : m == 32 ? 0.697 : m == 64 ? 0.709
+    : 0.7213 / (1 + 1.079 / m);
+  double sum = 0;
+  long zeros = 0;
+  for (long i=0; i<m; i++) {
+    sum += ldexp(1.0, -reg[i]);
+    if (reg[i] == 0) {
+      ++zeros;
+    }
+  }
+  double est = alpha * m * m / sum;
+  /* small sets are counted more accurately from the empty registers */
+  if (est <= 2.5 * m && zeros > 0) {
+    est = m * log((double) m / zeros);
+  }
+  return est;
+}
+
+/** Parses the --distances argument into ug_anf_bits.
+
+ Accepts "exact" or "anf:b", where 2^b is the number of registers per
+ counter (ANF_MIN_BITS to ANF_MAX_BITS).  "anf" alone uses ANF_DEFAULT_BITS.
+
+ @param arg - the option argument.
+ @return 0, or -1 if arg is not understood.
+ */
+int parse_distance_mode(char *arg) {
+  int bits;
+  if (strcmp(arg, "exact") == 0) {
+    ug_anf_bits = 0;
+    return 0;
+  }
+  if (strcmp(arg, "anf") == 0) {
+    ug_anf_bits = ANF_DEFAULT_BITS;
+    return 0;
+  }
+  if (sscanf(arg, "anf:%d", &bits) == 1 && bits >= ANF_MIN_BITS
+      && bits <= ANF_MAX_BITS) {
+    ug_anf_bits = bits;
+    return 0;
+  }
+  return -1;
+}
+
+/** Computes the neighbourhood function of a graph with HyperANF.
+
+ @param graph - the graph to measure.  Paths follow edge direction in
+ directed graphs.
+ @param bits - log2 of the registers per counter.
+ @param nf - an initialized vector, resized so that nf[t] estimates the
+ number of ordered pairs (u,v) with d(u,v) <= t, u = v included.  Its last
+ entry is the step at which no counter changed any more.
+ @return 0 unless an error occurs.
+ */
+int anf_neighbourhood(const igraph_t *graph, int bits, igraph_vector_t *nf) {
+  long n = igraph_vcount(graph);
+  long m = 1L << bits;
+  igraph_vector_clear(nf);
+  if (n == 0) {
+    return 0;
+  }
+  uint8_t *cur = (uint8_t*) calloc(n * m, sizeof(uint8_t));
+  uint8_t *next = (uint8_t*) malloc(n * m * sizeof(uint8_t));
+  if (cur == NULL || next == NULL) {
+    free(cur);
+    free(next);
+    IGRAPH_ERROR("Cannot allocate HyperANF counters", IGRAPH_ENOMEM);
+  }
+  for (long v=0; v<n; v++) {
+    uint64_t h = anf_hash((uint64_t) v);
+    long reg = (long) (h >> (64 - bits));
+    uint64_t rest = h << bits;
+    uint8_t rank = 1;
+    while (rank <= 64 - bits && !(rest & 0x8000000000000000ULL)) {
+      ++rank;
+      rest <<= 1;
+    }
+    cur[v * m + reg] = rank;
+  }
+  igraph_adjlist_t adj;
+  igraph_adjlist_init(graph, &adj, IGRAPH_OUT);
+  /* N(0) is exactly n: every vertex reaches itself */
+  igraph_vector_push_back(nf, n);
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    memcpy(next, cur, n * m * sizeof(uint8_t));
+    double total = 0;
+    for (long v=0; v<n; v++) {
+      uint8_t *mine = next + v * m;
+      igraph_vector_int_t *neis = igraph_adjlist_get(&adj, v);
+      long nlen = igraph_vector_int_size(neis);
+      for (long j=0; j<nlen; j++) {
+        const uint8_t *theirs = cur + (long) VECTOR(*neis)[j] * m;
+        for (long r=0; r<m; r++) {
+          if (theirs[r] > mine[r]) {
+            mine[r] = theirs[r];
+            changed = true;
+          }
+        }
+      }
+      total += anf_count(mine, m);
+    }
+    if (changed) {
+      /* counters only grow, so keep N(t) monotone despite estimation noise */
+      igraph_real_t last = igraph_vector_tail(nf);
+      igraph_vector_push_back(nf, total > last ? total : last);
+    }
+    uint8_t *tmp = cur;
+    cur = next;
+    next = tmp;
+  }
+  igraph_adjlist_destroy(&adj);
+  free(cur);
+  free(next);
+  return 0;
+}
+
+/** Estimates path-length statistics of a graph with HyperANF.
+
+ The average is over connected pairs, as igraph_average_path_length does
+ with unconn set.
+
+ @param graph - the graph to measure.
+ @param bits - log2 of the registers per counter.
+ @param avg - receives the average path length.
+ @param effective - receives the effective diameter, the (interpolated)
+ distance within which 90% of connected pairs lie.
+ @param lower - receives the last step at which a counter grew.  Every such
+ step is a real distance, so this is a lower bound on the diameter.
+ @param dist - if not NULL, an initialized vector that receives the number
+ of pairs at each distance (index 0 is distance 1).
+ @return 0 unless an error occurs.
+ */
+int anf_path_stats(const igraph_t *graph, int bits, igraph_real_t *avg,
+                   igraph_real_t *effective, igraph_integer_t *lower,
+                   igraph_vector_t *dist) {
+  igraph_vector_t nf;
+  igraph_vector_init(&nf, 0);
+  anf_neighbourhood(graph, bits, &nf);
+  long steps = igraph_vector_size(&nf);
+  igraph_real_t pairs = steps > 0 ? VECTOR(nf)[steps-1] - VECTOR(nf)[0] : 0;
+  igraph_real_t sum = 0;
+  if (dist != NULL) {
+    igraph_vector_resize(dist, steps > 0 ? steps - 1 : 0);
+  }
+  *effective = 0;
+  for (long t=1; t<steps; t++) {
+    igraph_real_t at = VECTOR(nf)[t] - VECTOR(nf)[t-1];
+    sum += t * at;
+    if (dist != NULL) {
+      VECTOR(*dist)[t-1] = at;
+    }
+    igraph_real_t within = VECTOR(nf)[t] - VECTOR(nf)[0];
+    igraph_real_t before = VECTOR(nf)[t-1] - VECTOR(nf)[0];
+    if (*effective == 0 && within >= 0.9 * pairs && at > 0) {
+      *effective = (t - 1) + (0.9 * pairs - before) / at;
+    }
+  }
+  *avg = pairs > 0 ? sum / pairs : NAN;
+  *lower = steps > 0 ? steps - 1 : 0;
+  igraph_vector_destroy(&nf);
+  return 0;
+}
+
+/** Formats a distance distribution as "1:count,2:count,...".
+
+ @param dist - pairs at each distance, as returned by anf_path_stats.
+ @return a malloc'd string the caller frees.
+ */
+char* anf_format_distribution(igraph_vector_t *dist) {
+  long steps = igraph_vector_size(dist);
+  size_t len = 32 * (steps + 1);
+  char *out = (char*) malloc(len);
+  size_t used = 0;
+  out[0] = '\0';
+  for (long t=0; t<steps; t++) {
+    used += snprintf(out + used, len - used, "%s%li:%.0f", t ? "," : "",
+                     t + 1, VECTOR(*dist)[t]);
+  }
+  return out;
+}
+
+/** Estimates the path lengths of a graph with ug_anf_bits registers.
+
+ Sets the graph's EFFECTIVE_DIAMETER and DISTANCE_DISTRIBUTION attributes.
+ The caller stores avg and diameter in AVG_PATH_LENGTH and DIAMETER.
+
+ @param graph - the graph to measure.
+ @param avg - receives the average path length.
+ @param diameter - receives the diameter lower bound.
+ @return 0 unless an error occurs.
+ */
+int estimate_distances(igraph_t *graph, igraph_real_t *avg, igraph_real_t *diameter) {
+  igraph_real_t effective;
+  igraph_integer_t lower;
+  igraph_vector_t dist;
+  igraph_vector_init(&dist, 0);
+  anf_path_stats(graph, ug_anf_bits, avg, &effective, &lower, &dist);
+  *diameter = lower;
+  char *formatted = anf_format_distribution(&dist);
+  SETGAN(graph, "EFFECTIVE_DIAMETER", effective);
+  SETGAS(graph, "DISTANCE_DISTRIBUTION", formatted);
+  free(formatted);
+  igraph_vector_destroy(&dist);
+  return 0;
+}
@@ -0,0 +1,176 @@
+/*
+ * GraphPass:
+ * A utility to filter networks and provide a default visualization output
+ * for Gephi or SigmaJS.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** @file arena.c
+ @brief A bump allocator for the scratch space of the filter path.
+
+ Filtering a graph needs a handful of vertex-sized buffers per method: the
+ cut list, the shuffle buffers, the scores being sorted, the idRef index and
+ the size and degree vectors.  They used to be stack arrays, which overflow
+ the stack on large graphs, and igraph vectors allocated afresh for every
+ method.  Instead filter_graph and sweep_graph reserve ug_scratch once,
+ sized by FILTER_SCRATCH_BYTES, and each method takes its buffers from it
+ and gives them back with arena_release.
+
+ A request that does not fit starts a new block, so the arena never fails
+ for lack of reservation, and arena_reset merges the blocks into one sized
+ for the largest use seen so the next method allocates nothing.  Forked
+ workers inherit the arena and write to their own copy of its pages.
+ */
+
+#include <graphpass.h>
+
+/** Rounds n up to the arena's alignment. */
+static size_t arena_round(size_t n) {
+  return (n + ARENA_ALIGN - 1) & ~((size_t) ARENA_ALIGN - 1);
+}
+
+/** Starts a new block of at least size bytes on top of the arena.
+
+ @return 0, or -1 if it could not be allocated.
+ */
+static int arena_push(struct Arena *arena, size_t size) {
+  size = arena_round(size < ARENA_MIN_BLOCK ? ARENA_MIN_BLOCK : size);
+  struct ArenaBlock *block = malloc(sizeof(struct ArenaBlock) + size);
+  if (block == NULL) {
+    return -1;
+  }
+  block->next = arena->head;
+  block->size = size;
+  block->used = 0;
+  arena->head = block;
+  arena->reserved += size;
+  ++arena->blocks;
+  return 0;
+}
+
+/** Frees every block above the mark's. */
+static void arena_pop_to(struct Arena *arena, struct ArenaBlock *keep) {
+  while (arena->head != NULL && arena->head != keep) {
+    struct ArenaBlock *block = arena->head;
+    arena->head = block->next;
+    arena->reserved -= block->size;
+    --arena->blocks;
+    free(block);
+  }
+}
+
+/** Makes sure the arena holds at least bytes in a single block.
+
+ Anything allocated from the arena is released.
+
+ @param arena - the arena, zeroed or previously used.
+ @param bytes - the scratch space a run needs at once.
+ @return 0, or -1 if the memory could not be allocated.
+ */
+int arena_reserve(struct Arena *arena, size_t bytes) {
+  arena->peak = arena->peak > bytes ? arena->peak : bytes;
+  return arena_reset(arena);
+}
+
+/** Returns aligned space for bytes from the arena.
+
+ @return the space, or NULL if a new block was needed and could not be
+ allocated.
+ */
+void* arena_alloc(struct Arena *arena, size_t bytes) {
+  bytes = arena_round(bytes > 0 ? bytes : 1);
+  if (arena->head == NULL || arena->head->size - arena->head->used < bytes) {
+    size_t grow = arena->head != NULL ? arena->head->size : 0;
+    if (arena_push(arena, bytes > grow ? bytes : grow) != 0) {
+      return NULL;
+    }
+  }
+  void *ptr = arena->head->data + arena->head->used;
+  arena->head->used += bytes;
+  arena->used += bytes;
+  arena->peak = arena->used > arena->peak ? arena->used : arena->peak;
+  return ptr;
+}
+
+/** Returns zeroed space for count items of size bytes from the arena. */
+void* arena_calloc(struct Arena *arena, size_t count, size_t size) {
+  void *ptr = arena_alloc(arena, count * size);
+  if (ptr != NULL) {
+    memset(ptr, 0, count * size);
+  }
+  return ptr;
+}
+
+/** Points an igraph vector at length doubles of arena space.
+
+ The vector is a view: VANV and the other attribute getters may shrink it,
+ but it must not grow past length or be destroyed.  It is given back with
+ the rest of the arena.
+
+ @return 0, or -1 if the space could not be allocated.
+ */
+int arena_vector(struct Arena *arena, igraph_vector_t *v, long length) {
+  igraph_real_t *data = arena_calloc(arena, length > 0 ? length : 1, sizeof(igraph_real_t));
+  if (data == NULL) {
+    return -1;
+  }
+  igraph_vector_view(v, data, length);
+  return 0;
+}
+
+/** Records the arena's position, to give back what is allocated after it. */
+struct ArenaMark arena_mark(struct Arena *arena) {
+  struct ArenaMark mark;
+  mark.block = arena->head;
+  mark.used = arena->head != NULL ? arena->head->used : 0;
+  mark.total = arena->used;
+  return mark;
+}
+
+/** Gives back everything allocated since the mark was taken.
+
+ Blocks started after the mark are freed; arena_reset folds their size into
+ the next reservation.
+ */
+void arena_release(struct Arena *arena, struct ArenaMark mark) {
+  arena_pop_to(arena, mark.block);
+  if (arena->head != NULL) {
+    arena->head->used = mark.used;
+  }
+  arena->used = mark.total;
+}
+
+/** Gives back everything and leaves one block as large as the most the
+ arena has held at once.
+
+ @return 0, or -1 if that block could not be allocated.
+ */
+int arena_reset(struct Arena *arena) {
+  size_t want = arena_round(arena->peak);
+  if (arena->blocks == 1 && arena->head->size >= want) {
+    arena->head->used = 0;
+    arena->used = 0;
+    return 0;
+  }
+  arena_pop_to(arena, NULL);
+  arena->used = 0;
+  return want > 0 ? arena_push(arena, want) : 0;
+}
+
+/** Frees the arena's blocks and forgets its peak. */
+void arena_free(struct Arena *arena) {
+  arena_pop_to(arena, NULL);
+  arena->used = 0;
+  arena->peak = 0;
+}
@@ -0,0 +1,166 @@
+/*
+ * GraphPass:
+ * A utility to filter networks and provide a default visualization output
+ * for Gephi or SigmaJS.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** @file attrs.c
+ @brief A column snapshot of a graph's vertex or edge attributes.
+
+ igraph's C attribute handler finds an attribute by a linear search of its
+ names on every VAN()/VAS() call, so reading it one element at a time costs
+ O(attributes) per value.  An AttrTable fetches every column of a graph
+ once, keeps the columns in the handler's order (writers depend on it) and
+ finds them by name through an open-addressed hash, so a loop over vertices
+ reads plain typed arrays.
+
+ The table is a read-only snapshot: rebuild it after changing attributes.
+ */
+
+#include <graphpass.h>
+
+/** Hash of an attribute name. */
+static uint64_t attr_hash(const char *name) {
+  return fnv_hash(FNV_OFFSET, name, strlen(name));
+}
+
+/** Fetches every attribute of one kind from a graph.
+
+ @param table - the table to fill.
+ @param graph - the graph to read.
+ @param kind - IGRAPH_ATTRIBUTE_VERTEX or IGRAPH_ATTRIBUTE_EDGE.
+ @return 0 unless an error occurs.
+ */
+int attr_table_init(struct AttrTable *table, const igraph_t *graph,
+                    igraph_attribute_elemtype_t kind) {
+  igraph_strvector_t gnames, vnames, enames;
+  igraph_vector_t gtypes, vtypes, etypes;
+  igraph_strvector_init(&gnames, 0);
+  igraph_strvector_init(&vnames, 0);
+  igraph_strvector_init(&enames, 0);
+  igraph_vector_init(&gtypes, 0);
+  igraph_vector_init(&vtypes, 0);
+  igraph_vector_init(&etypes, 0);
+  igraph_cattribute_list(graph, &gnames, &gtypes, &vnames, &vtypes, &enames, &etypes);
+  bool vertex = (kind == IGRAPH_ATTRIBUTE_VERTEX);
+  igraph_strvector_t *names = vertex ? &vnames : &enames;
+  igraph_vector_t *types = vertex ? &vtypes : &etypes;
+  long count = igraph_strvector_size(names);
+  long length = vertex ? igraph_vcount(graph) : igraph_ecount(graph);
+  table->count = count;
+  table->length = length;
+  /* at most half full, so probe chains stay short */
+  table->nslots = 8;
+  while (table->nslots < 2 * count) {
+    table->nslots *= 2;
+  }
+  table->cols = (struct AttrColumn*) calloc(count ? count : 1, sizeof(struct AttrColumn));
+  table->slots = (long*) malloc(table->nslots * sizeof(long));
+  for (long i=0; i<table->nslots; i++) {
+    table->slots[i] = -1;
+  }
+  for (long i=0; i<count; i++) {
+    struct AttrColumn *col = &table->cols[i];
+    col->name = strdup(STR(*names, i));
+    col->type = (igraph_attribute_type_t) VECTOR(*types)[i];
+    if (col->type == IGRAPH_ATTRIBUTE_NUMERIC) {
+      igraph_vector_init(&col->num, length);
+      if (vertex) {
+        igraph_i_attribute_get_numeric_vertex_attr(graph, col->name, igraph_vss_all(), &col->num);
+      } else {
+        igraph_i_attribute_get_numeric_edge_attr(graph, col->name,
+                                                 igraph_ess_all(IGRAPH_EDGEORDER_ID), &col->num);
+      }
+    } else if (col->type == IGRAPH_ATTRIBUTE_STRING) {
+      igraph_strvector_init(&col->str, length);
+      if (vertex) {
+        igraph_i_attribute_get_string_vertex_attr(graph, col->name, igraph_vss_all(), &col->str);
+      } else {
+        igraph_i_attribute_get_string_edge_attr(graph, col->name,
+                                                igraph_ess_all(IGRAPH_EDGEORDER_ID), &col->str);
+      }
+    } else if (col->type == IGRAPH_ATTRIBUTE_BOOLEAN) {
+      igraph_vector_bool_init(&col->boolv, length);
+      if (vertex) {
+        igraph_i_attribute_get_bool_vertex_attr(graph, col->name, igraph_vss_all(), &col->boolv);
+      } else {
+        igraph_i_attribute_get_bool_edge_attr(graph, col->name,
+                                              igraph_ess_all(IGRAPH_EDGEORDER_ID), &col->boolv);
+      }
+    }
+    long slot = attr_hash(col->name) & (table->nslots - 1);
+    while (table->slots[slot] != -1) {
+      slot = (slot + 1) & (table->nslots - 1);
+    }
+    table->slots[slot] = i;
+  }
+  igraph_strvector_destroy(&gnames);
+  igraph_strvector_destroy(&vnames);
+  igraph_strvector_destroy(&enames);
+  igraph_vector_destroy(&gtypes);
+  igraph_vector_destroy(&vtypes);
+  igraph_vector_destroy(&etypes);
+  return 0;
+}
+
+/** Finds a column by name.
+
+ @param table - an initialized table.
+ @param name - the attribute name.
+ @return the column, or NULL if the graph has no such attribute.
+ */
+struct AttrColumn* attr_table_get(const struct AttrTable *table, const char *name) {
+  long slot = attr_hash(name) & (table->nslots - 1);
+  while (table->slots[slot] != -1) {
+    struct AttrColumn *col = &table->cols[table->slots[slot]];
+    if (strcmp(col->name, name) == 0) {
+      return col;
+    }
+    slot = (slot + 1) & (table->nslots - 1);
+  }
+  return NULL;
+}
+
+/** Returns a numeric column by name, or NULL if it is missing or not numeric. */
+igraph_vector_t* attr_table_numeric(const struct AttrTable *table, const char *name) {
+  struct AttrColumn *col = attr_table_get(table, name);
+  return (col && col->type == IGRAPH_ATTRIBUTE_NUMERIC) ? &col->num : NULL;
+}
+
+/** Returns a string column by name, or NULL if it is missing or not a string. */
+igraph_strvector_t* attr_table_string(const struct AttrTable *table, const char *name) {
+  struct AttrColumn *col = attr_table_get(table, name);
+  return (col && col->type == IGRAPH_ATTRIBUTE_STRING) ? &col->str : NULL;
+}
+
+/** Frees the columns of a table. */
+void attr_table_destroy(struct AttrTable *table) {
+  for (long i=0; i<table->count; i++) {
+    struct AttrColumn *col = &table->cols[i];
+    if (col->type == IGRAPH_ATTRIBUTE_NUMERIC) {
+      igraph_vector_destroy(&col->num);
+    } else if (col->type == IGRAPH_ATTRIBUTE_STRING) {
+      igraph_strvector_destroy(&col->str);
+    } else if (col->type == IGRAPH_ATTRIBUTE_BOOLEAN) {
+      igraph_vector_bool_destroy(&col->boolv);
+    }
+    free(col->name);
+  }
+  free(table->cols);
+  free(table->slots);
+  table->cols = NULL;
+  table->slots = NULL;
+  table->count = 0;
+}
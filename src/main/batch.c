@@ -0,0 +1,375 @@
+/*
+ * GraphPass:
+ * A utility to filter networks and provide a default visualization output
+ * for Gephi or SigmaJS.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** @file batch.c
+ @brief Filters many graphs in one run (--batch).
+
+ The inputs come from a manifest, one path per line ('#' starts a comment),
+ or are the entries of a directory.  They are sorted largest first and
+ handed to a pool of ug_jobs workers, so the biggest graphs start early and
+ the small ones fill the gaps at the end.
+
+ Each worker is a forked process (see "Concurrency" in graphpass.h), so a
+ graph that fails or crashes its worker only fails its own row of the
+ summary.  Each worker
+ runs its filter methods one after another; the pool supplies the
+ parallelism.
+
+ The summary table is printed and written to BATCH_REPORT in the output
+ directory.
+ */
+
+#include <graphpass.h>
+#include <sys/wait.h>
+#include <dirent.h>
+
+/** What a worker sends back about its graph. */
+struct BatchResult {
+  int status; /**< BATCH_OK, BATCH_LOAD_FAILED, ... */
+  long nodes;
+  long edges;
+  double load_ms;
+  double filter_ms;
+};
+
+/** One input of the batch. */
+struct BatchFile {
+  char *path;
+  long bytes;
+  pid_t pid;
+  int fd; /**< read end of the worker's result pipe. */
+  double start_ms;
+  double wall_ms;
+  int wait_status;
+  bool reported; /**< the worker sent a BatchResult. */
+  struct BatchResult result;
+};
+
+static int add_file(struct BatchFile **files, long *count, long *cap, const char *path) {
+  if (*count == *cap) {
+    long bigger = *cap ? *cap * 2 : 64;
+    struct BatchFile *grown = (struct BatchFile*) realloc(*files, bigger * sizeof(struct BatchFile));
+    if (grown == NULL) {
+      return -1;
+    }
+    *files = grown;
+    *cap = bigger;
+  }
+  struct BatchFile *file = &(*files)[(*count)++];
+  memset(file, 0, sizeof(*file));
+  file->path = strdup(path);
+  file->bytes = input_size(path);
+  file->pid = -1;
+  file->fd = -1;
+  return file->path ? 0 : -1;
+}
+
+/** Reads the inputs of a batch from a manifest or a directory.
+
+ In a directory, entries starting with '.' or '_' and metric caches are
+ skipped.  Subdirectories are inputs too (CSV shards, see csv.c).
+
+ @return 0, or -1 if list cannot be read.
+ */
+static int read_batch(const char *list, struct BatchFile **files, long *count) {
+  struct stat st;
+  long cap = 0;
+  *files = NULL;
+  *count = 0;
+  if (stat(list, &st) != 0) {
+    return -1;
+  }
+  if (S_ISDIR(st.st_mode)) {
+    struct dirent **entries;
+    int n = scandir(list, &entries, NULL, alphasort);
+    if (n < 0) {
+      return -1;
+    }
+    for (int i=0; i<n; i++) {
+      const char *name = entries[i]->d_name;
+      size_t len = strlen(name);
+      size_t ext = strlen(CACHE_EXT);
+      char path[PATH_MAX];
+      bool cache = len > ext && strcmp(name + len - ext, CACHE_EXT) == 0;
+      snprintf(path, sizeof(path), "%s%s%s", list,
+               list[strlen(list) - 1] == '/' ? "" : "/", name);
+      if (name[0] != '.' && name[0] != '_' && !cache) {
+        add_file(files, count, &cap, path);
+      }
+      free(entries[i]);
+    }
+    free(entries);
+    return 0;
+  }
+  FILE *fp = fopen(list, "r");
+  char *line = NULL;
+  size_t size = 0;
+  if (fp == NULL) {
+    return -1;
+  }
+  while (getline(&line, &size, fp) != -1) {
+    char *start = line;
+    char *end;
+    char *hash = strchr(line, '#');
+    if (hash != NULL) {
+      *hash = '\0';
+    }
+    while (*start == ' ' || *start == '\t') {
+      start++;
+    }
+    end = start + strlen(start);
+    while (end > start && (end[-1] == '\n' || end[-1] == '\r' || end[-1] == ' '
+                           || end[-1] == '\t')) {
+      *--end = '\0';
+    }
+    if (*start) {
+      add_file(files, count, &cap, start);
+    }
+  }
+  free(line);
+  fclose(fp);
+  return 0;
+}
+
+/** Largest first; equal sizes keep manifest order. */
+static int bigger_first(const void *a, const void *b) {
+  const struct BatchFile *x = (const struct BatchFile*) a;
+  const struct BatchFile *y = (const struct BatchFile*) b;
+  if (x->bytes != y->bytes) {
+    return x->bytes < y->bytes ? 1 : -1;
+  }
+  return strcmp(x->path, y->path);
+}
+
+/** Loads and filters one graph in a worker, as main does for a single file.
+
+ @param path - the input.
+ @param outdir - the output directory, ending in '/'.
+ @param cache - true to use a metric cache beside the input (--cache).
+ @param res - receives the outcome.
+ */
+static void batch_run_file(const char *path, char *outdir, bool cache,
+                           struct BatchResult *res) {
+  char input[PATH_MAX];
+  struct CostEstimate cost;
+  double t0 = now_ms();
+  memset(res, 0, sizeof(*res));
+  strncpy(input, path, sizeof(input) - 1);
+  input[sizeof(input) - 1] = '\0';
+  /* a shard directory is named by its last component */
+  while (strlen(input) > 1 && input[strlen(input) - 1] == '/') {
+    input[strlen(input) - 1] = '\0';
+  }
+  get_filename(input, &ug_FILENAME);
+  get_directory(input, &ug_DIRECTORY);
+  ug_OUTPATH = outdir;
+  ug_OUTFILE = ug_FILENAME;
+  ug_jobs = 1;
+  if (strcmp(ug_OUTPATH, ug_DIRECTORY) == 0) {
+    res->status = BATCH_SAME_PATH;
+    return;
+  }
+  ug_CACHE = NULL;
+  if (cache) {
+    ug_CACHE = malloc(strlen(input) + strlen(CACHE_EXT) + 1);
+    strcpy(ug_CACHE, input);
+    strcat(ug_CACHE, CACHE_EXT);
+  }
+  if (load_graph(input) != 0) {
+    res->status = BATCH_LOAD_FAILED;
+    return;
+  }
+  res->nodes = igraph_vcount(&g);
+  res->edges = igraph_ecount(&g);
+  res->load_ms = now_ms() - t0;
+  if (cost_check(&g, input, &cost) != 0) {
+    igraph_destroy(&g);
+    res->status = BATCH_TOO_LARGE;
+    return;
+  }
+  t0 = now_ms();
+  res->status = filter_graph() == 0 ? BATCH_OK : BATCH_WRITE_FAILED;
+  res->filter_ms = now_ms() - t0;
+}
+
+/** Starts a worker for file. */
+static void batch_start(struct BatchFile *file, char *outdir, bool cache) {
+  int pipefd[2];
+  if (pipe(pipefd) == -1) {
+    return;
+  }
+  fflush(stdout);
+  fflush(stderr);
+  file->start_ms = now_ms();
+  pid_t pid = fork();
+  if (pid == 0) {
+    struct BatchResult res;
+    close(pipefd[0]);
+    batch_run_file(file->path, outdir, cache, &res);
+    ssize_t sent = write(pipefd[1], &res, sizeof(res));
+    close(pipefd[1]);
+    fflush(stdout);
+    fflush(stderr);
+    _exit(sent == sizeof(res) && res.status == BATCH_OK ? EXIT_SUCCESS : EXIT_FAILURE);
+  }
+  close(pipefd[1]);
+  if (pid == -1) {
+    close(pipefd[0]);
+    return;
+  }
+  file->pid = pid;
+  file->fd = pipefd[0];
+}
+
+/** Collects the result of a worker that has exited. */
+static void batch_reap(struct BatchFile *file, int status) {
+  ssize_t got = 0, n;
+  char *buf = (char*) &file->result;
+  file->wall_ms = now_ms() - file->start_ms;
+  file->wait_status = status;
+  while ((size_t) got < sizeof(struct BatchResult)
+         && ((n = read(file->fd, buf + got, sizeof(struct BatchResult) - got)) > 0
+             || (n == -1 && errno == EINTR))) {
+    got += n > 0 ? n : 0;
+  }
+  close(file->fd);
+  file->fd = -1;
+  file->pid = -1;
+  file->reported = ((size_t) got == sizeof(struct BatchResult));
+}
+
+/** Describes the outcome of a file for the summary. */
+static void batch_outcome(const struct BatchFile *file, char *out, size_t size) {
+  if (!file->reported) {
+    if (WIFSIGNALED(file->wait_status)) {
+      snprintf(out, size, "crashed (signal %d)", WTERMSIG(file->wait_status));
+    } else if (file->wait_status == -1) {
+      snprintf(out, size, "not started");
+    } else {
+      snprintf(out, size, "failed (exit %d)", WEXITSTATUS(file->wait_status));
+    }
+    return;
+  }
+  switch (file->result.status) {
+    case BATCH_OK: snprintf(out, size, "ok"); break;
+    case BATCH_LOAD_FAILED: snprintf(out, size, "could not load"); break;
+    case BATCH_TOO_LARGE: snprintf(out, size, "over budget"); break;
+    case BATCH_SAME_PATH: snprintf(out, size, "output would overwrite input"); break;
+    default: snprintf(out, size, "could not write output"); break;
+  }
+}
+
+/** Prints the summary table to fp. */
+static void batch_summary(FILE *fp, struct BatchFile *files, long count, double total_ms) {
+  long ok = 0;
+  char outcome[64];
+  fprintf(fp, "| Input                          | Bytes      | Nodes   | Edges    | Load ms    | Filter ms  | Wall ms    | Outcome |\n");
+  fprintf(fp, "|--------------------------------|------------|---------|----------|------------|------------|------------|---------|\n");
+  for (long i=0; i<count; i++) {
+    struct BatchFile *file = &files[i];
+    batch_outcome(file, outcome, sizeof(outcome));
+    if (file->reported && file->result.status == BATCH_OK) {
+      ++ok;
+    }
+    fprintf(fp, "| %-31s| %-11li| %-8li| %-9li| %-11.1f| %-11.1f| %-11.1f| %s |\n",
+            file->path, file->bytes, file->result.nodes, file->result.edges,
+            file->result.load_ms, file->result.filter_ms, file->wall_ms, outcome);
+  }
+  fprintf(fp, "\n%li of %li graphs filtered in %.1f ms.\n", ok, count, total_ms);
+}
+
+/** Filters every graph listed in a manifest or found in a directory.
+
+ @param list - the manifest or directory (--batch).
+ @param outdir - where the filtered graphs and BATCH_REPORT go.
+ @param cache - true to keep a metric cache beside each input (--cache).
+ @return 0 if every graph was filtered, -1 otherwise.
+ */
+int run_batch(char *list, char *outdir, bool cache) {
+  struct BatchFile *files;
+  long count;
+  struct stat st = {0};
+  char dir[PATH_MAX];
+  double start = now_ms();
+  if (read_batch(list, &files, &count) != 0) {
+    fprintf(stderr, ">>> FAILURE - Could not read the batch list %s.\n", list);
+    return -1;
+  }
+  snprintf(dir, sizeof(dir), "%s%s", outdir, outdir[strlen(outdir) - 1] == '/' ? "" : "/");
+  if (stat(dir, &st) == -1) {
+    fprintf(stderr, ">>> FAILURE - Output folder %s does not exist.\n", dir);
+    free(files);
+    return -1;
+  }
+  qsort(files, count, sizeof(struct BatchFile), bigger_first);
+  long jobs = ug_jobs > 0 ? ug_jobs : sysconf(_SC_NPROCESSORS_ONLN);
+  jobs = jobs < 1 ? 1 : jobs;
+  if (ug_verbose == true) {
+    printf("Filtering %li graphs across %li workers.\n", count, jobs);
+  }
+  write_queue_finish();
+  long next = 0, running = 0;
+  while (next < count || running > 0) {
+    while (next < count && running < jobs) {
+      files[next].wait_status = -1;
+      batch_start(&files[next], dir, cache);
+      running += files[next].pid != -1;
+      next++;
+    }
+    int status;
+    pid_t pid = wait(&status);
+    if (pid == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      break;
+    }
+    for (long i=0; i<next; i++) {
+      if (files[i].pid == pid) {
+        batch_reap(&files[i], status);
+        --running;
+        break;
+      }
+    }
+  }
+  double total = now_ms() - start;
+  int result = 0;
+  for (long i=0; i<count; i++) {
+    if (!files[i].reported || files[i].result.status != BATCH_OK) {
+      result = -1;
+    }
+  }
+  char report[PATH_MAX];
+  snprintf(report, sizeof(report), "%s%s", dir, BATCH_REPORT);
+  FILE *fp = fopen(report, "w");
+  if (fp != NULL) {
+    batch_summary(fp, files, count, total);
+    fclose(fp);
+  } else if (!ug_TEST) {
+    fprintf(stderr, ">>> FAILURE - Could not write %s.\n", report);
+  }
+  if (!ug_TEST) {
+    printf("\n");
+    batch_summary(stdout, files, count, total);
+  }
+  for (long i=0; i<count; i++) {
+    free(files[i].path);
+  }
+  free(files);
+  return result;
+}
@@ -0,0 +1,333 @@
+/*
+ * GraphPass:
+ * A utility to filter networks and provide a default visualization output
+ * for Gephi or SigmaJS.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** @file buffer.c
+ @brief An append buffer for writers that produce many small strings.
+
+ Writers append to the buffer and it reaches the stream with one fwrite
+ per OUT_BUFFER_SIZE bytes, instead of an fprintf (and a stream lock) per
+ field.  Numbers that are whole are formatted with integer arithmetic;
+ everything else goes through snprintf, so the text is always exactly what
+ printf would produce.  A buffer without a stream grows instead of
+ flushing, to build output in memory.
+
+ Write errors are sticky: once a flush fails the buffer drops further
+ output and out_buffer_flush / out_buffer_destroy report the failure.
+
+ out_buffer_ranges splits a section of a file (the nodes or the edges)
+ into chunks of OUT_CHUNK_SIZE elements that worker threads format into
+ private buffers, and appends the buffers in order, so the output is the
+ same whatever the thread count.  The formatters must read plain arrays
+ fetched beforehand and never call into igraph (see "Concurrency" in
+ graphpass.h).
+ */
+
+#include <graphpass.h>
+
+/** Starts a buffer.
+
+ @param buf - the buffer to initialize.
+ @param stream - where to flush, or NULL to keep everything in memory.
+ */
+void out_buffer_init(struct OutBuffer *buf, FILE *stream) {
+  buf->stream = stream;
+  buf->cap = OUT_BUFFER_SIZE;
+  buf->data = (char*) malloc(buf->cap);
+  buf->len = 0;
+  buf->failed = (buf->data == NULL);
+}
+
+/** Writes the buffered bytes to the stream.  Does nothing without one.
+
+ @return 0, or -1 if this or an earlier write failed.
+ */
+int out_buffer_flush(struct OutBuffer *buf) {
+  if (buf->stream != NULL && buf->len > 0 && !buf->failed) {
+    if (fwrite(buf->data, 1, buf->len, buf->stream) != buf->len) {
+      buf->failed = true;
+    }
+    buf->len = 0;
+  }
+  return buf->failed ? -1 : 0;
+}
+
+/** Makes room for n more bytes.  Returns false if that is not possible. */
+static bool reserve(struct OutBuffer *buf, size_t n) {
+  if (buf->failed) {
+    return false;
+  }
+  if (buf->len + n <= buf->cap) {
+    return true;
+  }
+  if (buf->stream != NULL) {
+    out_buffer_flush(buf);
+    if (buf->failed || n <= buf->cap) {
+      return !buf->failed;
+    }
+  }
+  size_t cap = buf->cap;
+  while (cap < buf->len + n) {
+    cap *= 2;
+  }
+  char *data = (char*) realloc(buf->data, cap);
+  if (data == NULL) {
+    buf->failed = true;
+    return false;
+  }
+  buf->data = data;
+  buf->cap = cap;
+  return true;
+}
+
+/** Appends len bytes. */
+void out_buffer_write(struct OutBuffer *buf, const char *data, size_t len) {
+  if (buf->stream != NULL && len > buf->cap && out_buffer_flush(buf) == 0) {
+    /* too big to buffer, such as a formatted chunk: write it through */
+    if (fwrite(data, 1, len, buf->stream) != len) {
+      buf->failed = true;
+    }
+    return;
+  }
+  if (reserve(buf, len)) {
+    memcpy(buf->data + buf->len, data, len);
+    buf->len += len;
+  }
+}
+
+/** Appends a string. */
+void out_buffer_puts(struct OutBuffer *buf, const char *s) {
+  out_buffer_write(buf, s, strlen(s));
+}
+
+/** Appends printf-formatted text. */
+void out_buffer_printf(struct OutBuffer *buf, const char *format, ...) {
+  va_list args;
+  int n;
+  if (!reserve(buf, 256)) {
+    return;
+  }
+  va_start(args, format);
+  n = vsnprintf(buf->data + buf->len, buf->cap - buf->len, format, args);
+  va_end(args);
+  if (n < 0) {
+    buf->failed = true;
+    return;
+  }
+  if ((size_t) n >= buf->cap - buf->len) {
+    if (!reserve(buf, n + 1)) {
+      return;
+    }
+    va_start(args, format);
+    vsnprintf(buf->data + buf->len, buf->cap - buf->len, format, args);
+    va_end(args);
+  }
+  buf->len += n;
+}
+
+/** Appends an integer, as "%li" would. */
+void out_buffer_long(struct OutBuffer *buf, long value) {
+  char digits[24];
+  int n = 0;
+  unsigned long u = value < 0 ? 0UL - (unsigned long) value : (unsigned long) value;
+  do {
+    digits[n++] = (char) ('0' + u % 10);
+    u /= 10;
+  } while (u > 0);
+  if (!reserve(buf, n + 1)) {
+    return;
+  }
+  if (value < 0) {
+    buf->data[buf->len++] = '-';
+  }
+  while (n > 0) {
+    buf->data[buf->len++] = digits[--n];
+  }
+}
+
+/** True if "%g" prints value as a plain integer: whole, below 10^6 (the
+ default precision) and not negative zero. */
+static bool whole(igraph_real_t value, igraph_real_t limit) {
+  return fabs(value) < limit && value == floor(value)
+    && !(value == 0 && signbit(value));
+}
+
+/** Appends a number as "%g" would. */
+void out_buffer_g(struct OutBuffer *buf, igraph_real_t value) {
+  if (whole(value, 1e6)) {
+    out_buffer_long(buf, (long) value);
+  } else {
+    out_buffer_printf(buf, "%g", value);
+  }
+}
+
+/** Appends a number as "%f" would. */
+void out_buffer_f(struct OutBuffer *buf, igraph_real_t value) {
+  if (whole(value, 1e15)) {
+    out_buffer_long(buf, (long) value);
+    out_buffer_write(buf, ".000000", 7);
+  } else {
+    out_buffer_printf(buf, "%f", value);
+  }
+}
+
+/** Appends a string escaped for XML, as igraph_i_xml_escape does.
+
+ Escapes in place rather than through a malloc'd copy, and never calls
+ into igraph, so writer threads can use it.
+
+ @return 0, or IGRAPH_EINVAL for control characters XML cannot hold.
+ */
+int out_buffer_xml(struct OutBuffer *buf, const char *s) {
+  const char *run = s;
+  const char *c;
+  for (c = s; *c; c++) {
+    unsigned char ch = (unsigned char) *c;
+    const char *entity;
+    switch (ch) {
+    case '&': entity = "&amp;"; break;
+    case '<': entity = "&lt;"; break;
+    case '>': entity = "&gt;"; break;
+    case '"': entity = "&quot;"; break;
+    case '\'': entity = "&apos;"; break;
+    default:
+      if (ch < 0x20 && ch != 0x09 && ch != 0x0A && ch != 0x0D) {
+        return IGRAPH_EINVAL;
+      }
+      continue;
+    }
+    out_buffer_write(buf, run, c - run);
+    out_buffer_puts(buf, entity);
+    run = c + 1;
+  }
+  out_buffer_write(buf, run, c - run);
+  return 0;
+}
+
+/** Appends a string as a quoted JSON string.
+
+ Quotes, backslashes and control characters are escaped; other bytes,
+ including UTF-8 sequences, are copied as they are.
+ */
+void out_buffer_json(struct OutBuffer *buf, const char *s) {
+  const char *run = s;
+  const char *c;
+  out_buffer_write(buf, "\"", 1);
+  for (c = s; *c; c++) {
+    unsigned char ch = (unsigned char) *c;
+    char escape[8];
+    if (ch == '"' || ch == '\\') {
+      escape[0] = '\\';
+      escape[1] = (char) ch;
+      escape[2] = '\0';
+    } else if (ch < 0x20) {
+      snprintf(escape, sizeof(escape), "\\u%04x", ch);
+    } else {
+      continue;
+    }
+    out_buffer_write(buf, run, c - run);
+    out_buffer_puts(buf, escape);
+    run = c + 1;
+  }
+  out_buffer_write(buf, run, c - run);
+  out_buffer_write(buf, "\"", 1);
+}
+
+/** One range of elements formatted by a worker. */
+struct OutChunk {
+  out_format_range format;
+  const void *arg;
+  long from;
+  long to;
+  struct OutBuffer buf;
+  int result;
+};
+
+static void* format_chunk(void *arg) {
+  struct OutChunk *chunk = (struct OutChunk*) arg;
+  chunk->result = chunk->format(chunk->arg, chunk->from, chunk->to, &chunk->buf);
+  return NULL;
+}
+
+/** Formats elements 0 to count, in chunks on up to threads workers at a
+ time, and appends them to buf in order.
+
+ @param buf - the buffer to append to.
+ @param count - the number of elements.
+ @param threads - the most workers to run at once.
+ @param format - formats elements from (inclusive) to to (exclusive).
+ @param arg - passed to format.
+ @return 0, or the error of the first chunk that failed.
+ */
+int out_buffer_ranges(struct OutBuffer *buf, long count, long threads,
+                      out_format_range format, const void *arg) {
+  if (threads < 2 || count <= OUT_CHUNK_SIZE) {
+    return format(arg, 0, count, buf);
+  }
+  struct OutChunk chunks[threads];
+  pthread_t workers[threads];
+  bool started[threads];
+  int result = 0;
+  for (long base=0; base<count; base+=threads * OUT_CHUNK_SIZE) {
+    long n = 0;
+    for (; n<threads && base + n * OUT_CHUNK_SIZE < count; n++) {
+      struct OutChunk *chunk = &chunks[n];
+      chunk->format = format;
+      chunk->arg = arg;
+      chunk->from = base + n * OUT_CHUNK_SIZE;
+      chunk->to = chunk->from + OUT_CHUNK_SIZE < count ? chunk->from + OUT_CHUNK_SIZE : count;
+      chunk->result = 0;
+      out_buffer_init(&chunk->buf, NULL);
+      started[n] = (pthread_create(&workers[n], NULL, format_chunk, chunk) == 0);
+      if (!started[n]) {
+        format_chunk(chunk);
+      }
+    }
+    for (long i=0; i<n; i++) {
+      if (started[i]) {
+        pthread_join(workers[i], NULL);
+      }
+      if (result == 0 && chunks[i].buf.failed) {
+        result = IGRAPH_ENOMEM;
+      }
+      if (result == 0) {
+        result = chunks[i].result;
+      }
+      if (result == 0) {
+        out_buffer_write(buf, chunks[i].buf.data, chunks[i].buf.len);
+      }
+      out_buffer_destroy(&chunks[i].buf);
+    }
+    if (result != 0) {
+      break;
+    }
+  }
+  return result;
+}
+
+/** Flushes and frees a buffer.
+
+ @return 0, or -1 if any write failed.
+ */
+int out_buffer_destroy(struct OutBuffer *buf) {
+  int result = out_buffer_flush(buf);
+  free(buf->data);
+  buf->data = NULL;
+  buf->len = 0;
+  buf->cap = 0;
+  return result;
+}
@@ -0,0 +1,295 @@
+/*
+ * GraphPass:
+ * A utility to filter networks and provide a default visualization output
+ * for Gephi or SigmaJS.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** @file cache.c
+ @brief Saves and restores analysis results in a sidecar file.
+
+ The cache file (by default the input path plus ".gpcache") holds the
+ per-vertex scores and graph-level values set by analysis_all.  It is keyed
+ by a fingerprint of the vertex ids, the edge list and the analysis
+ parameters, so a cache written for a different graph, or by a build with
+ different settings, is detected and rebuilt.
+
+ Layout (native byte order, checked through CACHE_ENDIAN_CHECK):
+
+     char     magic[8]        "GPCACHE\0"
+     uint32_t version         CACHE_VERSION
+     uint32_t endian          CACHE_ENDIAN_CHECK
+     uint64_t fingerprint
+     uint64_t nodes
+     uint32_t vertex attribute count, then for each:
+              uint32_t name length, name, double[nodes]
+     uint32_t graph attribute count, then for each:
+              uint32_t name length, name, double
+     uint64_t fingerprint     (repeated to detect truncated files)
+ */
+
+#include <graphpass.h>
+
+#define CACHE_MAGIC "GPCACHE"
+#define CACHE_VERSION 1
+#define CACHE_ENDIAN_CHECK 0x01020304
+#define CACHE_MAX_NAME 256
+#define CACHE_MAX_GRAPH_ATTRS 4096
+
+/** Vertex attributes computed by analysis_all that are worth caching. */
+static const char* CACHE_VERTEX_ATTRS[] = {
+  "Authority", "Betweenness", "Degree", "DegreeRank", "Hub", "Indegree",
+  "Outdegree", "Eigenvector", "PageRank", "WalkTrapModularity"
+};
+
+/** Hashes the vertex ids, the edge list and the analysis parameters.
+
+ @param graph - the graph to fingerprint.
+ @return a 64-bit FNV-1a hash.
+ */
+uint64_t graph_fingerprint(const igraph_t *graph) {
+  uint64_t hash = FNV_OFFSET;
+  int64_t n = igraph_vcount(graph);
+  int64_t m = igraph_ecount(graph);
+  int32_t directed = igraph_is_directed(graph) ? 1 : 0;
+  double damping = PAGERANK_DAMPING;
+  int32_t steps = WALKTRAP_STEPS;
+  int32_t version = CACHE_VERSION;
+  /* sampled betweenness is only reused under the same sampling */
+  int64_t bsources = ug_bmode == BETWEENNESS_EXACT ? n : betweenness_samples(graph);
+  hash = fnv_hash(hash, &version, sizeof(version));
+  int32_t anf_bits = ug_anf_bits;
+  hash = fnv_hash(hash, &bsources, sizeof(bsources));
+  hash = fnv_hash(hash, &anf_bits, sizeof(anf_bits));
+  hash = fnv_hash(hash, &damping, sizeof(damping));
+  hash = fnv_hash(hash, &steps, sizeof(steps));
+  hash = fnv_hash(hash, &directed, sizeof(directed));
+  hash = fnv_hash(hash, &n, sizeof(n));
+  hash = fnv_hash(hash, &m, sizeof(m));
+  if (has_node_keys(graph)) {
+    /* hashed as the text they stand for, like string ids */
+    char text[NODE_KEY_DIGITS + 1];
+    struct NodeKey *keys = malloc((n > 0 ? n : 1) * sizeof(struct NodeKey));
+    get_node_keys(graph, keys);
+    for (long int i=0; i<n; i++) {
+      node_key_format(&keys[i], text);
+      hash = fnv_hash(hash, text, NODE_KEY_DIGITS + 1);
+    }
+    free(keys);
+  } else if (igraph_cattribute_has_attr(graph, IGRAPH_ATTRIBUTE_VERTEX, "id")) {
+    igraph_strvector_t ids;
+    igraph_strvector_init(&ids, 0);
+    VASV(graph, "id", &ids);
+    for (long int i=0; i<igraph_strvector_size(&ids); i++) {
+      hash = fnv_hash(hash, STR(ids, i), strlen(STR(ids, i)) + 1);
+    }
+    igraph_strvector_destroy(&ids);
+  }
+  igraph_vector_t el;
+  igraph_vector_init(&el, 0);
+  igraph_get_edgelist(graph, &el, 0);
+  for (long int i=0; i<igraph_vector_size(&el); i++) {
+    int64_t v = (int64_t)VECTOR(el)[i];
+    hash = fnv_hash(hash, &v, sizeof(v));
+  }
+  igraph_vector_destroy(&el);
+  return hash;
+}
+
+static int write_name(FILE *fp, const char *name) {
+  uint32_t len = strlen(name);
+  if (fwrite(&len, sizeof(len), 1, fp) != 1) { return -1; }
+  if (fwrite(name, 1, len, fp) != len) { return -1; }
+  return 0;
+}
+
+static int read_name(FILE *fp, char *name) {
+  uint32_t len;
+  if (fread(&len, sizeof(len), 1, fp) != 1 || len >= CACHE_MAX_NAME) { return -1; }
+  if (fread(name, 1, len, fp) != len) { return -1; }
+  name[len] = '\0';
+  return 0;
+}
+
+/** Writes the analysis results of a graph to a cache file.
+
+ The file is written under a temporary name and renamed into place, so an
+ interrupted run never leaves a partial cache behind.
+
+ @param graph - an analyzed graph.
+ @param path - the cache file to write.
+ @return 0 unless an error occurs.
+ */
+int save_metric_cache(const igraph_t *graph, char *path) {
+  char tmppath[strlen(path) + 5];
+  snprintf(tmppath, sizeof(tmppath), "%s.tmp", path);
+  FILE *fp = fopen(tmppath, "wb");
+  if (fp == NULL) {
+    if (!ug_TEST) {
+      fprintf(stderr, "  ---WARNING--- : Could not write metric cache %s\n", path);
+    }
+    return -1;
+  }
+  int fail = 0;
+  uint32_t version = CACHE_VERSION;
+  uint32_t endian = CACHE_ENDIAN_CHECK;
+  uint64_t fingerprint = graph_fingerprint(graph);
+  uint64_t nodes = igraph_vcount(graph);
+  fail |= fwrite(CACHE_MAGIC, 1, 8, fp) != 8;
+  fail |= fwrite(&version, sizeof(version), 1, fp) != 1;
+  fail |= fwrite(&endian, sizeof(endian), 1, fp) != 1;
+  fail |= fwrite(&fingerprint, sizeof(fingerprint), 1, fp) != 1;
+  fail |= fwrite(&nodes, sizeof(nodes), 1, fp) != 1;
+
+  uint32_t vcount = 0;
+  for (size_t i=0; i<NELEMS(CACHE_VERTEX_ATTRS); i++) {
+    if (igraph_cattribute_has_attr(graph, IGRAPH_ATTRIBUTE_VERTEX, CACHE_VERTEX_ATTRS[i])) {
+      ++vcount;
+    }
+  }
+  fail |= fwrite(&vcount, sizeof(vcount), 1, fp) != 1;
+  igraph_vector_t col;
+  igraph_vector_init(&col, nodes);
+  for (size_t i=0; i<NELEMS(CACHE_VERTEX_ATTRS) && !fail; i++) {
+    if (igraph_cattribute_has_attr(graph, IGRAPH_ATTRIBUTE_VERTEX, CACHE_VERTEX_ATTRS[i])) {
+      VANV(graph, CACHE_VERTEX_ATTRS[i], &col);
+      fail |= write_name(fp, CACHE_VERTEX_ATTRS[i]) != 0;
+      fail |= fwrite(VECTOR(col), sizeof(igraph_real_t), nodes, fp) != nodes;
+    }
+  }
+  igraph_vector_destroy(&col);
+
+  igraph_vector_t gtypes, vtypes, etypes;
+  igraph_strvector_t gnames, vnames, enames;
+  igraph_vector_init(&gtypes, 0);
+  igraph_vector_init(&vtypes, 0);
+  igraph_vector_init(&etypes, 0);
+  igraph_strvector_init(&gnames, 0);
+  igraph_strvector_init(&vnames, 0);
+  igraph_strvector_init(&enames, 0);
+  igraph_cattribute_list(graph, &gnames, &gtypes, &vnames, &vtypes,
+                         &enames, &etypes);
+  uint32_t gcount = 0;
+  for (long int i=0; i<igraph_vector_size(&gtypes); i++) {
+    if (VECTOR(gtypes)[i] == IGRAPH_ATTRIBUTE_NUMERIC) {
+      ++gcount;
+    }
+  }
+  fail |= fwrite(&gcount, sizeof(gcount), 1, fp) != 1;
+  for (long int i=0; i<igraph_vector_size(&gtypes) && !fail; i++) {
+    if (VECTOR(gtypes)[i] == IGRAPH_ATTRIBUTE_NUMERIC) {
+      igraph_real_t val = GAN(graph, STR(gnames, i));
+      fail |= write_name(fp, STR(gnames, i)) != 0;
+      fail |= fwrite(&val, sizeof(val), 1, fp) != 1;
+    }
+  }
+  igraph_vector_destroy(&gtypes);
+  igraph_vector_destroy(&vtypes);
+  igraph_vector_destroy(&etypes);
+  igraph_strvector_destroy(&gnames);
+  igraph_strvector_destroy(&vnames);
+  igraph_strvector_destroy(&enames);
+
+  fail |= fwrite(&fingerprint, sizeof(fingerprint), 1, fp) != 1;
+  fail |= fclose(fp) != 0;
+  if (fail || rename(tmppath, path) != 0) {
+    remove(tmppath);
+    if (!ug_TEST) {
+      fprintf(stderr, "  ---WARNING--- : Could not write metric cache %s\n", path);
+    }
+    return -1;
+  }
+  if (ug_verbose == true) {
+    printf("Saved analysis to cache %s\n", path);
+  }
+  return 0;
+}
+
+/** Restores analysis results from a cache file onto a graph.
+
+ Nothing is set on the graph unless the whole file is valid and its
+ fingerprint matches the graph.
+
+ @param graph - the freshly loaded graph.
+ @param path - the cache file to read.
+ @return 0 if the cache was applied, 1 if it is missing, stale or damaged.
+ */
+int load_metric_cache(igraph_t *graph, char *path) {
+  FILE *fp = fopen(path, "rb");
+  if (fp == NULL) {
+    return 1;
+  }
+  char magic[8];
+  uint32_t version, endian, vcount, gcount;
+  uint64_t fingerprint, nodes, trailer;
+  int stale = 0;
+  stale |= fread(magic, 1, 8, fp) != 8 || memcmp(magic, CACHE_MAGIC, 8) != 0;
+  stale |= stale || fread(&version, sizeof(version), 1, fp) != 1 || version != CACHE_VERSION;
+  stale |= stale || fread(&endian, sizeof(endian), 1, fp) != 1 || endian != CACHE_ENDIAN_CHECK;
+  stale |= stale || fread(&fingerprint, sizeof(fingerprint), 1, fp) != 1
+    || fingerprint != graph_fingerprint(graph);
+  stale |= stale || fread(&nodes, sizeof(nodes), 1, fp) != 1
+    || nodes != (uint64_t)igraph_vcount(graph);
+  stale |= stale || fread(&vcount, sizeof(vcount), 1, fp) != 1
+    || vcount > NELEMS(CACHE_VERTEX_ATTRS);
+  if (stale) {
+    fclose(fp);
+    if (ug_verbose == true) {
+      printf("Metric cache %s does not match this graph, rebuilding.\n", path);
+    }
+    return 1;
+  }
+  char vnames[NELEMS(CACHE_VERTEX_ATTRS)][CACHE_MAX_NAME];
+  igraph_vector_t cols[NELEMS(CACHE_VERTEX_ATTRS)];
+  uint32_t read_cols = 0;
+  for (; read_cols<vcount && !stale; read_cols++) {
+    igraph_vector_init(&cols[read_cols], nodes);
+    stale |= read_name(fp, vnames[read_cols]) != 0;
+    stale |= stale || fread(VECTOR(cols[read_cols]), sizeof(igraph_real_t), nodes, fp) != nodes;
+  }
+  stale |= stale || fread(&gcount, sizeof(gcount), 1, fp) != 1
+    || gcount > CACHE_MAX_GRAPH_ATTRS;
+  char (*gnames)[CACHE_MAX_NAME] = stale ? NULL : malloc((gcount ? gcount : 1) * CACHE_MAX_NAME);
+  igraph_real_t *gvals = stale ? NULL : malloc((gcount ? gcount : 1) * sizeof(igraph_real_t));
+  stale |= gnames == NULL || gvals == NULL;
+  for (uint32_t i=0; i<gcount && !stale; i++) {
+    stale |= read_name(fp, gnames[i]) != 0;
+    stale |= stale || fread(&gvals[i], sizeof(igraph_real_t), 1, fp) != 1;
+  }
+  stale |= stale || fread(&trailer, sizeof(trailer), 1, fp) != 1 || trailer != fingerprint;
+  fclose(fp);
+  if (!stale) {
+    for (uint32_t i=0; i<read_cols; i++) {
+      SETVANV(graph, vnames[i], &cols[i]);
+    }
+    for (uint32_t i=0; i<gcount; i++) {
+      SETGAN(graph, gnames[i], gvals[i]);
+    }
+  }
+  for (uint32_t i=0; i<read_cols; i++) {
+    igraph_vector_destroy(&cols[i]);
+  }
+  free(gnames);
+  free(gvals);
+  if (stale) {
+    if (ug_verbose == true) {
+      printf("Metric cache %s is damaged, rebuilding.\n", path);
+    }
+    return 1;
+  }
+  if (ug_verbose == true) {
+    printf("Loaded analysis from cache %s\n", path);
+  }
+  return 0;
+}
@@ -0,0 +1,371 @@
+/*
+ * GraphPass:
+ * A utility to filter networks and provide a default visualization output
+ * for Gephi or SigmaJS.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** @file compress.c
+ @brief Reads and writes gzip (and, when built with HAVE_ZSTD, zstd) files.
+
+ Compressed input is recognised by its magic bytes and decompressed in
+ chunks into memory, where the GraphML loaders read it without a
+ temporary file.
+
+ Compressed output is written through a pipe: the writer formats into the
+ write end as if it were a plain file, while a second thread reads the
+ other end and compresses, so compression overlaps formatting.
+ */
+
+#include <graphpass.h>
+#include <zlib.h>
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#define COMPRESS_CHUNK (1 << 16) /**< bytes read or compressed per step. */
+
+/** Parses the --compress argument into ug_compress and ug_compress_level.
+
+ Accepts "none", "gz" or "zst", optionally followed by ":level".  Without
+ a level the library default is used.
+
+ @param arg - the option argument.
+ @return 0, or -1 if arg is not understood or zstd was not built in.
+ */
+int parse_compression(char *arg) {
+  int level = 0;
+  char *colon = strchr(arg, ':');
+  size_t len = colon ? (size_t) (colon - arg) : strlen(arg);
+  if (colon != NULL && (sscanf(colon + 1, "%d", &level) != 1 || level < 1)) {
+    return -1;
+  }
+  if (len == 4 && strncmp(arg, "none", 4) == 0 && colon == NULL) {
+    ug_compress = COMPRESSION_NONE;
+  } else if (len == 2 && strncmp(arg, "gz", 2) == 0 && level <= 9) {
+    ug_compress = COMPRESSION_GZIP;
+#ifdef HAVE_ZSTD
+  } else if (len == 3 && strncmp(arg, "zst", 3) == 0 && level <= ZSTD_maxCLevel()) {
+    ug_compress = COMPRESSION_ZSTD;
+#endif
+  } else {
+    return -1;
+  }
+  ug_compress_level = level;
+  return 0;
+}
+
+/** Returns the file extension for a compression, "" for none. */
+const char* compression_ext(compression_t type) {
+  return type == COMPRESSION_GZIP ? GZIP_EXT : type == COMPRESSION_ZSTD ? ZSTD_EXT : "";
+}
+
+/** Detects a compressed file from its first bytes.
+
+ @param filename - the file to check.
+ @return a compression_t, or -1 if the file cannot be read.
+ */
+int detect_compression(const char *filename) {
+  unsigned char magic[4] = {0, 0, 0, 0};
+  FILE *fp = fopen(filename, "rb");
+  if (fp == NULL) {
+    return -1;
+  }
+  size_t got = fread(magic, 1, sizeof(magic), fp);
+  fclose(fp);
+  if (got >= 2 && magic[0] == 0x1f && magic[1] == 0x8b) {
+    return COMPRESSION_GZIP;
+  }
+  if (got == 4 && magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f
+      && magic[3] == 0xfd) {
+    return COMPRESSION_ZSTD;
+  }
+  return COMPRESSION_NONE;
+}
+
+/** Makes room for COMPRESS_CHUNK more bytes in a growing buffer. */
+static int grow(char **data, size_t *cap, size_t used) {
+  if (used + COMPRESS_CHUNK <= *cap) {
+    return 0;
+  }
+  size_t size = *cap ? *cap : 4 * COMPRESS_CHUNK;
+  while (size < used + COMPRESS_CHUNK) {
+    size *= 2;
+  }
+  char *bigger = (char*) realloc(*data, size);
+  if (bigger == NULL) {
+    return -1;
+  }
+  *data = bigger;
+  *cap = size;
+  return 0;
+}
+
+static int gunzip_file(const char *filename, char **data, size_t *size) {
+  gzFile in = gzopen(filename, "rb");
+  size_t cap = 0;
+  int got = 0;
+  int result = 0;
+  if (in == NULL) {
+    return -1;
+  }
+  gzbuffer(in, COMPRESS_CHUNK);
+  *size = 0;
+  do {
+    if (grow(data, &cap, *size) != 0) {
+      result = -1;
+      break;
+    }
+    got = gzread(in, *data + *size, COMPRESS_CHUNK);
+    *size += got > 0 ? got : 0;
+  } while (got > 0);
+  if (got < 0) {
+    result = -1;
+  }
+  gzclose(in);
+  return result;
+}
+
+#ifdef HAVE_ZSTD
+static int unzstd_file(const char *filename, char **data, size_t *size) {
+  FILE *in = fopen(filename, "rb");
+  ZSTD_DStream *ds = ZSTD_createDStream();
+  char *chunk = (char*) malloc(COMPRESS_CHUNK);
+  size_t cap = 0, got, ret = 0;
+  int result = 0;
+  if (in == NULL || ds == NULL || chunk == NULL) {
+    result = -1;
+  } else {
+    ZSTD_initDStream(ds);
+    *size = 0;
+    while (result == 0 && (got = fread(chunk, 1, COMPRESS_CHUNK, in)) > 0) {
+      ZSTD_inBuffer input = {chunk, got, 0};
+      bool full = false;
+      /* a full output buffer may leave decoded bytes behind, so go on until
+         the input is used up and the output was not filled */
+      while (input.pos < input.size || full) {
+        if (grow(data, &cap, *size) != 0) {
+          result = -1;
+          break;
+        }
+        ZSTD_outBuffer output = {*data + *size, cap - *size, 0};
+        ret = ZSTD_decompressStream(ds, &output, &input);
+        if (ZSTD_isError(ret)) {
+          result = -1;
+          break;
+        }
+        *size += output.pos;
+        full = (output.pos == output.size);
+      }
+    }
+    /* a non-zero hint means the last frame was cut short */
+    if (result == 0 && (ferror(in) || ret != 0)) {
+      result = -1;
+    }
+  }
+  if (in != NULL) {
+    fclose(in);
+  }
+  ZSTD_freeDStream(ds);
+  free(chunk);
+  return result;
+}
+#endif
+
+/** Decompresses a whole file into memory.
+
+ @param filename - the compressed file.
+ @param type - its compression, from detect_compression.
+ @param data - receives a malloc'd buffer the caller frees.  It may be
+ larger than size.
+ @param size - receives the number of decompressed bytes.
+ @return 0, or -1 if the file is unreadable, corrupt, or compressed with
+ zstd in a build without it.
+ */
+int decompress_file(const char *filename, compression_t type, char **data,
+                    size_t *size) {
+  int result = -1;
+  *data = NULL;
+  *size = 0;
+  if (type == COMPRESSION_GZIP) {
+    result = gunzip_file(filename, data, size);
+#ifdef HAVE_ZSTD
+  } else if (type == COMPRESSION_ZSTD) {
+    result = unzstd_file(filename, data, size);
+#endif
+  }
+  if (result != 0) {
+    free(*data);
+    *data = NULL;
+  }
+  return result;
+}
+
+/** Compresses what arrives on the pipe until the writer closes it.
+
+ On a failed write it keeps draining the pipe, so the writer never blocks,
+ and reports the failure when the stream is closed.
+ */
+static void* compress_worker(void *arg) {
+  struct CompressStream *cs = (struct CompressStream*) arg;
+  char chunk[COMPRESS_CHUNK];
+  ssize_t got;
+#ifdef HAVE_ZSTD
+  size_t outcap = ZSTD_CStreamOutSize();
+  char *out = cs->type == COMPRESSION_ZSTD ? (char*) malloc(outcap) : NULL;
+  if (cs->type == COMPRESSION_ZSTD && out == NULL) {
+    cs->failed = true;
+  }
+#endif
+  while ((got = read(cs->pipe_in, chunk, sizeof(chunk))) != 0) {
+    if (got < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      cs->failed = true;
+      break;
+    }
+    if (cs->failed) {
+      continue;
+    }
+    if (cs->type == COMPRESSION_GZIP) {
+      if (gzwrite(cs->gz, chunk, (unsigned) got) != got) {
+        cs->failed = true;
+      }
+    }
+#ifdef HAVE_ZSTD
+    else {
+      ZSTD_inBuffer input = {chunk, (size_t) got, 0};
+      while (input.pos < input.size && !cs->failed) {
+        ZSTD_outBuffer output = {out, outcap, 0};
+        if (ZSTD_isError(ZSTD_compressStream2(cs->zc, &output, &input, ZSTD_e_continue))
+            || fwrite(out, 1, output.pos, cs->file) != output.pos) {
+          cs->failed = true;
+        }
+      }
+    }
+#endif
+  }
+#ifdef HAVE_ZSTD
+  if (cs->type == COMPRESSION_ZSTD && !cs->failed) {
+    size_t left;
+    do {
+      ZSTD_inBuffer input = {NULL, 0, 0};
+      ZSTD_outBuffer output = {out, outcap, 0};
+      left = ZSTD_compressStream2(cs->zc, &output, &input, ZSTD_e_end);
+      if (ZSTD_isError(left) || fwrite(out, 1, output.pos, cs->file) != output.pos) {
+        cs->failed = true;
+        break;
+      }
+    } while (left != 0);
+  }
+  free(out);
+#endif
+  close(cs->pipe_in);
+  return NULL;
+}
+
+/** Opens a compressed output file and starts its compression thread.
+
+ @param cs - the stream to start.
+ @param path - the file to write, with its extension.
+ @param type - COMPRESSION_GZIP or COMPRESSION_ZSTD.
+ @param level - the compression level, or 0 for the library default.
+ @return a stream to write the uncompressed data to, or NULL if the file
+ cannot be created.  Close it with compress_stream_close, not fclose.
+ */
+FILE* compress_stream_open(struct CompressStream *cs, const char *path,
+                           compression_t type, int level) {
+  int fds[2];
+  memset(cs, 0, sizeof(*cs));
+  cs->type = type;
+  if (type == COMPRESSION_GZIP) {
+    char mode[8];
+    snprintf(mode, sizeof(mode), level > 0 ? "wb%d" : "wb", level);
+    cs->gz = gzopen(path, mode);
+    if (cs->gz == NULL) {
+      return NULL;
+    }
+    gzbuffer(cs->gz, COMPRESS_CHUNK);
+#ifdef HAVE_ZSTD
+  } else if (type == COMPRESSION_ZSTD) {
+    cs->file = fopen(path, "wb");
+    cs->zc = ZSTD_createCCtx();
+    if (cs->file == NULL || cs->zc == NULL) {
+      if (cs->file != NULL) {
+        fclose(cs->file);
+      }
+      ZSTD_freeCCtx(cs->zc);
+      return NULL;
+    }
+    if (level > 0) {
+      ZSTD_CCtx_setParameter(cs->zc, ZSTD_c_compressionLevel, level);
+    }
+#endif
+  } else {
+    return NULL;
+  }
+  if (pipe(fds) == -1) {
+    compress_stream_close(cs);
+    return NULL;
+  }
+  cs->pipe_in = fds[0];
+  cs->out = fdopen(fds[1], "w");
+  if (cs->out == NULL) {
+    close(fds[0]);
+    close(fds[1]);
+    compress_stream_close(cs);
+    return NULL;
+  }
+  if (pthread_create(&cs->worker, NULL, compress_worker, cs) != 0) {
+    fclose(cs->out);
+    close(fds[0]);
+    cs->out = NULL;
+    compress_stream_close(cs);
+    return NULL;
+  }
+  cs->started = true;
+  return cs->out;
+}
+
+/** Finishes a compressed file: closes the pipe, waits for the compression
+ thread and closes the output.
+
+ @return 0, or -1 if anything failed to write.
+ */
+int compress_stream_close(struct CompressStream *cs) {
+  if (cs->out != NULL && fclose(cs->out) != 0) {
+    cs->failed = true;
+  }
+  cs->out = NULL;
+  if (cs->started) {
+    pthread_join(cs->worker, NULL);
+    cs->started = false;
+  }
+  if (cs->gz != NULL) {
+    if (gzclose(cs->gz) != Z_OK) {
+      cs->failed = true;
+    }
+    cs->gz = NULL;
+  }
+#ifdef HAVE_ZSTD
+  ZSTD_freeCCtx(cs->zc);
+  cs->zc = NULL;
+  if (cs->file != NULL && fclose(cs->file) != 0) {
+    cs->failed = true;
+  }
+  cs->file = NULL;
+#endif
+  return cs->failed ? -1 : 0;
+}
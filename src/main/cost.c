@@ -0,0 +1,453 @@
+/*
+ * GraphPass:
+ * A utility to filter networks and provide a default visualization output
+ * for Gephi or SigmaJS.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** @file cost.c
+ @brief Predicts the time and memory of a run (--dry-run, --memory-budget,
+ --time-budget).
+
+ Once the graph is loaded its size is known, and the cost of everything
+ after it follows from n, m and the run options:
+
+ - each metric the planner asks for on the original graph (see planner.c),
+   from its complexity: O(n + m) for degrees, O(k(n + m)) for the iterative
+   centralities, O(s(n + m)) for betweenness from s sources, O(n^2 log n)
+   for walktrap and O(i n^2) for the Fruchterman-Reingold layout;
+ - for each filter method, a pass over the edges to build its view, the
+   subgraph built from it unless the view is enough (see view.c), the
+   metrics planned for filtered graphs on the n - cutsize vertices that
+   are left, and formatting the output;
+ - the methods running ug_jobs at a time, each worker holding its own copy.
+
+ Operation counts become seconds through NS_PER_OP, nanoseconds per
+ operation of each metric.  The values below have not been measured: they
+ are conservative guesses from the complexity of each metric.  cost_bench
+ (src/bench) times every metric on real graphs and prints NS_PER_OP,
+ COST_NS_LOAD_BYTE and COST_MEASURED ready to replace them, under a
+ comment naming the machine and the graphs; keep that comment with the
+ values.  Until then --dry-run marks its times as unmeasured.
+
+ GraphML and CSV files do not record their size, so the estimate is made
+ after loading, before any analysis.
+ */
+
+#include <graphpass.h>
+#include <dirent.h>
+
+#define COST_BASE_BYTES (8 << 20) /**< the process before it loads anything. */
+#define COST_ARPACK_ITERATIONS 30 /**< matrix-vector products per ARPACK solve. */
+#define COST_PAGERANK_ITERATIONS 50
+#define COST_LAYOUT_ITERATIONS 500 /**< niter in layout_graph. */
+#define COST_WALKTRAP_VECTORS 64 /**< probability vectors walktrap holds at once. */
+#define COST_MEASURED 0 /**< 1 once the values below come from cost_bench. */
+#define COST_NS_LOAD_BYTE 15.0 /**< parsing, per byte of input. */
+#define COST_NS_COPY 10.0 /**< view_materialize, per vertex and edge. */
+#define COST_NS_WRITE_BYTE 8.0 /**< formatting and writing, per byte of output. */
+#define COST_NODE_BYTES 80 /**< an output node without attributes. */
+#define COST_EDGE_BYTES 60
+#define COST_VALUE_BYTES 30 /**< one attribute value in the output. */
+
+/** Nanoseconds per operation counted by metric_cost, in metric_t order.
+ Not yet measured, see above. */
+static const double NS_PER_OP[] = {
+  4.0,  /* Authority */
+  6.0,  /* Betweenness */
+  2.0,  /* Degree */
+  4.0,  /* DegreeRank */
+  4.0,  /* Hub */
+  2.0,  /* Indegree */
+  2.0,  /* Outdegree */
+  4.0,  /* Eigenvector */
+  4.0,  /* PageRank */
+  1.0,  /* WalkTrapModularity */
+  2.0, 2.0, 2.0, 2.0, 2.0, 2.0, 2.0, 2.0, /* centralizations */
+  6.0,  /* AVG_PATH_LENGTH */
+  6.0,  /* DIAMETER */
+  5.0,  /* OVERALL_CLUSTERING */
+  3.0,  /* ASSORTATIVITY */
+  3.0,  /* degree ASSORTATIVITY */
+  1.0,  /* DENSITY */
+  3.0,  /* RECIPROCITY */
+  5.0,  /* Layout */
+  2.0,  /* Colors */
+  2.0   /* Size */
+};
+
+/** The size of a file, or of the files directly inside a directory.
+
+ @return the number of bytes, or -1 if path does not exist.
+ */
+long input_size(const char *path) {
+  struct stat st;
+  long bytes = 0;
+  if (stat(path, &st) != 0) {
+    return -1;
+  }
+  if (!S_ISDIR(st.st_mode)) {
+    return (long) st.st_size;
+  }
+  DIR *dir = opendir(path);
+  struct dirent *entry;
+  char child[PATH_MAX];
+  while (dir != NULL && (entry = readdir(dir)) != NULL) {
+    snprintf(child, sizeof(child), "%s/%s", path, entry->d_name);
+    if (entry->d_name[0] != '.' && stat(child, &st) == 0 && S_ISREG(st.st_mode)) {
+      bytes += (long) st.st_size;
+    }
+  }
+  if (dir != NULL) {
+    closedir(dir);
+  }
+  return bytes;
+}
+
+/** Estimates the memory igraph holds for a graph and its attributes. */
+size_t graph_memory(igraph_t *graph) {
+  igraph_strvector_t gnames, vnames, enames;
+  igraph_vector_t gtypes, vtypes, etypes;
+  long vc = igraph_vcount(graph);
+  long ec = igraph_ecount(graph);
+  /* from, to and the two edge indexes, plus the two vertex offset vectors */
+  size_t bytes = (4 * ec + 2 * (vc + 1)) * sizeof(igraph_real_t);
+  igraph_strvector_init(&gnames, 0);
+  igraph_strvector_init(&vnames, 0);
+  igraph_strvector_init(&enames, 0);
+  igraph_vector_init(&gtypes, 0);
+  igraph_vector_init(&vtypes, 0);
+  igraph_vector_init(&etypes, 0);
+  igraph_cattribute_list(graph, &gnames, &gtypes, &vnames, &vtypes, &enames, &etypes);
+  for (int kind=0; kind<2; kind++) {
+    igraph_strvector_t *names = kind ? &enames : &vnames;
+    igraph_vector_t *types = kind ? &etypes : &vtypes;
+    long n = kind ? ec : vc;
+    for (long i=0; i<igraph_strvector_size(names); i++) {
+      if (VECTOR(*types)[i] != IGRAPH_ATTRIBUTE_STRING) {
+        bytes += n * sizeof(igraph_real_t);
+        continue;
+      }
+      igraph_strvector_t values;
+      igraph_strvector_init(&values, 0);
+      if (kind) {
+        igraph_cattribute_EASV(graph, STR(*names, i), igraph_ess_all(IGRAPH_EDGEORDER_ID), &values);
+      } else {
+        igraph_cattribute_VASV(graph, STR(*names, i), igraph_vss_all(), &values);
+      }
+      for (long j=0; j<igraph_strvector_size(&values); j++) {
+        bytes += strlen(STR(values, j)) + 1 + sizeof(char*);
+      }
+      igraph_strvector_destroy(&values);
+    }
+  }
+  igraph_strvector_destroy(&gnames);
+  igraph_strvector_destroy(&vnames);
+  igraph_strvector_destroy(&enames);
+  igraph_vector_destroy(&gtypes);
+  igraph_vector_destroy(&vtypes);
+  igraph_vector_destroy(&etypes);
+  return bytes;
+}
+
+/** Counts the work of computing one metric on a graph of n vertices and m
+ edges, and the scratch memory it needs.
+
+ @param metric - the metric.
+ @param n - the number of vertices.
+ @param m - the number of edges.
+ @param ops - receives the number of operations (see NS_PER_OP).
+ @param bytes - receives the memory held while it runs, results excluded.
+ */
+void metric_cost(metric_t metric, long n, long m, double *ops, double *bytes) {
+  double nm = (double) n + m;
+  double lg = log2(n + 2.0);
+  double degree = n > 0 ? 2.0 * m / n : 0.0;
+  double registers = (double) (1 << ug_anf_bits);
+  switch (metric) {
+    case MET_AUTHORITY:
+    case MET_HUB:
+      /* A A^T products: two passes over the edges per iteration */
+      *ops = 2.0 * COST_ARPACK_ITERATIONS * nm;
+      *bytes = 20.0 * 8 * n + 16.0 * m;
+      break;
+    case MET_EIGENVECTOR:
+      *ops = COST_ARPACK_ITERATIONS * nm;
+      *bytes = 20.0 * 8 * n + 16.0 * m;
+      break;
+    case MET_PAGERANK:
+      *ops = COST_PAGERANK_ITERATIONS * nm;
+      *bytes = 32.0 * n + 24.0 * m;
+      break;
+    case MET_BETWEENNESS:
+      *ops = (double) betweenness_sources(n) * nm;
+      *bytes = 40.0 * n + 16.0 * m;
+      break;
+    case MET_DEGREE_RANK:
+      *ops = n * lg;
+      *bytes = 24.0 * n;
+      break;
+    case MET_MODULARITY:
+      *ops = (double) n * n * lg;
+      *bytes = 16.0 * nm + 4.0 * n * (n < COST_WALKTRAP_VECTORS ? n : COST_WALKTRAP_VECTORS);
+      break;
+    case MET_PATH_LENGTH:
+    case MET_DIAMETER:
+      if (ug_anf_bits > 0) {
+        /* one round per distance, about 2 log n on small-world graphs */
+        *ops = registers * nm * 2.0 * lg;
+        *bytes = 2.0 * registers * n;
+      } else {
+        *ops = (double) n * nm;
+        *bytes = 24.0 * n + 16.0 * m;
+      }
+      break;
+    case MET_CLUSTERING:
+      *ops = m * (degree + 1.0);
+      *bytes = 16.0 * nm;
+      break;
+    case MET_LAYOUT:
+      *ops = COST_LAYOUT_ITERATIONS * ((double) n * n + m);
+      *bytes = 48.0 * n;
+      break;
+    case MET_ASSORTATIVITY:
+    case MET_DEGREE_ASSORTATIVITY:
+    case MET_DENSITY:
+    case MET_RECIPROCITY:
+    case MET_DEGREE:
+    case MET_INDEGREE:
+    case MET_OUTDEGREE:
+      *ops = nm;
+      *bytes = 8.0 * n;
+      break;
+    default:
+      /* centralizations, colours and sizes read one value per vertex */
+      *ops = n;
+      *bytes = 8.0 * n;
+  }
+}
+
+/** Nanoseconds per operation of a metric (see metric_cost). */
+double metric_ns(metric_t metric) {
+  return NS_PER_OP[metric];
+}
+
+/** The memory a metric's results add to the graph: a vertex attribute, or
+ x and y, or r, g and b. */
+static double metric_result_bytes(metric_t metric, long n) {
+  if (metric <= MET_MODULARITY || metric == MET_SIZE) {
+    return 8.0 * n;
+  }
+  if (metric == MET_LAYOUT) {
+    return 16.0 * n;
+  }
+  return metric == MET_COLORS ? 24.0 * n : 0.0;
+}
+
+/** Costs a plan on a graph of n vertices and m edges.
+
+ @param est - receives a row per metric if not NULL.
+ @param kept - receives the memory of the results.
+ @param scratch - receives the most scratch memory any one metric needs.
+ @return the predicted seconds.
+ */
+static double plan_cost(metric_plan_t plan, long n, long m, struct CostEstimate *est,
+                        double *kept, double *scratch) {
+  double seconds = 0.0;
+  *kept = 0.0;
+  *scratch = 0.0;
+  for (int metric=0; metric<=MET_SIZE; metric++) {
+    double ops, bytes;
+    if (!PLAN_HAS(plan, metric)) {
+      continue;
+    }
+    /* HyperANF measures both at once */
+    if (metric == MET_DIAMETER && ug_anf_bits > 0 && PLAN_HAS(plan, MET_PATH_LENGTH)) {
+      continue;
+    }
+    metric_cost((metric_t) metric, n, m, &ops, &bytes);
+    double s = ops * NS_PER_OP[metric] / 1e9;
+    seconds += s;
+    *kept += metric_result_bytes((metric_t) metric, n);
+    *scratch = bytes > *scratch ? bytes : *scratch;
+    if (est != NULL && est->count < COST_MAX_ROWS) {
+      struct CostRow *row = &est->rows[est->count++];
+      snprintf(row->name, sizeof(row->name), "  %s", metric_name((metric_t) metric));
+      row->seconds = s;
+      row->bytes = bytes;
+    }
+  }
+  return seconds;
+}
+
+static void add_row(struct CostEstimate *est, const char *name, double seconds, double bytes) {
+  if (est->count < COST_MAX_ROWS) {
+    struct CostRow *row = &est->rows[est->count++];
+    snprintf(row->name, sizeof(row->name), "%s", name);
+    row->seconds = seconds;
+    row->bytes = bytes;
+  }
+}
+
+/** The predicted size of an output file. */
+static double output_bytes(long n, long m, long vattrs, long eattrs) {
+  return (double) n * (COST_NODE_BYTES + COST_VALUE_BYTES * vattrs)
+    + (double) m * (COST_EDGE_BYTES + COST_VALUE_BYTES * eattrs);
+}
+
+/** Predicts the time and memory of filtering graph with the run options.
+
+ @param graph - the loaded graph (the global g once load_graph returns).
+ @param input_bytes - the size of the input, see input_size.
+ @param est - receives the estimate.
+ @return 0.
+ */
+int estimate_cost(igraph_t *graph, long input_bytes, struct CostEstimate *est) {
+  long n = igraph_vcount(graph);
+  long m = igraph_ecount(graph);
+  double base = (double) graph_memory(graph);
+  double input = input_bytes > 0 ? (double) input_bytes : 0.0;
+  double kept, scratch, seconds;
+  long vattrs = igraph_cattribute_has_attr(graph, IGRAPH_ATTRIBUTE_VERTEX, "label") ? 1 : 0;
+  memset(est, 0, sizeof(*est));
+
+  /* the input is mapped or buffered while it is parsed */
+  add_row(est, "load", input * COST_NS_LOAD_BYTE / 1e9, base + input);
+  est->seconds = est->rows[0].seconds;
+  double peak = base + input;
+
+  if (ug_quickrun == true) {
+    metric_plan_t plan = PLAN(MET_DEGREE) | PLAN(MET_MODULARITY) | PLAN(MET_COLORS)
+      | PLAN(MET_SIZE) | PLAN(MET_LAYOUT);
+    add_row(est, "analysis and layout", 0.0, 0.0);
+    struct CostRow *phase = &est->rows[est->count - 1];
+    phase->seconds = plan_cost(plan, n, m, est, &kept, &scratch);
+    phase->bytes = kept + scratch;
+    double out = output_bytes(n, m, vattrs + 8, 1);
+    add_row(est, "write", ug_save ? out * COST_NS_WRITE_BYTE / 1e9 : 0.0, OUT_BUFFER_SIZE);
+    est->seconds += phase->seconds + est->rows[est->count - 1].seconds;
+    double analysis = base + kept + scratch;
+    peak = analysis > peak ? analysis : peak;
+    est->peak_bytes = COST_BASE_BYTES + peak;
+    return 0;
+  }
+
+  /* a snapshot or an earlier request may already hold some of the analysis */
+  metric_plan_t plan = plan_missing(graph, plan_base(ug_methods, ug_save, ug_report, ug_report));
+  add_row(est, "analysis", 0.0, 0.0);
+  int analysis_row = est->count - 1;
+  seconds = plan_cost(plan, n, m, est, &kept, &scratch);
+  est->rows[analysis_row].seconds = seconds;
+  est->rows[analysis_row].bytes = kept + scratch;
+  est->seconds += seconds;
+  double analysis = base + kept + scratch;
+  peak = analysis > peak ? analysis : peak;
+  base += kept;
+
+  int methods = 0;
+  for (size_t i=0; ug_methods && i<strlen(ug_methods); i++) {
+    methods += method_attr(ug_methods[i]) != NULL;
+  }
+  if (methods == 0) {
+    est->peak_bytes = COST_BASE_BYTES + peak;
+    return 0;
+  }
+  /* the lowest-scoring vertices, mostly leaves, take about one edge each */
+  long cutsize = filter_cutsize();
+  long left = n - cutsize > 0 ? n - cutsize : 0;
+  double share = n > 0 ? (double) left / n : 0.0;
+  long m_left = m - cutsize > (long) (m * share) ? m - cutsize : (long) (m * share);
+  metric_plan_t derived = plan_derivative(ug_save, ug_report, ug_report);
+  double derived_kept, derived_scratch;
+  double derived_seconds = plan_cost(derived, left, m_left, NULL, &derived_kept, &derived_scratch);
+  double out = ug_save ? output_bytes(left, m_left, vattrs + 12, 1) : 0.0;
+  /* a view costs a pass over the edges; building the subgraph more */
+  bool built = ug_save || (derived & ~PLAN_VIEW) != 0;
+  double worker_seconds = (built ? COST_NS_COPY : 1.0) * ((double) n + m) / 1e9
+    + derived_seconds + out * COST_NS_WRITE_BYTE / 1e9;
+  /* the subgraph, its analysis, the formatted file while it is queued, and
+     its copy of the scratch arena */
+  double worker_bytes = (built ? base * share : 0.0) + derived_kept + derived_scratch
+    + (ug_write_queue > 0 ? out * ug_write_queue : 0.0) + OUT_BUFFER_SIZE
+    + FILTER_SCRATCH_BYTES(n, m);
+  for (size_t i=0; i<strlen(ug_methods); i++) {
+    char *attr = method_attr(ug_methods[i]);
+    if (attr != NULL) {
+      char name[48];
+      snprintf(name, sizeof(name), "filter %s", attr);
+      add_row(est, name, worker_seconds, worker_bytes);
+    }
+  }
+  long jobs = filter_jobs(methods);
+  long rounds = (methods + jobs - 1) / jobs;
+  est->seconds += rounds * worker_seconds;
+  double filtering = base + jobs * worker_bytes;
+  peak = filtering > peak ? filtering : peak;
+  est->peak_bytes = COST_BASE_BYTES + peak;
+  return 0;
+}
+
+/** Estimates a run on a loaded graph and checks it against the budgets and
+ the --max-nodes and --max-edges caps.
+
+ @param graph - the loaded graph.
+ @param input - its path, for the load estimate.
+ @param est - receives the estimate, and the reason if it does not fit.
+ @return 0 if the run fits, -1 if not.
+ */
+int cost_check(igraph_t *graph, const char *input, struct CostEstimate *est) {
+  long n = igraph_vcount(graph);
+  long m = igraph_ecount(graph);
+  estimate_cost(graph, input_size(input), est);
+  if ((ug_maxnodes > 0 && n > ug_maxnodes) || (ug_maxedges > 0 && m > ug_maxedges)) {
+    snprintf(est->reason, sizeof(est->reason),
+             "the graph has %li nodes and %li edges, over --max-nodes or --max-edges", n, m);
+    return -1;
+  }
+  if (ug_memory_budget > 0 && est->peak_bytes > ug_memory_budget) {
+    snprintf(est->reason, sizeof(est->reason),
+             "the run is predicted to use %.0f MB, over the %.0f MB --memory-budget",
+             est->peak_bytes / (1 << 20), ug_memory_budget / (1 << 20));
+    return -1;
+  }
+  if (ug_time_budget > 0 && est->seconds > ug_time_budget) {
+    snprintf(est->reason, sizeof(est->reason),
+             "the run is predicted to take %.0f s, over the %.0f s --time-budget",
+             est->seconds, ug_time_budget);
+    return -1;
+  }
+  return 0;
+}
+
+/** Prints an estimate as a table (--dry-run). */
+void print_cost(FILE *fp, const struct CostEstimate *est) {
+  fprintf(fp, "| Phase                          | Seconds    | Memory MB  |\n");
+  fprintf(fp, "|--------------------------------|------------|------------|\n");
+  for (int i=0; i<est->count; i++) {
+    fprintf(fp, "| %-31s| %-11.2f| %-11.1f|\n", est->rows[i].name,
+            est->rows[i].seconds, est->rows[i].bytes / (1 << 20));
+  }
+  fprintf(fp, "\nPredicted wall time: %.1f s", est->seconds);
+  if (COST_MEASURED == 0) {
+    fprintf(fp, " (from unmeasured estimates, see cost_bench)");
+  }
+  if (ug_time_budget > 0) {
+    fprintf(fp, " (budget %.0f s)", ug_time_budget);
+  }
+  fprintf(fp, "\nPredicted peak memory: %.1f MB", est->peak_bytes / (1 << 20));
+  if (ug_memory_budget > 0) {
+    fprintf(fp, " (budget %.0f MB)", ug_memory_budget / (1 << 20));
+  }
+  fprintf(fp, "\n");
+}
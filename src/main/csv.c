@@ -0,0 +1,684 @@
+/*
+ * GraphPass:
+ * A utility to filter networks and provide a default visualization output
+ * for Gephi or SigmaJS.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** @file csv.c
+ @brief Reads edge lists from CSV or TSV files, or from a directory of
+ shards such as the part-00000 ... files of an Archives Unleashed job.
+
+ Each line is one edge.  A shard may start with a header naming its
+ columns (src/source, dst/dest/target, weight/count, crawl_date/date);
+ without one the columns go by their number:
+
+     src,dst
+     src,dst,weight
+     crawl_date,src,dst,count       (the toolkit's domain graph)
+
+ Fields may be quoted ("a,b" and "" for a quote) but a record may not span
+ lines.  Tab-separated shards are recognised by a tab in the first line,
+ and gzip or zstd shards are decompressed.  Files whose names start with
+ '.' or '_' (_SUCCESS, .crc files) are skipped.
+
+ Shards are split at line boundaries into chunks of CSV_CHUNK_BYTES and
+ parsed on io_threads() workers.  Labels are interned into one hash map
+ shared by the workers, striped over CSV_LOCK_STRIPES locks.  Vertex ids
+ are then numbered in the order labels first appear across the sorted
+ shards, so the graph is the same for any thread count.
+
+ The graph has the attributes of the toolkit's GraphML: a "label" per
+ vertex, "weight" and "crawlDate" per edge when the shards have them, and
+ an "id" per vertex (the label), as load_graphml_mmap sets.
+ */
+
+#include <graphpass.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <strings.h>
+
+#define CSV_CHUNK_BYTES (8 << 20) /**< bytes of a shard parsed per task. */
+#define CSV_LOCK_STRIPES 256
+#define CSV_ARENA_BLOCK (1 << 20)
+#define CSV_MAX_FIELDS 16
+#define CSV_NUMBER_SIZE 64
+
+static const char* SRC_NAMES[] = {"src", "source", "from", "src_domain", "source_domain", NULL};
+static const char* DST_NAMES[] = {"dst", "dest", "target", "to", "dst_domain", "dest_domain",
+                                  "target_domain", NULL};
+static const char* WEIGHT_NAMES[] = {"weight", "count", NULL};
+static const char* DATE_NAMES[] = {"crawl_date", "crawldate", "date", NULL};
+
+/** A distinct vertex label, shared by every worker. */
+struct CsvLabel {
+  struct CsvLabel *next; /**< the next label in the bucket. */
+  uint64_t hash;
+  long id; /**< -1 until the labels are numbered. */
+  size_t len;
+  char name[];
+};
+
+struct CsvEdge {
+  struct CsvLabel *from;
+  struct CsvLabel *to;
+  igraph_real_t weight;
+  const char *date; /**< points into the shard, or an arena. */
+  size_t date_len;
+};
+
+/** One field of a line. */
+struct CsvField {
+  const char *ptr;
+  size_t len;
+  bool escaped; /**< quoted with "" inside, so it must be unescaped. */
+};
+
+struct CsvShard {
+  char *path;
+  char *data;
+  size_t size;
+  int compression; /**< decompressed by the worker that parses it. */
+  char delim;
+  bool header; /**< the first line names the columns. */
+  int src, dst, weight, date; /**< column numbers, -1 if absent. */
+};
+
+struct CsvChunk {
+  struct CsvShard *shard;
+  size_t start;
+  size_t end;
+  struct CsvEdge *edges;
+  long nedges;
+  long cap;
+  long skipped; /**< malformed lines. */
+  bool failed;
+};
+
+struct CsvLoader {
+  struct CsvShard *shards;
+  long nshards;
+  struct CsvChunk *chunks;
+  long nchunks;
+  long next; /**< the next chunk to parse, guarded by queue. */
+  pthread_mutex_t queue;
+  struct CsvLabel **buckets;
+  uint64_t nbuckets;
+  pthread_mutex_t locks[CSV_LOCK_STRIPES];
+};
+
+struct CsvWorker {
+  struct CsvLoader *loader;
+  struct Arena arena; /**< labels and unescaped fields, so workers never wait on malloc. */
+  pthread_t thread;
+};
+
+/** Finds a label, adding it if no worker has seen it yet.
+
+ @return the label, or NULL if memory runs out.
+ */
+static struct CsvLabel* intern(struct CsvLoader *ld, struct Arena *arena,
+                               const char *s, size_t len) {
+  uint64_t hash = fnv_hash(FNV_OFFSET, s, len);
+  uint64_t b = hash & (ld->nbuckets - 1);
+  pthread_mutex_t *lock = &ld->locks[b % CSV_LOCK_STRIPES];
+  struct CsvLabel *label;
+  pthread_mutex_lock(lock);
+  for (label = ld->buckets[b]; label != NULL; label = label->next) {
+    if (label->hash == hash && label->len == len && memcmp(label->name, s, len) == 0) {
+      break;
+    }
+  }
+  if (label == NULL) {
+    label = (struct CsvLabel*) arena_alloc(arena, sizeof(struct CsvLabel) + len + 1);
+    if (label != NULL) {
+      label->hash = hash;
+      label->id = -1;
+      label->len = len;
+      memcpy(label->name, s, len);
+      label->name[len] = '\0';
+      label->next = ld->buckets[b];
+      ld->buckets[b] = label;
+    }
+  }
+  pthread_mutex_unlock(lock);
+  return label;
+}
+
+/** Splits the line [p, eol) into at most CSV_MAX_FIELDS fields.
+
+ @return the number of fields.
+ */
+static int split_fields(const char *p, const char *eol, char delim, struct CsvField *fields) {
+  int n = 0;
+  while (n < CSV_MAX_FIELDS) {
+    struct CsvField f = {p, 0, false};
+    if (p < eol && *p == '"') {
+      const char *q = ++p;
+      f.ptr = q;
+      while (q < eol) {
+        if (*q == '"') {
+          if (q + 1 < eol && q[1] == '"') {
+            f.escaped = true;
+            q += 2;
+            continue;
+          }
+          break;
+        }
+        q++;
+      }
+      f.len = q - f.ptr;
+      p = q < eol ? q + 1 : eol;
+      while (p < eol && *p != delim) {
+        p++;
+      }
+    } else {
+      const char *q = p;
+      while (q < eol && *q != delim) {
+        q++;
+      }
+      f.len = q - p;
+      p = q;
+    }
+    fields[n++] = f;
+    if (p >= eol) {
+      break;
+    }
+    p++;
+  }
+  return n;
+}
+
+/** Returns the text of a field, unescaped into the arena if it must be. */
+static const char* field_text(struct Arena *arena, struct CsvField *f) {
+  if (!f->escaped) {
+    return f->ptr;
+  }
+  char *text = (char*) arena_alloc(arena, f->len + 1);
+  size_t len = 0;
+  if (text == NULL) {
+    return NULL;
+  }
+  for (size_t i=0; i<f->len; i++) {
+    text[len++] = f->ptr[i];
+    if (f->ptr[i] == '"' && i + 1 < f->len && f->ptr[i + 1] == '"') {
+      i++;
+    }
+  }
+  text[len] = '\0';
+  f->len = len;
+  f->escaped = false;
+  return text;
+}
+
+static bool field_is(const struct CsvField *f, const char **names) {
+  for (; *names != NULL; names++) {
+    if (strlen(*names) == f->len && strncasecmp(f->ptr, *names, f->len) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/** Reads the delimiter and the columns of a shard from its first line.
+
+ @return 0, or -1 if a header lacks a source or target column.
+ */
+static int read_columns(struct CsvShard *shard) {
+  struct CsvField fields[CSV_MAX_FIELDS];
+  const char *eol = memchr(shard->data, '\n', shard->size);
+  eol = eol ? eol : shard->data + shard->size;
+  if (eol > shard->data && eol[-1] == '\r') {
+    eol--;
+  }
+  shard->delim = memchr(shard->data, '\t', eol - shard->data) ? '\t' : ',';
+  int n = split_fields(shard->data, eol, shard->delim, fields);
+  shard->src = shard->dst = shard->weight = shard->date = -1;
+  for (int i=0; i<n; i++) {
+    if (field_is(&fields[i], SRC_NAMES)) { shard->src = i; }
+    else if (field_is(&fields[i], DST_NAMES)) { shard->dst = i; }
+    else if (field_is(&fields[i], WEIGHT_NAMES)) { shard->weight = i; }
+    else if (field_is(&fields[i], DATE_NAMES)) { shard->date = i; }
+  }
+  shard->header = shard->src >= 0 || shard->dst >= 0 || shard->weight >= 0 || shard->date >= 0;
+  if (shard->header) {
+    return (shard->src >= 0 && shard->dst >= 0) ? 0 : -1;
+  }
+  if (n >= 4) {
+    shard->date = 0;
+    shard->src = 1;
+    shard->dst = 2;
+    shard->weight = 3;
+  } else {
+    shard->src = 0;
+    shard->dst = 1;
+    shard->weight = n == 3 ? 2 : -1;
+  }
+  return 0;
+}
+
+static bool push_edge(struct CsvChunk *chunk, struct CsvEdge *edge) {
+  if (chunk->nedges == chunk->cap) {
+    long cap = chunk->cap ? 2 * chunk->cap : 1024;
+    struct CsvEdge *edges = (struct CsvEdge*) realloc(chunk->edges, cap * sizeof(struct CsvEdge));
+    if (edges == NULL) {
+      return false;
+    }
+    chunk->edges = edges;
+    chunk->cap = cap;
+  }
+  chunk->edges[chunk->nedges++] = *edge;
+  return true;
+}
+
+/** Parses the lines of one chunk into edges. */
+static void parse_chunk(struct CsvLoader *ld, struct Arena *arena, struct CsvChunk *chunk) {
+  struct CsvShard *shard = chunk->shard;
+  struct CsvField fields[CSV_MAX_FIELDS];
+  const char *p = shard->data + chunk->start;
+  const char *end = shard->data + chunk->end;
+  int needed = (shard->src > shard->dst ? shard->src : shard->dst) + 1;
+  if (shard->header && chunk->start == 0) {
+    const char *eol = memchr(p, '\n', end - p);
+    p = eol ? eol + 1 : end;
+  }
+  while (p < end && !chunk->failed) {
+    const char *eol = memchr(p, '\n', end - p);
+    const char *next = eol ? eol + 1 : end;
+    eol = eol ? eol : end;
+    if (eol > p && eol[-1] == '\r') {
+      eol--;
+    }
+    if (eol == p) {
+      p = next;
+      continue;
+    }
+    int n = split_fields(p, eol, shard->delim, fields);
+    p = next;
+    if (n < needed) {
+      chunk->skipped++;
+      continue;
+    }
+    struct CsvEdge edge = {NULL, NULL, 0.0, NULL, 0};
+    const char *src = field_text(arena, &fields[shard->src]);
+    const char *dst = field_text(arena, &fields[shard->dst]);
+    edge.from = src ? intern(ld, arena, src, fields[shard->src].len) : NULL;
+    edge.to = dst ? intern(ld, arena, dst, fields[shard->dst].len) : NULL;
+    if (shard->weight >= 0 && shard->weight < n) {
+      /* copied, because strtod would read past the end of a mapped file */
+      char number[CSV_NUMBER_SIZE];
+      struct CsvField *f = &fields[shard->weight];
+      size_t len = f->len < CSV_NUMBER_SIZE - 1 ? f->len : CSV_NUMBER_SIZE - 1;
+      memcpy(number, f->ptr, len);
+      number[len] = '\0';
+      edge.weight = strtod(number, NULL);
+    }
+    if (shard->date >= 0 && shard->date < n) {
+      edge.date = field_text(arena, &fields[shard->date]);
+      edge.date_len = fields[shard->date].len;
+    }
+    if (edge.from == NULL || edge.to == NULL
+        || (shard->date >= 0 && shard->date < n && edge.date == NULL)
+        || !push_edge(chunk, &edge)) {
+      chunk->failed = true;
+    }
+  }
+}
+
+/** Decompresses a compressed shard, which is always a single chunk. */
+static void inflate_chunk(struct CsvChunk *chunk) {
+  struct CsvShard *shard = chunk->shard;
+  if (decompress_file(shard->path, shard->compression, &shard->data, &shard->size) != 0) {
+    chunk->failed = true;
+    return;
+  }
+  chunk->end = shard->size;
+  if (shard->size > 0 && read_columns(shard) != 0) {
+    chunk->failed = true;
+  }
+}
+
+static void* csv_worker(void *arg) {
+  struct CsvWorker *worker = (struct CsvWorker*) arg;
+  struct CsvLoader *ld = worker->loader;
+  for (;;) {
+    pthread_mutex_lock(&ld->queue);
+    long c = ld->next++;
+    pthread_mutex_unlock(&ld->queue);
+    if (c >= ld->nchunks) {
+      break;
+    }
+    struct CsvChunk *chunk = &ld->chunks[c];
+    if (chunk->shard->compression != COMPRESSION_NONE) {
+      inflate_chunk(chunk);
+    }
+    if (!chunk->failed) {
+      parse_chunk(ld, &worker->arena, chunk);
+    }
+  }
+  return NULL;
+}
+
+static int compare_paths(const void *a, const void *b) {
+  return strcmp(*(char* const*) a, *(char* const*) b);
+}
+
+/** Lists the shards to read: the file itself, or the visible files of a
+ directory in name order.
+
+ @return the number of shards, or -1 if the directory cannot be read.
+ */
+static long list_shards(const char *path, char ***paths) {
+  struct stat st;
+  *paths = NULL;
+  if (stat(path, &st) != 0) {
+    return -1;
+  }
+  if (!S_ISDIR(st.st_mode)) {
+    *paths = (char**) malloc(sizeof(char*));
+    (*paths)[0] = strdup(path);
+    return 1;
+  }
+  DIR *dir = opendir(path);
+  if (dir == NULL) {
+    return -1;
+  }
+  long count = 0, cap = 0;
+  struct dirent *entry;
+  size_t dirlen = strlen(path);
+  bool slash = dirlen > 0 && path[dirlen - 1] == '/';
+  while ((entry = readdir(dir)) != NULL) {
+    if (entry->d_name[0] == '.' || entry->d_name[0] == '_') {
+      continue;
+    }
+    char *file = (char*) malloc(dirlen + strlen(entry->d_name) + 2);
+    sprintf(file, slash ? "%s%s" : "%s/%s", path, entry->d_name);
+    if (stat(file, &st) != 0 || !S_ISREG(st.st_mode)) {
+      free(file);
+      continue;
+    }
+    if (count == cap) {
+      cap = cap ? 2 * cap : 64;
+      *paths = (char**) realloc(*paths, cap * sizeof(char*));
+    }
+    (*paths)[count++] = file;
+  }
+  closedir(dir);
+  qsort(*paths, count, sizeof(char*), compare_paths);
+  return count;
+}
+
+/** Opens every shard and cuts the uncompressed ones into chunks. */
+static int plan_chunks(struct CsvLoader *ld, uint64_t *bytes) {
+  long cap = ld->nshards;
+  ld->chunks = (struct CsvChunk*) calloc(cap ? cap : 1, sizeof(struct CsvChunk));
+  *bytes = 0;
+  for (long s=0; s<ld->nshards; s++) {
+    struct CsvShard *shard = &ld->shards[s];
+    int compression = detect_compression(shard->path);
+    if (compression < 0) {
+      return -1;
+    }
+    shard->compression = compression;
+    if (compression == COMPRESSION_NONE) {
+      int fd = open(shard->path, O_RDONLY);
+      struct stat st_file;
+      if (fd < 0 || fstat(fd, &st_file) != 0) {
+        if (fd >= 0) {
+          close(fd);
+        }
+        return -1;
+      }
+      shard->size = st_file.st_size;
+      if (shard->size > 0) {
+        shard->data = mmap(NULL, shard->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (shard->data == MAP_FAILED) {
+          shard->data = NULL;
+          close(fd);
+          return -1;
+        }
+        madvise(shard->data, shard->size, MADV_SEQUENTIAL);
+      }
+      close(fd);
+      if (shard->size == 0) {
+        continue;
+      }
+      if (read_columns(shard) != 0) {
+        return -1;
+      }
+    } else {
+      struct stat st_file;
+      if (stat(shard->path, &st_file) == 0) {
+        /* a guess at the decompressed size, only used to size the label map */
+        shard->size = 4 * st_file.st_size;
+      }
+    }
+    *bytes += shard->size;
+    size_t start = 0;
+    do {
+      size_t end = shard->size;
+      if (compression == COMPRESSION_NONE && shard->size - start > CSV_CHUNK_BYTES) {
+        const char *nl = memchr(shard->data + start + CSV_CHUNK_BYTES, '\n',
+                                shard->size - start - CSV_CHUNK_BYTES);
+        end = nl ? (size_t) (nl - shard->data) + 1 : shard->size;
+      }
+      if (ld->nchunks == cap) {
+        cap *= 2;
+        ld->chunks = (struct CsvChunk*) realloc(ld->chunks, cap * sizeof(struct CsvChunk));
+      }
+      struct CsvChunk *chunk = &ld->chunks[ld->nchunks++];
+      memset(chunk, 0, sizeof(*chunk));
+      chunk->shard = shard;
+      chunk->start = start;
+      chunk->end = compression == COMPRESSION_NONE ? end : 0;
+      start = end;
+    } while (compression == COMPRESSION_NONE && start < shard->size);
+    if (compression != COMPRESSION_NONE) {
+      shard->size = 0;
+    }
+  }
+  return 0;
+}
+
+/** Numbers the labels in order of first appearance and builds the graph. */
+static int build_graph(struct CsvLoader *ld, igraph_t *graph) {
+  long m = 0, n = 0, cap = 1024;
+  bool weights = false, dates = false;
+  for (long c=0; c<ld->nchunks; c++) {
+    struct CsvShard *shard = ld->chunks[c].shard;
+    m += ld->chunks[c].nedges;
+    weights |= shard->weight >= 0;
+    dates |= shard->date >= 0;
+  }
+  struct CsvLabel **labels = (struct CsvLabel**) malloc(cap * sizeof(struct CsvLabel*));
+  igraph_vector_t el;
+  igraph_vector_init(&el, 2 * m);
+  long e = 0;
+  for (long c=0; c<ld->nchunks && labels != NULL; c++) {
+    for (long i=0; i<ld->chunks[c].nedges && labels != NULL; i++) {
+      struct CsvLabel *ends[2] = {ld->chunks[c].edges[i].from, ld->chunks[c].edges[i].to};
+      for (int k=0; k<2; k++) {
+        if (ends[k]->id < 0) {
+          if (n == cap) {
+            cap *= 2;
+            struct CsvLabel **bigger = (struct CsvLabel**) realloc(labels, cap * sizeof(*labels));
+            if (bigger == NULL) {
+              free(labels);
+              labels = NULL;
+              break;
+            }
+            labels = bigger;
+          }
+          ends[k]->id = n;
+          labels[n++] = ends[k];
+        }
+        VECTOR(el)[e++] = ends[k]->id;
+      }
+    }
+  }
+  if (labels == NULL) {
+    igraph_vector_destroy(&el);
+    return -1;
+  }
+  igraph_empty(graph, n, IGRAPH_DIRECTED);
+  igraph_add_edges(graph, &el, 0);
+  igraph_vector_destroy(&el);
+
+  igraph_strvector_t names;
+  igraph_strvector_init(&names, n);
+  for (long i=0; i<n; i++) {
+    igraph_strvector_set2(&names, i, labels[i]->name, labels[i]->len);
+  }
+  SETVASV(graph, "label", &names);
+  SETVASV(graph, "id", &names);
+  igraph_strvector_destroy(&names);
+  free(labels);
+  if (weights) {
+    igraph_vector_t col;
+    igraph_vector_init(&col, m);
+    for (long c=0, i=0; c<ld->nchunks; c++) {
+      for (long j=0; j<ld->chunks[c].nedges; j++) {
+        VECTOR(col)[i++] = ld->chunks[c].edges[j].weight;
+      }
+    }
+    SETEANV(graph, "weight", &col);
+    igraph_vector_destroy(&col);
+  }
+  if (dates) {
+    igraph_strvector_t col;
+    igraph_strvector_init(&col, m);
+    for (long c=0, i=0; c<ld->nchunks; c++) {
+      for (long j=0; j<ld->chunks[c].nedges; j++, i++) {
+        struct CsvEdge *edge = &ld->chunks[c].edges[j];
+        if (edge->date != NULL) {
+          igraph_strvector_set2(&col, i, edge->date, edge->date_len);
+        }
+      }
+    }
+    SETEASV(graph, "crawlDate", &col);
+    igraph_strvector_destroy(&col);
+  }
+  return 0;
+}
+
+/** True if a path is read as CSV: a directory of shards, or a file named
+ .csv or .tsv (optionally followed by a compression extension). */
+bool is_csv_input(const char *path) {
+  struct stat st;
+  if (stat(path, &st) == 0 && S_ISDIR(st.st_mode)) {
+    return true;
+  }
+  size_t len = strlen(path);
+  const char *exts[] = {GZIP_EXT, ZSTD_EXT};
+  for (size_t i=0; i<NELEMS(exts); i++) {
+    size_t n = strlen(exts[i]);
+    if (len > n && strcmp(path + len - n, exts[i]) == 0) {
+      len -= n;
+      break;
+    }
+  }
+  return len > 4 && (strncasecmp(path + len - 4, ".csv", 4) == 0
+                     || strncasecmp(path + len - 4, ".tsv", 4) == 0);
+}
+
+/** Loads an edge list from a CSV or TSV file, or a directory of shards.
+
+ @param path - the file or directory.
+ @param graph - an uninitialized graph, initialized only on success.
+ @return 0, or -1 if a shard cannot be read or has a header without
+ source and target columns.
+ */
+int load_csv(const char *path, igraph_t *graph) {
+  struct CsvLoader ld;
+  char **paths;
+  memset(&ld, 0, sizeof(ld));
+  ld.nshards = list_shards(path, &paths);
+  if (ld.nshards < 0) {
+    return -1;
+  }
+  ld.shards = (struct CsvShard*) calloc(ld.nshards ? ld.nshards : 1, sizeof(struct CsvShard));
+  for (long s=0; s<ld.nshards; s++) {
+    ld.shards[s].path = paths[s];
+    ld.shards[s].src = ld.shards[s].dst = ld.shards[s].weight = ld.shards[s].date = -1;
+  }
+  free(paths);
+  uint64_t bytes;
+  int result = plan_chunks(&ld, &bytes);
+  long threads = io_threads();
+  threads = threads < ld.nchunks ? threads : (ld.nchunks ? ld.nchunks : 1);
+  struct CsvWorker *workers = (struct CsvWorker*) calloc(threads, sizeof(struct CsvWorker));
+  if (result == 0) {
+    /* about one bucket per two labels for domain graphs */
+    ld.nbuckets = 4096;
+    while (ld.nbuckets < bytes / 64 && ld.nbuckets < ((uint64_t) 1 << 24)) {
+      ld.nbuckets *= 2;
+    }
+    ld.buckets = (struct CsvLabel**) calloc(ld.nbuckets, sizeof(struct CsvLabel*));
+    pthread_mutex_init(&ld.queue, NULL);
+    for (int i=0; i<CSV_LOCK_STRIPES; i++) {
+      pthread_mutex_init(&ld.locks[i], NULL);
+    }
+    long started = 0;
+    for (long t=0; t<threads; t++) {
+      workers[t].loader = &ld;
+      arena_reserve(&workers[t].arena, CSV_ARENA_BLOCK);
+      if (t > 0 && pthread_create(&workers[t].thread, NULL, csv_worker, &workers[t]) != 0) {
+        break;
+      }
+      started = t + 1;
+    }
+    /* this thread is worker 0 */
+    csv_worker(&workers[0]);
+    for (long t=1; t<started; t++) {
+      pthread_join(workers[t].thread, NULL);
+    }
+    pthread_mutex_destroy(&ld.queue);
+    for (int i=0; i<CSV_LOCK_STRIPES; i++) {
+      pthread_mutex_destroy(&ld.locks[i]);
+    }
+    long skipped = 0;
+    for (long c=0; c<ld.nchunks; c++) {
+      result = ld.chunks[c].failed ? -1 : result;
+      skipped += ld.chunks[c].skipped;
+    }
+    if (result == 0) {
+      result = build_graph(&ld, graph);
+    }
+    if (ug_verbose == true) {
+      printf("Read %li CSV shards in %li chunks on %li threads, skipped %li malformed lines.\n",
+             ld.nshards, ld.nchunks, threads, skipped);
+    }
+  }
+  for (long t=0; t<threads; t++) {
+    arena_free(&workers[t].arena);
+  }
+  free(workers);
+  for (long c=0; c<ld.nchunks; c++) {
+    free(ld.chunks[c].edges);
+  }
+  for (long s=0; s<ld.nshards; s++) {
+    struct CsvShard *shard = &ld.shards[s];
+    if (shard->compression == COMPRESSION_NONE && shard->data != NULL) {
+      munmap(shard->data, shard->size);
+    } else {
+      free(shard->data);
+    }
+    free(shard->path);
+  }
+  free(ld.chunks);
+  free(ld.shards);
+  free(ld.buckets);
+  return result;
+}
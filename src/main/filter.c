@@ -17,6 +17,8 @@
  */
 
 #include <graphpass.h>
+#include <limits.h>
+#include <sys/wait.h>
 
 /** @file filter.c
  @brief Basic filtering utilities
@@ -39,30 +41,82 @@ float fix_percentile() {
   return perc;
 }
 
-/** Create a graph from an original graph with a number of nodes equal to
-   cutsize.
+/** Builds an index from the idRef of each vertex in graph to its vertex id
+  in the graph that remains once the vertices in cut are deleted.
+
+  Deleting vertices keeps the remaining vertices in their original order, so
+  the index can be computed from the cut list alone.  Vertices that are cut
+  map to -1.
+
+  @param graph - the graph being filtered (must have an "idRef" attribute).
+  @param cut - the vertex ids to remove.
+  @param cutsize - the number of entries in cut.
+  @param index - an uninitialized vector, made a view of ug_scratch that is
+  given back with the caller's arena_release rather than destroyed.
+
+  @return 0 unless an error occurs.
+ */
+int build_filter_index(igraph_t *graph, double *cut, int cutsize, igraph_vector_long_t *index) {
+  long int n = igraph_vcount(graph);
+  long int kept = 0;
+  long int *data = arena_alloc(&ug_scratch, (n > 0 ? n : 1) * sizeof(long int));
+  if (data == NULL) {
+    return -1;
+  }
+  igraph_vector_long_view(index, data, n);
+  igraph_vector_long_fill(index, -1);
+  struct ArenaMark mark = arena_mark(&ug_scratch);
+  igraph_vector_t ids;
+  char *removed = arena_calloc(&ug_scratch, n > 0 ? n : 1, 1);
+  if (removed == NULL || arena_vector(&ug_scratch, &ids, n) != 0) {
+    arena_release(&ug_scratch, mark);
+    return -1;
+  }
+  VANV(graph, "idRef", &ids);
+  for (long int i=0; i<cutsize; i++) {
+    if (cut[i] >= 0 && cut[i] < n) {
+      removed[(long int)cut[i]] = 1;
+    }
+  }
+  for (long int i=0; i<n; i++) {
+    long int ref = (long int)VECTOR(ids)[i];
+    if (!removed[i] && ref >= 0 && ref < n) {
+      VECTOR(*index)[ref] = kept;
+    }
+    if (!removed[i]) {
+      ++kept;
+    }
+  }
+  arena_release(&ug_scratch, mark);
+  return 0;
+}
+
+/** Chooses the vertices to remove from a graph for a method.
+
+  Vertices scoring below cutoff are always cut; vertices scoring exactly
+  cutoff are chosen at random (with rand(), see seed_method) to make up
+  cutsize.  Scratch space comes from
+  ug_scratch and is given back before returning.
 
   @param graph - the graph to filter
   @param cutoff - the value to use as a cutoff value.
-  @param cutsize - the size of the requested graph.
+  @param cutsize - the number of vertices to cut.
   @param attr - the method used to shorten the graph
+  @param cut - an array of cutsize entries to receive the vertex ids to cut.
 
   @return 0 unless an error occurs.
  */
-int create_filtered_graph(igraph_t *graph, double cutoff, int cutsize, char* attr) {
-  srand(time(NULL));
+int select_cut(igraph_t *graph, double cutoff, int cutsize, char* attr, double *cut) {
   int checkFewer = 0;
   int checkEqual = 0;
-  /* a View containing the ids to keep */
-  igraph_vector_t grands;
-  igraph_vs_t selector;
-  igraph_t g2;
-  igraph_copy(&g2, graph);
-  /* the ids to cut */
-  double cut[cutsize];
+  struct ArenaMark mark = arena_mark(&ug_scratch);
   /** Random filtering is most basic */
   if (strcmp(attr, "Random") == 0) {
-    int precut[NODESIZE];
+    int *precut = arena_alloc(&ug_scratch, (NODESIZE > 0 ? NODESIZE : 1) * sizeof(int));
+    if (precut == NULL) {
+      arena_release(&ug_scratch, mark);
+      return -1;
+    }
     /* remove cutsize based on shuffle */
     for (long int i=0; i<NODESIZE; i++) {
       precut[i] = i;
@@ -72,24 +126,34 @@ int create_filtered_graph(igraph_t *graph, double cutoff, int cutsize, char* att
       cut[j] = precut[j];
     }
   } else {
+    igraph_vector_t vals;
+    if (arena_vector(&ug_scratch, &vals, NODESIZE) != 0) {
+      arena_release(&ug_scratch, mark);
+      return -1;
+    }
+    VANV(graph, attr, &vals);
     /* check the number of values less than (checkFewer) or equal (checkEqual) to
      the assigned cutoff value */
     for (long int i=0; i<NODESIZE; i++) {
-      if (VAN(graph, attr, i) < cutoff) {
+      if (VECTOR(vals)[i] < cutoff) {
         ++checkFewer;  // number of nodes fewer than cutoff
-      } else if (VAN(graph, attr, i) == cutoff){
+      } else if (VECTOR(vals)[i] == cutoff){
         ++checkEqual; // number of nodes equal to cutoff
       }
     }
     for (long int i=0; i<cutsize; i++) {
       cut[i] = -1.0;
     }
-    int equal[checkEqual];
+    int *equal = arena_alloc(&ug_scratch, (checkEqual > 0 ? checkEqual : 1) * sizeof(int));
+    if (equal == NULL) {
+      arena_release(&ug_scratch, mark);
+      return -1;
+    }
     if (checkFewer == cutsize) {
       /* if number of equals and less thans are all needed then just do the filter */
       int index = 0;
       for (long int i=0; i<NODESIZE; i++) {
-        if (VAN(graph, attr, i) < cutoff) {
+        if (VECTOR(vals)[i] < cutoff) {
           cut[index] = (double)i;
           ++index;
         }
@@ -102,7 +166,7 @@ int create_filtered_graph(igraph_t *graph, double cutoff, int cutsize, char* att
       printf("    This means that all values that equal the cutoff point will be selected randomly.\n");
       int rands = 0;
       for (long int i=0; i<NODESIZE; i++) {
-        if (VAN(graph, attr, i) == cutoff) {
+        if (VECTOR(vals)[i] == cutoff) {
           equal[rands] = i;
           ++rands;
         }
@@ -120,10 +184,10 @@ int create_filtered_graph(igraph_t *graph, double cutoff, int cutsize, char* att
       int index = 0;
       int rands = 0;
       for (long int i=0; i<NODESIZE; i++) {
-        if (VAN(graph, attr, i) < cutoff) {
+        if (VECTOR(vals)[i] < cutoff) {
           cut[index] = (double)i;
           ++index;
-        } else if (VAN(graph, attr, i) == cutoff) {
+        } else if (VECTOR(vals)[i] == cutoff) {
           equal[rands] = (double)i;
           ++rands;
         }
@@ -143,44 +207,224 @@ int create_filtered_graph(igraph_t *graph, double cutoff, int cutsize, char* att
       }
     }
   }
-  igraph_vector_view(&grands, cut, cutsize);
-  igraph_vs_vector(&selector, &grands);
-  igraph_delete_vertices(&g2, selector);
-  layout_graph(&g2, 'f');
-  calc_degree(&g2, 'd');
-  calc_degree(&g2, 'i');
-  calc_degree(&g2, 'o');
-  calc_betweenness (&g2);
-  calc_eigenvector (&g2);
-  calc_pagerank (&g2);
-  calc_modularity(&g2);
-
-  colors(&g2);
-  igraph_vector_t size;
-  igraph_vector_init(&size, cutsize);
-  igraph_vector_t rank;
-  igraph_vector_init(&rank, igraph_vcount(&g2));
-
-  igraph_vector_t ideg;
-  igraph_vector_t odeg;
-  igraph_vector_init(&ideg, cutsize);
-  igraph_vector_init(&odeg, cutsize);
-
-  VANV(&g2, "Degree", &size);
-  VANV(&g2, "Indegree", &ideg);
-  VANV(&g2, "Outdegree", &odeg);
-  // print size here.
-  produceRank(&size, &rank);
-  SETVANV(&g2, "DegreeRank", &rank);
-  set_size(&g2, &size, 100);
-  centralization(&g2, "Betweenness");
-  centralization(&g2, "PageRank");
-  centralization(&g2, "Degree");
-  centralization(&g2, "Eigenvector");
-  igraph_real_t pathl, cluster, assort, dens, recip, pvals, tsco;
-  igraph_integer_t dia;
-  igraph_average_path_length(graph, &pathl, 1, 1);
-  igraph_diameter(&g2, &dia, NULL, NULL, NULL ,1, 1);
+  arena_release(&ug_scratch, mark);
+  return 0;
+}
+
+/** Create a graph from an original graph with a number of nodes equal to
+   cutsize.
+
+  @param graph - the graph to filter
+  @param cutoff - the value to use as a cutoff value.
+  @param cutsize - the size of the requested graph.
+  @param attr - the method used to shorten the graph
+  @param result - receives the graph-level values for the report.
+
+  @return 0 unless an error occurs.
+ */
+int create_filtered_graph(igraph_t *graph, double cutoff, int cutsize, char* attr,
+                          struct FilterResult *result) {
+  struct ArenaMark mark = arena_mark(&ug_scratch);
+  /* the ids to cut */
+  double *cut = arena_alloc(&ug_scratch, (cutsize > 0 ? cutsize : 1) * sizeof(double));
+  if (cut == NULL || select_cut(graph, cutoff, cutsize, attr, cut) != 0) {
+    arena_release(&ug_scratch, mark);
+    return -1;
+  }
+  int rc = filter_by_cut(graph, cut, cutsize, attr, result);
+  arena_release(&ug_scratch, mark);
+  return rc;
+}
+
+/** Returns a numeric graph attribute, or NaN if the plan did not compute it. */
+static igraph_real_t gan_or_nan(igraph_t *graph, char *name) {
+  if (!igraph_cattribute_has_attr(graph, IGRAPH_ATTRIBUTE_GRAPH, name)) {
+    return NAN;
+  }
+  return GAN(graph, name);
+}
+
+/** Computes the graph-level values of a filtered graph on its view.
+
+  Only for plans within PLAN_VIEW.  Values the plan leaves out are NaN, as
+  for a built graph (see plan_drop_stale).
+ */
+static int filter_on_view(igraph_t *graph, struct GraphView *view, igraph_vector_long_t *index,
+                          metric_plan_t plan, struct FilterResult *result) {
+  igraph_vector_t degree;
+  igraph_real_t degcent = NAN, pvals = NAN, tsco = NAN;
+  if (arena_vector(&ug_scratch, &degree, view->vcount) != 0) {
+    return -1;
+  }
+  if (PLAN_HAS(plan, MET_DEGREE) || PLAN_HAS(plan, MET_C_DEGREE)
+      || PLAN_HAS(plan, MET_DEGREE_RANK)) {
+    view_degree(view, IGRAPH_ALL, &degree);
+  }
+  if (PLAN_HAS(plan, MET_C_DEGREE)) {
+    degcent = view_centralization(view, &degree);
+  }
+  if (PLAN_HAS(plan, MET_DEGREE_RANK)
+      && PLAN_HAS(ug_plan ? ug_plan : PLAN_ANALYSIS_ALL, MET_DEGREE_RANK)) {
+    igraph_vector_t ranks, largeRank, idRef;
+    long int n = igraph_vcount(&g);
+    if (arena_vector(&ug_scratch, &ranks, view->vcount) != 0
+        || arena_vector(&ug_scratch, &largeRank, n) != 0
+        || arena_vector(&ug_scratch, &idRef, n) != 0) {
+      return -1;
+    }
+    rank_vector(&degree, &ranks, RANK_COMPETITION);
+    VANV(&g, "DegreeRank", &largeRank);
+    VANV(&g, "idRef", &idRef);
+    rank_compare_vectors(&largeRank, &idRef, &ranks, index, &pvals, &tsco);
+  }
+  result->write_failed = false;
+  result->assort = NAN;
+  result->edges = view->ecount;
+  result->density = PLAN_HAS(plan, MET_DENSITY) ? view_density(view) : NAN;
+  result->diameter = NAN;
+  result->pathlength = NAN;
+  result->clustering = NAN;
+  result->betcent = NAN;
+  result->degcent = degcent;
+  result->idegcent = NAN;
+  result->odegcent = NAN;
+  result->eigcent = NAN;
+  result->pagecent = NAN;
+  result->reciprocity = PLAN_HAS(plan, MET_RECIPROCITY) ? view_reciprocity(view) : NAN;
+  result->pv = pvals;
+  result->ts = tsco;
+  return 0;
+}
+
+/** Removes the vertices in cut from graph, analyzes what is left, writes
+   it and records its graph-level values.
+
+  The filtered graph starts as a view of graph (see view.c).  If nothing is
+  written and every planned metric can be read through the view, the graph
+  is never built; otherwise view_materialize builds it with only the
+  attributes --attrs keeps (see project.c).  The index, the view and the
+  vectors read from the graph are views of ug_scratch, given back before
+  returning.
+
+  @param graph - the graph to filter
+  @param cut - the vertex ids to remove.
+  @param cutsize - the number of entries in cut.
+  @param attr - the method used to shorten the graph
+  @param result - receives the graph-level values for the report.
+
+  @return 0 unless an error occurs.
+ */
+int filter_by_cut(igraph_t *graph, double *cut, int cutsize, char* attr,
+                  struct FilterResult *result) {
+  igraph_t g2;
+  struct GraphView view;
+  /* a vector as long as the original graph holds any of g2's attributes */
+  long int n = igraph_vcount(graph);
+  struct ArenaMark mark = arena_mark(&ug_scratch);
+  igraph_vector_long_t index;
+  if (build_filter_index(graph, cut, cutsize, &index) != 0
+      || view_init(&view, graph, cut, cutsize) != 0) {
+    arena_release(&ug_scratch, mark);
+    return -1;
+  }
+  metric_plan_t plan = ug_derived_plan ? ug_derived_plan : PLAN_DERIVATIVE_ALL;
+  if (ug_save == false && (plan & ~PLAN_VIEW) == 0) {
+    int rc = filter_on_view(graph, &view, &index, plan, result);
+    arena_release(&ug_scratch, mark);
+    return rc;
+  }
+  if (view_materialize(&view, &g2, output_attrs()) != 0) {
+    arena_release(&ug_scratch, mark);
+    return -1;
+  }
+  plan_drop_stale(&g2, plan);
+  if (PLAN_HAS(plan, MET_LAYOUT)) {
+    layout_graph(&g2, 'f');
+  }
+  if (PLAN_HAS(plan, MET_AUTHORITY)) {
+    calc_authority(&g2);
+  }
+  if (PLAN_HAS(plan, MET_HUB)) {
+    calc_hub(&g2);
+  }
+  if (PLAN_HAS(plan, MET_DEGREE)) {
+    calc_degree(&g2, 'd');
+  }
+  if (PLAN_HAS(plan, MET_INDEGREE)) {
+    calc_degree(&g2, 'i');
+  }
+  if (PLAN_HAS(plan, MET_OUTDEGREE)) {
+    calc_degree(&g2, 'o');
+  }
+  if (PLAN_HAS(plan, MET_BETWEENNESS)) {
+    calc_betweenness (&g2);
+  }
+  if (PLAN_HAS(plan, MET_EIGENVECTOR)) {
+    calc_eigenvector (&g2);
+  }
+  if (PLAN_HAS(plan, MET_PAGERANK)) {
+    calc_pagerank (&g2);
+  }
+  if (PLAN_HAS(plan, MET_MODULARITY)) {
+    calc_modularity(&g2);
+  }
+  if (PLAN_HAS(plan, MET_COLORS)) {
+    colors(&g2);
+  }
+  if (PLAN_HAS(plan, MET_DEGREE_RANK)) {
+    rank_attribute(&g2, "Degree", RANK_COMPETITION);
+  }
+  if (PLAN_HAS(plan, MET_SIZE)) {
+    igraph_vector_t size;
+    if (arena_vector(&ug_scratch, &size, n) == 0) {
+      VANV(&g2, "Degree", &size);
+      set_size(&g2, &size, 100);
+    }
+  }
+  if (PLAN_HAS(plan, MET_C_AUTHORITY)) {
+    centralization(&g2, "Authority");
+  }
+  if (PLAN_HAS(plan, MET_C_BETWEENNESS)) {
+    centralization(&g2, "Betweenness");
+  }
+  if (PLAN_HAS(plan, MET_C_PAGERANK)) {
+    centralization(&g2, "PageRank");
+  }
+  if (PLAN_HAS(plan, MET_C_DEGREE)) {
+    centralization(&g2, "Degree");
+  }
+  if (PLAN_HAS(plan, MET_C_HUB)) {
+    centralization(&g2, "Hub");
+  }
+  if (PLAN_HAS(plan, MET_C_INDEGREE)) {
+    centralization(&g2, "Indegree");
+  }
+  if (PLAN_HAS(plan, MET_C_OUTDEGREE)) {
+    centralization(&g2, "Outdegree");
+  }
+  if (PLAN_HAS(plan, MET_C_EIGENVECTOR)) {
+    centralization(&g2, "Eigenvector");
+  }
+  /* values left out of the plan are reported as NaN and not written */
+  igraph_real_t pathl = NAN, cluster = NAN, assort = NAN, dens = NAN, recip = NAN;
+  igraph_real_t dia = NAN, pvals = NAN, tsco = NAN;
+  /* do not pass on the original graph's distance estimates */
+  if (igraph_cattribute_has_attr(&g2, IGRAPH_ATTRIBUTE_GRAPH, "DISTANCE_DISTRIBUTION")) {
+    DELGA(&g2, "DISTANCE_DISTRIBUTION");
+    DELGA(&g2, "EFFECTIVE_DIAMETER");
+  }
+  if (ug_anf_bits > 0 && (PLAN_HAS(plan, MET_PATH_LENGTH) || PLAN_HAS(plan, MET_DIAMETER))) {
+    estimate_distances(&g2, &pathl, &dia);
+  } else {
+    if (PLAN_HAS(plan, MET_PATH_LENGTH)) {
+      igraph_average_path_length(&g2, &pathl, 1, 1);
+    }
+    if (PLAN_HAS(plan, MET_DIAMETER)) {
+      igraph_integer_t d;
+      igraph_diameter(&g2, &d, NULL, NULL, NULL ,1, 1);
+      dia = d;
+    }
+  }
   /* get Rankings
    int ranks[20];
    igraph_vector_t eids, sorted;
@@ -193,108 +437,455 @@ int create_filtered_graph(igraph_t *graph, double cutoff, int cutsize, char* att
    ++check;
    } */
 
-  igraph_transitivity_undirected(&g, &cluster, IGRAPH_TRANSITIVITY_ZERO);
-  igraph_assortativity(&g2, &ideg, &odeg, &assort, 1);
-  igraph_density(&g2, &dens, 0);
-  igraph_reciprocity(&g2, &recip, 1, IGRAPH_RECIPROCITY_DEFAULT);
+  if (PLAN_HAS(plan, MET_CLUSTERING)) {
+    igraph_transitivity_undirected(&g2, &cluster, IGRAPH_TRANSITIVITY_ZERO);
+  }
+  if (PLAN_HAS(plan, MET_DEGREE_ASSORTATIVITY)) {
+    igraph_vector_t ideg;
+    igraph_vector_t odeg;
+    if (arena_vector(&ug_scratch, &ideg, n) == 0 && arena_vector(&ug_scratch, &odeg, n) == 0) {
+      VANV(&g2, "Indegree", &ideg);
+      VANV(&g2, "Outdegree", &odeg);
+      igraph_assortativity(&g2, &ideg, &odeg, &assort, 1);
+    }
+  }
+  if (PLAN_HAS(plan, MET_DENSITY)) {
+    igraph_density(&g2, &dens, 0);
+  }
+  if (PLAN_HAS(plan, MET_RECIPROCITY)) {
+    igraph_reciprocity(&g2, &recip, 1, IGRAPH_RECIPROCITY_DEFAULT);
+  }
   SETGAN(&g2, "NODES", igraph_vcount(&g2));
   SETGAN(&g2, "EDGES", igraph_ecount(&g2));
-  SETGAN(&g2, "AVG_PATH_LENGTH", pathl);
-  SETGAN(&g2, "DIAMETER", dia);
-  SETGAN(&g2, "OVERALL_CLUSTERING", cluster);
-  SETGAN(&g2, "ASSORTATIVITY", assort);
-  SETGAN(&g2, "DENSITY", dens);
-  SETGAN(&g2, "RECIPROCITY", recip);
+  if (PLAN_HAS(plan, MET_PATH_LENGTH)) {
+    SETGAN(&g2, "AVG_PATH_LENGTH", pathl);
+  }
+  if (PLAN_HAS(plan, MET_DIAMETER)) {
+    SETGAN(&g2, "DIAMETER", dia);
+  }
+  if (PLAN_HAS(plan, MET_CLUSTERING)) {
+    SETGAN(&g2, "OVERALL_CLUSTERING", cluster);
+  }
+  if (PLAN_HAS(plan, MET_DEGREE_ASSORTATIVITY)) {
+    SETGAN(&g2, "ASSORTATIVITY", assort);
+  }
+  if (PLAN_HAS(plan, MET_DENSITY)) {
+    SETGAN(&g2, "DENSITY", dens);
+  }
+  if (PLAN_HAS(plan, MET_RECIPROCITY)) {
+    SETGAN(&g2, "RECIPROCITY", recip);
+  }
+  /* the original graph only carries DegreeRank when a comparison is planned;
+     compare before writing, which may drop Degree */
+  if (PLAN_HAS(plan, MET_DEGREE_RANK)
+      && PLAN_HAS(ug_plan ? ug_plan : PLAN_ANALYSIS_ALL, MET_DEGREE_RANK)) {
+    rankCompare(&g, &g2, "Degree", &index, &pvals, &tsco);
+  }
+  result->write_failed = false;
   if (ug_save == true) {
-    write_graph(&g2, attr);
-  }
-  push(&asshead, assort, attr);
-  push(&edges, GAN(&g2, "EDGES"), attr);
-  push(&density, dens, attr);
-  push(&diameter, dia, attr);
-  push(&pathlength, pathl, attr);
-  push(&clustering, cluster, attr);
-  push(&betcent, GAN(&g2, "centralizationBetweenness"), attr);
-  push(&degcent, GAN(&g2, "centralizationDegree"), attr);
-  push(&idegcent, GAN(&g2, "centralizationIndegree"), attr);
-  push(&odegcent, GAN(&g2, "centralizationOutdegree"), attr);
-  push(&eigcent, GAN(&g2, "centralizationEigenvector"), attr);
-  push(&pagecent, GAN(&g2, "centralizationPageRank"), attr);
-  push(&reciprocity, recip, attr);
-  rankCompare(&g, &g2, "Degree", &pvals, &tsco);
-  push(&pv, pvals, attr);
-  push(&ts, tsco, attr);
-  igraph_vector_destroy(&size);
-  igraph_vector_destroy(&rank);
-  igraph_vector_destroy(&ideg);
-  igraph_vector_destroy(&odeg);
-  igraph_vs_destroy(&selector);
+    result->write_failed = (write_graph(&g2, attr) != 0);
+  }
+  result->assort = assort;
+  result->edges = GAN(&g2, "EDGES");
+  result->density = dens;
+  result->diameter = dia;
+  result->pathlength = pathl;
+  result->clustering = cluster;
+  result->betcent = gan_or_nan(&g2, "centralizationBetweenness");
+  result->degcent = gan_or_nan(&g2, "centralizationDegree");
+  result->idegcent = gan_or_nan(&g2, "centralizationIndegree");
+  result->odegcent = gan_or_nan(&g2, "centralizationOutdegree");
+  result->eigcent = gan_or_nan(&g2, "centralizationEigenvector");
+  result->pagecent = gan_or_nan(&g2, "centralizationPageRank");
+  result->reciprocity = recip;
+  result->pv = pvals;
+  result->ts = tsco;
   igraph_destroy(&g2);
+  arena_release(&ug_scratch, mark);
+  return 0;
+}
+
+/** Maps a method character from ug_methods to the attribute it filters on.
+
+  @param method - a character from the methods string.
+  @return the attribute name, or NULL if the method is unknown.
+ */
+char* method_attr (char method) {
+  switch (method) {
+    case 'a' : return "Authority";
+    case 'b' : return "Betweenness";
+    case 'c' : return "Clustering";
+    case 'd' : return "Degree";
+    case 'h' : return "Hub";
+    case 'i' : return "Indegree";
+    case 'o' : return "Outdegree";
+    case 'e' : return "Eigenvector";
+    case 'p' : return "PageRank";
+    case 'r' : return "Random";
+    default : return NULL;
+  }
+}
+
+/** @struct MethodOrder
+ @brief Every vertex of the base graph, sorted by one method's scores.
+
+ While sweeping percentages the cut set for a method at a lower percentage
+ is a prefix of the cut set at a higher one, so the order is computed once
+ and each percentage takes the first cutsize vertices.
+ */
+struct MethodOrder {
+  char* attr;
+  igraph_vector_t order;
+};
+
+static struct MethodOrder method_orders[MAX_METHODS];
+static int method_order_count = 0;
+
+/** A vertex score with a random key that orders vertices with equal scores. */
+struct OrderKey {
+  igraph_real_t val;
+  int tiebreak;
+  long int idx;
+};
+
+static int order_key_cmp(const void *a, const void *b) {
+  const struct OrderKey *x = (const struct OrderKey*) a;
+  const struct OrderKey *y = (const struct OrderKey*) b;
+  if (x->val < y->val) { return -1; }
+  if (x->val > y->val) { return 1; }
+  return (x->tiebreak > y->tiebreak) - (x->tiebreak < y->tiebreak);
+}
+
+static struct MethodOrder* find_method_order(char* attr) {
+  for (int i=0; i<method_order_count; i++) {
+    if (strcmp(method_orders[i].attr, attr) == 0) {
+      return &method_orders[i];
+    }
+  }
+  return NULL;
+}
+
+/** Sorts the vertices of graph once for each scored method in methods.
+
+  Vertices with equal scores are put in a random order, as select_cut does,
+  but that order then holds for every percentage until
+  clear_method_orders is called.
+
+  @param graph - the analyzed base graph.
+  @param methods - a string of method characters (see runFilters).
+  @return 0 unless an error occurs.
+ */
+int prepare_method_orders(igraph_t *graph, char* methods) {
+  long int n = igraph_vcount(graph);
+  srand(time(NULL));
+  clear_method_orders();
+  for (size_t m=0; m<strlen(methods) && method_order_count < MAX_METHODS; m++) {
+    char* attr = method_attr(methods[m]);
+    if (attr == NULL || strcmp(attr, "Random") == 0 || find_method_order(attr)
+        || !igraph_cattribute_has_attr(graph, IGRAPH_ATTRIBUTE_VERTEX, attr)) {
+      continue;
+    }
+    igraph_vector_t scores;
+    struct ArenaMark mark = arena_mark(&ug_scratch);
+    struct OrderKey *keys = arena_alloc(&ug_scratch, (n ? n : 1) * sizeof(struct OrderKey));
+    if (keys == NULL || arena_vector(&ug_scratch, &scores, n) != 0) {
+      arena_release(&ug_scratch, mark);
+      return -1;
+    }
+    VANV(graph, attr, &scores);
+    for (long int i=0; i<n; i++) {
+      keys[i].val = VECTOR(scores)[i];
+      keys[i].tiebreak = rand();
+      keys[i].idx = i;
+    }
+    qsort(keys, n, sizeof(struct OrderKey), order_key_cmp);
+    struct MethodOrder *mo = &method_orders[method_order_count++];
+    mo->attr = attr;
+    igraph_vector_init(&mo->order, n);
+    for (long int i=0; i<n; i++) {
+      VECTOR(mo->order)[i] = keys[i].idx;
+    }
+    arena_release(&ug_scratch, mark);
+  }
+  return 0;
+}
+
+/** Frees the orders made by prepare_method_orders. */
+int clear_method_orders() {
+  for (int i=0; i<method_order_count; i++) {
+    igraph_vector_destroy(&method_orders[i].order);
+  }
+  method_order_count = 0;
   return 0;
 }
 
-int shrink (igraph_t *graph, int cutsize, char* attr) {
+/** Selects the cutoff value for a method and filters the graph by it.
+
+  If prepare_method_orders has sorted the graph for this method, the cut is
+  the first cutsize vertices of that order.  If scratch space runs out the
+  result is marked as failed.
+
+  @param graph - the graph to filter
+  @param cutsize - the number of nodes to remove.
+  @param attr - the method used to shorten the graph
+  @param result - receives the graph-level values for the report.
+
+  @return 0 unless an error occurs.
+ */
+int shrink (igraph_t *graph, int cutsize, char* attr, struct FilterResult *result) {
   igraph_vector_t v;
-  if (strcmp(attr, "Random")==0) {
-    create_filtered_graph(graph, 0.0, cutsize, attr);
+  int rc = -1;
+  struct MethodOrder *mo = find_method_order(attr);
+  if (mo != NULL && cutsize <= igraph_vector_size(&mo->order)) {
+    rc = filter_by_cut(graph, VECTOR(mo->order), cutsize, attr, result);
+  } else if (strcmp(attr, "Random")==0) {
+    rc = create_filtered_graph(graph, 0.0, cutsize, attr, result);
   } else {
-    igraph_vector_init(&v, NODESIZE);
-    for (long i=0; i<NODESIZE; i++) {
-      VECTOR(v)[i] = VAN(graph, attr, i);
+    struct ArenaMark mark = arena_mark(&ug_scratch);
+    if (arena_vector(&ug_scratch, &v, NODESIZE) == 0) {
+      VANV(graph, attr, &v);
+      igraph_vector_sort(&v);
+      rc = create_filtered_graph(graph, VECTOR(v)[cutsize], cutsize, attr, result);
     }
-    igraph_vector_sort(&v);
-    create_filtered_graph(graph, VECTOR(v)[cutsize], cutsize, attr);
+    arena_release(&ug_scratch, mark);
   }
-  igraph_vector_destroy(&v);
-  return 0;
+  if (rc != 0) {
+    memset(result, 0, sizeof(*result));
+    result->write_failed = true;
+  }
+  return rc;
+}
+
+/** Works out how many filter methods to run at once.
+
+  A value of 0 (the default) uses every online processor.
+ */
+long filter_jobs (int count) {
+  long jobs = ug_jobs;
+  if (jobs < 1) {
+    jobs = sysconf(_SC_NPROCESSORS_ONLN);
+  }
+  if (jobs < 1) {
+    jobs = 1;
+  }
+  return jobs > count ? count : jobs;
+}
+
+/** Seeds igraph's generator and rand() for method i of a run.
+
+  Each method starts from seed + i, so it lays out and breaks ties the same
+  way in a worker as it does when the methods run one after another.
+ */
+static void seed_method (unsigned long seed, int i) {
+  igraph_rng_seed(igraph_rng_default(), seed + i);
+  srand(seed + i);
+}
+
+/** Runs the filter methods in worker processes, at most "jobs" at a time.
+
+  Each method runs in a forked child (see "Concurrency" in graphpass.h),
+  which sends its FilterResult back through a pipe, and the parent collects
+  the results in method order.  A method whose worker fails is run again in
+  the parent.  Queued output is written before each
+  fork, and each child writes its own before it reports.
+
+  @param graph - the analyzed graph to filter.
+  @param cutsize - the number of nodes to remove.
+  @param attrs - the attribute for each method, in ug_methods order.
+  @param count - the number of methods.
+  @param jobs - the maximum number of workers alive at once.
+  @param seed - the run's seed (see seed_method).
+  @param results - receives a FilterResult per method.
+  @return 0 unless an error occurs.
+ */
+static int run_parallel (igraph_t *graph, int cutsize, char** attrs, int count,
+                         long jobs, unsigned long seed, struct FilterResult *results) {
+  int fds[count];
+  pid_t pids[count];
+  long running = 0;
+  int failed = write_queue_finish();
+  for (int i=0; i<count; i++) {
+    fds[i] = -1;
+    pids[i] = -1;
+    if (running >= jobs) {
+      if (wait(NULL) > 0) {
+        --running;
+      }
+    }
+    int pipefd[2];
+    if (pipe(pipefd) == -1) {
+      continue;
+    }
+    fflush(stdout);
+    fflush(stderr);
+    pid_t pid = fork();
+    if (pid == 0) {
+      struct FilterResult res;
+      close(pipefd[0]);
+      if (i < ug_failing_workers) {
+        _exit(EXIT_FAILURE);
+      }
+      seed_method(seed, i);
+      shrink(graph, cutsize, attrs[i], &res);
+      if (write_queue_finish() != 0) {
+        res.write_failed = true;
+      }
+      ssize_t sent = write(pipefd[1], &res, sizeof(res));
+      close(pipefd[1]);
+      fflush(stdout);
+      _exit(sent == sizeof(res) ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+    close(pipefd[1]);
+    if (pid == -1) {
+      close(pipefd[0]);
+      continue;
+    }
+    fds[i] = pipefd[0];
+    pids[i] = pid;
+    ++running;
+  }
+  for (int i=0; i<count; i++) {
+    ssize_t got = 0;
+    if (fds[i] != -1) {
+      size_t need = sizeof(struct FilterResult);
+      char *buf = (char*) &results[i];
+      ssize_t n;
+      while ((size_t)got < need
+             && ((n = read(fds[i], buf + got, need - got)) > 0
+                 || (n == -1 && errno == EINTR))) {
+        got += n > 0 ? n : 0;
+      }
+      close(fds[i]);
+    }
+    if (pids[i] != -1) {
+      waitpid(pids[i], NULL, 0);
+    }
+    if ((size_t)got != sizeof(struct FilterResult)) {
+      if (!ug_TEST) {
+        fprintf(stderr, "  ---WARNING--- : Worker for %s failed, running it again.\n", attrs[i]);
+      }
+      seed_method(seed, i);
+      shrink(graph, cutsize, attrs[i], &results[i]);
+    }
+  }
+  return failed == 0 ? 0 : -1;
 }
 
+/** Filters the graph once for each method in ug_methods.
+
+  Methods run concurrently (see ug_jobs), but their results are added to the
+  report lists in the order they appear in ug_methods, and each method is
+  seeded from its place in that order, so reports and output files match a
+  sequential run.
+
+  @param graph - the analyzed graph to filter.
+  @param cutsize - the number of nodes to remove.
+  @return 0, or -1 if an output file could not be written.  Files still in
+  the write queue are checked by write_queue_finish.
+ */
 int runFilters (igraph_t *graph, int cutsize) {
-  int flag = 0;
-  while (flag > -1) {
-    switch (ug_methods[flag]) {
-      case 'a' : shrink(graph, cutsize, "Authority");
-        break;
-      case 'b' : shrink(graph, cutsize, "Betweenness");
-        break;
-      case 'c' : shrink(graph, cutsize, "Clustering");
-        break;
-      case 'd' : shrink(graph, cutsize, "Degree");
-        break;
-      case 'h' : shrink(graph, cutsize, "Hub");
-        break;
-      case 'i' : shrink(graph, cutsize, "Indegree");
-        break;
-      case 'o' : shrink(graph, cutsize, "Outdegree");
-        break;
-      case 'e' : shrink(graph, cutsize, "Eigenvector");
-        break;
-      case 'p' : shrink(graph, cutsize, "PageRank");
-        break;
-      case 'r' : shrink(graph, cutsize, "Random");
-        break;
-      case '\0' :
-        flag = -2;
-        break;
-      default: printf("---WARNING--- : Invalid parameter for method sent, ignoring.\n \
+  int len = strlen(ug_methods);
+  char* attrs[len > 0 ? len : 1];
+  int count = 0;
+  for (int i=0; i<len; i++) {
+    char* attr = method_attr(ug_methods[i]);
+    if (attr == NULL) {
+      printf("---WARNING--- : Invalid parameter for method sent, ignoring.\n \
                       This may affect your outputs.\n\n");
+      continue;
     }
-    ++flag;
+    attrs[count++] = attr;
   }
+  if (count == 0) {
+    return 0;
+  }
+  struct FilterResult results[count];
+  long jobs = filter_jobs(count);
+  int result = 0;
+  unsigned long seed;
+  RNG_BEGIN();
+  seed = RNG_INTEGER(0, INT_MAX - count);
+  RNG_END();
+  if (jobs > 1) {
+    if (ug_verbose == true) {
+      printf("Running %d filter methods across %ld workers.\n", count, jobs);
+    }
+    result = run_parallel(graph, cutsize, attrs, count, jobs, seed, results);
+  } else {
+    for (int i=0; i<count; i++) {
+      seed_method(seed, i);
+      shrink(graph, cutsize, attrs[i], &results[i]);
+    }
+  }
+  for (int i=0; i<count; i++) {
+    push_result(&results[i], attrs[i]);
+    if (results[i].write_failed) {
+      result = -1;
+    }
+  }
+  return result;
+}
 
-  return 0;
+/** Converts ug_percent into the number of vertices to cut from the graph.
+
+  @return the number of vertices to remove.
+ */
+int filter_cutsize() {
+  float percentile = (ug_percent > 0.99) ? fix_percentile() : ug_percent;
+  return round((double)NODESIZE * percentile);
 }
 
-/** Filters an igraph using one or more methods based on global "ug_methods", and outputs graphs as derivatives of filename.
+/** Tags the global graph with idRefs and runs (or restores) its analysis.
 
   @return 0 unless an error is discovered
  */
-
-int filter_graph() {
+int analyze_base_graph() {
   igraph_vector_t idRef;
   igraph_vector_init_seq(&idRef, 0, igraph_vcount(&g)-1);
-  float percentile;
+  SETVANV(&g, "idRef", &idRef);
+  igraph_vector_destroy(&idRef);
+  metric_plan_t plan = ug_plan ? ug_plan : PLAN_ANALYSIS_ALL;
+  /* a snapshot converted with --cache holds the analysis it was written with */
+  bool restored = ug_snapshot_metrics != 0 && ug_snapshot_metrics == graph_fingerprint(&g);
+  if (!restored && ug_CACHE != NULL && load_metric_cache(&g, ug_CACHE) == 0) {
+    restored = true;
+  }
+  if (restored) {
+    /* only compute what the cache did not hold */
+    plan = plan_missing(&g, plan);
+    if (plan == 0) {
+      return 0;
+    }
+  }
+  analysis_planned(&g, plan);
+  if (ug_CACHE != NULL) {
+    save_metric_cache(&g, ug_CACHE);
+  }
+  return 0;
+}
+
+/** Plans the run and analyzes the global graph for filter_run, unless it
+ is a quickrun, which needs no analysis.
+
+  @return 0.
+ */
+int filter_analyze() {
+  if (ug_quickrun == false) {
+    plan_run(ug_report);
+    analyze_base_graph();
+  }
+  return 0;
+}
+
+/** Filters the analyzed global graph once for each method in ug_methods,
+ writing each filtered graph unless ug_save is off.  A quickrun writes the
+ laid-out graph instead (see quickrunGraph).
+
+  @return 0, or -1 if an output file could not be written.
+ */
+int filter_run() {
   int cutsize;
+  int result;
   if (ug_quickrun == true) {
     if (ug_verbose == true) {
       printf("\n\nQuickrun requested.\n\n");
@@ -304,24 +895,44 @@ int filter_graph() {
       printf("nodes.\n\n");
       printf("Quickrun is quicker, but less informative in terms of output.\n");
     }
-    quickrunGraph();
-    igraph_destroy(&g);
-    return(0);
+    return quickrunGraph();
   }
   /* if (CALC_WEIGHTS == false) {igraph_vector_init(&WEIGHTED, NODESIZE);}*/
-  percentile = (ug_percent > 0.99) ? fix_percentile() : ug_percent;
-  cutsize = round((double)NODESIZE * percentile);
+  cutsize = filter_cutsize();
   if (ug_verbose == true) {
     printf("Filtering the graphs by %f will reduce the graph size by %d \n", ug_percent, cutsize);
     printf("This will produce a graph with %d nodes.\n", (NODESIZE - cutsize));
   }
-  SETVANV(&g, "idRef", &idRef);
-  analysis_all(&g);
-  runFilters(&g, cutsize);
-  if (ug_report == true) {
+  arena_reserve(&ug_scratch, FILTER_SCRATCH_BYTES(NODESIZE, igraph_ecount(&g)));
+  result = runFilters(&g, cutsize);
+  arena_free(&ug_scratch);
+  return result;
+}
+
+/** Writes the report of the filters run so far, if ug_report is set. */
+int filter_report() {
+  if (ug_report == true && ug_quickrun == false) {
     write_report(&g);
   }
-  igraph_destroy(&g);
-  igraph_vector_destroy(&idRef);
   return 0;
 }
+
+/** Filters an igraph using one or more methods based on global "ug_methods", and outputs graphs as derivatives of filename.
+
+  Runs filter_analyze, filter_run and filter_report, then frees the graph.
+  Waits for the write queue before returning, so the last files are written
+  while the report is.
+
+  @return 0, or -1 if an output file could not be written.
+ */
+
+int filter_graph() {
+  filter_analyze();
+  int result = filter_run();
+  filter_report();
+  igraph_destroy(&g);
+  if (write_queue_finish() != 0) {
+    result = -1;
+  }
+  return result;
+}
@@ -0,0 +1,987 @@
+/*
+ * GraphPass:
+ * A utility to filter networks and provide a default visualization output
+ * for Gephi or SigmaJS.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** @file graphml.c
+ @brief A fast GraphML loader for the files GraphPass usually reads, and
+ a GraphML writer that formats on several threads.
+
+ The file is mmapped and scanned for <key>, <graph>, <node>, <edge> and
+ <data> tags directly, without building a DOM or SAX events.  Node ids are
+ interned in an open-addressed hash that points into the mapped file, and
+ the edge vector is allocated once from a count of <edge> tags.  While every
+ id is 32 hex digits the hash holds them as NodeKeys, compared and hashed as
+ two words, and the graph gets them packed (see ids.c).
+
+ The result matches igraph_read_graph_graphml: vertices are numbered in the
+ order their ids first appear, key attributes are created in declaration
+ order (with their <default>, or NaN / "" without one) and the node ids are
+ added last as the "id" vertex attribute, or as packed ids that write_graph
+ writes as that attribute.  Anything outside that subset
+ (CDATA, boolean keys, edge ids, hyperedges, ports, nested graphs, unknown
+ entities) makes load_graphml_mmap return GRAPHML_UNSUPPORTED, and
+ load_graph falls back to igraph's reader.
+
+ write_graph_graphml writes what igraph_write_graph_graphml (igraph 0.7)
+ writes, byte for byte, but reads attributes as whole columns and formats
+ the <node> and <edge> elements on worker threads (see out_buffer_ranges).
+ */
+
+#define _GNU_SOURCE /* memmem */
+#include <graphpass.h>
+#include <ctype.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define GRAPHML_MAX_KEYS 256
+#define GRAPHML_MAX_ATTRS 16 /**< XML attributes read per tag. */
+
+/** A run of bytes, usually inside the mapped file. */
+struct Slice {
+  const char *ptr;
+  long len;
+  bool owned; /**< true if ptr was decoded into malloc'd memory. */
+};
+
+/** A declared <key>. */
+struct GraphmlKey {
+  struct Slice id;
+  char *name;
+  igraph_attribute_elemtype_t kind;
+  bool numeric;
+  igraph_real_t numdef;
+  struct Slice strdef;
+};
+
+/** One <data> value, applied to its column once the sizes are known. */
+struct GraphmlValue {
+  int key;
+  long elem;
+  igraph_real_t num;
+  struct Slice str;
+};
+
+/** A parsed tag: its name and XML attributes. */
+struct GraphmlTag {
+  struct Slice name;
+  struct Slice attr_names[GRAPHML_MAX_ATTRS];
+  struct Slice attr_vals[GRAPHML_MAX_ATTRS];
+  int nattrs;
+  bool closing;
+  bool empty; /**< self-closing, <tag/>. */
+};
+
+struct GraphmlState {
+  const char *p;
+  const char *end;
+  struct GraphmlKey keys[GRAPHML_MAX_KEYS];
+  int nkeys;
+  /* interned node ids */
+  struct Slice *ids;
+  struct NodeKey *nodekeys; /**< the ids as keys, while packed. */
+  bool packed; /**< every id so far is NODE_KEY_DIGITS hex digits. */
+  long nids;
+  long idcap;
+  long *slots;
+  long nslots;
+  /* edges */
+  igraph_vector_t edges;
+  long nedges;
+  long edgecap;
+  /* values */
+  struct GraphmlValue *vals;
+  long nvals;
+  long valcap;
+};
+
+static uint64_t slice_hash(struct Slice s) {
+  return fnv_hash(FNV_OFFSET, s.ptr, s.len);
+}
+
+static bool slice_eq(struct Slice a, const char *b) {
+  return (long) strlen(b) == a.len && memcmp(a.ptr, b, a.len) == 0;
+}
+
+static bool slice_same(struct Slice a, struct Slice b) {
+  return a.len == b.len && memcmp(a.ptr, b.ptr, a.len) == 0;
+}
+
+/** Returns the value of an XML attribute of a tag, or an empty slice. */
+static struct Slice tag_attr(struct GraphmlTag *tag, const char *name) {
+  for (int i=0; i<tag->nattrs; i++) {
+    if (slice_eq(tag->attr_names[i], name)) {
+      return tag->attr_vals[i];
+    }
+  }
+  struct Slice none = {NULL, 0, false};
+  return none;
+}
+
+/** Reads a numeric character reference, the text between "&#" and ";".
+
+ @return the character, or -1 unless it is a character XML allows (libxml
+ refuses the document then, so igraph's reader reports the error).
+ */
+static long char_ref(struct Slice ref) {
+  int base = 10;
+  long i = 0;
+  long code = 0;
+  if (ref.len > 0 && ref.ptr[0] == 'x') {
+    base = 16;
+    i = 1;
+  }
+  if (i == ref.len) {
+    return -1;
+  }
+  for (; i<ref.len; i++) {
+    char c = ref.ptr[i];
+    int digit = (c >= '0' && c <= '9') ? c - '0'
+      : (base == 16 && c >= 'a' && c <= 'f') ? c - 'a' + 10
+      : (base == 16 && c >= 'A' && c <= 'F') ? c - 'A' + 10 : -1;
+    if (digit < 0) {
+      return -1;
+    }
+    code = code * base + digit;
+    if (code > 0x10FFFF) {
+      return -1;
+    }
+  }
+  if ((code < 0x20 && code != 0x9 && code != 0xA && code != 0xD)
+      || (code >= 0xD800 && code <= 0xDFFF) || code == 0xFFFE || code == 0xFFFF) {
+    return -1;
+  }
+  return code;
+}
+
+/** Decodes XML entities in s.  Returns -1 for entities it does not know,
+ invalid character references and failed allocations.
+ */
+static int decode(struct Slice *s) {
+  if (memchr(s->ptr, '&', s->len) == NULL) {
+    return 0;
+  }
+  char *out = (char*) malloc(s->len + 1);
+  if (out == NULL) {
+    return -1;
+  }
+  long o = 0;
+  for (long i=0; i<s->len; i++) {
+    if (s->ptr[i] != '&') {
+      out[o++] = s->ptr[i];
+      continue;
+    }
+    const char *semi = memchr(s->ptr + i, ';', s->len - i);
+    if (semi == NULL) {
+      free(out);
+      return -1;
+    }
+    struct Slice ent = {s->ptr + i + 1, semi - (s->ptr + i + 1), false};
+    if (slice_eq(ent, "amp")) { out[o++] = '&'; }
+    else if (slice_eq(ent, "lt")) { out[o++] = '<'; }
+    else if (slice_eq(ent, "gt")) { out[o++] = '>'; }
+    else if (slice_eq(ent, "quot")) { out[o++] = '"'; }
+    else if (slice_eq(ent, "apos")) { out[o++] = '\''; }
+    else if (ent.len > 1 && ent.ptr[0] == '#') {
+      struct Slice ref = {ent.ptr + 1, ent.len - 1, false};
+      long code = char_ref(ref);
+      if (code < 0) {
+        free(out);
+        return -1;
+      }
+      /* encode as UTF-8, as libxml hands it to igraph */
+      if (code < 0x80) {
+        out[o++] = (char) code;
+      } else if (code < 0x800) {
+        out[o++] = (char) (0xC0 | (code >> 6));
+        out[o++] = (char) (0x80 | (code & 0x3F));
+      } else {
+        /* never longer than the entity itself, so out cannot overflow */
+        if (code < 0x10000) {
+          out[o++] = (char) (0xE0 | (code >> 12));
+        } else {
+          out[o++] = (char) (0xF0 | (code >> 18));
+          out[o++] = (char) (0x80 | ((code >> 12) & 0x3F));
+        }
+        out[o++] = (char) (0x80 | ((code >> 6) & 0x3F));
+        out[o++] = (char) (0x80 | (code & 0x3F));
+      }
+    } else {
+      free(out);
+      return -1;
+    }
+    i = semi - s->ptr;
+  }
+  out[o] = '\0';
+  s->ptr = out;
+  s->len = o;
+  s->owned = true;
+  return 0;
+}
+
+static void release(struct Slice *s) {
+  if (s->owned) {
+    free((char*) s->ptr);
+    s->owned = false;
+  }
+}
+
+/** Reads the next tag, skipping text, comments, processing instructions
+ and the doctype.  Returns 1 at end of input, -1 if unsupported.
+ */
+static int next_tag(struct GraphmlState *st, struct GraphmlTag *tag) {
+  while (1) {
+    const char *lt = memchr(st->p, '<', st->end - st->p);
+    if (lt == NULL) {
+      return 1;
+    }
+    st->p = lt + 1;
+    if (st->p < st->end && *st->p == '?') {
+      const char *q = memmem(st->p, st->end - st->p, "?>", 2);
+      if (q == NULL) { return -1; }
+      st->p = q + 2;
+      continue;
+    }
+    if (st->end - st->p >= 3 && memcmp(st->p, "!--", 3) == 0) {
+      const char *q = memmem(st->p, st->end - st->p, "-->", 3);
+      if (q == NULL) { return -1; }
+      st->p = q + 3;
+      continue;
+    }
+    if (st->end - st->p >= 8 && memcmp(st->p, "!DOCTYPE", 8) == 0) {
+      /* internal subsets may declare entities */
+      const char *gt = memchr(st->p, '>', st->end - st->p);
+      if (gt == NULL || memchr(st->p, '[', gt - st->p) != NULL) { return -1; }
+      st->p = gt + 1;
+      continue;
+    }
+    if (st->p < st->end && *st->p == '!') {
+      return -1; /* CDATA */
+    }
+    break;
+  }
+  if (st->p >= st->end) {
+    return -1;
+  }
+  tag->closing = (*st->p == '/');
+  if (tag->closing) {
+    ++st->p;
+  }
+  const char *s = st->p;
+  while (st->p < st->end && !isspace((unsigned char) *st->p) && *st->p != '>' && *st->p != '/') {
+    ++st->p;
+  }
+  tag->name.ptr = s;
+  tag->name.len = st->p - s;
+  tag->name.owned = false;
+  tag->nattrs = 0;
+  tag->empty = false;
+  while (st->p < st->end) {
+    while (st->p < st->end && isspace((unsigned char) *st->p)) {
+      ++st->p;
+    }
+    if (st->p >= st->end) { return -1; }
+    if (*st->p == '>') {
+      ++st->p;
+      return 0;
+    }
+    if (*st->p == '/') {
+      tag->empty = true;
+      ++st->p;
+      continue;
+    }
+    const char *an = st->p;
+    while (st->p < st->end && *st->p != '=' && !isspace((unsigned char) *st->p)) {
+      ++st->p;
+    }
+    long anlen = st->p - an;
+    while (st->p < st->end && (isspace((unsigned char) *st->p) || *st->p == '=')) {
+      ++st->p;
+    }
+    if (st->p >= st->end || (*st->p != '"' && *st->p != '\'')) { return -1; }
+    char quote = *st->p++;
+    const char *av = st->p;
+    const char *q = memchr(st->p, quote, st->end - st->p);
+    if (q == NULL) { return -1; }
+    st->p = q + 1;
+    if (tag->nattrs < GRAPHML_MAX_ATTRS) {
+      struct Slice n = {an, anlen, false};
+      struct Slice v = {av, q - av, false};
+      tag->attr_names[tag->nattrs] = n;
+      tag->attr_vals[tag->nattrs] = v;
+      ++tag->nattrs;
+    }
+  }
+  return -1;
+}
+
+/** Reads the text up to the closing tag name, which must follow directly. */
+static int element_text(struct GraphmlState *st, const char *name, struct Slice *text) {
+  const char *lt = memchr(st->p, '<', st->end - st->p);
+  if (lt == NULL) { return -1; }
+  text->ptr = st->p;
+  text->len = lt - st->p;
+  text->owned = false;
+  long nlen = strlen(name);
+  if (st->end - lt < nlen + 3 || lt[1] != '/' || memcmp(lt + 2, name, nlen) != 0) {
+    return -1;
+  }
+  const char *gt = memchr(lt, '>', st->end - lt);
+  if (gt == NULL) { return -1; }
+  st->p = gt + 1;
+  return decode(text);
+}
+
+/** Mixes the two words of a key into a slot hash. */
+static uint64_t key_hash(struct NodeKey key) {
+  uint64_t hash = (key.hi ^ (key.lo * 0x9E3779B97F4A7C15ULL));
+  return hash ^ (hash >> 29);
+}
+
+/** Rebuilds the id hash with nslots slots.  Returns -1 if out of memory. */
+static int rehash(struct GraphmlState *st, long nslots) {
+  long *slots = (long*) malloc(nslots * sizeof(long));
+  if (slots == NULL) {
+    return -1;
+  }
+  for (long i=0; i<nslots; i++) {
+    slots[i] = -1;
+  }
+  for (long i=0; i<st->nids; i++) {
+    long s = (st->packed ? key_hash(st->nodekeys[i]) : slice_hash(st->ids[i])) & (nslots - 1);
+    while (slots[s] != -1) {
+      s = (s + 1) & (nslots - 1);
+    }
+    slots[s] = i;
+  }
+  free(st->slots);
+  st->slots = slots;
+  st->nslots = nslots;
+  return 0;
+}
+
+/** Returns the vertex id of a node id, adding it if it is new, or -1 if
+ out of memory.
+ */
+static long intern(struct GraphmlState *st, struct Slice id) {
+  struct NodeKey key = {0, 0};
+  if (st->packed && node_key_parse(id.ptr, id.len, &key) != 0) {
+    /* not a digest: hash the text of every id from now on */
+    st->packed = false;
+    free(st->nodekeys);
+    st->nodekeys = NULL;
+    if (st->nslots > 0 && rehash(st, st->nslots) != 0) {
+      return -1;
+    }
+  }
+  if (2 * (st->nids + 1) > st->nslots
+      && rehash(st, st->nslots ? st->nslots * 2 : 1024) != 0) {
+    return -1;
+  }
+  long s = (st->packed ? key_hash(key) : slice_hash(id)) & (st->nslots - 1);
+  while (st->slots[s] != -1) {
+    long i = st->slots[s];
+    if (st->packed ? (st->nodekeys[i].hi == key.hi && st->nodekeys[i].lo == key.lo)
+        : slice_same(st->ids[i], id)) {
+      return i;
+    }
+    s = (s + 1) & (st->nslots - 1);
+  }
+  if (st->nids == st->idcap) {
+    long cap = st->idcap ? st->idcap * 2 : 1024;
+    struct Slice *ids = (struct Slice*) realloc(st->ids, cap * sizeof(struct Slice));
+    if (ids == NULL) {
+      return -1;
+    }
+    st->ids = ids;
+    if (st->packed) {
+      struct NodeKey *keys = (struct NodeKey*) realloc(st->nodekeys, cap * sizeof(struct NodeKey));
+      if (keys == NULL) {
+        return -1;
+      }
+      st->nodekeys = keys;
+    }
+    st->idcap = cap;
+  }
+  st->ids[st->nids] = id;
+  if (st->packed) {
+    st->nodekeys[st->nids] = key;
+  }
+  st->slots[s] = st->nids;
+  return st->nids++;
+}
+
+static int find_key(struct GraphmlState *st, struct Slice id) {
+  for (int i=0; i<st->nkeys; i++) {
+    if (slice_same(st->keys[i].id, id)) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+/** Counts <edge> tags so the edge vector is allocated once. */
+static long count_edges(const char *p, const char *end) {
+  long count = 0;
+  while ((p = memmem(p, end - p, "<edge", 5)) != NULL) {
+    p += 5;
+    if (p < end && (isspace((unsigned char) *p) || *p == '>' || *p == '/')) {
+      ++count;
+    }
+  }
+  return count;
+}
+
+static int parse_key(struct GraphmlState *st, struct GraphmlTag *tag) {
+  if (st->nkeys == GRAPHML_MAX_KEYS) { return -1; }
+  struct GraphmlKey *key = &st->keys[st->nkeys];
+  struct Slice kind = tag_attr(tag, "for");
+  struct Slice type = tag_attr(tag, "attr.type");
+  struct Slice name = tag_attr(tag, "attr.name");
+  key->id = tag_attr(tag, "id");
+  if (key->id.ptr == NULL) { return -1; }
+  if (slice_eq(kind, "node")) { key->kind = IGRAPH_ATTRIBUTE_VERTEX; }
+  else if (slice_eq(kind, "edge")) { key->kind = IGRAPH_ATTRIBUTE_EDGE; }
+  else if (slice_eq(kind, "graph")) { key->kind = IGRAPH_ATTRIBUTE_GRAPH; }
+  else { return -1; }
+  if (slice_eq(type, "string")) { key->numeric = false; }
+  else if (slice_eq(type, "double") || slice_eq(type, "float")
+           || slice_eq(type, "int") || slice_eq(type, "long")) { key->numeric = true; }
+  else { return -1; }
+  if (name.ptr == NULL) {
+    name = key->id;
+  }
+  if (decode(&name) != 0) { return -1; }
+  key->name = strndup(name.ptr, name.len);
+  release(&name);
+  if (key->name == NULL) { return -1; }
+  if (key->kind == IGRAPH_ATTRIBUTE_VERTEX && strcmp(key->name, "id") == 0) {
+    free(key->name);
+    return -1; /* igraph then keeps the key instead of the node ids */
+  }
+  key->numdef = NAN;
+  key->strdef.ptr = "";
+  key->strdef.len = 0;
+  key->strdef.owned = false;
+  ++st->nkeys;
+  if (tag->empty) {
+    return 0;
+  }
+  /* look for <default> up to </key> */
+  struct GraphmlTag inner;
+  while (next_tag(st, &inner) == 0) {
+    if (inner.closing && slice_eq(inner.name, "key")) {
+      return 0;
+    }
+    if (!inner.closing && slice_eq(inner.name, "default") && !inner.empty) {
+      struct Slice text;
+      if (element_text(st, "default", &text) != 0) { return -1; }
+      if (key->numeric) {
+        char *stop;
+        char buf[64];
+        long n = text.len < 63 ? text.len : 63;
+        memcpy(buf, text.ptr, n);
+        buf[n] = '\0';
+        key->numdef = strtod(buf, &stop);
+        if (stop == buf) { release(&text); return -1; }
+        release(&text);
+      } else {
+        key->strdef = text;
+      }
+    } else if (!inner.closing && !slice_eq(inner.name, "desc")) {
+      return -1;
+    }
+  }
+  return -1;
+}
+
+static int add_value(struct GraphmlState *st, int key, long elem, struct Slice text) {
+  if (st->nvals == st->valcap) {
+    long cap = st->valcap ? st->valcap * 2 : 4096;
+    struct GraphmlValue *vals = (struct GraphmlValue*) realloc(st->vals,
+                                                               cap * sizeof(struct GraphmlValue));
+    if (vals == NULL) {
+      release(&text);
+      return -1;
+    }
+    st->vals = vals;
+    st->valcap = cap;
+  }
+  struct GraphmlValue *v = &st->vals[st->nvals];
+  v->key = key;
+  v->elem = elem;
+  v->str = text;
+  v->num = NAN;
+  if (st->keys[key].numeric) {
+    char buf[64];
+    char *stop;
+    long n = text.len < 63 ? text.len : 63;
+    memcpy(buf, text.ptr, n);
+    buf[n] = '\0';
+    v->num = strtod(buf, &stop);
+    if (stop == buf) {
+      release(&v->str);
+      return -1;
+    }
+    release(&v->str);
+  }
+  ++st->nvals;
+  return 0;
+}
+
+/** Parses the mapped file into st.  Returns 0, or -1 if unsupported. */
+static int parse(struct GraphmlState *st, bool *directed) {
+  struct GraphmlTag tag;
+  int graphs = 0;
+  bool in_graph = false;
+  igraph_attribute_elemtype_t scope = IGRAPH_ATTRIBUTE_GRAPH;
+  long elem = 0;
+  int r;
+  while ((r = next_tag(st, &tag)) == 0) {
+    if (tag.closing) {
+      if (slice_eq(tag.name, "node") || slice_eq(tag.name, "edge")) {
+        scope = IGRAPH_ATTRIBUTE_GRAPH;
+        elem = 0;
+      } else if (slice_eq(tag.name, "graph")) {
+        in_graph = false;
+      }
+      continue;
+    }
+    if (slice_eq(tag.name, "key")) {
+      if (parse_key(st, &tag) != 0) { return -1; }
+    } else if (slice_eq(tag.name, "graph")) {
+      if (graphs++ > 0) { return -1; }
+      in_graph = true;
+      *directed = !slice_eq(tag_attr(&tag, "edgedefault"), "undirected");
+    } else if (slice_eq(tag.name, "node")) {
+      struct Slice id = tag_attr(&tag, "id");
+      if (!in_graph || id.ptr == NULL || memchr(id.ptr, '&', id.len)) { return -1; }
+      elem = intern(st, id);
+      if (elem < 0) { return -1; }
+      scope = tag.empty ? IGRAPH_ATTRIBUTE_GRAPH : IGRAPH_ATTRIBUTE_VERTEX;
+    } else if (slice_eq(tag.name, "edge")) {
+      struct Slice from = tag_attr(&tag, "source");
+      struct Slice to = tag_attr(&tag, "target");
+      if (!in_graph || from.ptr == NULL || to.ptr == NULL
+          || tag_attr(&tag, "id").ptr != NULL || tag_attr(&tag, "directed").ptr != NULL
+          || memchr(from.ptr, '&', from.len) || memchr(to.ptr, '&', to.len)) {
+        return -1;
+      }
+      if (st->nedges == st->edgecap) {
+        return -1; /* the count was wrong, let igraph read it */
+      }
+      long source = intern(st, from);
+      long target = intern(st, to);
+      if (source < 0 || target < 0) { return -1; }
+      VECTOR(st->edges)[2 * st->nedges] = source;
+      VECTOR(st->edges)[2 * st->nedges + 1] = target;
+      elem = st->nedges++;
+      scope = tag.empty ? IGRAPH_ATTRIBUTE_GRAPH : IGRAPH_ATTRIBUTE_EDGE;
+    } else if (slice_eq(tag.name, "data")) {
+      int key = find_key(st, tag_attr(&tag, "key"));
+      if (key < 0 || st->keys[key].kind != scope) { return -1; }
+      struct Slice text = {"", 0, false};
+      if (!tag.empty && element_text(st, "data", &text) != 0) { return -1; }
+      if (add_value(st, key, elem, text) != 0) { return -1; }
+    } else if (slice_eq(tag.name, "desc")) {
+      struct Slice text;
+      if (!tag.empty && element_text(st, "desc", &text) != 0) { return -1; }
+      release(&text);
+    } else if (!slice_eq(tag.name, "graphml")) {
+      return -1; /* hyperedge, port, nested content ... */
+    }
+  }
+  return (r == 1 && graphs == 1) ? 0 : -1;
+}
+
+/** Sets every key column on the graph, in declaration order. */
+static void set_columns(struct GraphmlState *st, igraph_t *graph) {
+  long n = igraph_vcount(graph);
+  for (int k=0; k<st->nkeys; k++) {
+    struct GraphmlKey *key = &st->keys[k];
+    long size = key->kind == IGRAPH_ATTRIBUTE_VERTEX ? n
+      : key->kind == IGRAPH_ATTRIBUTE_EDGE ? st->nedges : 1;
+    if (key->numeric) {
+      igraph_vector_t col;
+      igraph_vector_init(&col, size);
+      igraph_vector_fill(&col, key->numdef);
+      for (long i=0; i<st->nvals; i++) {
+        if (st->vals[i].key == k) {
+          VECTOR(col)[st->vals[i].elem] = st->vals[i].num;
+        }
+      }
+      if (key->kind == IGRAPH_ATTRIBUTE_VERTEX) { SETVANV(graph, key->name, &col); }
+      else if (key->kind == IGRAPH_ATTRIBUTE_EDGE) { SETEANV(graph, key->name, &col); }
+      else { SETGAN(graph, key->name, VECTOR(col)[0]); }
+      igraph_vector_destroy(&col);
+    } else {
+      igraph_strvector_t col;
+      igraph_strvector_init(&col, size);
+      for (long i=0; i<size; i++) {
+        igraph_strvector_set2(&col, i, key->strdef.ptr, key->strdef.len);
+      }
+      for (long i=0; i<st->nvals; i++) {
+        if (st->vals[i].key == k) {
+          igraph_strvector_set2(&col, st->vals[i].elem, st->vals[i].str.ptr, st->vals[i].str.len);
+        }
+      }
+      if (key->kind == IGRAPH_ATTRIBUTE_VERTEX) { SETVASV(graph, key->name, &col); }
+      else if (key->kind == IGRAPH_ATTRIBUTE_EDGE) { SETEASV(graph, key->name, &col); }
+      else { SETGAS(graph, key->name, STR(col, 0)); }
+      igraph_strvector_destroy(&col);
+    }
+  }
+  if (st->packed && n > 0) {
+    set_node_keys(graph, st->nodekeys, n);
+    return;
+  }
+  igraph_strvector_t ids;
+  igraph_strvector_init(&ids, n);
+  for (long i=0; i<n; i++) {
+    igraph_strvector_set2(&ids, i, st->ids[i].ptr, st->ids[i].len);
+  }
+  SETVASV(graph, "id", &ids);
+  igraph_strvector_destroy(&ids);
+}
+
+static void free_state(struct GraphmlState *st) {
+  for (int k=0; k<st->nkeys; k++) {
+    free(st->keys[k].name);
+    release(&st->keys[k].strdef);
+  }
+  for (long i=0; i<st->nvals; i++) {
+    release(&st->vals[i].str);
+  }
+  free(st->vals);
+  free(st->ids);
+  free(st->nodekeys);
+  free(st->slots);
+  igraph_vector_destroy(&st->edges);
+}
+
+/** Loads GraphML held in memory.
+
+ @param data - the document; it need not be NUL-terminated.
+ @param size - its length in bytes.
+ @param graph - an uninitialized graph, initialized only on success.
+ @return 0 on success, GRAPHML_UNSUPPORTED if the document uses GraphML
+ that this loader does not handle, or -1 if out of memory.
+ */
+int load_graphml_buffer(const char *data, size_t size, igraph_t *graph) {
+  struct GraphmlState *st = (struct GraphmlState*) calloc(1, sizeof(struct GraphmlState));
+  if (st == NULL) {
+    return -1;
+  }
+  st->p = data;
+  st->end = data + size;
+  st->packed = true;
+  st->edgecap = count_edges(data, data + size);
+  igraph_vector_init(&st->edges, 2 * st->edgecap);
+  bool directed = true;
+  int result = GRAPHML_UNSUPPORTED;
+  if (parse(st, &directed) == 0) {
+    igraph_vector_resize(&st->edges, 2 * st->nedges);
+    igraph_empty(graph, st->nids, directed);
+    igraph_add_edges(graph, &st->edges, 0);
+    set_columns(st, graph);
+    result = 0;
+  }
+  free_state(st);
+  free(st);
+  return result;
+}
+
+/** Loads a GraphML file through a memory map.
+
+ @param filename - the file to read.
+ @param graph - an uninitialized graph, initialized only on success.
+ @return 0 on success, GRAPHML_UNSUPPORTED if the file uses GraphML that
+ this loader does not handle, or -1 if the file cannot be read.
+ */
+int load_graphml_mmap(const char *filename, igraph_t *graph) {
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0) {
+    return -1;
+  }
+  struct stat st_file;
+  if (fstat(fd, &st_file) != 0 || st_file.st_size == 0) {
+    close(fd);
+    return -1;
+  }
+  size_t size = st_file.st_size;
+  char *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    return -1;
+  }
+  madvise(map, size, MADV_SEQUENTIAL);
+  int result = load_graphml_buffer(map, size, graph);
+  munmap(map, size);
+  return result;
+}
+
+/** Everything the GraphML node and edge formatters read, fetched before
+ any thread starts.
+ */
+struct GraphmlWriter {
+  struct AttrTable vtable;
+  struct AttrTable etable;
+  char **vtag; /**< <data> start tag per vertex column. */
+  char **etag; /**< <data> start tag per edge column. */
+  igraph_vector_t edges; /**< from, to pairs in edge id order. */
+};
+
+/** Returns the GraphML type of an attribute, or NULL if it is not written. */
+static const char* graphml_type(igraph_attribute_type_t type) {
+  switch (type) {
+  case IGRAPH_ATTRIBUTE_STRING: return "string";
+  case IGRAPH_ATTRIBUTE_NUMERIC: return "double";
+  case IGRAPH_ATTRIBUTE_BOOLEAN: return "boolean";
+  default: return NULL;
+  }
+}
+
+/** Builds the <data> start tag of an attribute, with the escaped name, so
+ it is escaped once per file rather than once per value.
+ */
+static int data_tag(const char *indent, const char *prefix, const char *name,
+                    char **result) {
+  char *name_escaped;
+  IGRAPH_CHECK(igraph_i_xml_escape((char*) name, &name_escaped));
+  size_t len = strlen(indent) + strlen(prefix) + strlen(name_escaped) + 20;
+  *result = (char*) malloc(len);
+  if (*result != NULL) {
+    snprintf(*result, len, "%s<data key=\"%s%s\">", indent, prefix, name_escaped);
+  }
+  igraph_Free(name_escaped);
+  if (*result == NULL) {
+    IGRAPH_ERROR("Cannot format GraphML output", IGRAPH_ENOMEM);
+  }
+  return 0;
+}
+
+/** Writes the <key> of every written attribute of one kind. */
+static int write_keys(struct OutBuffer *buf, const igraph_strvector_t *names,
+                      const igraph_vector_t *types, const char *prefix, const char *kind) {
+  for (long i=0; i<igraph_strvector_size(names); i++) {
+    const char *type = graphml_type((igraph_attribute_type_t) VECTOR(*types)[i]);
+    if (type != NULL) {
+      char *name_escaped;
+      IGRAPH_CHECK(igraph_i_xml_escape((char*) STR(*names, i), &name_escaped));
+      out_buffer_printf(buf, "  <key id=\"%s%s\" for=\"%s\" attr.name=\"%s\" attr.type=\"%s\"/>\x0A",
+                        prefix, name_escaped, kind, name_escaped, type);
+      igraph_Free(name_escaped);
+    }
+  }
+  return 0;
+}
+
+/** Writes one <data> element of column col for element elem.  NaN numbers
+ are left out, as igraph does. */
+static int write_data(struct OutBuffer *buf, const struct AttrColumn *col,
+                      const char *tag, long elem) {
+  if (col->type == IGRAPH_ATTRIBUTE_NUMERIC) {
+    if (!isnan(VECTOR(col->num)[elem])) {
+      out_buffer_puts(buf, tag);
+      out_buffer_g(buf, VECTOR(col->num)[elem]);
+      out_buffer_puts(buf, "</data>\x0A");
+    }
+  } else if (col->type == IGRAPH_ATTRIBUTE_STRING) {
+    int result;
+    out_buffer_puts(buf, tag);
+    if ((result = out_buffer_xml(buf, STR(col->str, elem))) != 0) {
+      return result;
+    }
+    out_buffer_puts(buf, "</data>\x0A");
+  } else if (col->type == IGRAPH_ATTRIBUTE_BOOLEAN) {
+    out_buffer_puts(buf, tag);
+    out_buffer_puts(buf, VECTOR(col->boolv)[elem] ? "true" : "false");
+    out_buffer_puts(buf, "</data>\x0A");
+  }
+  return 0;
+}
+
+/** Writes the <node> elements from (inclusive) to to (exclusive). */
+static int write_nodes(const void *arg, long from, long to, struct OutBuffer *buf) {
+  const struct GraphmlWriter *w = (const struct GraphmlWriter*) arg;
+  int result;
+  for (long l=from; l<to; l++) {
+    out_buffer_puts(buf, "    <node id=\"n");
+    out_buffer_long(buf, l);
+    out_buffer_puts(buf, "\">\x0A");
+    for (long i=0; i<w->vtable.count; i++) {
+      if ((result = write_data(buf, &w->vtable.cols[i], w->vtag[i], l)) != 0) {
+        return result;
+      }
+    }
+    out_buffer_puts(buf, "    </node>\x0A");
+  }
+  return 0;
+}
+
+/** Writes the <edge> elements from (inclusive) to to (exclusive). */
+static int write_edges(const void *arg, long from, long to, struct OutBuffer *buf) {
+  const struct GraphmlWriter *w = (const struct GraphmlWriter*) arg;
+  int result;
+  for (long l=from; l<to; l++) {
+    out_buffer_puts(buf, "    <edge source=\"n");
+    out_buffer_long(buf, (long) VECTOR(w->edges)[2 * l]);
+    out_buffer_puts(buf, "\" target=\"n");
+    out_buffer_long(buf, (long) VECTOR(w->edges)[2 * l + 1]);
+    out_buffer_puts(buf, "\">\x0A");
+    for (long i=0; i<w->etable.count; i++) {
+      if ((result = write_data(buf, &w->etable.cols[i], w->etag[i], l)) != 0) {
+        return result;
+      }
+    }
+    out_buffer_puts(buf, "    </edge>\x0A");
+  }
+  return 0;
+}
+
+/** Writes the graph-level <data> elements. */
+static int write_graph_data(struct OutBuffer *buf, const igraph_t *graph,
+                            const igraph_strvector_t *names, const igraph_vector_t *types,
+                            const char *prefix) {
+  for (long i=0; i<igraph_strvector_size(names); i++) {
+    const char *name = STR(*names, i);
+    igraph_attribute_type_t type = (igraph_attribute_type_t) VECTOR(*types)[i];
+    char *tag;
+    int result = 0;
+    if (graphml_type(type) == NULL
+        || (type == IGRAPH_ATTRIBUTE_NUMERIC && isnan(GAN(graph, name)))) {
+      continue;
+    }
+    IGRAPH_CHECK(data_tag("    ", prefix, name, &tag));
+    out_buffer_puts(buf, tag);
+    if (type == IGRAPH_ATTRIBUTE_NUMERIC) {
+      out_buffer_g(buf, GAN(graph, name));
+    } else if (type == IGRAPH_ATTRIBUTE_STRING) {
+      result = out_buffer_xml(buf, GAS(graph, name));
+    } else {
+      out_buffer_puts(buf, GAB(graph, name) ? "true" : "false");
+    }
+    out_buffer_puts(buf, "</data>\x0A");
+    free(tag);
+    if (result != 0) {
+      IGRAPH_ERROR("Cannot format GraphML output", result);
+    }
+  }
+  return 0;
+}
+
+/** Writes a GraphML file exactly as igraph_write_graph_graphml does.
+
+ Attributes are read as whole columns and the <node> and <edge> elements
+ are formatted on ug_threads threads by out_buffer_ranges, so a large graph
+ is not written one fprintf at a time.  TEST_WRITE_GRAPHML_THREADS checks
+ the output against igraph's writer.
+
+ @param graph - the graph to write.
+ @param outstream - the stream to write to.
+ @param prefixattr - if true, prefixes attribute keys with "g_", "v_" and "e_".
+ @return 0, or an igraph error code.
+ */
+int write_graph_graphml(const igraph_t *graph, FILE *outstream, igraph_bool_t prefixattr) {
+  igraph_strvector_t gnames, vnames, enames;
+  igraph_vector_t gtypes, vtypes, etypes;
+  struct GraphmlWriter w;
+  struct OutBuffer buf;
+  const char *gprefix = prefixattr ? "g_" : "";
+  const char *vprefix = prefixattr ? "v_" : "";
+  const char *eprefix = prefixattr ? "e_" : "";
+  long threads = io_threads();
+  int result = 0;
+
+  igraph_strvector_init(&gnames, 0);
+  igraph_strvector_init(&vnames, 0);
+  igraph_strvector_init(&enames, 0);
+  igraph_vector_init(&gtypes, 0);
+  igraph_vector_init(&vtypes, 0);
+  igraph_vector_init(&etypes, 0);
+  igraph_cattribute_list(graph, &gnames, &gtypes, &vnames, &vtypes, &enames, &etypes);
+  attr_table_init(&w.vtable, graph, IGRAPH_ATTRIBUTE_VERTEX);
+  attr_table_init(&w.etable, graph, IGRAPH_ATTRIBUTE_EDGE);
+  w.vtag = (char**) calloc(w.vtable.count + 1, sizeof(char*));
+  w.etag = (char**) calloc(w.etable.count + 1, sizeof(char*));
+  igraph_vector_init(&w.edges, 0);
+  igraph_get_edgelist(graph, &w.edges, 0);
+
+  out_buffer_init(&buf, outstream);
+  out_buffer_puts(&buf, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\x0A"
+                  "<graphml xmlns=\"http://graphml.graphdrawing.org/xmlns\"\x0A"
+                  "         xmlns:xsi=\"http://www.w3.org/2001/XMLSchema-instance\"\x0A"
+                  "         xsi:schemaLocation=\"http://graphml.graphdrawing.org/xmlns\x0A"
+                  "         http://graphml.graphdrawing.org/xmlns/1.0/graphml.xsd\">\x0A"
+                  "<!-- Created by igraph -->\x0A");
+  if (w.vtag == NULL || w.etag == NULL) {
+    result = IGRAPH_ENOMEM;
+  }
+  for (long i=0; result == 0 && i<w.vtable.count; i++) {
+    result = data_tag("      ", vprefix, w.vtable.cols[i].name, &w.vtag[i]);
+  }
+  for (long i=0; result == 0 && i<w.etable.count; i++) {
+    result = data_tag("      ", eprefix, w.etable.cols[i].name, &w.etag[i]);
+  }
+  if (result == 0) {
+    result = write_keys(&buf, &gnames, &gtypes, gprefix, "graph");
+  }
+  if (result == 0) {
+    result = write_keys(&buf, &vnames, &vtypes, vprefix, "node");
+  }
+  if (result == 0) {
+    result = write_keys(&buf, &enames, &etypes, eprefix, "edge");
+  }
+  out_buffer_printf(&buf, "  <graph id=\"G\" edgedefault=\"%s\">\x0A",
+                    igraph_is_directed(graph) ? "directed" : "undirected");
+  if (result == 0) {
+    result = write_graph_data(&buf, graph, &gnames, &gtypes, gprefix);
+  }
+  if (result == 0) {
+    result = out_buffer_ranges(&buf, igraph_vcount(graph), threads, write_nodes, &w);
+  }
+  if (result == 0) {
+    result = out_buffer_ranges(&buf, igraph_ecount(graph), threads, write_edges, &w);
+  }
+  out_buffer_puts(&buf, "  </graph>\x0A</graphml>\x0A");
+
+  for (long i=0; w.vtag != NULL && i<w.vtable.count; i++) {
+    free(w.vtag[i]);
+  }
+  for (long i=0; w.etag != NULL && i<w.etable.count; i++) {
+    free(w.etag[i]);
+  }
+  free(w.vtag);
+  free(w.etag);
+  attr_table_destroy(&w.vtable);
+  attr_table_destroy(&w.etable);
+  igraph_vector_destroy(&w.edges);
+  igraph_strvector_destroy(&gnames);
+  igraph_strvector_destroy(&vnames);
+  igraph_strvector_destroy(&enames);
+  igraph_vector_destroy(&gtypes);
+  igraph_vector_destroy(&vtypes);
+  igraph_vector_destroy(&etypes);
+
+  if (out_buffer_destroy(&buf) != 0) {
+    IGRAPH_ERROR("Write failed", IGRAPH_EFILE);
+  }
+  if (result != 0) {
+    IGRAPH_ERROR("Cannot format GraphML output", result);
+  }
+  return 0;
+}
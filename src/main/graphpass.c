@@ -22,6 +22,9 @@
  Graphpass accepts a file, a percentage and a series of characters that represent
  methods of filtering a network graph, and outputs new graph files with the filtered
  graphs and optionally, a report showing how those filters affected the graph.
+
+ The command line sets the options of a gp_context and runs it through the
+ API in libgraphpass.h.
  */
 
 #define _GNU_SOURCE
@@ -33,32 +36,73 @@
 #include <stdlib.h>
 #include "graphpass.h"
 
-char* FILEPATH; /**< The filepath (ug_DIRECTORY + ug_FILENAME). */
-
-/** Whether to save the graph. **/
-bool ug_save = true;
-/** Graph format true for GEXF; false for GRAPHML. **/
-bool ug_gformat = false;
-/** Produce a report analyzing effect of filtering on graph. **/
-bool ug_report = false;
-/** Provide a quickrun with simple sizing, positioning and coloring. **/
-bool ug_quickrun = false;
-/** Print out helper messages. **/
-bool ug_verbose = false;
+static char* FILEPATH; /**< The input, from --input or the arguments. */
+
+/** The context the command line configures (see libgraphpass.c). **/
+static gp_context *ctx;
+/** The arguments that are not options: [output] input, in reverse. **/
+static struct Argument *args = NULL;
+/** The input (--input) and output (--output) given as options. **/
+static char *input = NULL;
+static char *output = NULL;
+/** Filter one graph, unless --batch lists many (gp_batch). **/
+static char* batch = NULL;
+/** Filter the graph, unless --dry-run only asks what it would cost (gp_check). **/
+static bool dry_run = false;
+/** Serve filter requests on this socket instead of filtering once (gp_serve). **/
+static char* serve = NULL;
+/** Megabytes of graphs --serve keeps loaded; 0 uses SERVE_CACHE_MB. **/
+static long serve_cache = 0;
+/** Filter the graph, unless "convert" asks for a snapshot. **/
+static bool convert = false;
+/** Sweep percentages instead of filtering once (--sweep start:end:step, gp_sweep). **/
+static bool sweep = false;
+static int sweep_start = 0;
+static int sweep_end = 99;
+static int sweep_step = 1;
 /** Not a test file. */
 bool ug_TEST = false;
 /** Concluding error msg. */
-int conclude;
+static int conclude;
 
 const char hyphen = '-';
 
+/** Sets an option of the context, or exits with its error. */
+static void set_option(const char *option, const char *value) {
+  if (gp_set(ctx, option, value) != 0) {
+    fprintf(stderr, "FAIL >>> %s.\n", gp_error(ctx));
+    exit(EXIT_FAILURE);
+  }
+}
+
+/** Frees the context and the argument list. */
+static void finish() {
+  gp_destroy(ctx);
+  freeArgs(&args);
+}
+
+/** Prints the context's error and exits. */
+static void fail_run() {
+  fprintf(stderr, "FAIL >>> %s.\n", gp_error(ctx));
+  fprintf(stderr, "FAIL >>> Exiting...\n");
+  finish();
+  exit(EXIT_FAILURE);
+}
+
 int main (int argc, char *argv[]) {
   int c;
+  ctx = gp_create();
+  if (ctx == NULL) {
+    fprintf(stderr, "FAIL >>> Graphpass could not allocate its context.\n");
+    exit(EXIT_FAILURE);
+  }
   while (1)
     {
       static struct option long_options[] =
         {
           /* These options have no required argument. */
+          {"cache",   no_argument,       0, 'c'},
+          {"dry-run", no_argument,       0, 'D'},
           {"gexf",    no_argument,       0, 'g'},
           {"no-save", no_argument,       0, 'n'},
           {"quick",   no_argument,       0, 'q'},
@@ -66,17 +110,31 @@ int main (int argc, char *argv[]) {
           {"verbose", no_argument,       0, 'v'},
 
           /* These options require an argument. */
+          {"attrs", required_argument, 0, 'a'},
+          {"batch", required_argument, 0, 'l'},
+          {"betweenness", required_argument, 0, 'b'},
+          {"distances", required_argument, 0, 'd'},
+          {"format", required_argument, 0, 'f'},
           {"input", required_argument, 0, 'i'},
+          {"jobs", required_argument, 0, 'j'},
           {"methods", required_argument, 0, 'm'},
           {"output",  required_argument, 0, 'o'},
           {"percent", required_argument, 0, 'p'},
+          {"serve", required_argument, 0, 'u'},
+          {"serve-cache", required_argument, 0, 'e'},
+          {"sweep", required_argument, 0, 's'},
+          {"threads", required_argument, 0, 't'},
           {"max-nodes", required_argument, 0, 'x'},
           {"max-edges", required_argument, 0, 'y'},
+          {"memory-budget", required_argument, 0, 'M'},
+          {"time-budget", required_argument, 0, 'T'},
+          {"write-queue", required_argument, 0, 'k'},
+          {"compress", required_argument, 0, 'z'},
           {0, 0, 0, 0}
         };
       /* getopt_long stores the option index here. */
       int option_index = 0;
-      c = getopt_long (argc, argv, "gnvqri:m:o:p:x:y:",
+      c = getopt_long (argc, argv, "cgnvqrDa:b:d:e:f:i:j:k:l:m:o:p:s:t:u:x:y:z:M:T:",
                        long_options, &option_index);
 
       /* Detect the end of the options. */
@@ -88,41 +146,90 @@ int main (int argc, char *argv[]) {
           /* If this option sets a flag, do nothing else now. */
           if (long_options[option_index].flag != 0)
             break;
+        case 'c':
+          set_option("cache", NULL);
+          break;
+        case 'D':
+          dry_run = true;
+          break;
+        case 'M':
+          set_option("memory-budget", optarg);
+          break;
+        case 'T':
+          set_option("time-budget", optarg);
+          break;
         case 'n':
-          ug_save = !ug_save;
+          set_option("no-save", NULL);
           break;
         case 'g':
-          ug_gformat = !ug_gformat;
+          set_option("gexf", NULL);
+          break;
+        case 'a':
+          set_option("attrs", optarg);
+          break;
+        case 'b':
+          set_option("betweenness", optarg);
+          break;
+        case 'd':
+          set_option("distances", optarg);
+          break;
+        case 'e':
+          serve_cache = optarg ? (long)strtol(optarg, (char**)NULL, 10) : 0;
+          break;
+        case 'f':
+          set_option("format", optarg);
           break;
         case 'i':
-          ug_INPUT = optarg ? optarg : "./";
+          input = optarg ? optarg : "./";
+          break;
+        case 'j':
+          set_option("jobs", optarg);
+          break;
+        case 'k':
+          set_option("write-queue", optarg);
+          break;
+        case 'l':
+          batch = optarg;
           break;
         case 'r':
-          ug_report = !ug_report;
+          set_option("report", NULL);
           break;
         case 'm':
-          ug_methods = optarg ? optarg : "d";
+          set_option("methods", optarg);
           break;
         case 'o':
-          ug_OUT = optarg ? optarg : "./";
+          output = optarg ? optarg : "./";
           break;
         case 'p':
-          ug_percent = optarg ? atof(optarg) : 0.0;
+          set_option("percent", optarg);
           break;
-        case 'q':
-          ug_quickrun = !ug_quickrun;
+        case 's':
+          sweep = true;
+          if (sscanf(optarg, "%d:%d:%d", &sweep_start, &sweep_end, &sweep_step) < 2) {
+            fprintf(stderr, "FAIL >>> --sweep expects start:end or start:end:step.\n");
+            exit(EXIT_FAILURE);
+          }
           break;
-        case 'w':
-          CALC_WEIGHTS = !CALC_WEIGHTS;
+        case 't':
+          set_option("threads", optarg);
+          break;
+        case 'u':
+          serve = optarg;
+          break;
+        case 'q':
+          set_option("quick", NULL);
           break;
         case 'v':
-          ug_verbose = true;
+          set_option("verbose", NULL);
           break;
         case 'x':
-          ug_maxnodes = optarg ? (long)strtol(optarg, (char**)NULL, 10) : MAX_NODES;
+          set_option("max-nodes", optarg);
           break;
         case 'y':
-          ug_maxedges = optarg ? (long)strtol(optarg, (char**)NULL, 10) : MAX_EDGES;
+          set_option("max-edges", optarg);
+          break;
+        case 'z':
+          set_option("compress", optarg);
           break;
         case '?':
           /* getopt_long already printed an error message. */
@@ -132,90 +239,96 @@ int main (int argc, char *argv[]) {
         }
     }
 
+  /* "graphpass convert [input] [output]" writes a snapshot. */
+  if (optind < argc && strcmp(argv[optind], "convert") == 0) {
+    convert = true;
+    optind++;
+  }
+
   /* Print any remaining command line arguments (not options). */
   if (optind < argc)
     {
       while (optind < argc)
-        pushArg(&ug_args, argv[optind++]);
+        pushArg(&args, argv[optind++]);
     }
 
   /** Set default values if not included in flags. **/
-  if (ug_args) {
-    ug_OUTARG = ug_args->val;
-    if (ug_args->next) {
-      ug_PATH = ug_args->next->val;
+  char *path = NULL;
+  char *outarg = NULL;
+  if (args) {
+    outarg = args->val;
+    if (args->next) {
+      path = args->next->val;
     } else {
-      ug_PATH = ug_OUTARG;
-      ug_OUTARG = NULL;
+      path = outarg;
+      outarg = NULL;
     }
   }
-  ug_maxnodes = ug_maxnodes ? ug_maxnodes : MAX_NODES;
-  ug_maxedges = ug_maxedges ? ug_maxedges : MAX_EDGES;
-  ug_percent = ug_percent ? ug_percent : 0.00;
-  ug_methods = ug_methods ? ug_methods : "d";
-  /** Setup directory path and filenames. **/
-  FILEPATH = ug_INPUT ? ug_INPUT : ug_PATH;
-  FILEPATH = FILEPATH ? FILEPATH : "src/resources/cpp2.graphml";
-  get_filename(FILEPATH, &ug_FILENAME);
-  ug_FILENAME = ug_FILENAME ? ug_FILENAME : "FILE";
-  get_directory(FILEPATH, &ug_DIRECTORY);
-  ug_DIRECTORY = ug_DIRECTORY ? ug_DIRECTORY : "./";
-  if (ug_OUTARG) {
-    get_filename(ug_OUTARG, &ug_OUTFILE);
-    // If OUTPATH and FILEPATH are the same, this could overwrite original file.
-    // Checks follow below.
-    ug_OUTFILE = ug_OUTFILE ? ug_OUTFILE : ug_FILENAME;
-    get_directory(ug_OUTARG, &ug_OUTPATH);
-    ug_OUTPATH = ug_OUTPATH ? ug_OUTPATH : "./";
-  } else {
-    ug_OUTPATH = "./";
-    ug_OUTFILE = ug_FILENAME;
+  if (serve) {
+    conclude = gp_serve(ctx, serve, serve_cache);
+    finish();
+    return conclude == 0 ? 0 : EXIT_FAILURE;
   }
-  // Prevent output from destroying original file.
-  if(strcmp(ug_OUTFILE, ug_FILENAME) == 0
-    && strcmp(ug_OUTPATH, ug_DIRECTORY) == 0) {
-    fprintf(stderr, "FAIL >>> Input and output locations cannot be the same.\n");
-    fprintf(stderr, "FAIL >>> Exiting...\n");
-    exit(EXIT_FAILURE);
+  if (batch) {
+    char *outdir = output ? output : (args ? args->val : "./");
+    conclude = gp_batch(ctx, batch, outdir);
+    finish();
+    return conclude == 0 ? 0 : EXIT_FAILURE;
   }
+  /** Setup directory path and filenames. **/
+  FILEPATH = input ? input : path;
+  FILEPATH = FILEPATH ? FILEPATH : "src/resources/cpp2.graphml";
 
-  /** Start output description. **/
-  if (ug_verbose == true) {
-    printf(">>>>>>>  GRAPHPASSING >>>>>>>> \n");
-    printf("FILEPATH: %s\n", FILEPATH);
-    printf("OUTPUT DIRECTORY: %s\nPERCENTAGE: %f\n", ug_OUTPATH, ug_percent);
-    printf("FILE: %s\nMETHODS STRING: %s\n", ug_FILENAME, ug_methods);
-    printf("QUICKRUN: %i\nREPORT: %i\nSAVE: %i\n", ug_quickrun, ug_report, ug_save);
+  if (convert == true) {
+    char *snapshot = snapshot_path(FILEPATH, outarg);
+    if (gp_convert(ctx, FILEPATH, outarg) != 0) {
+      free(snapshot);
+      fail_run();
+    }
+    printf("\n\n>>>>  SUCCESS! - Snapshot written to %s\n", snapshot);
+    free(snapshot);
+    finish();
+    return 0;
   }
 
-  /** Set up FILEPATH to access graphml file. **/
-  if (ug_verbose == true) {
-    printf("Running graphpass on file: %s\n", FILEPATH);
+  /** Load the graph; with --verbose this prints the run's settings. **/
+  if (gp_load(ctx, FILEPATH, outarg) != 0) {
+    fail_run();
   }
-  int load = load_graph(FILEPATH);
-  if (load != 0) {
-    fprintf(stderr, "FAIL >>> Graphpass could not load the graph.");
-    exit(EXIT_FAILURE);
+
+  int fits = gp_check(ctx, dry_run ? stdout : NULL);
+  if (dry_run == true) {
+    if (fits != 0) {
+      printf("\nThis run would be rejected: %s.\n", gp_error(ctx));
+    }
+    finish();
+    return fits == 0 ? 0 : EXIT_FAILURE;
   }
-  if (igraph_vcount(&g) > ug_maxnodes || igraph_ecount(&g) > ug_maxedges){
-    fprintf(stderr, "FAIL >>> Graphpass can only conduct analysis on graphs with \
-fewer than %li nodes and %li edges.\n", ug_maxnodes, ug_maxedges);
+  if (fits != 0) {
+    fprintf(stderr, "FAIL >>> Graphpass will not run: %s.\n", gp_error(ctx));
+    fprintf(stderr, "FAIL >>> Use --dry-run to see the estimate, or raise the budget.\n");
     fprintf(stderr, "FAIL >>> Exiting...\n");
+    finish();
     exit(EXIT_FAILURE);
   }
 
   /** Start the filtering based on values and methods. **/
-  conclude = filter_graph();
+  if (sweep == true) {
+    conclude = gp_sweep(ctx, sweep_start, sweep_end, sweep_step);
+  } else {
+    conclude = gp_analyze(ctx) != 0 || gp_filter(ctx) != 0 || gp_write(ctx) != 0 ? -1 : 0;
+  }
   if (conclude == 0) {
     printf("\n\n>>>>  SUCCESS!");
   } else {
-    fprintf(stderr, ">>>>  FAIL - an unknown error occurred during run.");
+    fprintf(stderr, ">>>>  FAIL - %s.", gp_error(ctx));
   }
-  if (ug_save) {
-    printf("- Files output to %s\n", ug_OUTPATH);
+  if (gp_output(ctx) != NULL) {
+    printf("- Files output to %s\n", gp_output(ctx));
   }
   else {
     printf("- NO_SAVE requested, so no output.\n\n\n");
   }
-  return 0;
+  finish();
+  return conclude == 0 ? 0 : EXIT_FAILURE;
 }
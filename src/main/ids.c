@@ -0,0 +1,183 @@
+/*
+ * GraphPass:
+ * A utility to filter networks and provide a default visualization output
+ * for Gephi or SigmaJS.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** @file ids.c
+ @brief Node ids of 32 hex digits, kept as 128-bit keys.
+
+ The node ids of the web archive crawls are MD5 digests written as 32
+ lowercase hex digits.  As a string attribute each is a separate 33-byte
+ allocation behind a pointer, copied one by one whenever a filtered graph
+ is built.  When every id of a GraphML file has that form, load_graphml_mmap
+ interns them as a NodeKey and stores them in NODE_KEY_PARTS numeric
+ vertex columns instead: 24 bytes per vertex in three plain vectors.
+
+ igraph's attribute handler only knows numbers, strings and booleans, and a
+ double holds 53 bits exactly, so a key is split at hex digit boundaries
+ into 52, 52 and 24 bits.  write_graph formats a copy of the graph in
+ which the columns are the "id" string attribute again (copy_node_ids,
+ see view_output), so the output is the same as for a graph loaded with
+ string ids while the graph itself keeps its packed ids.  Any other ids
+ stay strings.
+ */
+
+#include <graphpass.h>
+
+/** The vertex columns holding the parts of a NodeKey, most significant first. */
+static const char *NODE_KEY_ATTRS[NODE_KEY_PARTS] = {"id#0", "id#1", "id#2"};
+
+/** Value of a lowercase hex digit, or -1. */
+static int hex_value(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  return -1;
+}
+
+/** Reads a node id of exactly NODE_KEY_DIGITS lowercase hex digits.
+
+ Uppercase digits are refused, so that node_key_format gives back the id
+ it was read from.
+
+ @param text - the id, not necessarily NUL-terminated.
+ @param len - its length.
+ @param key - set to the key.
+ @return 0, or -1 if the id does not have that form.
+ */
+int node_key_parse(const char *text, long len, struct NodeKey *key) {
+  uint64_t half[2] = {0, 0};
+  if (len != NODE_KEY_DIGITS) {
+    return -1;
+  }
+  for (int i=0; i<NODE_KEY_DIGITS; i++) {
+    int v = hex_value(text[i]);
+    if (v < 0) {
+      return -1;
+    }
+    half[i / 16] = (half[i / 16] << 4) | (uint64_t) v;
+  }
+  key->hi = half[0];
+  key->lo = half[1];
+  return 0;
+}
+
+/** Writes a key as NODE_KEY_DIGITS lowercase hex digits and a NUL. */
+void node_key_format(const struct NodeKey *key, char *text) {
+  snprintf(text, NODE_KEY_DIGITS + 1, "%016llx%016llx", (unsigned long long) key->hi,
+           (unsigned long long) key->lo);
+}
+
+/** Whether a vertex attribute is one of the columns of a packed id. */
+bool is_node_key_attr(const char *name) {
+  for (int p=0; p<NODE_KEY_PARTS; p++) {
+    if (strcmp(name, NODE_KEY_ATTRS[p]) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/** Whether the graph's node ids are packed. */
+bool has_node_keys(const igraph_t *graph) {
+  return igraph_cattribute_has_attr(graph, IGRAPH_ATTRIBUTE_VERTEX, NODE_KEY_ATTRS[0]);
+}
+
+/** Stores one key per vertex as the graph's node ids.
+
+ @param graph - the graph, with n vertices.
+ @param keys - the id of each vertex.
+ @param n - the number of vertices.
+ @return 0 unless an error occurs.
+ */
+int set_node_keys(igraph_t *graph, const struct NodeKey *keys, long n) {
+  igraph_vector_t parts[NODE_KEY_PARTS];
+  for (int p=0; p<NODE_KEY_PARTS; p++) {
+    IGRAPH_CHECK(igraph_vector_init(&parts[p], n));
+  }
+  for (long i=0; i<n; i++) {
+    VECTOR(parts[0])[i] = (igraph_real_t) (keys[i].hi >> 12);
+    VECTOR(parts[1])[i] = (igraph_real_t) (((keys[i].hi & 0xfff) << 40) | (keys[i].lo >> 24));
+    VECTOR(parts[2])[i] = (igraph_real_t) (keys[i].lo & 0xffffff);
+  }
+  for (int p=0; p<NODE_KEY_PARTS; p++) {
+    SETVANV(graph, NODE_KEY_ATTRS[p], &parts[p]);
+    igraph_vector_destroy(&parts[p]);
+  }
+  return 0;
+}
+
+/** Reads the packed id of every vertex.
+
+ @param graph - a graph with packed ids (see has_node_keys).
+ @param keys - room for one key per vertex.
+ @return 0 unless an error occurs.
+ */
+int get_node_keys(const igraph_t *graph, struct NodeKey *keys) {
+  long n = igraph_vcount(graph);
+  igraph_vector_t parts[NODE_KEY_PARTS];
+  for (int p=0; p<NODE_KEY_PARTS; p++) {
+    IGRAPH_CHECK(igraph_vector_init(&parts[p], n));
+    igraph_i_attribute_get_numeric_vertex_attr(graph, NODE_KEY_ATTRS[p], igraph_vss_all(),
+                                               &parts[p]);
+  }
+  for (long i=0; i<n; i++) {
+    uint64_t top = (uint64_t) VECTOR(parts[0])[i];
+    uint64_t mid = (uint64_t) VECTOR(parts[1])[i];
+    uint64_t low = (uint64_t) VECTOR(parts[2])[i];
+    keys[i].hi = (top << 12) | (mid >> 40);
+    keys[i].lo = ((mid & 0xffffffffffULL) << 24) | low;
+  }
+  for (int p=0; p<NODE_KEY_PARTS; p++) {
+    igraph_vector_destroy(&parts[p]);
+  }
+  return 0;
+}
+
+/** Sets the "id" string attribute of a graph from the packed ids of another.
+
+ Called by view_output, which puts "id" where the first column of the
+ packed ids is, so GraphML keys and GEXF attributes come out in the same
+ order as for a graph loaded with string ids.
+
+ @param from - a graph with packed ids (see has_node_keys).
+ @param to - the graph to set "id" on, with count vertices.
+ @param keep - the vertex of from that each vertex of to is.
+ @param count - the number of vertices of to.
+ @return 0 unless an error occurs.
+ */
+int copy_node_ids(const igraph_t *from, igraph_t *to, const long *keep, long count) {
+  long n = igraph_vcount(from);
+  struct NodeKey *keys = malloc((n > 0 ? n : 1) * sizeof(struct NodeKey));
+  if (keys == NULL) {
+    return -1;
+  }
+  get_node_keys(from, keys);
+  igraph_strvector_t ids;
+  char text[NODE_KEY_DIGITS + 1];
+  igraph_strvector_init(&ids, count);
+  for (long i=0; i<count; i++) {
+    node_key_format(&keys[keep[i]], text);
+    igraph_strvector_set2(&ids, i, text, NODE_KEY_DIGITS);
+  }
+  free(keys);
+  SETVASV(to, "id", &ids);
+  igraph_strvector_destroy(&ids);
+  return 0;
+}
@@ -77,47 +77,299 @@ int strip_ext(char *fname) {
   return 0;
 }
 
-/** \fn int load_graph
- Loads a graphml file.
+/** \fn long io_threads
+    \brief Works out how many threads read or write a file (--threads).
+
+    A value of 0 (the default) uses every online processor.
+ */
+long io_threads () {
+  long threads = ug_threads;
+  if (threads < 1) {
+    threads = sysconf(_SC_NPROCESSORS_ONLN);
+  }
+  return threads < 1 ? 1 : threads;
+}
+
+/** \fn uint64_t fnv_hash
+    \brief Adds bytes to an FNV-1a hash.
+
+    Start from FNV_OFFSET; hashing a second run of bytes continues the first.
+    @param hash - the hash so far.
+    @param data - the bytes to add.
+    @param len - their number.
+    @return the new hash.
+ */
+uint64_t fnv_hash(uint64_t hash, const void *data, size_t len) {
+  const unsigned char *p = (const unsigned char*) data;
+  for (size_t i=0; i<len; i++) {
+    hash ^= p[i];
+    hash *= FNV_PRIME;
+  }
+  return hash;
+}
+
+/** \fn double now_ms
+    \brief Milliseconds on the monotonic clock, for timing runs.
+ */
+double now_ms() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+/** \fn int load_graphml_libxml
+ Loads a graphml file with igraph's own (libxml2) reader.
  @param filename - name of the file to load.
+ @param graph - an uninitialized graph to load into.
+ @return 0, or -1 if the file cannot be opened.
  */
-extern int load_graph (char* filename) {
-  igraph_i_set_attribute_table(&igraph_cattribute_table);
+int load_graphml_libxml(const char *filename, igraph_t *graph) {
   FILE *fp;
   fp = fopen(filename, "r");
   if (fp == 0) {
+    return (-1);
+  }
+  igraph_read_graph_graphml(graph, fp, 0);
+  fclose(fp);
+  return (0);
+}
+
+/** \fn int load_compressed
+ Loads a gzip or zstd compressed graphml file.
+
+ The file is decompressed into memory and read from there by the loader in
+ graphml.c, or by igraph's reader through fmemopen when it falls back.
+ @param filename - name of the file to load.
+ @param type - its compression.
+ @param graph - an uninitialized graph to load into.
+ @return 0, or -1 if the file cannot be decompressed.
+ */
+static int load_compressed(const char *filename, compression_t type, igraph_t *graph) {
+  char *data;
+  size_t size;
+  if (ug_verbose) {
+    printf("Decompressing %s input.\n", type == COMPRESSION_GZIP ? "gzip" : "zstd");
+  }
+  if (decompress_file(filename, type, &data, &size) != 0 || size == 0) {
+    free(data);
+    return (-1);
+  }
+  int loaded = load_graphml_buffer(data, size, graph);
+  if (loaded == GRAPHML_UNSUPPORTED) {
+    FILE *fp = fmemopen(data, size, "r");
+    loaded = -1;
+    if (fp != NULL) {
+      igraph_read_graph_graphml(graph, fp, 0);
+      fclose(fp);
+      loaded = 0;
+    }
+  }
+  free(data);
+  return loaded;
+}
+
+/** \fn int load_graph
+ Loads a graphml file, a snapshot or a CSV edge list.
+
+ Directories and .csv or .tsv files are read as edge lists (see csv.c).
+ Snapshots written by "graphpass convert" are recognised by their magic
+ and mapped (see snapshot.c).  Otherwise tries the mmap loader in graphml.c
+ first and falls back to igraph's reader for GraphML it does not handle.
+ Files compressed with gzip or zstd are recognised by their first bytes and
+ decompressed on the fly.
+ @param filename - name of the file to load.
+ */
+extern int load_graph (char* filename) {
+  igraph_i_set_attribute_table(&igraph_cattribute_table);
+  int loaded;
+  int compression = detect_compression(filename);
+  ug_snapshot_metrics = 0;
+  if (is_csv_input(filename)) {
+    loaded = load_csv(filename, &g);
+  } else if (compression == COMPRESSION_NONE
+      && (loaded = load_snapshot(filename, &g, &ug_snapshot_metrics, false)) != SNAPSHOT_NONE) {
+    if (loaded != 0) {
+      if (!ug_TEST) {
+        fprintf(stderr, ">>> FAILURE - Snapshot %s is damaged or was written by another version.\n",
+                filename);
+        fprintf(stderr, ">>>         - Convert the graph again.\n");
+      }
+      return (-1);
+    }
+    if (ug_verbose) {
+      printf("Loaded snapshot %s.\n", filename);
+    }
+  } else if (compression == COMPRESSION_GZIP || compression == COMPRESSION_ZSTD) {
+    loaded = load_compressed(filename, compression, &g);
+  } else {
+    loaded = load_graphml_mmap(filename, &g);
+    if (loaded == GRAPHML_UNSUPPORTED) {
+      if (ug_verbose) {
+        printf("Reading %s with the igraph GraphML reader.\n", filename);
+      }
+      loaded = load_graphml_libxml(filename, &g);
+    }
+  }
+  if (loaded != 0) {
     if (!ug_TEST) {
       fprintf(stderr, ">>> FAILURE - Could not find graphML file at filepath location.\n");
     }
     return (-1);
   }
-  igraph_read_graph_graphml(&g, fp, 0);
   NODESIZE = igraph_vcount(&g);
   EDGESIZE = igraph_ecount(&g);
   if (ug_verbose) {
     printf("Successfully ingested graph with %li nodes and %li edges.\n"
     , (long int)NODESIZE, (long int)EDGESIZE);
   }
-  fclose(fp);
   return (0);
 }
 
 
+/** \fn int parse_format
+    \brief Parses the --format argument into ug_format.
+    @param arg - "graphml", "gexf" or "sigma".
+    @return 0, or -1 if arg is not a known format.
+ */
+int parse_format(char *arg) {
+  if (strcmp(arg, "graphml") == 0) {
+    ug_format = FORMAT_GRAPHML;
+  } else if (strcmp(arg, "gexf") == 0) {
+    ug_format = FORMAT_GEXF;
+  } else if (strcmp(arg, "sigma") == 0) {
+    ug_format = FORMAT_SIGMA;
+  } else {
+    return -1;
+  }
+  return 0;
+}
+
+/** \fn FILE* open_output
+    \brief Opens an output file, through a compression thread if ug_compress
+    asks for one.
+    @param path - the file to create.
+    @param cs - the compression stream, used unless ug_compress is none.
+    @return the stream to write to, or NULL if the file cannot be created.
+ */
+FILE* open_output(const char *path, struct CompressStream *cs) {
+  if (ug_compress == COMPRESSION_NONE) {
+    return fopen(path, "w");
+  }
+  return compress_stream_open(cs, path, ug_compress, ug_compress_level);
+}
+
+/** \fn int close_output
+    \brief Closes a stream from open_output.
+    @return 0, or -1 if the file could not be written.
+ */
+int close_output(FILE *fp, struct CompressStream *cs) {
+  if (ug_compress == COMPRESSION_NONE) {
+    return fclose(fp) == 0 ? 0 : -1;
+  }
+  return compress_stream_close(cs);
+}
+
+/** Formats graph in the format ug_format selects.
+
+ The writers report errors through igraph's error handler, which aborts
+ by default; it is set to return the error instead, so a failed write
+ reaches the caller and the exit status like any other failed output.
+
+ @return 0, or -1 if the output could not be written.
+ */
+int format_graph(igraph_t *graph, FILE *fp) {
+  int rc;
+  igraph_error_handler_t *handler = igraph_set_error_handler(
+      ug_TEST ? igraph_error_handler_ignore : igraph_error_handler_printignore);
+  if (ug_format == FORMAT_GEXF) {
+    rc = igraph_write_graph_gexf(graph, fp, 1);
+  } else if (ug_format == FORMAT_SIGMA) {
+    rc = write_graph_sigma(graph, fp, output_attrs());
+  } else {
+    rc = write_graph_graphml(graph, fp, 1);
+  }
+  igraph_set_error_handler(handler);
+  return rc == 0 ? 0 : -1;
+}
+
+/** Formats a graph and writes it to path, through the write queue or the
+ --serve stream when there is one.
+
+ @return 0, or -1 if the output could not be written.
+ */
+static int write_output(igraph_t *graph, char *path) {
+  FILE *fp;
+  struct CompressStream cs;
+  int written = 0;
+  if (ug_verbose == true) {
+    printf("Writing output to: %s\n", path);
+  }
+  if (ug_stream != NULL || ug_write_queue > 0) {
+    char *data = NULL;
+    size_t size = 0;
+    fp = open_memstream(&data, &size);
+    if (fp == NULL) {
+      return(-1);
+    }
+    written = format_graph(graph, fp);
+    if (fclose(fp) != 0 || written != 0) {
+      free(data);
+      return(-1);
+    }
+    if (ug_stream != NULL) {
+      written = stream_output(ug_stream, path + strlen(ug_OUTPATH), data, size);
+      free(data);
+      return written;
+    }
+    return write_queue_push(path, data, size);
+  }
+  fp = open_output(path, &cs);
+  if (fp) {
+    written = format_graph(graph, fp);
+  } else {
+    if (!ug_TEST) {
+      fprintf (stderr, "\n ERROR: Output path %s could not be accessed. Graphpass", ug_OUTPATH);
+      fprintf (stderr, "\n        cannot create more than one directory in your outpath.");
+      fprintf (stderr, "\n        If you require additional directories, please create them");
+      fprintf (stderr, "\n        before running graphpass.\n\n");
+    }
+    return(-1);
+  }
+  if (close_output(fp, &cs) != 0) {
+    written = -1;
+  }
+  if (written != 0) {
+    if (!ug_TEST) {
+      fprintf(stderr, ">>> FAILURE - Could not write output to %s.\n", path);
+    }
+    return(-1);
+  }
+  return 0;
+}
+
 /** \fn int write_graph (igraph_t *graph)
     \brief Writes a graph file.
 
      Based on the ug_OUTPUT, FILENAME and methods
      writes a network graph to the appropriate location.
-     If GFORMAT is set to "true" the file will output to GEXF,
-     otherwise a graphml file will be produced.
+     ug_format selects GEXF, SigmaJS JSON or, by default, GraphML.
+     The graph itself is not changed: when --attrs drops some of its
+     vertex or edge attributes, or its node ids are packed (see ids.c), a
+     copy without them and with the "id" attribute is formatted instead
+     (see project_attributes).
+
+     With a --write-queue the graph is formatted into memory and the file
+     is written on a background thread (see writeq.c); failures to write it
+     are reported by write_queue_finish rather than here.  Under --serve
+     with no output folder, the file is sent to the client instead (see
+     server.c).
      @param graph - the graph to write to the file.
  **/
 
 extern int write_graph(igraph_t *graph, char *attr) {
-  FILE *fp;
   char fn[strlen(ug_OUTFILE)+1];
   struct stat st = {0};
-  if (stat(ug_OUTPATH, &st) == -1) {
+  if (ug_stream == NULL && stat(ug_OUTPATH, &st) == -1) {
     if (!ug_TEST) {
       fprintf(stderr, ">>> FAILURE - Could not create file at selected output location.\n");
       fprintf(stderr, ">>>         - Ensure that your assigned output folder exists.\n");
@@ -138,32 +390,25 @@ extern int write_graph(igraph_t *graph, char *attr) {
     strncat(path, perc_as_string, 3);
     strncat(path, attr, strlen(attr));
   }
-  if (ug_gformat){
+  if (ug_format == FORMAT_GEXF) {
     strncat(path, ".gexf", 5);
+  } else if (ug_format == FORMAT_SIGMA) {
+    strncat(path, ".json", 5);
   } else {
     strncat(path, ".graphml", 8);
   }
+  strncat(path, compression_ext(ug_compress), 4);
   if (ug_save == true) {
-    if (ug_verbose == true) {
-      printf("Writing output to: %s\n", path);
-    }
-    fp = fopen(path, "w");
-    if (fp) {
-      if (ug_gformat) {
-        igraph_write_graph_gexf(graph, fp, 1);
-      } else {
-        igraph_write_graph_graphml(graph, fp, 1);
-      }
-    } else {
-      if (!ug_TEST) {
-        fprintf (stderr, "\n ERROR: Output path %s could not be accessed. Graphpass", ug_OUTPATH);
-        fprintf (stderr, "\n        cannot create more than one directory in your outpath.");
-        fprintf (stderr, "\n        If you require additional directories, please create them");
-        fprintf (stderr, "\n        before running graphpass.\n\n");
-      }
+    igraph_t out;
+    int projected = project_attributes(graph, &out, output_attrs());
+    if (projected < 0) {
       return(-1);
     }
-    fclose(fp);
+    int written = write_output(projected ? &out : graph, path);
+    if (projected) {
+      igraph_destroy(&out);
+    }
+    return written;
   }
   return 0;
 }
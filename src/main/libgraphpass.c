@@ -0,0 +1,614 @@
+/*
+ * GraphPass:
+ * A utility to filter networks and provide a default visualization output
+ * for Gephi or SigmaJS.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** @file libgraphpass.c
+ @brief gp_context: a graph and its run state, owned by the caller.
+
+ The modules of GraphPass read their options and write their results
+ through the globals in graphpass.h.  A gp_context keeps its own copy of
+ every one of them (GP_STATE below), and each gp_ call swaps the context's
+ copy in, runs, and swaps the caller's globals back (gp_enter, gp_leave).
+ Contexts therefore never see each other's graph, options or report
+ lists, a context can be used for any number of runs, and gp_destroy
+ frees everything it holds.  The strings a context keeps (option values
+ and the loaded graph's paths) have one slot each and are freed when set
+ again; paths given to gp_convert, gp_batch and gp_serve are used for the
+ call only.
+
+ A few modules keep scratch state in statics of their own: the sorted
+ method orders of a sweep (filter.c), the write queue (writeq.c) and the
+ graph cache of the server (server.c).  None of it outlives a call:
+ sweep_graph clears its orders, gp_leave drains the write queue, and
+ run_server empties its cache before it returns.  So no state passes from
+ one context to another between calls.
+
+ Contexts give isolation, not concurrency.  The swap is guarded by a
+ process-wide mutex, so calls from several threads are safe but run one at
+ a time: the modules still share the globals, as igraph 0.7 shares its
+ own (see "Concurrency" in graphpass.h).  Running contexts side
+ by side would mean passing the context through every module instead.
+ Work inside a call still uses --jobs worker processes and --threads
+ threads, and gp_batch filters many graphs in worker processes.
+
+ The graphpass binary is a client of this API and touches none of the
+ globals itself; see graphpass.c.
+ */
+
+#include <graphpass.h>
+
+/** Every global a run reads or writes, with its type. */
+#define GP_STATE(X) \
+  X(igraph_t, g) X(igraph_integer_t, NODESIZE) X(igraph_integer_t, EDGESIZE) \
+  X(char*, ug_OUT) X(char*, ug_OUTFILE) X(char*, ug_INPUT) X(char*, ug_FILENAME) \
+  X(char*, ug_PATH) X(char*, ug_methods) X(char*, ug_OUTPATH) X(char*, ug_OUTPUT) \
+  X(char*, ug_OUTARG) X(char*, ug_DIRECTORY) X(char*, ug_CACHE) X(bool, ug_convert) \
+  X(uint64_t, ug_snapshot_metrics) X(float, ug_percent) X(long, ug_maxnodes) \
+  X(long, ug_maxedges) X(double, ug_memory_budget) X(double, ug_time_budget) \
+  X(bool, ug_report) X(output_format_t, ug_format) X(char*, ug_attrs) \
+  X(bool, ug_quickrun) X(bool, ug_save) X(bool, ug_verbose) X(long, ug_jobs) \
+  X(long, ug_threads) X(compression_t, ug_compress) X(int, ug_compress_level) \
+  X(long, ug_write_queue) X(FILE*, ug_stream) X(betweenness_mode_t, ug_bmode) \
+  X(long, ug_bsamples) X(double, ug_bepsilon) X(int, ug_anf_bits) \
+  X(metric_plan_t, ug_plan) X(metric_plan_t, ug_derived_plan) X(bool, CALC_WEIGHTS) \
+  X(igraph_vector_t, WEIGHTED) X(struct Arena, ug_scratch) X(struct Argument*, ug_args) \
+  X(struct Node*, asshead) X(struct Node*, edges) X(struct Node*, density) \
+  X(struct Node*, betcent) X(struct Node*, reciprocity) X(struct Node*, degcent) \
+  X(struct Node*, idegcent) X(struct Node*, odegcent) X(struct Node*, eigcent) \
+  X(struct Node*, pagecent) X(struct Node*, diameter) X(struct Node*, pathlength) \
+  X(struct Node*, clustering) X(struct Node*, pv) X(struct Node*, ts) \
+  X(struct RankNode*, ranks)
+
+#define GP_FIELD(type, name) type name;
+#define GP_SAVE(type, name) state->name = name;
+#define GP_LOAD(type, name) name = state->name;
+
+struct GpState {
+  GP_STATE(GP_FIELD)
+};
+
+/** The strings a context keeps between calls: the option values the
+ modules point to and the paths of the loaded graph. */
+enum gp_string {
+  GP_METHODS, GP_ATTRS, GP_PATH, GP_OUTARG, GP_DIRECTORY, GP_OUTPATH, GP_CACHE,
+  GP_STRINGS
+};
+
+struct gp_context {
+  struct GpState state; /**< the globals while the context is not in a call. */
+  struct GpState saved; /**< the caller's globals while it is. */
+  bool loaded; /**< state.g holds a graph. */
+  int write_failed; /**< an output file of a gp_filter call failed. */
+  char *strings[GP_STRINGS]; /**< owned copies, replaced when set again. */
+  char error[256];
+};
+
+static pthread_mutex_t gp_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void state_save(struct GpState *state) {
+  GP_STATE(GP_SAVE)
+}
+
+static void state_load(const struct GpState *state) {
+  GP_STATE(GP_LOAD)
+}
+
+/** Makes the context's state the process's until gp_leave. */
+static void gp_enter(gp_context *ctx) {
+  pthread_mutex_lock(&gp_lock);
+  state_save(&ctx->saved);
+  state_load(&ctx->state);
+  ctx->error[0] = '\0';
+}
+
+/** Takes the context's state back and restores the caller's.
+
+ Output files still queued are written first, so no call leaves work
+ behind for another context.
+ */
+static void gp_leave(gp_context *ctx) {
+  if (write_queue_finish() != 0) {
+    ctx->write_failed = -1;
+  }
+  state_save(&ctx->state);
+  state_load(&ctx->saved);
+  pthread_mutex_unlock(&gp_lock);
+}
+
+/** Sets the error message and returns -1. */
+static int gp_fail(gp_context *ctx, const char *format, ...) {
+  va_list args;
+  va_start(args, format);
+  vsnprintf(ctx->error, sizeof(ctx->error), format, args);
+  va_end(args);
+  return -1;
+}
+
+/** Gives the context a string to keep in one of its slots, freeing the
+ one it replaces.
+
+ @param slot - the slot, see gp_string.
+ @param s - a malloc'd string, or NULL to empty the slot.
+ @return s.
+ */
+static char* gp_own(gp_context *ctx, enum gp_string slot, char *s) {
+  free(ctx->strings[slot]);
+  ctx->strings[slot] = s;
+  return s;
+}
+
+/** Copies a string into one of the context's slots.
+
+ @return the copy, or NULL if s is NULL or could not be copied.
+ */
+static char* gp_keep(gp_context *ctx, enum gp_string slot, const char *s) {
+  return gp_own(ctx, slot, s ? strdup(s) : NULL);
+}
+
+/** The sidecar cache path of an input, or NULL if it cannot be allocated. */
+static char* cache_path(const char *path) {
+  char *sidecar = malloc(strlen(path) + strlen(CACHE_EXT) + 1);
+  if (sidecar != NULL) {
+    strcpy(sidecar, path);
+    strcat(sidecar, CACHE_EXT);
+  }
+  return sidecar;
+}
+
+/** Creates a context with the defaults of the graphpass binary.
+
+ @return the context, or NULL if it could not be allocated.
+ */
+gp_context* gp_create() {
+  gp_context *ctx = calloc(1, sizeof(gp_context));
+  if (ctx == NULL) {
+    return NULL;
+  }
+  igraph_i_set_attribute_table(&igraph_cattribute_table);
+  struct GpState *state = &ctx->state;
+  state->ug_methods = "d";
+  state->ug_save = true;
+  state->ug_format = FORMAT_GRAPHML;
+  state->ug_write_queue = 2;
+  state->ug_bmode = BETWEENNESS_EXACT;
+  state->ug_OUTPATH = "./";
+  state->ug_memory_budget = COST_MEMORY_SHARE * (double) sysconf(_SC_PHYS_PAGES)
+    * (double) sysconf(_SC_PAGESIZE);
+  return ctx;
+}
+
+/** Frees a context, its graph, its report and everything it copied. */
+void gp_destroy(gp_context *ctx) {
+  if (ctx == NULL) {
+    return;
+  }
+  gp_enter(ctx);
+  if (ctx->loaded) {
+    igraph_destroy(&g);
+  }
+  clear_report();
+  clear_method_orders();
+  arena_free(&ug_scratch);
+  freeArgs(&ug_args);
+  gp_leave(ctx);
+  for (int i=0; i<GP_STRINGS; i++) {
+    free(ctx->strings[i]);
+  }
+  free(ctx);
+}
+
+/** The reason the last call on the context failed, or "". */
+const char* gp_error(const gp_context *ctx) {
+  return ctx->error;
+}
+
+/** Whether a flag's value turns it on: no value, or anything but 0,
+ false, no and off. */
+static bool flag_on(const char *value) {
+  return value == NULL || !(strcmp(value, "0") == 0 || strcmp(value, "false") == 0
+                            || strcmp(value, "no") == 0 || strcmp(value, "off") == 0);
+}
+
+/** Reads a count, 0 for none. */
+static long count_value(const char *value) {
+  long n = value ? strtol(value, (char**)NULL, 10) : 0;
+  return n > 0 ? n : 0;
+}
+
+/** Sets an option by the name of its graphpass flag (without the dashes).
+
+ Flags (cache, gexf, no-save, quick, report, verbose, weights) are set with no value
+ and cleared with "0".  Run modes (batch, serve, sweep, dry-run) are not
+ options of a context but calls of their own (gp_batch, gp_serve, gp_sweep,
+ gp_check).
+
+ @return 0, or -1 if the option is unknown or its value is not valid.
+ */
+int gp_set(gp_context *ctx, const char *option, const char *value) {
+  int rc = 0;
+  /* only methods and attrs keep their value, in the context's slots */
+  char *copy = value ? strdup(value) : NULL;
+  if (value != NULL && copy == NULL) {
+    return gp_fail(ctx, "could not copy the value of %s", option);
+  }
+  gp_enter(ctx);
+  if (strcmp(option, "cache") == 0) {
+    /* the sidecar path is made by gp_load */
+    ug_CACHE = flag_on(value) ? "" : NULL;
+  } else if (strcmp(option, "gexf") == 0) {
+    ug_format = flag_on(value) ? FORMAT_GEXF : FORMAT_GRAPHML;
+  } else if (strcmp(option, "no-save") == 0) {
+    ug_save = !flag_on(value);
+  } else if (strcmp(option, "quick") == 0) {
+    ug_quickrun = flag_on(value);
+  } else if (strcmp(option, "report") == 0) {
+    ug_report = flag_on(value);
+  } else if (strcmp(option, "verbose") == 0) {
+    ug_verbose = flag_on(value);
+  } else if (strcmp(option, "weights") == 0) {
+    CALC_WEIGHTS = flag_on(value);
+  } else if (strcmp(option, "attrs") == 0) {
+    if (parse_attrs(copy) != 0) {
+      rc = gp_fail(ctx, "--attrs expects a comma-separated list of attributes, %s or %s",
+                   ATTRS_VIZ, ATTRS_FULL);
+    } else {
+      gp_own(ctx, GP_ATTRS, copy);
+      copy = NULL;
+    }
+  } else if (strcmp(option, "betweenness") == 0) {
+    if (copy == NULL || parse_betweenness_mode(copy) != 0) {
+      rc = gp_fail(ctx, "--betweenness expects exact, approx:k or eps:e (0 < e < 1)");
+    }
+  } else if (strcmp(option, "distances") == 0) {
+    if (copy == NULL || parse_distance_mode(copy) != 0) {
+      rc = gp_fail(ctx, "--distances expects exact, anf or anf:b (%d <= b <= %d)",
+                   ANF_MIN_BITS, ANF_MAX_BITS);
+    }
+  } else if (strcmp(option, "format") == 0) {
+    if (copy == NULL || parse_format(copy) != 0) {
+      rc = gp_fail(ctx, "--format expects graphml, gexf or sigma");
+    }
+  } else if (strcmp(option, "compress") == 0) {
+    if (copy == NULL || parse_compression(copy) != 0) {
+      rc = gp_fail(ctx, "--compress expects none, gz, gz:level (1-9), zst or zst:level");
+    }
+  } else if (strcmp(option, "methods") == 0) {
+    ug_methods = copy ? gp_own(ctx, GP_METHODS, copy) : "d";
+    copy = NULL;
+  } else if (strcmp(option, "percent") == 0) {
+    ug_percent = value ? atof(value) : 0.0;
+  } else if (strcmp(option, "jobs") == 0) {
+    ug_jobs = count_value(value);
+  } else if (strcmp(option, "threads") == 0) {
+    ug_threads = count_value(value);
+  } else if (strcmp(option, "write-queue") == 0) {
+    ug_write_queue = count_value(value);
+  } else if (strcmp(option, "max-nodes") == 0) {
+    ug_maxnodes = count_value(value);
+  } else if (strcmp(option, "max-edges") == 0) {
+    ug_maxedges = count_value(value);
+  } else if (strcmp(option, "memory-budget") == 0) {
+    ug_memory_budget = value ? atof(value) * (1 << 20) : 0;
+    ug_memory_budget = ug_memory_budget > 0 ? ug_memory_budget : 0;
+  } else if (strcmp(option, "time-budget") == 0) {
+    ug_time_budget = value ? atof(value) : 0;
+    ug_time_budget = ug_time_budget > 0 ? ug_time_budget : 0;
+  } else {
+    rc = gp_fail(ctx, "unknown option %s", option);
+  }
+  free(copy);
+  gp_leave(ctx);
+  return rc;
+}
+
+/** Prints the settings of the run, as the verbose header. */
+static void describe_run() {
+  printf(">>>>>>>  GRAPHPASSING >>>>>>>> \n");
+  printf("FILEPATH: %s\n", ug_PATH);
+  printf("OUTPUT DIRECTORY: %s\nPERCENTAGE: %f\n", ug_OUTPATH, ug_percent);
+  printf("FILE: %s\nMETHODS STRING: %s\n", ug_FILENAME, ug_methods);
+  printf("QUICKRUN: %i\nREPORT: %i\nSAVE: %i\n", ug_quickrun, ug_report, ug_save);
+  printf("FORMAT: %s\n", ug_format == FORMAT_GEXF ? "gexf"
+         : ug_format == FORMAT_SIGMA ? "sigma" : "graphml");
+  printf("ATTRS: %s\n", output_attrs());
+  printf("JOBS: %li\n", ug_jobs);
+  printf("THREADS: %li\n", ug_threads);
+  printf("WRITE QUEUE: %li\n", ug_write_queue);
+  printf("MEMORY BUDGET: %.0f MB\nTIME BUDGET: %.0f s\n", ug_memory_budget / (1 << 20),
+         ug_time_budget);
+  printf("COMPRESS: %s (%d)\n", ug_compress == COMPRESSION_GZIP ? "gz"
+         : ug_compress == COMPRESSION_ZSTD ? "zst" : "none", ug_compress_level);
+  printf("BETWEENNESS: %s\n", ug_bmode == BETWEENNESS_EXACT ? "exact"
+         : ug_bmode == BETWEENNESS_SAMPLE ? "approx" : "eps");
+  printf("DISTANCES: %s (%d)\n", ug_anf_bits ? "anf" : "exact", ug_anf_bits);
+  printf("CACHE: %s\n", ug_CACHE ? ug_CACHE : "off");
+}
+
+/** Loads a graph into the context, replacing any graph and report it held.
+
+ With verbose set, the settings of the run are printed once it is loaded.
+
+ @param input - the graph file, snapshot or CSV directory.
+ @param output - where filtered graphs go: a directory ending in "/", or a
+ path whose directory and file name the outputs take.  NULL writes them to
+ the working directory under the input's name.
+ @return 0, or -1 if the outputs would overwrite the input or the graph
+ cannot be loaded.
+ */
+int gp_load(gp_context *ctx, const char *input, const char *output) {
+  if (input == NULL) {
+    return gp_fail(ctx, "no input given");
+  }
+  gp_enter(ctx);
+  int rc = 0;
+  char *path = gp_keep(ctx, GP_PATH, input);
+  char *outarg = gp_keep(ctx, GP_OUTARG, output);
+  char *name = NULL, *dir = NULL;
+  if (path == NULL || (output != NULL && outarg == NULL)) {
+    rc = gp_fail(ctx, "could not copy the paths");
+    gp_leave(ctx);
+    return rc;
+  }
+  get_filename(path, &name);
+  ug_FILENAME = name ? name : "FILE";
+  get_directory(path, &dir);
+  /* get_directory answers in a static buffer */
+  ug_DIRECTORY = gp_keep(ctx, GP_DIRECTORY, dir ? dir : "./");
+  ug_PATH = path;
+  ug_OUTARG = outarg;
+  ug_OUTPATH = "./";
+  ug_OUTFILE = ug_FILENAME;
+  if (outarg != NULL) {
+    name = NULL;
+    dir = NULL;
+    get_filename(outarg, &name);
+    ug_OUTFILE = name ? name : ug_FILENAME;
+    get_directory(outarg, &dir);
+    ug_OUTPATH = gp_keep(ctx, GP_OUTPATH, dir ? dir : "./");
+  }
+  if (ug_DIRECTORY == NULL || ug_OUTPATH == NULL) {
+    rc = gp_fail(ctx, "could not copy the paths");
+  } else if (strcmp(ug_OUTFILE, ug_FILENAME) == 0 && strcmp(ug_OUTPATH, ug_DIRECTORY) == 0) {
+    rc = gp_fail(ctx, "Input and output locations cannot be the same");
+  }
+  if (rc == 0 && ug_CACHE != NULL) {
+    ug_CACHE = gp_own(ctx, GP_CACHE, cache_path(path));
+    if (ug_CACHE == NULL) {
+      rc = gp_fail(ctx, "could not copy the paths");
+    }
+  }
+  if (rc == 0) {
+    if (ctx->loaded) {
+      igraph_destroy(&g);
+      ctx->loaded = false;
+    }
+    clear_report();
+    if (ug_verbose == true) {
+      printf("Running graphpass on file: %s\n", path);
+    }
+    if (load_graph(path) != 0) {
+      rc = gp_fail(ctx, "Graphpass could not load the graph");
+    } else {
+      ctx->loaded = true;
+      if (ug_verbose == true) {
+        describe_run();
+      }
+    }
+  }
+  gp_leave(ctx);
+  return rc;
+}
+
+/** Where the context writes its output files, or NULL if no-save is set. */
+const char* gp_output(const gp_context *ctx) {
+  return ctx->state.ug_save ? ctx->state.ug_OUTPATH : NULL;
+}
+
+/** The context's graph, or NULL before gp_load.  It stays owned by the
+ context and must not be used while another call is running on it.  Node
+ ids of 32 hex digits are held packed, not as "id" (see ids.c). */
+igraph_t* gp_graph(gp_context *ctx) {
+  return ctx->loaded ? &ctx->state.g : NULL;
+}
+
+/** Checks the predicted cost of filtering the loaded graph against the
+ context's budgets and caps (see cost.c).
+
+ @param estimate - if not NULL, the per-phase estimate is printed to it.
+ @return 0 if the run fits, -1 with the reason otherwise.
+ */
+int gp_check(gp_context *ctx, FILE *estimate) {
+  struct CostEstimate cost;
+  if (!ctx->loaded) {
+    return gp_fail(ctx, "no graph loaded");
+  }
+  gp_enter(ctx);
+  int rc = cost_check(&g, ug_PATH, &cost);
+  if (estimate != NULL) {
+    print_cost(estimate, &cost);
+  }
+  if (rc != 0) {
+    gp_fail(ctx, "%s", cost.reason);
+  }
+  gp_leave(ctx);
+  return rc;
+}
+
+/** Plans the run and analyzes the loaded graph (or restores the analysis
+ from its cache).  Quickruns need no analysis and skip it (see
+ filter_analyze). */
+int gp_analyze(gp_context *ctx) {
+  if (!ctx->loaded) {
+    return gp_fail(ctx, "no graph loaded");
+  }
+  gp_enter(ctx);
+  filter_analyze();
+  gp_leave(ctx);
+  return 0;
+}
+
+/** Filters the analyzed graph once for each method, writing each filtered
+ graph unless no-save is set and recording its values for gp_write.  A
+ quickrun writes the laid-out graph instead.
+
+ @return 0, or -1 if an output file could not be written.
+ */
+int gp_filter(gp_context *ctx) {
+  if (!ctx->loaded) {
+    return gp_fail(ctx, "no graph loaded");
+  }
+  ctx->write_failed = 0;
+  gp_enter(ctx);
+  int rc = filter_run();
+  gp_leave(ctx);
+  if (rc != 0 || ctx->write_failed != 0) {
+    return gp_fail(ctx, "an output file could not be written");
+  }
+  return 0;
+}
+
+/** Writes the report of the filters run so far, if report is set. */
+int gp_write(gp_context *ctx) {
+  if (!ctx->loaded) {
+    return gp_fail(ctx, "no graph loaded");
+  }
+  gp_enter(ctx);
+  filter_report();
+  gp_leave(ctx);
+  return ctx->write_failed == 0 ? 0 : gp_fail(ctx, "an output file could not be written");
+}
+
+/** Appends the Degree rank p-value of each method for a range of
+ percentages to GRAPH/graph_report.csv (see sweep_graph).  The options
+ the sweep overrides are restored afterwards. */
+int gp_sweep(gp_context *ctx, int start, int end, int step) {
+  if (!ctx->loaded) {
+    return gp_fail(ctx, "no graph loaded");
+  }
+  gp_enter(ctx);
+  if (ug_verbose == true) {
+    printf("Sweeping percentages %d to %d by %d.\n", start, end, step);
+  }
+  bool report = ug_report, save = ug_save;
+  char *methods = ug_methods, *output = ug_OUTPUT;
+  int rc = sweep_graph(start, end, step);
+  ug_report = report;
+  ug_save = save;
+  ug_methods = methods;
+  ug_OUTPUT = output;
+  gp_leave(ctx);
+  return rc == 0 ? 0 : gp_fail(ctx, "could not write GRAPH/graph_report.csv");
+}
+
+/** Loads a graph and writes it as a snapshot (see snapshot.c), with its
+ analysis when cache is set.  The graph is not kept.
+
+ @param input - the graph to convert.
+ @param snapshot - the snapshot to write, or NULL for input plus
+ SNAPSHOT_EXT.
+ */
+int gp_convert(gp_context *ctx, const char *input, const char *snapshot) {
+  if (input == NULL) {
+    return gp_fail(ctx, "no input given");
+  }
+  gp_enter(ctx);
+  int rc = 0;
+  char *path = (char*) input;
+  char *name = NULL;
+  char *target = snapshot_path(path, (char*) snapshot);
+  /* the paths are the caller's, so the loaded graph's are put back */
+  char *filename = ug_FILENAME, *graph_path = ug_PATH, *cache = ug_CACHE;
+  get_filename(path, &name);
+  ug_FILENAME = name ? name : "FILE";
+  ug_PATH = path;
+  ug_convert = true;
+  if (target == NULL || strcmp(target, path) == 0) {
+    rc = gp_fail(ctx, "Input and output locations cannot be the same");
+  } else {
+    char *sidecar = cache != NULL ? cache_path(path) : NULL;
+    ug_CACHE = sidecar;
+    if (ctx->loaded) {
+      igraph_destroy(&g);
+      ctx->loaded = false;
+    }
+    if (ug_verbose == true) {
+      printf("CONVERT: %s\n", target);
+    }
+    if (cache != NULL && sidecar == NULL) {
+      rc = gp_fail(ctx, "could not copy the paths");
+    } else if (load_graph(path) != 0) {
+      rc = gp_fail(ctx, "Graphpass could not load the graph");
+    } else {
+      if (convert_graph(target) != 0) {
+        rc = gp_fail(ctx, "Graphpass could not write the snapshot");
+      }
+      igraph_destroy(&g);
+    }
+    free(sidecar);
+  }
+  ug_FILENAME = filename;
+  ug_PATH = graph_path;
+  ug_CACHE = cache;
+  ug_convert = false;
+  free(target);
+  gp_leave(ctx);
+  return rc;
+}
+
+/** Filters every graph a --batch list names with the context's options,
+ each in a worker process, and writes the summary table (see batch.c).
+ The context's own graph is left alone.
+
+ @param list - a file listing one graph per line, or a directory.
+ @param outdir - the folder the filtered graphs and the table go to.
+ @return 0 if every graph was filtered and written.
+ */
+int gp_batch(gp_context *ctx, const char *list, const char *outdir) {
+  char *path = (char*) list, *dir = (char*) outdir;
+  if (path == NULL || dir == NULL) {
+    return gp_fail(ctx, "no batch list or output folder given");
+  }
+  gp_enter(ctx);
+  if (ug_verbose == true) {
+    printf(">>>>>>>  GRAPHPASSING >>>>>>>> \n");
+    printf("BATCH: %s\nOUTPUT DIRECTORY: %s\n", path, dir);
+    printf("PERCENTAGE: %f\nMETHODS STRING: %s\nJOBS: %li\n", ug_percent,
+           ug_methods, ug_jobs);
+  }
+  int rc = run_batch(path, dir, ug_CACHE != NULL);
+  gp_leave(ctx);
+  return rc == 0 ? 0 : gp_fail(ctx, "not every graph of the batch was filtered");
+}
+
+/** Serves filter requests on a Unix socket with the context's options
+ until the server is stopped (see server.c).  The context is in the call,
+ and so holds the lock, for as long as the server runs.
+
+ @param socket - the socket path.
+ @param cache_mb - megabytes of graphs kept loaded, 0 for SERVE_CACHE_MB.
+ @return 0 once stopped, or -1 if the socket could not be served.
+ */
+int gp_serve(gp_context *ctx, const char *socket, long cache_mb) {
+  char *path = (char*) socket;
+  if (path == NULL) {
+    return gp_fail(ctx, "no socket given");
+  }
+  gp_enter(ctx);
+  int rc = run_server(path, cache_mb, ug_CACHE != NULL);
+  gp_leave(ctx);
+  return rc == 0 ? 0 : gp_fail(ctx, "could not serve on %s", path);
+}
@@ -0,0 +1,260 @@
+/*
+ * GraphPass:
+ * A utility to filter networks and provide a default visualization output
+ * for Gephi or SigmaJS.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** @file planner.c
+ @brief Works out which metrics a run actually needs.
+
+ Each metric declares the metrics it is computed from.  A plan is a bitmask
+ of metrics (see PLAN()); plan_closure adds the dependencies of everything
+ in a plan, so analysis_planned and filter_by_cut compute only what the
+ selected filter methods, the report and the saved graphs use.
+ */
+
+#include <graphpass.h>
+
+/** @struct Metric
+ @brief A metric, the attribute it is stored in and what it depends on.
+ */
+struct Metric {
+  metric_t id;
+  char* attr; /**< attribute holding the result, NULL for layout steps. */
+  igraph_attribute_elemtype_t type; /**< vertex or graph attribute. */
+  metric_plan_t deps;
+};
+
+/* in metric_t order, so METRICS[m] describes metric m */
+static const struct Metric METRICS[] = {
+  {MET_AUTHORITY, "Authority", IGRAPH_ATTRIBUTE_VERTEX, 0},
+  {MET_BETWEENNESS, "Betweenness", IGRAPH_ATTRIBUTE_VERTEX, 0},
+  {MET_DEGREE, "Degree", IGRAPH_ATTRIBUTE_VERTEX, 0},
+  {MET_DEGREE_RANK, "DegreeRank", IGRAPH_ATTRIBUTE_VERTEX, PLAN(MET_DEGREE)},
+  {MET_HUB, "Hub", IGRAPH_ATTRIBUTE_VERTEX, 0},
+  {MET_INDEGREE, "Indegree", IGRAPH_ATTRIBUTE_VERTEX, 0},
+  {MET_OUTDEGREE, "Outdegree", IGRAPH_ATTRIBUTE_VERTEX, 0},
+  {MET_EIGENVECTOR, "Eigenvector", IGRAPH_ATTRIBUTE_VERTEX, 0},
+  {MET_PAGERANK, "PageRank", IGRAPH_ATTRIBUTE_VERTEX, 0},
+  {MET_MODULARITY, "WalkTrapModularity", IGRAPH_ATTRIBUTE_VERTEX, 0},
+  {MET_C_AUTHORITY, "centralizationAuthority", IGRAPH_ATTRIBUTE_GRAPH, PLAN(MET_AUTHORITY)},
+  {MET_C_BETWEENNESS, "centralizationBetweenness", IGRAPH_ATTRIBUTE_GRAPH, PLAN(MET_BETWEENNESS)},
+  {MET_C_DEGREE, "centralizationDegree", IGRAPH_ATTRIBUTE_GRAPH, PLAN(MET_DEGREE)},
+  {MET_C_HUB, "centralizationHub", IGRAPH_ATTRIBUTE_GRAPH, PLAN(MET_HUB)},
+  {MET_C_INDEGREE, "centralizationIndegree", IGRAPH_ATTRIBUTE_GRAPH, PLAN(MET_INDEGREE)},
+  {MET_C_OUTDEGREE, "centralizationOutdegree", IGRAPH_ATTRIBUTE_GRAPH, PLAN(MET_OUTDEGREE)},
+  {MET_C_EIGENVECTOR, "centralizationEigenvector", IGRAPH_ATTRIBUTE_GRAPH, PLAN(MET_EIGENVECTOR)},
+  {MET_C_PAGERANK, "centralizationPageRank", IGRAPH_ATTRIBUTE_GRAPH, PLAN(MET_PAGERANK)},
+  {MET_PATH_LENGTH, "AVG_PATH_LENGTH", IGRAPH_ATTRIBUTE_GRAPH, 0},
+  {MET_DIAMETER, "DIAMETER", IGRAPH_ATTRIBUTE_GRAPH, 0},
+  {MET_CLUSTERING, "OVERALL_CLUSTERING", IGRAPH_ATTRIBUTE_GRAPH, 0},
+  {MET_ASSORTATIVITY, "ASSORTATIVITY", IGRAPH_ATTRIBUTE_GRAPH, PLAN(MET_MODULARITY)},
+  {MET_DEGREE_ASSORTATIVITY, "ASSORTATIVITY", IGRAPH_ATTRIBUTE_GRAPH,
+    PLAN(MET_INDEGREE) | PLAN(MET_OUTDEGREE)},
+  {MET_DENSITY, "DENSITY", IGRAPH_ATTRIBUTE_GRAPH, 0},
+  {MET_RECIPROCITY, "RECIPROCITY", IGRAPH_ATTRIBUTE_GRAPH, 0},
+  {MET_LAYOUT, NULL, IGRAPH_ATTRIBUTE_VERTEX, 0},
+  {MET_COLORS, NULL, IGRAPH_ATTRIBUTE_VERTEX, PLAN(MET_MODULARITY)},
+  {MET_SIZE, NULL, IGRAPH_ATTRIBUTE_VERTEX, PLAN(MET_DEGREE)}
+};
+
+/** Adds every dependency of the metrics in plan.
+
+ @param plan - the metrics that are wanted.
+ @return plan with all of its dependencies.
+ */
+metric_plan_t plan_closure(metric_plan_t plan) {
+  metric_plan_t before;
+  do {
+    before = plan;
+    for (size_t i=0; i<NELEMS(METRICS); i++) {
+      if (plan & PLAN(METRICS[i].id)) {
+        plan |= METRICS[i].deps;
+      }
+    }
+  } while (plan != before);
+  return plan;
+}
+
+/** Returns the attribute a metric is stored in, or a name for layout steps. */
+const char* metric_name(metric_t metric) {
+  if (METRICS[metric].attr != NULL) {
+    return METRICS[metric].attr;
+  }
+  return metric == MET_LAYOUT ? "Layout" : metric == MET_COLORS ? "Colors" : "Size";
+}
+
+/** Returns the metric a filter method (see runFilters) cuts on, or 0. */
+metric_plan_t plan_method(char method) {
+  switch (method) {
+    case 'a' : return PLAN(MET_AUTHORITY);
+    case 'b' : return PLAN(MET_BETWEENNESS);
+    case 'd' : return PLAN(MET_DEGREE);
+    case 'e' : return PLAN(MET_EIGENVECTOR);
+    case 'h' : return PLAN(MET_HUB);
+    case 'i' : return PLAN(MET_INDEGREE);
+    case 'o' : return PLAN(MET_OUTDEGREE);
+    case 'p' : return PLAN(MET_PAGERANK);
+    default : return 0;
+  }
+}
+
+/** Plans the metrics a written graph carries.
+
+ Every vertex metric whose column --attrs keeps, and, for GraphML (the only
+ format that writes graph attributes, which --attrs does not trim), every
+ graph-level value.
+
+ @param assortativity - the assortativity stored in this graph,
+ MET_ASSORTATIVITY or MET_DEGREE_ASSORTATIVITY.
+ @return the plan, not closed.
+ */
+static metric_plan_t plan_saved(metric_t assortativity) {
+  metric_plan_t plan = 0;
+  for (size_t i=0; i<NELEMS(METRICS); i++) {
+    metric_t id = METRICS[i].id;
+    if (METRICS[i].attr == NULL
+        || ((id == MET_ASSORTATIVITY || id == MET_DEGREE_ASSORTATIVITY) && id != assortativity)) {
+      continue;
+    }
+    if (METRICS[i].type == IGRAPH_ATTRIBUTE_VERTEX
+        ? attr_wanted(output_attrs(), METRICS[i].attr, IGRAPH_ATTRIBUTE_VERTEX)
+        : ug_format == FORMAT_GRAPHML) {
+      plan |= PLAN(id);
+    }
+  }
+  return plan;
+}
+
+/** Plans the analysis of the original graph.
+
+ @param methods - the filter methods string.
+ @param save - true if graphs are written (see plan_saved).
+ @param report - true if write_report will run (it prints every graph value).
+ @param compare - true if filtered graphs are rank-compared to the original.
+ @return the closed plan.
+ */
+metric_plan_t plan_base(char* methods, bool save, bool report, bool compare) {
+  metric_plan_t plan = 0;
+  for (size_t i=0; methods && i<strlen(methods); i++) {
+    plan |= plan_method(methods[i]);
+  }
+  if (save) {
+    plan |= plan_saved(MET_ASSORTATIVITY);
+  }
+  if (report) {
+    plan |= PLAN_ANALYSIS_ALL;
+  }
+  if (compare) {
+    plan |= PLAN(MET_DEGREE_RANK);
+  }
+  return plan_closure(plan);
+}
+
+/** Plans the analysis of each filtered graph.
+
+ @param save - true if the filtered graphs are written (the visualization
+ and every value they carry are needed, see plan_saved).
+ @param report - true if the graph-level values are reported.
+ @param compare - true if filtered graphs are rank-compared to the original.
+ @return the closed plan.
+ */
+metric_plan_t plan_derivative(bool save, bool report, bool compare) {
+  metric_plan_t plan = 0;
+  if (save) {
+    plan |= PLAN(MET_LAYOUT) | PLAN(MET_COLORS) | PLAN(MET_SIZE)
+      | plan_saved(MET_DEGREE_ASSORTATIVITY);
+  }
+  if (report) {
+    plan |= PLAN(MET_PATH_LENGTH) | PLAN(MET_DIAMETER) | PLAN(MET_CLUSTERING)
+      | PLAN(MET_DEGREE_ASSORTATIVITY) | PLAN(MET_DENSITY) | PLAN(MET_RECIPROCITY)
+      | PLAN(MET_C_BETWEENNESS) | PLAN(MET_C_PAGERANK) | PLAN(MET_C_DEGREE)
+      | PLAN(MET_C_INDEGREE) | PLAN(MET_C_OUTDEGREE) | PLAN(MET_C_EIGENVECTOR);
+  }
+  if (compare) {
+    plan |= PLAN(MET_DEGREE_RANK);
+  }
+  return plan_closure(plan);
+}
+
+/** Sets ug_plan and ug_derived_plan from the run options.
+
+ @param compare - true if filtered graphs are rank-compared to the original.
+ @return 0.
+ */
+int plan_run(bool compare) {
+  ug_plan = plan_base(ug_methods, ug_save, ug_report, compare);
+  ug_derived_plan = plan_derivative(ug_save, ug_report, compare);
+  if (ug_verbose == true) {
+    printf("Planned analysis:");
+    for (size_t i=0; i<NELEMS(METRICS); i++) {
+      if ((ug_plan & PLAN(METRICS[i].id)) && METRICS[i].attr) {
+        printf(" %s", METRICS[i].attr);
+      }
+    }
+    printf("\n");
+  }
+  return 0;
+}
+
+/** Removes the metrics of a plan that are already set on a graph.
+
+ Used after restoring a metric cache, so only the missing metrics are
+ computed.  Layout steps are never treated as present.
+
+ @param graph - the graph to check.
+ @param plan - the wanted metrics.
+ @return the metrics of plan that still need computing.
+ */
+metric_plan_t plan_missing(const igraph_t *graph, metric_plan_t plan) {
+  for (size_t i=0; i<NELEMS(METRICS); i++) {
+    if ((plan & PLAN(METRICS[i].id)) && METRICS[i].attr
+        && igraph_cattribute_has_attr(graph, METRICS[i].type, METRICS[i].attr)) {
+      plan &= ~PLAN(METRICS[i].id);
+    }
+  }
+  return plan;
+}
+
+/** Deletes the graph-level values a plan does not recompute.
+
+ A filtered graph starts with a copy of the original graph's attributes
+ (see view_materialize); values left out of its plan would otherwise be
+ written as if they described it.
+
+ @param graph - the filtered graph.
+ @param plan - the metrics computed on it.
+ @return 0.
+ */
+int plan_drop_stale(igraph_t *graph, metric_plan_t plan) {
+  for (size_t i=0; i<NELEMS(METRICS); i++) {
+    if (METRICS[i].type != IGRAPH_ATTRIBUTE_GRAPH
+        || !igraph_cattribute_has_attr(graph, IGRAPH_ATTRIBUTE_GRAPH, METRICS[i].attr)) {
+      continue;
+    }
+    bool kept = false;
+    /* ASSORTATIVITY is stored by two metrics */
+    for (size_t j=0; j<NELEMS(METRICS); j++) {
+      if ((plan & PLAN(METRICS[j].id)) && METRICS[j].attr
+          && strcmp(METRICS[j].attr, METRICS[i].attr) == 0) {
+        kept = true;
+      }
+    }
+    if (!kept) {
+      DELGA(graph, METRICS[i].attr);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,180 @@
+/*
+ * GraphPass:
+ * A utility to filter networks and provide a default visualization output
+ * for Gephi or SigmaJS.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** @file project.c
+ @brief Chooses the vertex and edge attributes written to output (--attrs).
+
+ The list names attributes and presets, comma-separated.  The label,
+ position, size and colour of each vertex and the weight of each edge are
+ always kept: every writer draws the graph from them.  "viz" keeps only
+ those, "full" (or "all") keeps everything.  Without --attrs, GEXF and
+ GraphML output is "full" and SigmaJS output "viz".
+
+ Attributes that are not wanted are never copied into a filtered graph
+ (see view_materialize) or into the copy a graph is written from (see
+ project_attributes), and plan_derivative leaves out metrics nobody will
+ write.
+ */
+
+#include <graphpass.h>
+
+/** Attributes every output keeps, vertex then edge. */
+static const char *VIZ_VERTEX_ATTRS[] = {"label", "name", "x", "y", "size", "r", "g", "b"};
+static const char *VIZ_EDGE_ATTRS[] = {"weight"};
+
+/** The attribute list of this run: --attrs, or the default of ug_format. */
+const char* output_attrs() {
+  if (ug_attrs != NULL) {
+    return ug_attrs;
+  }
+  return ug_format == FORMAT_SIGMA ? ATTRS_VIZ : ATTRS_FULL;
+}
+
+/** Whether an attribute is one of the viz fields every output keeps.
+
+ @param name - the attribute name.
+ @param kind - IGRAPH_ATTRIBUTE_VERTEX or IGRAPH_ATTRIBUTE_EDGE.
+ */
+bool attr_is_viz(const char *name, igraph_attribute_elemtype_t kind) {
+  bool vertex = (kind == IGRAPH_ATTRIBUTE_VERTEX);
+  const char **viz = vertex ? VIZ_VERTEX_ATTRS : VIZ_EDGE_ATTRS;
+  size_t count = vertex ? NELEMS(VIZ_VERTEX_ATTRS) : NELEMS(VIZ_EDGE_ATTRS);
+  for (size_t i=0; i<count; i++) {
+    if (strcmp(name, viz[i]) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/** Calls fn on each item of a comma-separated list until it returns true.
+
+ @return true if fn did.
+ */
+static bool any_item(const char *list, bool (*fn)(const char*, size_t, const char*),
+                     const char *arg) {
+  const char *item = list;
+  while (true) {
+    const char *end = strchr(item, ',');
+    size_t len = end ? (size_t) (end - item) : strlen(item);
+    if (fn(item, len, arg)) {
+      return true;
+    }
+    if (end == NULL) {
+      return false;
+    }
+    item = end + 1;
+  }
+}
+
+static bool is_full(const char *item, size_t len, const char *unused) {
+  return (len == strlen(ATTRS_FULL) && strncmp(item, ATTRS_FULL, len) == 0)
+    || (len == 3 && strncmp(item, "all", 3) == 0);
+}
+
+static bool is_name(const char *item, size_t len, const char *name) {
+  return len == strlen(name) && strncmp(item, name, len) == 0;
+}
+
+/** Whether an attribute list keeps an attribute.
+
+ @param attrs - the list, or NULL for "full".
+ @param name - the attribute name.  The columns of packed node ids count as "id".
+ @param kind - IGRAPH_ATTRIBUTE_VERTEX or IGRAPH_ATTRIBUTE_EDGE.
+ */
+bool attr_wanted(const char *attrs, const char *name, igraph_attribute_elemtype_t kind) {
+  if (kind == IGRAPH_ATTRIBUTE_VERTEX && is_node_key_attr(name)) {
+    name = "id";
+  }
+  return attrs == NULL || attr_is_viz(name, kind) || any_item(attrs, is_full, NULL)
+    || any_item(attrs, is_name, name);
+}
+
+static bool is_empty(const char *item, size_t len, const char *unused) {
+  return len == 0;
+}
+
+/** Checks the --attrs argument and sets ug_attrs.
+
+ @param arg - the option argument.
+ @return 0, or -1 if it is empty or has an empty item.
+ */
+int parse_attrs(char *arg) {
+  if (arg == NULL || any_item(arg, is_empty, NULL)) {
+    return -1;
+  }
+  ug_attrs = arg;
+  return 0;
+}
+
+/** Whether a graph has a vertex or edge attribute the list does not keep. */
+static bool drops_attributes(const igraph_t *graph, const char *attrs) {
+  igraph_strvector_t gnames, vnames, enames;
+  igraph_vector_t gtypes, vtypes, etypes;
+  bool drops = false;
+  if (attrs == NULL || any_item(attrs, is_full, NULL)) {
+    return false;
+  }
+  igraph_strvector_init(&gnames, 0);
+  igraph_strvector_init(&vnames, 0);
+  igraph_strvector_init(&enames, 0);
+  igraph_vector_init(&gtypes, 0);
+  igraph_vector_init(&vtypes, 0);
+  igraph_vector_init(&etypes, 0);
+  igraph_cattribute_list(graph, &gnames, &gtypes, &vnames, &vtypes, &enames, &etypes);
+  for (long i=0; i<igraph_strvector_size(&vnames) && !drops; i++) {
+    drops = !attr_wanted(attrs, STR(vnames, i), IGRAPH_ATTRIBUTE_VERTEX);
+  }
+  for (long i=0; i<igraph_strvector_size(&enames) && !drops; i++) {
+    drops = !attr_wanted(attrs, STR(enames, i), IGRAPH_ATTRIBUTE_EDGE);
+  }
+  igraph_strvector_destroy(&gnames);
+  igraph_strvector_destroy(&vnames);
+  igraph_strvector_destroy(&enames);
+  igraph_vector_destroy(&gtypes);
+  igraph_vector_destroy(&vtypes);
+  igraph_vector_destroy(&etypes);
+  return drops;
+}
+
+/** Builds the graph an output is formatted from, leaving graph as it is.
+
+ The copy has only the vertex and edge attributes the list keeps, and
+ "id" strings in place of packed node ids (see view_output).  Filtered
+ graphs already hold only the attributes they write, so most of them are
+ formatted directly and no copy is made.
+
+ @param graph - the graph to write.
+ @param res - an uninitialized graph, built if 1 is returned.
+ @param attrs - the list, see attr_wanted.
+ @return 1 if res was built and is to be written and destroyed, 0 if
+ graph can be written as it is, or -1 if the copy could not be made.
+ */
+int project_attributes(const igraph_t *graph, igraph_t *res, const char *attrs) {
+  if (!has_node_keys(graph) && !drops_attributes(graph, attrs)) {
+    return 0;
+  }
+  struct GraphView view;
+  struct ArenaMark mark = arena_mark(&ug_scratch);
+  int rc = view_init(&view, graph, NULL, 0);
+  if (rc == 0) {
+    rc = view_output(&view, res, attrs);
+  }
+  arena_release(&ug_scratch, mark);
+  return rc == 0 ? 1 : -1;
+}
@@ -50,7 +50,7 @@ extern int quickrunGraph() {
   if (ug_verbose == true)
     printf("Producing layout details... \n");
   layout_graph(&g, 'f');
-  write_graph(&g, "-");
+  int result = write_graph(&g, "-");
   igraph_vector_destroy(&size);
-  return 0;
+  return result;
 }
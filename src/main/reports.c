@@ -39,6 +39,54 @@ int push(struct Node** head_ref, igraph_real_t value, char* attr)
   (*head_ref) = new_node;
   return 0;
 }
+/** Adds the values of a filtered graph to the report lists. **/
+int push_result(struct FilterResult *result, char* attr) {
+  push(&asshead, result->assort, attr);
+  push(&edges, result->edges, attr);
+  push(&density, result->density, attr);
+  push(&diameter, result->diameter, attr);
+  push(&pathlength, result->pathlength, attr);
+  push(&clustering, result->clustering, attr);
+  push(&betcent, result->betcent, attr);
+  push(&degcent, result->degcent, attr);
+  push(&idegcent, result->idegcent, attr);
+  push(&odegcent, result->odegcent, attr);
+  push(&eigcent, result->eigcent, attr);
+  push(&pagecent, result->pagecent, attr);
+  push(&reciprocity, result->reciprocity, attr);
+  push(&pv, result->pv, attr);
+  push(&ts, result->ts, attr);
+  return 0;
+}
+
+static void free_nodes(struct Node** head_ref) {
+  while (*head_ref != NULL) {
+    struct Node* next = (*head_ref)->next;
+    free(*head_ref);
+    *head_ref = next;
+  }
+}
+
+/** Empties the report lists so that another set of filters can be recorded. **/
+int clear_report() {
+  free_nodes(&asshead);
+  free_nodes(&edges);
+  free_nodes(&density);
+  free_nodes(&diameter);
+  free_nodes(&pathlength);
+  free_nodes(&clustering);
+  free_nodes(&betcent);
+  free_nodes(&degcent);
+  free_nodes(&idegcent);
+  free_nodes(&odegcent);
+  free_nodes(&eigcent);
+  free_nodes(&pagecent);
+  free_nodes(&reciprocity);
+  free_nodes(&pv);
+  free_nodes(&ts);
+  return 0;
+}
+
 /** Adds a new value to a RankNode. **/
 int pushRank (struct RankNode** head_ref, int rankids[20]) {
   struct RankNode* new_node = (struct RankNode*) malloc(sizeof(struct RankNode));
@@ -59,58 +107,124 @@ int pushArg (struct Argument** arg, char *value) {
   return 0;
 }
 
-/** Does a rank-order test on two graphs, based on attribute. **/
-int rankCompare(igraph_t *g1, igraph_t *g2, char* attr, igraph_real_t* result_pv, igraph_real_t* result_ts ) {
-  igraph_vector_t rank1, rank2, idRef1, idRef2, checkRef;
-  char attribute[strlen(attr) + 5];
-  strncpy(attribute, attr, strlen(attr)+1);
-  strncat(attribute, "Rank", 5);
-  bool first = (igraph_vcount(g1) < igraph_vcount(g2));
-  if (first){
-    igraph_vector_init(&rank2, igraph_vcount(g1));
-    igraph_vector_init(&rank1, igraph_vcount(g1));
-    //idRefs should be shrunk to smaller size;
-    igraph_vector_init(&idRef1, igraph_vcount(g2));
-    igraph_vector_init(&idRef2, igraph_vcount(g1));
-    igraph_vector_init(&checkRef, igraph_vcount(g1));
-    VANV(g1, attribute, &rank2);
-    VANV(g2, "idRef", &idRef1);
-    VANV(g1, "idRef", &idRef2);
-  } else {
-    igraph_vector_init(&rank2, igraph_vcount(g2));
-    igraph_vector_init(&rank1, igraph_vcount(g2));
-    //idRefs will be filtered to smaller size;
-    igraph_vector_init(&idRef1, igraph_vcount(g1));
-    igraph_vector_init(&idRef2, igraph_vcount(g2));
-    igraph_vector_init(&checkRef, igraph_vcount(g2));
-    VANV(g2, attribute, &rank2);
-    VANV(g2, "idRef", &idRef2);
-    VANV(g1, "idRef", &idRef1);
+/** Frees a list of arguments (not their values) and empties it. **/
+void freeArgs (struct Argument** arg) {
+  while (*arg != NULL) {
+    struct Argument* next = (*arg)->next;
+    free(*arg);
+    (*arg) = next;
+  }
+}
+
+/** Builds a dense index from idRef to vertex id for a graph.
+
+ Entries for idRefs that are not in the graph are set to -1, so looking up a
+ vertex of the original graph in a derivative graph is O(1).
+
+ @param graph - the graph whose vertices to index (usually a filtered graph).
+ @param size - the minimum size of the index (the vertex count of the original).
+ @param index - an uninitialized vector to hold the index.
+ @return 0 unless an error occurs.
+ */
+int idref_index(const igraph_t *graph, long int size, igraph_vector_long_t *index) {
+  igraph_vector_t ids;
+  long int n = igraph_vcount(graph);
+  igraph_vector_init(&ids, n);
+  VANV(graph, "idRef", &ids);
+  for (long int i=0; i<n; i++) {
+    if ((long int)VECTOR(ids)[i] >= size) {
+      size = (long int)VECTOR(ids)[i] + 1;
+    }
   }
+  igraph_vector_long_init(index, size);
+  igraph_vector_long_fill(index, -1);
+  for (long int i=0; i<n; i++) {
+    if (VECTOR(ids)[i] >= 0) {
+      VECTOR(*index)[(long int)VECTOR(ids)[i]] = i;
+    }
+  }
+  igraph_vector_destroy(&ids);
+  return 0;
+}
+
+/** Does a rank-order test on ranks held in vectors.
+
+ @param largeRank - the ranks of the larger graph.
+ @param idRef - the idRef of each vertex of the larger graph.
+ @param smallRank - the ranks of the smaller graph.
+ @param index - idRef of the larger graph to vertex id of the smaller graph.
+ @param result_pv - receives the p-value.
+ @param result_ts - receives the t-statistic.
+ @return 0 unless an error occurs.
+ **/
+int rank_compare_vectors(const igraph_vector_t *largeRank, const igraph_vector_t *idRef,
+                         igraph_vector_t *smallRank, const igraph_vector_long_t *index,
+                         igraph_real_t *result_pv, igraph_real_t *result_ts) {
+  igraph_vector_t rank1;
+  long int nlarge = igraph_vector_size(largeRank);
+  long int nsmall = igraph_vector_size(smallRank);
+  long int isize = igraph_vector_long_size(index);
+  igraph_vector_init(&rank1, nsmall);
   //need to find ranks based on idReference
-  int check = 0;
-  for (long int i=0; i<igraph_vector_size(&idRef1); i++) {
-    if (igraph_vector_contains(&idRef2, VECTOR(idRef1)[i])) {
-      if (first) {
-        VECTOR(rank1)[check]=VAN(g2, attribute, i);
-        VECTOR(checkRef)[check] = i;
-      } else {
-        VECTOR(rank1)[check]=VAN(g1, attribute, i);
-        VECTOR(checkRef)[check] = i;
-      }
-      check++;
+  for (long int i=0; i<nlarge; i++) {
+    long int ref = (long int)VECTOR(*idRef)[i];
+    long int j = (ref >= 0 && ref < isize) ? VECTOR(*index)[ref] : -1;
+    if (j >= 0 && j < nsmall) {
+      VECTOR(rank1)[j] = VECTOR(*largeRank)[i];
     }
   }
-  igraph_vector_destroy(&idRef2);
-  igraph_vector_destroy(&idRef1);
   igraph_real_t pvalue;
   igraph_real_t tstat;
-  paired_t_stat(&rank1, &rank2, &pvalue, &tstat);
+  paired_t_stat(&rank1, smallRank, &pvalue, &tstat);
   *result_pv = pvalue;
   *result_ts = tstat;
-  igraph_vector_destroy(&rank2);
   igraph_vector_destroy(&rank1);
-  igraph_vector_destroy(&checkRef);
+  return 0;
+}
+
+/** Does a rank-order test on two graphs, based on attribute.
+
+ Vertices of the larger graph are matched to the smaller graph through an
+ idRef index, so the comparison is O(n).
+
+ @param g1 - a graph (usually the original).
+ @param g2 - a graph (usually a filtered derivative of g1).
+ @param attr - the attribute whose "<attr>Rank" values are compared.
+ @param index - idRef of the larger graph to vertex id of the smaller graph,
+ as built by build_filter_index or idref_index.  If NULL it is built here.
+ @param result_pv - receives the p-value.
+ @param result_ts - receives the t-statistic.
+ @return 0 unless an error occurs.
+ **/
+int rankCompare(igraph_t *g1, igraph_t *g2, char* attr, igraph_vector_long_t *index,
+                igraph_real_t* result_pv, igraph_real_t* result_ts ) {
+  igraph_vector_t rank2, largeRank, idRef;
+  igraph_vector_long_t built;
+  char attribute[strlen(attr) + 5];
+  strncpy(attribute, attr, strlen(attr)+1);
+  strncat(attribute, "Rank", 5);
+  bool first = (igraph_vcount(g1) < igraph_vcount(g2));
+  igraph_t *large = first ? g2 : g1;
+  igraph_t *small = first ? g1 : g2;
+  long int nlarge = igraph_vcount(large);
+  long int nsmall = igraph_vcount(small);
+  igraph_vector_init(&rank2, nsmall);
+  igraph_vector_init(&largeRank, nlarge);
+  igraph_vector_init(&idRef, nlarge);
+  VANV(small, attribute, &rank2);
+  VANV(large, attribute, &largeRank);
+  VANV(large, "idRef", &idRef);
+  if (index == NULL) {
+    idref_index(small, nlarge, &built);
+  }
+  rank_compare_vectors(&largeRank, &idRef, &rank2, index ? index : &built,
+                       result_pv, result_ts);
+  if (index == NULL) {
+    igraph_vector_long_destroy(&built);
+  }
+  igraph_vector_destroy(&idRef);
+  igraph_vector_destroy(&largeRank);
+  igraph_vector_destroy(&rank2);
   return 0;
 }
 
@@ -153,12 +267,32 @@ int write_report(igraph_t *graph) {
   fprintf( fs, "-------------------- \n\n");
   fprintf( fs, "ORIGINAL GRAPH: *%s.gexf*\n\n", ug_FILENAME);
   for (int i=0; i<igraph_strvector_size(&gnames); i++) {
-    fprintf(fs, "%s : %f \n", STR(gnames, i), GAN(&g, STR(gnames, i)));
+    if (VECTOR(gtypes)[i] == IGRAPH_ATTRIBUTE_STRING) {
+      fprintf(fs, "%s : %s \n", STR(gnames, i), GAS(&g, STR(gnames, i)));
+    } else {
+      fprintf(fs, "%s : %f \n", STR(gnames, i), GAN(&g, STR(gnames, i)));
+    }
   }
   /* print names (use asshead) */
   fprintf(fs, "TRAIT COMPARISON BY FILTERING METHOD \n");
   fprintf(fs, "------------------------------------ \n");
   fprintf(fs, "Percent Filtered: %-2f\n", ug_percent);
+  if (ug_anf_bits > 0) {
+    fprintf(fs, "Distances: HyperANF, %d registers (about %.1f%% error), DIAMETER is a lower bound\n",
+            1 << ug_anf_bits, 104.0 / sqrt(1 << ug_anf_bits));
+  } else {
+    fprintf(fs, "Distances: exact\n");
+  }
+  if (ug_bmode == BETWEENNESS_EXACT) {
+    fprintf(fs, "Betweenness: exact\n");
+  } else if (ug_bmode == BETWEENNESS_SAMPLE) {
+    fprintf(fs, "Betweenness: approx, %li of %li sources sampled\n",
+            betweenness_samples(&g), (long) igraph_vcount(&g));
+  } else {
+    fprintf(fs, "Betweenness: eps %f (p >= %.2f), %li of %li sources sampled\n",
+            ug_bepsilon, 1 - BETWEENNESS_DELTA, betweenness_samples(&g),
+            (long) igraph_vcount(&g));
+  }
   fprintf(fs, "\n| Method          | Δ Edges   | Δ Assort | Δ Dens.  | Δ Recipr | Δ C(Deg.)|\n");
   fprintf(fs, "|-----------------|-----------|----------|----------|----------|----------|\n");
   while (asshead != NULL) {
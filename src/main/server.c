@@ -0,0 +1,446 @@
+/*
+ * GraphPass:
+ * A utility to filter networks and provide a default visualization output
+ * for Gephi or SigmaJS.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** @file server.c
+ @brief Serves filter requests on a UNIX socket (--serve).
+
+ A request is a few key=value lines ended by an empty line or by the
+ client closing its end:
+
+     input=/data/collection.graphml
+     methods=p
+     percent=30
+     format=sigma
+
+ attrs and output are optional too.  Without output the filtered graphs are
+ sent back on the connection, each as a "FILE name bytes" line followed by
+ the file; with output=DIR they are written there as a normal run would.
+ The reply starts with "OK hit|miss load_ms analyze_ms" and ends with
+ "END ok|failed filter_ms", or is a single "ERR message" line.
+
+ The server keeps the graphs it has loaded and analyzed, most recently used
+ first, until their estimated size passes the --serve-cache budget.  A
+ request for a cached graph only computes the metrics its methods need that
+ earlier requests did not (see plan_missing), so a hit costs little more
+ than the filter and the write.  A graph is reloaded when its file changes.
+
+ Each request is filtered in a forked child (see "Concurrency" in
+ graphpass.h), so a crash fails only that request and never the cache.
+ The parent loads and analyzes one request at a time.
+ */
+
+#include <graphpass.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <sys/time.h>
+#include <limits.h>
+#include <signal.h>
+
+#define SERVE_REQUEST_MAX 8192 /**< bytes a request may take. */
+#define SERVE_READ_TIMEOUT 5 /**< seconds a client has to send its request. */
+
+/** A loaded and analyzed graph. */
+struct CachedGraph {
+  char *path;
+  time_t mtime;
+  off_t size;
+  igraph_t graph;
+  size_t bytes; /**< estimated memory, see graph_memory. */
+  struct CachedGraph *next;
+};
+
+/** The fields of a request, pointing into its buffer. */
+struct ServeRequest {
+  char buf[SERVE_REQUEST_MAX + 1];
+  char *input;
+  char *methods;
+  char *percent;
+  char *format;
+  char *attrs;
+  char *output;
+};
+
+static struct CachedGraph *cache_head = NULL; /**< most recently used first. */
+static size_t cache_total = 0;
+static volatile sig_atomic_t stopping = 0;
+
+static void on_stop(int sig) {
+  stopping = 1;
+}
+
+/** Wakes accept so finished children are reaped. */
+static void on_child(int sig) {
+}
+
+static void cache_evict(struct CachedGraph **link) {
+  struct CachedGraph *entry = *link;
+  *link = entry->next;
+  cache_total -= entry->bytes;
+  if (ug_verbose == true) {
+    printf("Evicting %s (%zu bytes).\n", entry->path, entry->bytes);
+  }
+  igraph_destroy(&entry->graph);
+  free(entry->path);
+  free(entry);
+}
+
+/** Finds a cached graph and moves it to the front.  An entry whose file has
+ changed since it was loaded is dropped.
+
+ @return the entry, or NULL on a miss.
+ */
+static struct CachedGraph* cache_lookup(const char *path, const struct stat *st) {
+  for (struct CachedGraph **link = &cache_head; *link != NULL; link = &(*link)->next) {
+    struct CachedGraph *entry = *link;
+    if (strcmp(entry->path, path) != 0) {
+      continue;
+    }
+    if (entry->mtime != st->st_mtime || entry->size != st->st_size) {
+      cache_evict(link);
+      return NULL;
+    }
+    *link = entry->next;
+    entry->next = cache_head;
+    cache_head = entry;
+    return entry;
+  }
+  return NULL;
+}
+
+/** Evicts the least recently used graphs until the cache fits in budget,
+ but never the graph being served. */
+static void cache_trim(size_t budget) {
+  while (cache_total > budget && cache_head != NULL && cache_head->next != NULL) {
+    struct CachedGraph **link = &cache_head->next;
+    while ((*link)->next != NULL) {
+      link = &(*link)->next;
+    }
+    cache_evict(link);
+  }
+}
+
+/** Sends one output file on a --serve connection as "FILE name bytes\n"
+ followed by its contents.
+
+ @return 0, or -1 if the client could not be written to.
+ */
+int stream_output(FILE *out, const char *name, const char *data, size_t size) {
+  fprintf(out, "FILE %s %zu\n", name, size);
+  if (size > 0 && fwrite(data, 1, size, out) != size) {
+    return -1;
+  }
+  return fflush(out) == 0 ? 0 : -1;
+}
+
+/** Reads and splits a request.
+
+ @return NULL, or a message for the client.
+ */
+static const char* read_request(int fd, struct ServeRequest *req) {
+  size_t got = 0;
+  ssize_t n;
+  memset(req, 0, sizeof(*req));
+  while (got < SERVE_REQUEST_MAX) {
+    n = read(fd, req->buf + got, SERVE_REQUEST_MAX - got);
+    if (n == -1 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      break;
+    }
+    got += n;
+    req->buf[got] = '\0';
+    if (strstr(req->buf, "\n\n") != NULL || strstr(req->buf, "\r\n\r\n") != NULL) {
+      break;
+    }
+  }
+  req->buf[got] = '\0';
+  /* anything after the empty line is not part of the request */
+  char *end = strstr(req->buf, "\n\n");
+  if (end != NULL) {
+    end[1] = '\0';
+  }
+  char *save = NULL;
+  for (char *line = strtok_r(req->buf, "\n", &save); line != NULL;
+       line = strtok_r(NULL, "\n", &save)) {
+    size_t len = strlen(line);
+    if (len > 0 && line[len - 1] == '\r') {
+      line[--len] = '\0';
+    }
+    if (len == 0) {
+      break;
+    }
+    char *value = strchr(line, '=');
+    if (value == NULL) {
+      return "expected key=value lines";
+    }
+    *value++ = '\0';
+    if (strcmp(line, "input") == 0) { req->input = value; }
+    else if (strcmp(line, "methods") == 0) { req->methods = value; }
+    else if (strcmp(line, "percent") == 0) { req->percent = value; }
+    else if (strcmp(line, "format") == 0) { req->format = value; }
+    else if (strcmp(line, "attrs") == 0) { req->attrs = value; }
+    else if (strcmp(line, "output") == 0) { req->output = value; }
+    else { return "unknown key"; }
+  }
+  if (req->input == NULL || *req->input == '\0') {
+    return "input is required";
+  }
+  return NULL;
+}
+
+/** Filters the analyzed graph in g for the request and replies; runs in a
+ forked child. */
+static void serve_filter(int conn, struct ServeRequest *req, bool hit,
+                         double load_ms, double analyze_ms) {
+  char input[PATH_MAX];
+  char outdir[PATH_MAX];
+  FILE *out = fdopen(conn, "w");
+  if (out == NULL) {
+    _exit(EXIT_FAILURE);
+  }
+  strncpy(input, req->input, sizeof(input) - 1);
+  input[sizeof(input) - 1] = '\0';
+  while (strlen(input) > 1 && input[strlen(input) - 1] == '/') {
+    input[strlen(input) - 1] = '\0';
+  }
+  get_filename(input, &ug_FILENAME);
+  ug_OUTFILE = ug_FILENAME;
+  if (req->output != NULL) {
+    snprintf(outdir, sizeof(outdir), "%s%s", req->output,
+             req->output[strlen(req->output) - 1] == '/' ? "" : "/");
+    ug_OUTPATH = outdir;
+  } else {
+    /* frames from parallel workers would interleave on one connection */
+    ug_stream = out;
+    ug_OUTPATH = "";
+    ug_jobs = 1;
+    ug_compress = COMPRESSION_NONE;
+  }
+  fprintf(out, "OK %s %.1f %.1f\n", hit ? "hit" : "miss", load_ms, analyze_ms);
+  fflush(out);
+  double start = now_ms();
+  int result = runFilters(&g, filter_cutsize());
+  if (write_queue_finish() != 0) {
+    result = -1;
+  }
+  fprintf(out, "END %s %.1f\n", result == 0 ? "ok" : "failed", now_ms() - start);
+  fclose(out);
+  _exit(result == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+/** Answers one connection.
+
+ @param conn - the client.
+ @param listener - the listening socket, closed in the child.
+ @param budget - the cache budget in bytes.
+ @param cache - true to keep a metric cache beside each input (--cache).
+ @param format - the server's --format, used unless the request names one.
+ @param attrs - the server's --attrs, used unless the request names them.
+ */
+static void serve_request(int conn, int listener, size_t budget, bool cache,
+                          output_format_t format, char *attrs) {
+  struct ServeRequest req;
+  struct CostEstimate cost;
+  struct stat st, outst;
+  const char *error = read_request(conn, &req);
+  double start = now_ms();
+  ug_methods = req.methods && *req.methods ? req.methods : "d";
+  ug_percent = req.percent ? atof(req.percent) : 0.0;
+  ug_format = format;
+  ug_attrs = attrs;
+  ug_quickrun = false;
+  ug_report = false;
+  ug_save = true;
+  ug_stream = NULL;
+  if (error == NULL && req.format != NULL && parse_format(req.format) != 0) {
+    error = "format expects graphml, gexf or sigma";
+  }
+  if (error == NULL && req.attrs != NULL && parse_attrs(req.attrs) != 0) {
+    error = "attrs expects a comma-separated list";
+  }
+  if (error == NULL && (ug_percent < 0.0 || ug_percent >= 100.0)) {
+    error = "percent must be from 0 to 100";
+  }
+  if (error == NULL && stat(req.input, &st) != 0) {
+    error = "input not found";
+  }
+  if (error == NULL && req.output != NULL && stat(req.output, &outst) != 0) {
+    error = "output folder does not exist";
+  }
+  struct CachedGraph *entry = NULL;
+  char *sidecar = NULL;
+  if (error == NULL) {
+    entry = cache_lookup(req.input, &st);
+  }
+  bool hit = (entry != NULL);
+  if (error == NULL && !hit) {
+    if (cache) {
+      sidecar = malloc(strlen(req.input) + strlen(CACHE_EXT) + 1);
+      if (sidecar == NULL) {
+        error = "out of memory";
+      } else {
+        strcpy(sidecar, req.input);
+        strcat(sidecar, CACHE_EXT);
+      }
+    }
+    ug_CACHE = sidecar;
+    if (error != NULL) {
+      /* reported below */
+    } else if (load_graph(req.input) != 0) {
+      error = "could not load the graph";
+    } else if (cost_check(&g, req.input, &cost) != 0) {
+      igraph_destroy(&g);
+      error = cost.reason;
+    } else if ((entry = (struct CachedGraph*) calloc(1, sizeof(struct CachedGraph))) == NULL
+               || (entry->path = strdup(req.input)) == NULL) {
+      free(entry);
+      entry = NULL;
+      igraph_destroy(&g);
+      error = "out of memory";
+    } else {
+      entry->mtime = st.st_mtime;
+      entry->size = st.st_size;
+      entry->graph = g;
+      entry->next = cache_head;
+      cache_head = entry;
+    }
+  }
+  if (error != NULL) {
+    if (sidecar != NULL) {
+      free(sidecar);
+      ug_CACHE = NULL;
+    }
+    dprintf(conn, "ERR %s\n", error);
+    return;
+  }
+  double load_ms = now_ms() - start;
+  /* the analysis is added to the cached graph, for this and later requests */
+  g = entry->graph;
+  NODESIZE = igraph_vcount(&g);
+  EDGESIZE = igraph_ecount(&g);
+  plan_run(false);
+  if (!hit) {
+    analyze_base_graph();
+    free(sidecar);
+    ug_CACHE = NULL;
+  } else {
+    metric_plan_t missing = plan_missing(&g, ug_plan ? ug_plan : PLAN_ANALYSIS_ALL);
+    if (missing != 0) {
+      analysis_planned(&g, missing);
+    }
+  }
+  entry->graph = g;
+  cache_total -= entry->bytes;
+  entry->bytes = graph_memory(&g);
+  cache_total += entry->bytes;
+  double analyze_ms = now_ms() - start - load_ms;
+  if (ug_verbose == true) {
+    printf("%s %s %s%s: load %.1f ms, analysis %.1f ms, cache %zu bytes.\n",
+           hit ? "HIT " : "MISS", req.input, ug_methods, req.percent ? req.percent : "0",
+           load_ms, analyze_ms, cache_total);
+  }
+  fflush(stdout);
+  fflush(stderr);
+  pid_t pid = fork();
+  if (pid == 0) {
+    close(listener);
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+    signal(SIGCHLD, SIG_DFL);
+    serve_filter(conn, &req, hit, load_ms, analyze_ms);
+  }
+  if (pid == -1) {
+    dprintf(conn, "ERR could not start a worker\n");
+  }
+  cache_trim(budget);
+}
+
+/** Serves filter requests on a UNIX socket until SIGINT or SIGTERM.
+
+ @param socket_path - where to listen (--serve); an old socket there is
+ replaced.
+ @param cache_mb - the memory budget of loaded graphs, in megabytes.
+ @param cache - true to keep a metric cache beside each input (--cache).
+ @return 0, or -1 if the socket could not be opened.
+ */
+int run_server(char *socket_path, long cache_mb, bool cache) {
+  struct sockaddr_un addr;
+  struct sigaction sa;
+  struct stat st;
+  size_t budget = (size_t) (cache_mb > 0 ? cache_mb : SERVE_CACHE_MB) << 20;
+  output_format_t format = ug_format;
+  char *attrs = ug_attrs;
+  if (strlen(socket_path) >= sizeof(addr.sun_path)) {
+    fprintf(stderr, ">>> FAILURE - Socket path %s is too long.\n", socket_path);
+    return -1;
+  }
+  int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listener == -1) {
+    return -1;
+  }
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, socket_path);
+  if (stat(socket_path, &st) == 0 && S_ISSOCK(st.st_mode)) {
+    unlink(socket_path);
+  }
+  if (bind(listener, (struct sockaddr*) &addr, sizeof(addr)) != 0
+      || listen(listener, 16) != 0) {
+    fprintf(stderr, ">>> FAILURE - Could not listen on %s.\n", socket_path);
+    close(listener);
+    return -1;
+  }
+  memset(&sa, 0, sizeof(sa));
+  /* a server stopped before may be started again in the same process */
+  stopping = 0;
+  sa.sa_handler = on_stop;
+  sigaction(SIGINT, &sa, NULL);
+  sigaction(SIGTERM, &sa, NULL);
+  sa.sa_handler = on_child;
+  sigaction(SIGCHLD, &sa, NULL);
+  signal(SIGPIPE, SIG_IGN);
+  if (!ug_TEST) {
+    printf("Serving on %s with a %li MB graph cache.\n", socket_path, (long) (budget >> 20));
+    fflush(stdout);
+  }
+  while (!stopping) {
+    while (waitpid(-1, NULL, WNOHANG) > 0) {
+    }
+    int conn = accept(listener, NULL, NULL);
+    if (conn == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      break;
+    }
+    struct timeval timeout = {SERVE_READ_TIMEOUT, 0};
+    setsockopt(conn, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    serve_request(conn, listener, budget, cache, format, attrs);
+    close(conn);
+  }
+  close(listener);
+  unlink(socket_path);
+  while (wait(NULL) > 0) {
+  }
+  while (cache_head != NULL) {
+    cache_evict(&cache_head);
+  }
+  return 0;
+}
@@ -0,0 +1,190 @@
+/*
+ * GraphPass:
+ * A utility to filter networks and provide a default visualization output
+ * for Gephi or SigmaJS.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** @file sigma.c
+ @brief Writes SigmaJS JSON files.
+
+ The file is the {"nodes": [...], "edges": [...]} object SigmaJS reads
+ directly, in the layout of Gephi's JSON exporter:
+
+     {"id":"n0","label":"a.com","x":1.5,"y":-2,"size":10,
+      "color":"rgb(255,0,0)","attributes":{"PageRank":0.25}}
+     {"id":"e0","source":"n0","target":"n1","size":1}
+
+ Node and edge ids are those of the GEXF writer.  The attributes an
+ --attrs list keeps (see project.c), other than those written as node and
+ edge fields, go into "attributes"; a value that is missing (no x column,
+ a NaN PageRank) is left out rather than written as null.
+
+ Like gexf.c, columns are fetched once into AttrTables and each element is
+ appended to an OutBuffer, which reaches the file in OUT_BUFFER_SIZE
+ writes; no document is built in memory.
+ */
+
+#include <graphpass.h>
+
+/** Picks the columns of a table written under "attributes".
+
+ @param table - the vertex or edge columns.
+ @param attrs - the --attrs list.
+ @param kind - IGRAPH_ATTRIBUTE_VERTEX or IGRAPH_ATTRIBUTE_EDGE.
+ @param cols - receives the chosen columns, table->count at most.
+ @return the number chosen.
+ */
+static long select_columns(const struct AttrTable *table, const char *attrs,
+                           igraph_attribute_elemtype_t kind, struct AttrColumn **cols) {
+  long n = 0;
+  for (long i=0; i<table->count; i++) {
+    struct AttrColumn *col = &table->cols[i];
+    if (!attr_is_viz(col->name, kind) && attr_wanted(attrs, col->name, kind)) {
+      cols[n++] = col;
+    }
+  }
+  return n;
+}
+
+/** Appends ,"key":value for a number, nothing if it is NaN or infinite. */
+static void json_number(struct OutBuffer *buf, const char *key, igraph_real_t value) {
+  if (isfinite(value)) {
+    out_buffer_puts(buf, key);
+    out_buffer_g(buf, value);
+  }
+}
+
+/** Appends the "attributes" object of element elem. */
+static void json_attributes(struct OutBuffer *buf, struct AttrColumn **cols, long ncols,
+                            long elem) {
+  bool first = true;
+  if (ncols == 0) {
+    return;
+  }
+  out_buffer_puts(buf, ",\"attributes\":{");
+  for (long i=0; i<ncols; i++) {
+    struct AttrColumn *col = cols[i];
+    if (col->type == IGRAPH_ATTRIBUTE_NUMERIC && !isfinite(VECTOR(col->num)[elem])) {
+      continue;
+    }
+    if (col->type != IGRAPH_ATTRIBUTE_NUMERIC && col->type != IGRAPH_ATTRIBUTE_STRING
+        && col->type != IGRAPH_ATTRIBUTE_BOOLEAN) {
+      continue;
+    }
+    if (!first) {
+      out_buffer_write(buf, ",", 1);
+    }
+    first = false;
+    out_buffer_json(buf, col->name);
+    out_buffer_write(buf, ":", 1);
+    if (col->type == IGRAPH_ATTRIBUTE_NUMERIC) {
+      out_buffer_g(buf, VECTOR(col->num)[elem]);
+    } else if (col->type == IGRAPH_ATTRIBUTE_STRING) {
+      out_buffer_json(buf, STR(col->str, elem));
+    } else {
+      out_buffer_puts(buf, VECTOR(col->boolv)[elem] ? "true" : "false");
+    }
+  }
+  out_buffer_write(buf, "}", 1);
+}
+
+/** Writes a SigmaJS JSON file.
+
+ @param graph - the graph to write.
+ @param outstream - a file object.
+ @param attrs - the vertex and edge attributes to include, as for --attrs,
+ or NULL for all of them.
+ @return 0, or -1 if the file could not be written.
+ */
+int write_graph_sigma(const igraph_t *graph, FILE *outstream, const char *attrs) {
+  struct AttrTable vtable, etable;
+  struct OutBuffer buf;
+  igraph_vector_t edges;
+  long vc = igraph_vcount(graph);
+  long ec = igraph_ecount(graph);
+
+  attr_table_init(&vtable, graph, IGRAPH_ATTRIBUTE_VERTEX);
+  attr_table_init(&etable, graph, IGRAPH_ATTRIBUTE_EDGE);
+  struct AttrColumn *vcols[vtable.count + 1];
+  struct AttrColumn *ecols[etable.count + 1];
+  long nv = select_columns(&vtable, attrs, IGRAPH_ATTRIBUTE_VERTEX, vcols);
+  long ne = select_columns(&etable, attrs, IGRAPH_ATTRIBUTE_EDGE, ecols);
+  igraph_strvector_t *labels = attr_table_string(&vtable, "label");
+  igraph_vector_t *x = attr_table_numeric(&vtable, "x");
+  igraph_vector_t *y = attr_table_numeric(&vtable, "y");
+  igraph_vector_t *size = attr_table_numeric(&vtable, "size");
+  igraph_vector_t *red = attr_table_numeric(&vtable, "r");
+  igraph_vector_t *green = attr_table_numeric(&vtable, "g");
+  igraph_vector_t *blue = attr_table_numeric(&vtable, "b");
+  igraph_vector_t *weight = attr_table_numeric(&etable, "weight");
+  if (labels == NULL) {
+    labels = attr_table_string(&vtable, "name");
+  }
+  igraph_vector_init(&edges, 0);
+  igraph_get_edgelist(graph, &edges, 0);
+
+  out_buffer_init(&buf, outstream);
+  out_buffer_puts(&buf, "{\"nodes\":[\x0A");
+  for (long l=0; l<vc; l++) {
+    out_buffer_puts(&buf, l ? ",\x0A{\"id\":\"n" : "{\"id\":\"n");
+    out_buffer_long(&buf, l);
+    out_buffer_write(&buf, "\"", 1);
+    if (labels != NULL) {
+      out_buffer_puts(&buf, ",\"label\":");
+      out_buffer_json(&buf, STR(*labels, l));
+    }
+    if (x != NULL) {
+      json_number(&buf, ",\"x\":", VECTOR(*x)[l]);
+    }
+    if (y != NULL) {
+      json_number(&buf, ",\"y\":", VECTOR(*y)[l]);
+    }
+    if (size != NULL) {
+      json_number(&buf, ",\"size\":", VECTOR(*size)[l]);
+    }
+    if (red != NULL && green != NULL && blue != NULL) {
+      out_buffer_puts(&buf, ",\"color\":\"rgb(");
+      out_buffer_long(&buf, (int)VECTOR(*red)[l]);
+      out_buffer_write(&buf, ",", 1);
+      out_buffer_long(&buf, (int)VECTOR(*green)[l]);
+      out_buffer_write(&buf, ",", 1);
+      out_buffer_long(&buf, (int)VECTOR(*blue)[l]);
+      out_buffer_puts(&buf, ")\"");
+    }
+    json_attributes(&buf, vcols, nv, l);
+    out_buffer_write(&buf, "}", 1);
+  }
+  out_buffer_puts(&buf, "\x0A],\"edges\":[\x0A");
+  for (long l=0; l<ec; l++) {
+    out_buffer_puts(&buf, l ? ",\x0A{\"id\":\"e" : "{\"id\":\"e");
+    out_buffer_long(&buf, l);
+    out_buffer_puts(&buf, "\",\"source\":\"n");
+    out_buffer_long(&buf, (long) VECTOR(edges)[2 * l]);
+    out_buffer_puts(&buf, "\",\"target\":\"n");
+    out_buffer_long(&buf, (long) VECTOR(edges)[2 * l + 1]);
+    out_buffer_write(&buf, "\"", 1);
+    if (weight != NULL) {
+      json_number(&buf, ",\"size\":", VECTOR(*weight)[l]);
+    }
+    json_attributes(&buf, ecols, ne, l);
+    out_buffer_write(&buf, "}", 1);
+  }
+  out_buffer_puts(&buf, "\x0A]}\x0A");
+
+  igraph_vector_destroy(&edges);
+  attr_table_destroy(&vtable);
+  attr_table_destroy(&etable);
+  return out_buffer_destroy(&buf);
+}
@@ -0,0 +1,599 @@
+/*
+ * GraphPass:
+ * A utility to filter networks and provide a default visualization output
+ * for Gephi or SigmaJS.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** @file snapshot.c
+ @brief A binary graph snapshot that loads without parsing.
+
+ "graphpass convert" writes a graph, with all its graph, vertex and edge
+ attributes, to a snapshot file (by default the input path with
+ SNAPSHOT_EXT).  load_graph recognises snapshots by their magic and maps
+ them: the edge list is handed to igraph_create straight from the map and
+ every column is one copy, so a reload costs little more than reading the
+ file.
+
+ Layout (native byte order, checked through SNAPSHOT_ENDIAN_CHECK; every
+ array starts on an 8-byte boundary, padding is zero):
+
+     header (struct SnapshotHeader, 64 bytes)
+     double   edges[2 * edges]   from, to pairs as igraph_create takes them
+     columns, in attribute handler order, each:
+              struct SnapshotColumn, name (NUL-terminated)
+              numeric: double[length]
+              boolean: uint8_t[length]
+              string:  uint64_t words, uint64_t bytes, uint64_t offsets[words],
+                       char dictionary[bytes], uint32_t codes[length]
+
+ Strings are dictionary-encoded: each distinct value is stored once and
+ every element holds the index of its value.  The checksum covers all of
+ the file after the header.  convert checks it on the file it has just
+ written; load_graph does not, since reading the columns already checks
+ every length, offset and vertex id against the file, and the checksum
+ pass costs about a third as much as the copies a load makes.  A snapshot converted with --cache also holds
+ the analysis of the graph and records its cache fingerprint, which
+ analyze_base_graph uses to reuse those columns.
+ */
+
+#include <graphpass.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+
+#define SNAPSHOT_MAGIC "GPSNAP"
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_ENDIAN_CHECK 0x01020304
+
+/** The start of every snapshot file. */
+struct SnapshotHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t endian;
+  uint64_t nodes;
+  uint64_t edges;
+  uint32_t directed;
+  uint32_t columns;
+  uint64_t metrics; /**< graph_fingerprint of the stored analysis, 0 if none. */
+  uint64_t payload; /**< bytes after the header. */
+  uint64_t checksum;
+};
+
+/** The start of every column. */
+struct SnapshotColumn {
+  uint32_t kind; /**< an igraph_attribute_elemtype_t. */
+  uint32_t type; /**< an igraph_attribute_type_t. */
+  uint64_t length;
+  uint32_t name_bytes; /**< including the NUL. */
+  uint32_t reserved;
+};
+
+/** A running checksum: four FNV-style lanes over 64-bit words, so it runs
+ near memory speed on the load path. */
+struct Checksum {
+  uint64_t lane[4];
+  unsigned char tail[32];
+  size_t ntail;
+  uint64_t size;
+};
+
+static void checksum_init(struct Checksum *ck) {
+  for (int j=0; j<4; j++) {
+    ck->lane[j] = FNV_OFFSET ^ j;
+  }
+  ck->ntail = 0;
+  ck->size = 0;
+}
+
+static void checksum_block(uint64_t *lane, const unsigned char *p) {
+  for (int j=0; j<4; j++) {
+    uint64_t w;
+    memcpy(&w, p + 8 * j, sizeof(w));
+    lane[j] = (lane[j] ^ w) * FNV_PRIME;
+    lane[j] ^= lane[j] >> 29;
+  }
+}
+
+static void checksum_update(struct Checksum *ck, const void *data, size_t len) {
+  const unsigned char *p = (const unsigned char*) data;
+  ck->size += len;
+  if (ck->ntail > 0) {
+    size_t take = len < 32 - ck->ntail ? len : 32 - ck->ntail;
+    memcpy(ck->tail + ck->ntail, p, take);
+    ck->ntail += take;
+    p += take;
+    len -= take;
+    if (ck->ntail < 32) {
+      return;
+    }
+    checksum_block(ck->lane, ck->tail);
+    ck->ntail = 0;
+  }
+  for (; len >= 32; p += 32, len -= 32) {
+    checksum_block(ck->lane, p);
+  }
+  memcpy(ck->tail, p, len);
+  ck->ntail = len;
+}
+
+static uint64_t checksum_final(struct Checksum *ck) {
+  if (ck->ntail > 0) {
+    memset(ck->tail + ck->ntail, 0, 32 - ck->ntail);
+    checksum_block(ck->lane, ck->tail);
+  }
+  uint64_t hash = FNV_OFFSET;
+  for (int j=0; j<4; j++) {
+    hash = (hash ^ ck->lane[j]) * FNV_PRIME;
+  }
+  return (hash ^ ck->size) * FNV_PRIME;
+}
+
+/** Writes the payload, checksumming as it goes. */
+struct SnapshotWriter {
+  FILE *fp;
+  struct Checksum ck;
+  uint32_t columns;
+  bool failed;
+};
+
+static void put(struct SnapshotWriter *w, const void *data, size_t len) {
+  if (!w->failed && len > 0) {
+    w->failed = fwrite(data, 1, len, w->fp) != len;
+    checksum_update(&w->ck, data, len);
+  }
+}
+
+/** Pads the payload to the next 8-byte boundary. */
+static void pad(struct SnapshotWriter *w) {
+  static const char zeros[8] = {0};
+  put(w, zeros, (8 - w->ck.size % 8) % 8);
+}
+
+static void put_column_header(struct SnapshotWriter *w, igraph_attribute_elemtype_t kind,
+                              igraph_attribute_type_t type, uint64_t length,
+                              const char *name) {
+  struct SnapshotColumn col = {kind, type, length, strlen(name) + 1, 0};
+  put(w, &col, sizeof(col));
+  put(w, name, col.name_bytes);
+  pad(w);
+  w->columns++;
+}
+
+/** Writes a string column as a dictionary of its distinct values and one
+ code per element. */
+static void put_strings(struct SnapshotWriter *w, const igraph_strvector_t *col) {
+  long n = igraph_strvector_size(col);
+  long nslots = 16;
+  while (nslots < 2 * n) {
+    nslots *= 2;
+  }
+  long *slots = (long*) malloc(nslots * sizeof(long));
+  long *first = (long*) malloc((n ? n : 1) * sizeof(long));
+  uint64_t *offsets = (uint64_t*) malloc((n ? n : 1) * sizeof(uint64_t));
+  uint32_t *codes = (uint32_t*) malloc((n ? n : 1) * sizeof(uint32_t));
+  if (slots == NULL || first == NULL || offsets == NULL || codes == NULL) {
+    w->failed = true;
+  } else {
+    uint64_t words = 0, bytes = 0;
+    for (long i=0; i<nslots; i++) {
+      slots[i] = -1;
+    }
+    for (long i=0; i<n; i++) {
+      const char *s = STR(*col, i);
+      long slot = fnv_hash(FNV_OFFSET, s, strlen(s)) & (nslots - 1);
+      while (slots[slot] != -1 && strcmp(STR(*col, first[slots[slot]]), s) != 0) {
+        slot = (slot + 1) & (nslots - 1);
+      }
+      if (slots[slot] == -1) {
+        slots[slot] = words;
+        first[words] = i;
+        offsets[words] = bytes;
+        bytes += strlen(s) + 1;
+        words++;
+      }
+      codes[i] = slots[slot];
+    }
+    put(w, &words, sizeof(words));
+    put(w, &bytes, sizeof(bytes));
+    put(w, offsets, words * sizeof(uint64_t));
+    for (uint64_t d=0; d<words; d++) {
+      const char *s = STR(*col, first[d]);
+      put(w, s, strlen(s) + 1);
+    }
+    pad(w);
+    put(w, codes, n * sizeof(uint32_t));
+    pad(w);
+  }
+  free(slots);
+  free(first);
+  free(offsets);
+  free(codes);
+}
+
+static void put_table(struct SnapshotWriter *w, const igraph_t *graph,
+                      igraph_attribute_elemtype_t kind) {
+  struct AttrTable table;
+  attr_table_init(&table, graph, kind);
+  for (long i=0; i<table.count; i++) {
+    struct AttrColumn *col = &table.cols[i];
+    if (col->type == IGRAPH_ATTRIBUTE_NUMERIC) {
+      put_column_header(w, kind, col->type, table.length, col->name);
+      put(w, VECTOR(col->num), table.length * sizeof(igraph_real_t));
+    } else if (col->type == IGRAPH_ATTRIBUTE_STRING) {
+      put_column_header(w, kind, col->type, table.length, col->name);
+      put_strings(w, &col->str);
+    } else if (col->type == IGRAPH_ATTRIBUTE_BOOLEAN) {
+      put_column_header(w, kind, col->type, table.length, col->name);
+      for (long j=0; j<table.length; j++) {
+        uint8_t b = VECTOR(col->boolv)[j] ? 1 : 0;
+        put(w, &b, 1);
+      }
+      pad(w);
+    }
+  }
+  attr_table_destroy(&table);
+}
+
+static void put_graph_attrs(struct SnapshotWriter *w, const igraph_t *graph) {
+  igraph_strvector_t gnames, vnames, enames;
+  igraph_vector_t gtypes, vtypes, etypes;
+  igraph_strvector_init(&gnames, 0);
+  igraph_strvector_init(&vnames, 0);
+  igraph_strvector_init(&enames, 0);
+  igraph_vector_init(&gtypes, 0);
+  igraph_vector_init(&vtypes, 0);
+  igraph_vector_init(&etypes, 0);
+  igraph_cattribute_list(graph, &gnames, &gtypes, &vnames, &vtypes, &enames, &etypes);
+  for (long i=0; i<igraph_strvector_size(&gnames); i++) {
+    const char *name = STR(gnames, i);
+    igraph_attribute_type_t type = (igraph_attribute_type_t) VECTOR(gtypes)[i];
+    if (type == IGRAPH_ATTRIBUTE_NUMERIC) {
+      igraph_real_t value = GAN(graph, name);
+      put_column_header(w, IGRAPH_ATTRIBUTE_GRAPH, type, 1, name);
+      put(w, &value, sizeof(value));
+    } else if (type == IGRAPH_ATTRIBUTE_STRING) {
+      igraph_strvector_t value;
+      igraph_strvector_init(&value, 1);
+      igraph_strvector_set(&value, 0, GAS(graph, name));
+      put_column_header(w, IGRAPH_ATTRIBUTE_GRAPH, type, 1, name);
+      put_strings(w, &value);
+      igraph_strvector_destroy(&value);
+    } else if (type == IGRAPH_ATTRIBUTE_BOOLEAN) {
+      uint8_t b = GAB(graph, name) ? 1 : 0;
+      put_column_header(w, IGRAPH_ATTRIBUTE_GRAPH, type, 1, name);
+      put(w, &b, 1);
+      pad(w);
+    }
+  }
+  igraph_strvector_destroy(&gnames);
+  igraph_strvector_destroy(&vnames);
+  igraph_strvector_destroy(&enames);
+  igraph_vector_destroy(&gtypes);
+  igraph_vector_destroy(&vtypes);
+  igraph_vector_destroy(&etypes);
+}
+
+/** Returns the snapshot path for "graphpass convert".
+
+ @param input - the graph being converted.
+ @param output - the path given on the command line, or NULL.
+ @return a malloc'd path: output, or input with its extension replaced by
+ SNAPSHOT_EXT.
+ */
+char* snapshot_path(const char *input, const char *output) {
+  if (output != NULL) {
+    return strdup(output);
+  }
+  char *path = (char*) malloc(strlen(input) + strlen(SNAPSHOT_EXT) + 1);
+  strcpy(path, input);
+  /* a directory of CSV shards gets a snapshot beside it */
+  while (strlen(path) > 1 && path[strlen(path) - 1] == '/') {
+    path[strlen(path) - 1] = '\0';
+  }
+  char *dot = strrchr(path, '.');
+  if (dot != NULL && strchr(dot, '/') == NULL && dot != path) {
+    *dot = '\0';
+  }
+  strcat(path, SNAPSHOT_EXT);
+  return path;
+}
+
+/** Writes a graph and all its attributes to a snapshot file.
+
+ Like the metric cache, the file is written under a temporary name and
+ renamed into place.
+
+ @param graph - the graph to write.
+ @param path - the snapshot file.
+ @param metrics - whether the graph holds an analysis to be reused; its
+ graph_fingerprint is recorded.
+ @return 0 unless an error occurs.
+ */
+int save_snapshot(const igraph_t *graph, const char *path, bool metrics) {
+  char tmppath[strlen(path) + 5];
+  snprintf(tmppath, sizeof(tmppath), "%s.tmp", path);
+  struct SnapshotWriter w;
+  w.fp = fopen(tmppath, "wb");
+  w.columns = 0;
+  if (w.fp == NULL) {
+    return -1;
+  }
+  struct SnapshotHeader header;
+  memset(&header, 0, sizeof(header));
+  w.failed = fwrite(&header, sizeof(header), 1, w.fp) != 1;
+  checksum_init(&w.ck);
+
+  igraph_vector_t el;
+  igraph_vector_init(&el, 0);
+  igraph_get_edgelist(graph, &el, 0);
+  put(&w, VECTOR(el), igraph_vector_size(&el) * sizeof(igraph_real_t));
+  igraph_vector_destroy(&el);
+  put_graph_attrs(&w, graph);
+  put_table(&w, graph, IGRAPH_ATTRIBUTE_VERTEX);
+  put_table(&w, graph, IGRAPH_ATTRIBUTE_EDGE);
+
+  memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+  header.version = SNAPSHOT_VERSION;
+  header.endian = SNAPSHOT_ENDIAN_CHECK;
+  header.nodes = igraph_vcount(graph);
+  header.edges = igraph_ecount(graph);
+  header.directed = igraph_is_directed(graph) ? 1 : 0;
+  header.columns = w.columns;
+  header.metrics = metrics ? graph_fingerprint(graph) : 0;
+  header.payload = w.ck.size;
+  header.checksum = checksum_final(&w.ck);
+  bool fail = w.failed || fseek(w.fp, 0, SEEK_SET) != 0
+    || fwrite(&header, sizeof(header), 1, w.fp) != 1;
+  fail |= fclose(w.fp) != 0;
+  if (fail || rename(tmppath, path) != 0) {
+    remove(tmppath);
+    return -1;
+  }
+  return 0;
+}
+
+/** Reads the mapped payload, checking every length against what is left. */
+struct SnapshotReader {
+  const char *p;
+  const char *end;
+  bool bad;
+};
+
+/** Takes count items of size bytes, then skips to the next 8-byte boundary.
+ Returns NULL, and marks the reader bad, if the payload is too short. */
+static const void* take(struct SnapshotReader *r, uint64_t count, size_t size) {
+  uint64_t left = r->end - r->p;
+  if (r->bad || count > left / size) {
+    r->bad = true;
+    return NULL;
+  }
+  uint64_t len = (count * size + 7) & ~(uint64_t) 7;
+  if (len > left) {
+    r->bad = true;
+    return NULL;
+  }
+  const void *data = r->p;
+  r->p += len;
+  return data;
+}
+
+/** Reads one string column into a new strvector. */
+static int take_strings(struct SnapshotReader *r, uint64_t length, igraph_strvector_t *col) {
+  const uint64_t *counts = (const uint64_t*) take(r, 2, sizeof(uint64_t));
+  if (counts == NULL) {
+    return -1;
+  }
+  uint64_t words = counts[0], bytes = counts[1];
+  const uint64_t *offsets = (const uint64_t*) take(r, words, sizeof(uint64_t));
+  const char *dictionary = (const char*) take(r, bytes, 1);
+  const uint32_t *codes = (const uint32_t*) take(r, length, sizeof(uint32_t));
+  if (r->bad || (bytes > 0 && dictionary[bytes - 1] != '\0')) {
+    return -1;
+  }
+  for (uint64_t d=0; d<words; d++) {
+    if (offsets[d] >= bytes) {
+      return -1;
+    }
+  }
+  igraph_strvector_init(col, length);
+  for (uint64_t i=0; i<length; i++) {
+    if (codes[i] >= words) {
+      igraph_strvector_destroy(col);
+      return -1;
+    }
+    igraph_strvector_set(col, i, dictionary + offsets[codes[i]]);
+  }
+  return 0;
+}
+
+/** Reads one column and sets it on the graph. */
+static int take_column(struct SnapshotReader *r, igraph_t *graph) {
+  const struct SnapshotColumn *col = (const struct SnapshotColumn*) take(r, 1, sizeof(*col));
+  const char *name = col ? (const char*) take(r, col->name_bytes, 1) : NULL;
+  if (r->bad || col->name_bytes == 0 || name[col->name_bytes - 1] != '\0') {
+    return -1;
+  }
+  uint64_t length = col->kind == IGRAPH_ATTRIBUTE_VERTEX ? (uint64_t) igraph_vcount(graph)
+    : col->kind == IGRAPH_ATTRIBUTE_EDGE ? (uint64_t) igraph_ecount(graph)
+    : col->kind == IGRAPH_ATTRIBUTE_GRAPH ? 1 : 0;
+  if (col->length != length) {
+    return -1;
+  }
+  if (col->type == IGRAPH_ATTRIBUTE_NUMERIC) {
+    const igraph_real_t *data = (const igraph_real_t*) take(r, length, sizeof(igraph_real_t));
+    if (data == NULL) {
+      return -1;
+    }
+    igraph_vector_t v;
+    igraph_vector_view(&v, data, length);
+    if (col->kind == IGRAPH_ATTRIBUTE_VERTEX) { SETVANV(graph, name, &v); }
+    else if (col->kind == IGRAPH_ATTRIBUTE_EDGE) { SETEANV(graph, name, &v); }
+    else { SETGAN(graph, name, data[0]); }
+  } else if (col->type == IGRAPH_ATTRIBUTE_STRING) {
+    igraph_strvector_t v;
+    if (take_strings(r, length, &v) != 0) {
+      return -1;
+    }
+    if (col->kind == IGRAPH_ATTRIBUTE_VERTEX) { SETVASV(graph, name, &v); }
+    else if (col->kind == IGRAPH_ATTRIBUTE_EDGE) { SETEASV(graph, name, &v); }
+    else { SETGAS(graph, name, STR(v, 0)); }
+    igraph_strvector_destroy(&v);
+  } else if (col->type == IGRAPH_ATTRIBUTE_BOOLEAN) {
+    const uint8_t *data = (const uint8_t*) take(r, length, 1);
+    if (data == NULL) {
+      return -1;
+    }
+    igraph_vector_bool_t v;
+    igraph_vector_bool_init(&v, length);
+    for (uint64_t i=0; i<length; i++) {
+      VECTOR(v)[i] = data[i] != 0;
+    }
+    if (col->kind == IGRAPH_ATTRIBUTE_VERTEX) { SETVABV(graph, name, &v); }
+    else if (col->kind == IGRAPH_ATTRIBUTE_EDGE) { SETEABV(graph, name, &v); }
+    else { SETGAB(graph, name, VECTOR(v)[0]); }
+    igraph_vector_bool_destroy(&v);
+  } else {
+    return -1;
+  }
+  return 0;
+}
+
+/** Builds the graph from a mapped snapshot whose header has been checked. */
+static int read_snapshot(const struct SnapshotHeader *header, const char *payload,
+                         igraph_t *graph) {
+  struct SnapshotReader r = {payload, payload + header->payload, false};
+  if (header->nodes > MAX_USER_NODES || header->edges > MAX_USER_EDGES) {
+    return -1;
+  }
+  const igraph_real_t *edges = (const igraph_real_t*) take(&r, 2 * header->edges,
+                                                         sizeof(igraph_real_t));
+  if (edges == NULL) {
+    return -1;
+  }
+  /* igraph_create reports bad vertex ids through the error handler */
+  for (uint64_t i=0; i<2*header->edges; i++) {
+    if (!(edges[i] >= 0 && edges[i] < header->nodes && edges[i] == floor(edges[i]))) {
+      return -1;
+    }
+  }
+  igraph_vector_t el;
+  igraph_vector_view(&el, edges, 2 * header->edges);
+  igraph_create(graph, &el, header->nodes, header->directed != 0);
+  for (uint32_t c=0; c<header->columns; c++) {
+    if (take_column(&r, graph) != 0) {
+      igraph_destroy(graph);
+      return -1;
+    }
+  }
+  if (r.p != r.end) {
+    igraph_destroy(graph);
+    return -1;
+  }
+  return 0;
+}
+
+/** Loads a snapshot file through a memory map.
+
+ @param filename - the file to read.
+ @param graph - an uninitialized graph, initialized only on success.
+ @param metrics - receives the fingerprint of the stored analysis, or 0.
+ May be NULL.
+ @param verify - also check the payload against the stored checksum.
+ @return 0 on success, SNAPSHOT_NONE if the file is not a snapshot, or -1
+ if it cannot be read, is malformed (or fails the checksum), or was written
+ by another version or byte order.
+ */
+int load_snapshot(const char *filename, igraph_t *graph, uint64_t *metrics, bool verify) {
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0) {
+    return -1;
+  }
+  struct stat st_file;
+  char magic[8];
+  if (fstat(fd, &st_file) != 0 || st_file.st_size < (off_t) sizeof(magic)
+      || read(fd, magic, sizeof(magic)) != sizeof(magic)
+      || memcmp(magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0) {
+    close(fd);
+    return SNAPSHOT_NONE;
+  }
+  size_t size = st_file.st_size;
+  if (size < sizeof(struct SnapshotHeader)) {
+    close(fd);
+    return -1;
+  }
+  char *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    return -1;
+  }
+  madvise(map, size, MADV_SEQUENTIAL);
+  const struct SnapshotHeader *header = (const struct SnapshotHeader*) map;
+  const char *payload = map + sizeof(struct SnapshotHeader);
+  int result = -1;
+  if (header->version == SNAPSHOT_VERSION && header->endian == SNAPSHOT_ENDIAN_CHECK
+      && header->payload == size - sizeof(struct SnapshotHeader)) {
+    struct Checksum ck;
+    checksum_init(&ck);
+    if (verify) {
+      checksum_update(&ck, payload, header->payload);
+    }
+    if (!verify || checksum_final(&ck) == header->checksum) {
+      result = read_snapshot(header, payload, graph);
+    }
+  }
+  if (result == 0 && metrics != NULL) {
+    *metrics = header->metrics;
+  }
+  munmap(map, size);
+  return result;
+}
+
+/** Runs "graphpass convert": writes the loaded graph to a snapshot.
+
+ With --cache the analysis is restored from the metric cache, or computed
+ and cached, and stored in the snapshot as well.
+
+ @param path - the snapshot file to write.
+ @return 0 unless an error occurs.
+ */
+int convert_graph(char *path) {
+  bool metrics = false;
+  if (ug_CACHE != NULL) {
+    if (load_metric_cache(&g, ug_CACHE) != 0) {
+      analysis_planned(&g, PLAN_ANALYSIS_ALL);
+      save_metric_cache(&g, ug_CACHE);
+    }
+    metrics = true;
+  }
+  igraph_t check;
+  if (save_snapshot(&g, path, metrics) != 0) {
+    if (!ug_TEST) {
+      fprintf(stderr, ">>> FAILURE - Could not write snapshot %s.\n", path);
+    }
+    return -1;
+  }
+  /* loads skip the checksum, so check it once here */
+  if (load_snapshot(path, &check, NULL, true) != 0) {
+    if (!ug_TEST) {
+      fprintf(stderr, ">>> FAILURE - Snapshot %s did not read back.\n", path);
+    }
+    remove(path);
+    return -1;
+  }
+  igraph_destroy(&check);
+  if (ug_verbose == true) {
+    printf("Wrote snapshot %s\n", path);
+  }
+  return 0;
+}
@@ -0,0 +1,343 @@
+/*
+ * GraphPass:
+ * A utility to filter networks and provide a default visualization output
+ * for Gephi or SigmaJS.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** @file view.c
+ @brief A filtered graph as a keep-mask over its parent.
+
+ A GraphView is the subgraph left once the cut vertices of a parent graph
+ are removed, without building it: the vertices that remain keep their
+ order and are numbered 0 to vcount - 1, and an edge is in the view when
+ both of its ends are.  Degrees, density, reciprocity and degree
+ centralization are read from the parent's adjacency through the mask,
+ giving exactly what igraph computes on the subgraph, so runs that need
+ nothing else (sweeps and report-less comparisons) never build one.
+
+ Everything else (layout, walktrap, the iterative centralities, path
+ lengths and the writers) needs an igraph_t, and view_materialize builds
+ one from the kept edges in their original order, copying only the kept
+ values of the attributes the run writes.  The result is the graph
+ igraph_copy and igraph_delete_vertices would give, without the full
+ second copy.
+
+ All of a view's arrays come from ug_scratch and are given back with the
+ caller's arena_release.
+ */
+
+#include <graphpass.h>
+
+/** Builds the view of parent with the vertices in cut removed.
+
+ @param view - the view to fill.
+ @param parent - the graph to view; it must outlive the view.
+ @param cut - the vertex ids to remove; out of range ids are ignored.
+ @param cutsize - the number of entries in cut.
+ @return 0, or -1 if scratch space runs out.
+ */
+int view_init(struct GraphView *view, const igraph_t *parent, const double *cut, long cutsize) {
+  long n = igraph_vcount(parent);
+  long m = igraph_ecount(parent);
+  view->parent = parent;
+  view->index = arena_alloc(&ug_scratch, (n > 0 ? n : 1) * sizeof(long));
+  view->parent_of = arena_alloc(&ug_scratch, (n > 0 ? n : 1) * sizeof(long));
+  if (view->index == NULL || view->parent_of == NULL) {
+    return -1;
+  }
+  for (long i=0; i<n; i++) {
+    view->index[i] = 0;
+  }
+  for (long i=0; i<cutsize; i++) {
+    if (cut[i] >= 0 && cut[i] < n) {
+      view->index[(long) cut[i]] = -1;
+    }
+  }
+  view->vcount = 0;
+  for (long i=0; i<n; i++) {
+    if (view->index[i] == 0) {
+      view->parent_of[view->vcount] = i;
+      view->index[i] = view->vcount++;
+    }
+  }
+  view->ecount = 0;
+  for (long e=0; e<m; e++) {
+    igraph_integer_t from, to;
+    igraph_edge(parent, e, &from, &to);
+    if (view->index[from] >= 0 && view->index[to] >= 0) {
+      ++view->ecount;
+    }
+  }
+  return 0;
+}
+
+/** Counts the degree of each vertex of a view, as igraph_degree with
+ IGRAPH_NO_LOOPS does on the subgraph.
+
+ @param view - the view.
+ @param mode - IGRAPH_OUT, IGRAPH_IN or IGRAPH_ALL; ignored if undirected.
+ @param res - an initialized vector, resized to vcount.
+ @return 0 unless an error occurs.
+ */
+int view_degree(const struct GraphView *view, igraph_neimode_t mode, igraph_vector_t *res) {
+  long m = igraph_ecount(view->parent);
+  if (!igraph_is_directed(view->parent)) {
+    mode = IGRAPH_ALL;
+  }
+  IGRAPH_CHECK(igraph_vector_resize(res, view->vcount));
+  igraph_vector_null(res);
+  for (long e=0; e<m; e++) {
+    igraph_integer_t from, to;
+    igraph_edge(view->parent, e, &from, &to);
+    long a = view->index[from];
+    long b = view->index[to];
+    if (a < 0 || b < 0 || a == b) {
+      continue;
+    }
+    if (mode & IGRAPH_OUT) {
+      VECTOR(*res)[a] += 1;
+    }
+    if (mode & IGRAPH_IN) {
+      VECTOR(*res)[b] += 1;
+    }
+  }
+  return 0;
+}
+
+/** The density of a view, as igraph_density without loops. */
+igraph_real_t view_density(const struct GraphView *view) {
+  igraph_real_t nodes = view->vcount;
+  igraph_real_t edges = view->ecount;
+  if (view->vcount < 2) {
+    return NAN;
+  }
+  if (igraph_is_directed(view->parent)) {
+    return edges / nodes / (nodes - 1);
+  }
+  return edges / nodes * 2.0 / (nodes - 1);
+}
+
+/** Copies the neighbours of a parent vertex that are in the view, as view
+ ids.  igraph lists neighbours sorted, and the view keeps their order. */
+static void view_neighbors(const struct GraphView *view, long vid, igraph_neimode_t mode,
+                           igraph_vector_t *neis) {
+  igraph_neighbors(view->parent, neis, vid, mode);
+  long kept = 0;
+  for (long i=0; i<igraph_vector_size(neis); i++) {
+    long j = view->index[(long) VECTOR(*neis)[i]];
+    if (j >= 0) {
+      VECTOR(*neis)[kept++] = j;
+    }
+  }
+  igraph_vector_resize(neis, kept);
+}
+
+/** The reciprocity of a view, as igraph_reciprocity ignoring loops with
+ IGRAPH_RECIPROCITY_DEFAULT: the share of edges whose reverse is present. */
+igraph_real_t view_reciprocity(const struct GraphView *view) {
+  if (!igraph_is_directed(view->parent)) {
+    return 1.0;
+  }
+  igraph_vector_t in, out;
+  long rec = 0, loops = 0;
+  igraph_vector_init(&in, 0);
+  igraph_vector_init(&out, 0);
+  for (long v=0; v<view->vcount; v++) {
+    long vid = view->parent_of[v];
+    view_neighbors(view, vid, IGRAPH_IN, &in);
+    view_neighbors(view, vid, IGRAPH_OUT, &out);
+    long ip = 0, op = 0;
+    while (ip < igraph_vector_size(&in) && op < igraph_vector_size(&out)) {
+      if (VECTOR(in)[ip] < VECTOR(out)[op]) {
+        ++ip;
+      } else if (VECTOR(in)[ip] > VECTOR(out)[op]) {
+        ++op;
+      } else {
+        if (VECTOR(in)[ip] == v) {
+          ++loops;
+        } else {
+          ++rec;
+        }
+        ++ip;
+        ++op;
+      }
+    }
+  }
+  igraph_vector_destroy(&in);
+  igraph_vector_destroy(&out);
+  return (igraph_real_t) rec / (view->ecount - loops);
+}
+
+/** Degree centralization of a view from its degrees, as centralization()
+ computes it on the subgraph. */
+igraph_real_t view_centralization(const struct GraphView *view, igraph_vector_t *scores) {
+  int directed = igraph_is_directed(view->parent) ? 1 : 2;
+  int maximum = (int) (view->vcount * (view->vcount - 1)) / directed;
+  return igraph_centralization(scores, maximum, 1);
+}
+
+/** Copies the values of one attribute at the kept positions.
+
+ @param kind - IGRAPH_ATTRIBUTE_GRAPH, IGRAPH_ATTRIBUTE_VERTEX or
+ IGRAPH_ATTRIBUTE_EDGE.
+ @param keep - the parent position of each value to copy, or NULL for a
+ graph attribute.
+ @param count - the number of values to copy.
+ */
+static int copy_attribute(const igraph_t *from, igraph_t *to, const char *name,
+                          igraph_attribute_elemtype_t kind, igraph_attribute_type_t type,
+                          const long *keep, long count) {
+  bool vertex = (kind == IGRAPH_ATTRIBUTE_VERTEX);
+  if (kind == IGRAPH_ATTRIBUTE_GRAPH) {
+    if (type == IGRAPH_ATTRIBUTE_NUMERIC) {
+      SETGAN(to, name, GAN(from, name));
+    } else if (type == IGRAPH_ATTRIBUTE_STRING) {
+      SETGAS(to, name, GAS(from, name));
+    } else if (type == IGRAPH_ATTRIBUTE_BOOLEAN) {
+      SETGAB(to, name, GAB(from, name));
+    }
+    return 0;
+  }
+  if (type == IGRAPH_ATTRIBUTE_NUMERIC) {
+    igraph_vector_t all;
+    igraph_vector_init(&all, 0);
+    if (vertex) { VANV(from, name, &all); } else { EANV(from, name, &all); }
+    for (long i=0; i<count; i++) {
+      VECTOR(all)[i] = VECTOR(all)[keep[i]];
+    }
+    igraph_vector_resize(&all, count);
+    if (vertex) { SETVANV(to, name, &all); } else { SETEANV(to, name, &all); }
+    igraph_vector_destroy(&all);
+  } else if (type == IGRAPH_ATTRIBUTE_STRING) {
+    igraph_strvector_t all, kept;
+    igraph_strvector_init(&all, 0);
+    igraph_strvector_init(&kept, count);
+    if (vertex) { VASV(from, name, &all); } else { EASV(from, name, &all); }
+    for (long i=0; i<count; i++) {
+      igraph_strvector_set(&kept, i, STR(all, keep[i]));
+    }
+    igraph_strvector_destroy(&all);
+    if (vertex) { SETVASV(to, name, &kept); } else { SETEASV(to, name, &kept); }
+    igraph_strvector_destroy(&kept);
+  } else if (type == IGRAPH_ATTRIBUTE_BOOLEAN) {
+    igraph_vector_bool_t all;
+    igraph_vector_bool_init(&all, 0);
+    if (vertex) { VABV(from, name, &all); } else { EABV(from, name, &all); }
+    for (long i=0; i<count; i++) {
+      VECTOR(all)[i] = VECTOR(all)[keep[i]];
+    }
+    igraph_vector_bool_resize(&all, count);
+    if (vertex) { SETVABV(to, name, &all); } else { SETEABV(to, name, &all); }
+    igraph_vector_bool_destroy(&all);
+  }
+  return 0;
+}
+
+/** Builds the subgraph a view stands for, with packed node ids either
+ copied as they are or turned into the "id" string attribute. */
+static int materialize(const struct GraphView *view, igraph_t *res, const char *attrs,
+                       bool unpack) {
+  const igraph_t *parent = view->parent;
+  long m = igraph_ecount(parent);
+  igraph_vector_t edges;
+  struct ArenaMark mark = arena_mark(&ug_scratch);
+  long *kept = arena_alloc(&ug_scratch, (view->ecount > 0 ? view->ecount : 1) * sizeof(long));
+  if (kept == NULL || arena_vector(&ug_scratch, &edges, 2 * view->ecount) != 0) {
+    arena_release(&ug_scratch, mark);
+    return -1;
+  }
+  long count = 0;
+  for (long e=0; e<m; e++) {
+    igraph_integer_t from, to;
+    igraph_edge(parent, e, &from, &to);
+    if (view->index[from] >= 0 && view->index[to] >= 0) {
+      VECTOR(edges)[2 * count] = view->index[from];
+      VECTOR(edges)[2 * count + 1] = view->index[to];
+      kept[count++] = e;
+    }
+  }
+  igraph_create(res, &edges, view->vcount, igraph_is_directed(parent));
+  igraph_strvector_t gnames, vnames, enames;
+  igraph_vector_t gtypes, vtypes, etypes;
+  igraph_strvector_init(&gnames, 0);
+  igraph_strvector_init(&vnames, 0);
+  igraph_strvector_init(&enames, 0);
+  igraph_vector_init(&gtypes, 0);
+  igraph_vector_init(&vtypes, 0);
+  igraph_vector_init(&etypes, 0);
+  igraph_cattribute_list(parent, &gnames, &gtypes, &vnames, &vtypes, &enames, &etypes);
+  for (long i=0; i<igraph_strvector_size(&gnames); i++) {
+    copy_attribute(parent, res, STR(gnames, i), IGRAPH_ATTRIBUTE_GRAPH,
+                   (igraph_attribute_type_t) VECTOR(gtypes)[i], NULL, 1);
+  }
+  bool ids = false;
+  for (long i=0; i<igraph_strvector_size(&vnames); i++) {
+    if (!attr_wanted(attrs, STR(vnames, i), IGRAPH_ATTRIBUTE_VERTEX)) {
+      continue;
+    }
+    if (unpack && is_node_key_attr(STR(vnames, i))) {
+      /* "id" goes where the first column of the packed ids is */
+      if (!ids) {
+        copy_node_ids(parent, res, view->parent_of, view->vcount);
+        ids = true;
+      }
+    } else {
+      copy_attribute(parent, res, STR(vnames, i), IGRAPH_ATTRIBUTE_VERTEX,
+                     (igraph_attribute_type_t) VECTOR(vtypes)[i], view->parent_of, view->vcount);
+    }
+  }
+  for (long i=0; i<igraph_strvector_size(&enames); i++) {
+    if (attr_wanted(attrs, STR(enames, i), IGRAPH_ATTRIBUTE_EDGE)) {
+      copy_attribute(parent, res, STR(enames, i), IGRAPH_ATTRIBUTE_EDGE,
+                     (igraph_attribute_type_t) VECTOR(etypes)[i], kept, count);
+    }
+  }
+  igraph_strvector_destroy(&gnames);
+  igraph_strvector_destroy(&vnames);
+  igraph_strvector_destroy(&enames);
+  igraph_vector_destroy(&gtypes);
+  igraph_vector_destroy(&vtypes);
+  igraph_vector_destroy(&etypes);
+  arena_release(&ug_scratch, mark);
+  return 0;
+}
+
+/** Builds the subgraph a view stands for.
+
+ Vertices and edges keep their parent order, graph attributes are copied,
+ and vertex and edge attributes are copied if attrs keeps them (see
+ attr_wanted), so the graph matches igraph_copy, attribute deletion and
+ igraph_delete_vertices on the parent.
+
+ @param view - the view.
+ @param res - an uninitialized graph to build.
+ @param attrs - the attribute list of the run.
+ @return 0, or -1 if scratch space runs out.
+ */
+int view_materialize(const struct GraphView *view, igraph_t *res, const char *attrs) {
+  return materialize(view, res, attrs, false);
+}
+
+/** Builds the graph a writer formats: view_materialize, with packed node
+ ids turned back into the "id" string attribute (see ids.c).
+
+ @param view - the view.
+ @param res - an uninitialized graph to build.
+ @param attrs - the attribute list of the output.
+ @return 0, or -1 if scratch space runs out.
+ */
+int view_output(const struct GraphView *view, igraph_t *res, const char *attrs) {
+  return materialize(view, res, attrs, true);
+}
@@ -37,9 +37,12 @@ extern int colors (igraph_t *graph) {
   igraph_vector_init(&r, gsize);
   igraph_vector_init(&g, gsize);
   igraph_vector_init(&b, gsize);
+  igraph_vector_t membership;
+  igraph_vector_init(&membership, gsize);
+  VANV(graph, attr, &membership);
   /* Set RGB values based on WalkTrapModularity membership */
   for (long int i=0; i<gsize; i++) {
-    switch ((int)VAN(graph, attr, i)) {
+    switch ((int)VECTOR(membership)[i]) {
       case 0 :
         VECTOR(r)[i] = 35;
         VECTOR(g)[i] = 217;
@@ -109,6 +112,7 @@ extern int colors (igraph_t *graph) {
   igraph_vector_destroy(&r);
   igraph_vector_destroy(&g);
   igraph_vector_destroy(&b);
+  igraph_vector_destroy(&membership);
   return 0;
 }
 
@@ -0,0 +1,172 @@
+/*
+ * GraphPass:
+ * A utility to filter networks and provide a default visualization output
+ * for Gephi or SigmaJS.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** @file writeq.c
+ @brief Writes output files on a background thread (--write-queue).
+
+ write_graph formats each filtered graph into memory, which needs igraph
+ and so stays on the filtering thread, and hands the text to this queue.
+ A writer thread creates, compresses and closes the files while the next
+ method is filtered and analyzed.  At most ug_write_queue files are held
+ in memory: write_queue_push blocks until the writer has finished one.
+
+ Writes that fail are counted, and write_queue_finish reports them, so a
+ failure still reaches the exit status.
+ */
+
+#include <graphpass.h>
+
+/** One formatted file waiting to be written. */
+struct WriteJob {
+  char *path;
+  char *data;
+  size_t size;
+  struct WriteJob *next;
+};
+
+static pthread_mutex_t queue_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t queue_changed = PTHREAD_COND_INITIALIZER;
+static struct WriteJob *queue_head = NULL;
+static struct WriteJob *queue_tail = NULL;
+static long in_flight = 0; /**< queued jobs plus the one being written. */
+static int failures = 0;
+static bool closing = false;
+static bool started = false;
+static pthread_t writer;
+
+/** Writes data to path, compressed as ug_compress asks.
+
+ @return 0, or -1 if the file could not be created or written.
+ */
+static int write_output_file(const char *path, const char *data, size_t size) {
+  struct CompressStream cs;
+  FILE *fp = open_output(path, &cs);
+  int result = 0;
+  if (fp == NULL) {
+    return -1;
+  }
+  if (size > 0 && fwrite(data, 1, size, fp) != size) {
+    result = -1;
+  }
+  if (close_output(fp, &cs) != 0) {
+    result = -1;
+  }
+  return result;
+}
+
+static void* write_worker(void *arg) {
+  pthread_mutex_lock(&queue_lock);
+  while (true) {
+    while (queue_head == NULL && !closing) {
+      pthread_cond_wait(&queue_changed, &queue_lock);
+    }
+    if (queue_head == NULL) {
+      break;
+    }
+    struct WriteJob *job = queue_head;
+    queue_head = job->next;
+    if (queue_head == NULL) {
+      queue_tail = NULL;
+    }
+    pthread_mutex_unlock(&queue_lock);
+    int result = write_output_file(job->path, job->data, job->size);
+    if (result != 0 && !ug_TEST) {
+      fprintf(stderr, ">>> FAILURE - Could not write output to %s.\n", job->path);
+    }
+    free(job->path);
+    free(job->data);
+    free(job);
+    pthread_mutex_lock(&queue_lock);
+    if (result != 0) {
+      ++failures;
+    }
+    --in_flight;
+    pthread_cond_broadcast(&queue_changed);
+  }
+  pthread_mutex_unlock(&queue_lock);
+  return NULL;
+}
+
+/** Hands a formatted file to the writer thread.
+
+ Blocks while ug_write_queue files are already in flight.  If the thread
+ cannot be started the file is written before returning.
+
+ @param path - the file to write; it is copied.
+ @param data - the file contents, malloc'd; the queue frees it.
+ @param size - the number of bytes in data.
+ @return 0, or -1 if the file had to be written here and that failed.
+ */
+int write_queue_push(const char *path, char *data, size_t size) {
+  struct WriteJob *job = (struct WriteJob*) malloc(sizeof(struct WriteJob));
+  char *copy = strdup(path);
+  pthread_mutex_lock(&queue_lock);
+  if (!started && job != NULL && copy != NULL) {
+    closing = false;
+    started = (pthread_create(&writer, NULL, write_worker, NULL) == 0);
+  }
+  if (!started || job == NULL || copy == NULL) {
+    pthread_mutex_unlock(&queue_lock);
+    free(job);
+    free(copy);
+    int result = write_output_file(path, data, size);
+    free(data);
+    return result;
+  }
+  while (in_flight >= (ug_write_queue > 0 ? ug_write_queue : 1)) {
+    pthread_cond_wait(&queue_changed, &queue_lock);
+  }
+  job->path = copy;
+  job->data = data;
+  job->size = size;
+  job->next = NULL;
+  if (queue_tail != NULL) {
+    queue_tail->next = job;
+  } else {
+    queue_head = job;
+  }
+  queue_tail = job;
+  ++in_flight;
+  pthread_cond_broadcast(&queue_changed);
+  pthread_mutex_unlock(&queue_lock);
+  return 0;
+}
+
+/** Waits for every queued file to be written and stops the writer thread.
+
+ Call before forking, so a child does not inherit the queue, and before
+ the process exits.
+
+ @return the number of files that failed to write since the last call.
+ */
+int write_queue_finish() {
+  pthread_mutex_lock(&queue_lock);
+  if (started) {
+    closing = true;
+    pthread_cond_broadcast(&queue_changed);
+    pthread_mutex_unlock(&queue_lock);
+    pthread_join(writer, NULL);
+    pthread_mutex_lock(&queue_lock);
+    started = false;
+    closing = false;
+  }
+  int failed = failures;
+  failures = 0;
+  pthread_mutex_unlock(&queue_lock);
+  return failed;
+}
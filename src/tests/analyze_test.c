@@ -73,6 +73,45 @@ void TEST_BETWEENNESS_ALGORITHM() {
   igraph_vector_destroy(&bet);
 }
 
+void TEST_BETWEENNESS_APPROX() {
+  igraph_t path;
+  igraph_vector_t bet;
+  igraph_ring(&path, 5, IGRAPH_UNDIRECTED, 0, 0);
+  TEST_ASSERT_EQUAL_INT(-1, parse_betweenness_mode("approx:0"));
+  TEST_ASSERT_EQUAL_INT(-1, parse_betweenness_mode("eps:2"));
+  TEST_ASSERT_EQUAL_INT(0, parse_betweenness_mode("eps:0.5"));
+  TEST_ASSERT_EQUAL_INT(5, betweenness_samples(&path));
+  TEST_ASSERT_EQUAL_INT(0, parse_betweenness_mode("approx:3"));
+  TEST_ASSERT_EQUAL_INT(3, betweenness_samples(&path));
+  calc_betweenness(&path);
+  igraph_vector_init(&bet, 0);
+  VANV(&path, "Betweenness", &bet);
+  /* the ends of a path are never between two other nodes */
+  TEST_ASSERT_EQUAL_FLOAT(0.0, VECTOR(bet)[0]);
+  TEST_ASSERT_EQUAL_FLOAT(0.0, VECTOR(bet)[4]);
+  TEST_ASSERT_TRUE(VECTOR(bet)[2] > 0);
+  parse_betweenness_mode("exact");
+  calc_betweenness(&path);
+  VANV(&path, "Betweenness", &bet);
+  TEST_ASSERT_EQUAL_FLOAT(4.0, VECTOR(bet)[2]);
+  igraph_vector_destroy(&bet);
+  igraph_destroy(&path);
+}
+
+void TEST_ANF_DISTANCES() {
+  igraph_real_t exact, avg, effective;
+  igraph_integer_t diameter, lower;
+  igraph_average_path_length(&g, &exact, 1, 1);
+  igraph_diameter(&g, &diameter, NULL, NULL, NULL, 1, 1);
+  TEST_ASSERT_EQUAL_INT(-1, parse_distance_mode("anf:99"));
+  TEST_ASSERT_EQUAL_INT(0, parse_distance_mode("anf:10"));
+  anf_path_stats(&g, ug_anf_bits, &avg, &effective, &lower, NULL);
+  TEST_ASSERT_FLOAT_WITHIN(0.1 * exact, exact, avg);
+  TEST_ASSERT_TRUE(lower <= diameter);
+  TEST_ASSERT_TRUE(effective <= lower);
+  parse_distance_mode("exact");
+}
+
 void TEST_AUTHORITY_ALGORITHM() {
   calc_authority(&g);
   igraph_vector_t aut;
@@ -153,6 +192,281 @@ void TEST_RANKORDER() {
   igraph_vector_destroy(&ranks);
 }
 
+void TEST_RANK_TIES() {
+  igraph_vector_t test, dense, fractional, ranks;
+  igraph_vector_init(&test, 6);
+  igraph_vector_init(&dense, 6);
+  igraph_vector_init(&fractional, 6);
+  igraph_vector_init(&ranks, 0);
+  VECTOR(test)[0] = 5; VECTOR(test)[1] = 9;
+  VECTOR(test)[2] = 5; VECTOR(test)[3] = 1;
+  VECTOR(test)[4] = 9; VECTOR(test)[5] = 5;
+  VECTOR(dense)[0] = 2.0; VECTOR(dense)[1] = 1.0;
+  VECTOR(dense)[2] = 2.0; VECTOR(dense)[3] = 3.0;
+  VECTOR(dense)[4] = 1.0; VECTOR(dense)[5] = 2.0;
+  VECTOR(fractional)[0] = 4.0; VECTOR(fractional)[1] = 1.5;
+  VECTOR(fractional)[2] = 4.0; VECTOR(fractional)[3] = 6.0;
+  VECTOR(fractional)[4] = 1.5; VECTOR(fractional)[5] = 4.0;
+  rank_vector(&test, &ranks, RANK_DENSE);
+  TEST_ASSERT_TRUE(igraph_vector_all_e(&ranks, &dense));
+  rank_vector(&test, &ranks, RANK_FRACTIONAL);
+  TEST_ASSERT_TRUE(igraph_vector_all_e(&ranks, &fractional));
+  rank_vector(&test, &ranks, RANK_COMPETITION);
+  TEST_ASSERT_EQUAL_FLOAT(VECTOR(ranks)[0], 3.0);
+  TEST_ASSERT_EQUAL_FLOAT(VECTOR(ranks)[3], 6.0);
+  igraph_vector_destroy(&test);
+  igraph_vector_destroy(&dense);
+  igraph_vector_destroy(&fractional);
+  igraph_vector_destroy(&ranks);
+}
+
+void TEST_RANK_ATTRIBUTE() {
+  calc_pagerank(&g);
+  rank_attribute(&g, "PageRank", RANK_COMPETITION);
+  igraph_vector_t pr, ranks;
+  igraph_vector_init(&pr, 0);
+  igraph_vector_init(&ranks, 0);
+  VANV(&g, "PageRank", &pr);
+  VANV(&g, "PageRankRank", &ranks);
+  TEST_ASSERT_EQUAL_INT(igraph_vector_size(&pr), igraph_vector_size(&ranks));
+  for (long int i=0; i<igraph_vector_size(&pr); i++) {
+    long int higher = 0;
+    for (long int j=0; j<igraph_vector_size(&pr); j++) {
+      if (VECTOR(pr)[j] > VECTOR(pr)[i]) {
+        ++higher;
+      }
+    }
+    TEST_ASSERT_EQUAL_FLOAT(VECTOR(ranks)[i], higher + 1);
+  }
+  igraph_vector_destroy(&pr);
+  igraph_vector_destroy(&ranks);
+}
+
+/* rankCompare as it was before idref_index: a linear idRef search per vertex */
+static void linear_rank_compare(igraph_t *large, igraph_t *small, char *attribute,
+                                igraph_real_t *pv, igraph_real_t *ts) {
+  igraph_vector_t rank1, rank2, idRef1, idRef2;
+  igraph_vector_init(&rank1, igraph_vcount(small));
+  igraph_vector_init(&rank2, igraph_vcount(small));
+  igraph_vector_init(&idRef1, igraph_vcount(large));
+  igraph_vector_init(&idRef2, igraph_vcount(small));
+  VANV(small, attribute, &rank2);
+  VANV(large, "idRef", &idRef1);
+  VANV(small, "idRef", &idRef2);
+  int check = 0;
+  for (long int i=0; i<igraph_vector_size(&idRef1); i++) {
+    if (igraph_vector_contains(&idRef2, VECTOR(idRef1)[i])) {
+      VECTOR(rank1)[check] = VAN(large, attribute, i);
+      check++;
+    }
+  }
+  paired_t_stat(&rank1, &rank2, pv, ts);
+  igraph_vector_destroy(&idRef2);
+  igraph_vector_destroy(&idRef1);
+  igraph_vector_destroy(&rank2);
+  igraph_vector_destroy(&rank1);
+}
+
+void TEST_RANK_COMPARE() {
+  igraph_t g2;
+  igraph_vector_t idRef, cut;
+  igraph_vector_long_t index;
+  igraph_real_t pv, ts, linear_pv, linear_ts;
+  long int n = igraph_vcount(&g);
+  igraph_vector_init_seq(&idRef, 0, n-1);
+  SETVANV(&g, "idRef", &idRef);
+  calc_degree(&g, 'd');
+  rank_attribute(&g, "Degree", RANK_COMPETITION);
+  /* vertex 0 and a few others are missing from g2 */
+  igraph_vector_init(&cut, 4);
+  VECTOR(cut)[0] = 0; VECTOR(cut)[1] = 3;
+  VECTOR(cut)[2] = 50; VECTOR(cut)[3] = n-1;
+  igraph_copy(&g2, &g);
+  igraph_delete_vertices(&g2, igraph_vss_vector(&cut));
+  calc_degree(&g2, 'd');
+  rank_attribute(&g2, "Degree", RANK_COMPETITION);
+  TEST_ASSERT_EQUAL_INT(0, idref_index(&g2, n, &index));
+  TEST_ASSERT_EQUAL_INT(n, igraph_vector_long_size(&index));
+  TEST_ASSERT_EQUAL_INT(-1, VECTOR(index)[0]);
+  TEST_ASSERT_EQUAL_INT(0, VECTOR(index)[1]);
+  TEST_ASSERT_EQUAL_INT(-1, VECTOR(index)[3]);
+  TEST_ASSERT_EQUAL_INT(2, VECTOR(index)[4]);
+  TEST_ASSERT_EQUAL_INT(-1, VECTOR(index)[n-1]);
+  linear_rank_compare(&g, &g2, "DegreeRank", &linear_pv, &linear_ts);
+  /* with the index built by rankCompare, passed in, and in either order */
+  TEST_ASSERT_EQUAL_INT(0, rankCompare(&g, &g2, "Degree", NULL, &pv, &ts));
+  TEST_ASSERT_EQUAL_MEMORY(&linear_pv, &pv, sizeof(pv));
+  TEST_ASSERT_EQUAL_MEMORY(&linear_ts, &ts, sizeof(ts));
+  TEST_ASSERT_EQUAL_INT(0, rankCompare(&g, &g2, "Degree", &index, &pv, &ts));
+  TEST_ASSERT_EQUAL_MEMORY(&linear_pv, &pv, sizeof(pv));
+  TEST_ASSERT_EQUAL_MEMORY(&linear_ts, &ts, sizeof(ts));
+  TEST_ASSERT_EQUAL_INT(0, rankCompare(&g2, &g, "Degree", NULL, &pv, &ts));
+  TEST_ASSERT_EQUAL_MEMORY(&linear_pv, &pv, sizeof(pv));
+  TEST_ASSERT_EQUAL_MEMORY(&linear_ts, &ts, sizeof(ts));
+  igraph_vector_long_destroy(&index);
+  igraph_vector_destroy(&cut);
+  igraph_vector_destroy(&idRef);
+  igraph_destroy(&g2);
+}
+
+void TEST_PLANNER() {
+  metric_plan_t plan = plan_base("d", false, false, false);
+  TEST_ASSERT_TRUE(PLAN_HAS(plan, MET_DEGREE));
+  TEST_ASSERT_FALSE(PLAN_HAS(plan, MET_BETWEENNESS));
+  TEST_ASSERT_FALSE(PLAN_HAS(plan, MET_DEGREE_RANK));
+  plan = plan_base("p", false, false, true);
+  TEST_ASSERT_TRUE(PLAN_HAS(plan, MET_DEGREE_RANK));
+  TEST_ASSERT_TRUE(PLAN_HAS(plan, MET_DEGREE));
+  TEST_ASSERT_TRUE(plan_base(ALL_METHODS, false, true, false) == PLAN_ANALYSIS_ALL);
+  /* a saved GraphML file carries every column and graph value */
+  ug_format = FORMAT_GRAPHML;
+  TEST_ASSERT_TRUE(plan_base("d", true, false, false) == PLAN_ANALYSIS_ALL);
+  plan = plan_derivative(false, false, false);
+  TEST_ASSERT_TRUE(plan == 0);
+  plan = plan_derivative(true, false, false);
+  TEST_ASSERT_TRUE(plan == PLAN_DERIVATIVE_ALL);
+  TEST_ASSERT_TRUE(PLAN_HAS(plan, MET_AUTHORITY));
+  TEST_ASSERT_TRUE(PLAN_HAS(plan, MET_C_HUB));
+  TEST_ASSERT_TRUE(PLAN_HAS(plan, MET_PATH_LENGTH));
+  TEST_ASSERT_FALSE(PLAN_HAS(plan, MET_ASSORTATIVITY));
+  /* the graph values need the scores they are computed from */
+  ug_attrs = ATTRS_VIZ;
+  plan = plan_derivative(true, false, false);
+  TEST_ASSERT_TRUE(PLAN_HAS(plan, MET_C_AUTHORITY));
+  TEST_ASSERT_TRUE(PLAN_HAS(plan, MET_AUTHORITY));
+  /* SigmaJS and GEXF files hold no graph values */
+  ug_format = FORMAT_SIGMA;
+  plan = plan_derivative(true, false, false);
+  TEST_ASSERT_TRUE(PLAN_HAS(plan, MET_DEGREE));
+  TEST_ASSERT_TRUE(PLAN_HAS(plan, MET_MODULARITY));
+  TEST_ASSERT_FALSE(PLAN_HAS(plan, MET_BETWEENNESS));
+  TEST_ASSERT_FALSE(PLAN_HAS(plan, MET_PAGERANK));
+  TEST_ASSERT_FALSE(PLAN_HAS(plan, MET_AUTHORITY));
+  TEST_ASSERT_FALSE(PLAN_HAS(plan, MET_C_AUTHORITY));
+  TEST_ASSERT_FALSE(PLAN_HAS(plan, MET_PATH_LENGTH));
+  ug_format = FORMAT_GRAPHML;
+  ug_attrs = "viz,PageRank";
+  TEST_ASSERT_TRUE(PLAN_HAS(plan_derivative(true, false, false), MET_PAGERANK));
+  ug_attrs = NULL;
+  analysis_planned(&g, plan_base("d", false, false, false));
+  TEST_ASSERT_TRUE(igraph_cattribute_has_attr(&g, IGRAPH_ATTRIBUTE_VERTEX, "Degree"));
+  TEST_ASSERT_FALSE(igraph_cattribute_has_attr(&g, IGRAPH_ATTRIBUTE_GRAPH, "centralizationHub"));
+  TEST_ASSERT_TRUE(plan_missing(&g, PLAN(MET_DEGREE) | PLAN(MET_C_HUB)) == PLAN(MET_C_HUB));
+  SETGAN(&g, "centralizationHub", 0.5);
+  SETGAN(&g, "ASSORTATIVITY", 0.5);
+  plan_drop_stale(&g, PLAN(MET_DEGREE_ASSORTATIVITY));
+  TEST_ASSERT_FALSE(igraph_cattribute_has_attr(&g, IGRAPH_ATTRIBUTE_GRAPH, "centralizationHub"));
+  TEST_ASSERT_TRUE(igraph_cattribute_has_attr(&g, IGRAPH_ATTRIBUTE_GRAPH, "ASSORTATIVITY"));
+  DELGA(&g, "ASSORTATIVITY");
+}
+
+void TEST_COST_ESTIMATE() {
+  struct CostEstimate est;
+  double exact, sampled, bytes;
+  /* the run options this test changes, restored for the tests after it */
+  char *methods = ug_methods;
+  bool save = ug_save;
+  long jobs = ug_jobs, maxnodes = ug_maxnodes, bsamples = ug_bsamples;
+  double memory_budget = ug_memory_budget, time_budget = ug_time_budget;
+  betweenness_mode_t bmode = ug_bmode;
+  metric_cost(MET_BETWEENNESS, 1000, 5000, &exact, &bytes);
+  ug_bmode = BETWEENNESS_SAMPLE;
+  ug_bsamples = 10;
+  metric_cost(MET_BETWEENNESS, 1000, 5000, &sampled, &bytes);
+  ug_bmode = BETWEENNESS_EXACT;
+  TEST_ASSERT_TRUE(sampled * 10 < exact);
+  ug_methods = "dp";
+  ug_save = true;
+  ug_jobs = 1;
+  ug_maxnodes = 0;
+  ug_memory_budget = 0;
+  ug_time_budget = 0;
+  TEST_ASSERT_EQUAL_INT(0, cost_check(&g, "src/resources/cpp2.graphml", &est));
+  TEST_ASSERT_TRUE(est.seconds > 0);
+  TEST_ASSERT_TRUE(est.peak_bytes > graph_memory(&g));
+  /* load, the analysis, then a row per method */
+  TEST_ASSERT_EQUAL_STRING("load", est.rows[0].name);
+  TEST_ASSERT_EQUAL_STRING("filter PageRank", est.rows[est.count - 1].name);
+  ug_memory_budget = 1024;
+  TEST_ASSERT_EQUAL_INT(-1, cost_check(&g, "src/resources/cpp2.graphml", &est));
+  TEST_ASSERT_NOT_NULL(strstr(est.reason, "--memory-budget"));
+  ug_memory_budget = 0;
+  ug_time_budget = 1e-9;
+  TEST_ASSERT_EQUAL_INT(-1, cost_check(&g, "src/resources/cpp2.graphml", &est));
+  TEST_ASSERT_NOT_NULL(strstr(est.reason, "--time-budget"));
+  ug_time_budget = 0;
+  ug_maxnodes = 10;
+  TEST_ASSERT_EQUAL_INT(-1, cost_check(&g, "src/resources/cpp2.graphml", &est));
+  ug_methods = methods;
+  ug_save = save;
+  ug_jobs = jobs;
+  ug_maxnodes = maxnodes;
+  ug_bsamples = bsamples;
+  ug_bmode = bmode;
+  ug_memory_budget = memory_budget;
+  ug_time_budget = time_budget;
+}
+
+void TEST_ARENA() {
+  struct Arena arena = {0};
+  igraph_vector_t v;
+  TEST_ASSERT_EQUAL_INT(0, arena_reserve(&arena, 1024));
+  TEST_ASSERT_EQUAL_INT(1, arena.blocks);
+  char *first = arena_alloc(&arena, 10);
+  TEST_ASSERT_EQUAL_INT(0, (size_t) first % ARENA_ALIGN);
+  struct ArenaMark mark = arena_mark(&arena);
+  TEST_ASSERT_EQUAL_INT(0, arena_vector(&arena, &v, 100));
+  TEST_ASSERT_EQUAL_INT(100, igraph_vector_size(&v));
+  /* larger than the block: a second block, freed on release */
+  TEST_ASSERT_NOT_NULL(arena_alloc(&arena, 4 * ARENA_MIN_BLOCK));
+  TEST_ASSERT_EQUAL_INT(2, arena.blocks);
+  arena_release(&arena, mark);
+  TEST_ASSERT_EQUAL_INT(1, arena.blocks);
+  TEST_ASSERT_TRUE(arena_alloc(&arena, 10) == first + ARENA_ALIGN);
+  /* a reset keeps one block large enough for the peak */
+  arena_reset(&arena);
+  TEST_ASSERT_EQUAL_INT(1, arena.blocks);
+  TEST_ASSERT_TRUE(arena.reserved >= 4 * ARENA_MIN_BLOCK);
+  TEST_ASSERT_NOT_NULL(arena_alloc(&arena, 4 * ARENA_MIN_BLOCK));
+  TEST_ASSERT_EQUAL_INT(1, arena.blocks);
+  arena_free(&arena);
+  TEST_ASSERT_NULL(arena.head);
+}
+
+void TEST_GRAPH_VIEW() {
+  struct GraphView view;
+  igraph_t g2;
+  igraph_vector_t deg, ref;
+  igraph_real_t dens, recip;
+  double cut[] = {0, 3, 5, 3};
+  struct ArenaMark mark = arena_mark(&ug_scratch);
+  TEST_ASSERT_EQUAL_INT(0, view_init(&view, &g, cut, 4));
+  TEST_ASSERT_EQUAL_INT(igraph_vcount(&g) - 3, view.vcount);
+  TEST_ASSERT_EQUAL_INT(-1, view.index[3]);
+  TEST_ASSERT_EQUAL_INT(4, view.parent_of[view.index[4]]);
+  TEST_ASSERT_EQUAL_INT(0, view_materialize(&view, &g2, ATTRS_FULL));
+  TEST_ASSERT_EQUAL_INT(view.vcount, igraph_vcount(&g2));
+  TEST_ASSERT_EQUAL_INT(view.ecount, igraph_ecount(&g2));
+  TEST_ASSERT_EQUAL_STRING(VAS(&g, "label", 4), VAS(&g2, "label", view.index[4]));
+  /* the view gives what igraph does on the built graph */
+  igraph_vector_init(&deg, 0);
+  igraph_vector_init(&ref, 0);
+  view_degree(&view, IGRAPH_IN, &deg);
+  igraph_degree(&g2, &ref, igraph_vss_all(), IGRAPH_IN, IGRAPH_NO_LOOPS);
+  TEST_ASSERT_TRUE(igraph_vector_all_e(&deg, &ref));
+  view_degree(&view, IGRAPH_ALL, &deg);
+  igraph_degree(&g2, &ref, igraph_vss_all(), IGRAPH_ALL, IGRAPH_NO_LOOPS);
+  TEST_ASSERT_TRUE(igraph_vector_all_e(&deg, &ref));
+  igraph_density(&g2, &dens, 0);
+  TEST_ASSERT_EQUAL_FLOAT(dens, view_density(&view));
+  igraph_reciprocity(&g2, &recip, 1, IGRAPH_RECIPROCITY_DEFAULT);
+  TEST_ASSERT_EQUAL_FLOAT(recip, view_reciprocity(&view));
+  igraph_vector_destroy(&deg);
+  igraph_vector_destroy(&ref);
+  igraph_destroy(&g2);
+  arena_release(&ug_scratch, mark);
+}
+
 void TEST_MEAN() {
   igraph_vector_t test;
   igraph_vector_init(&test, 10);
@@ -32,7 +32,7 @@ void setUp() {
   ug_percent = 0.0;
   ug_DIRECTORY = "src/resources/";
   ug_OUTFILE = "file";
-  ug_gformat = true;
+  ug_format = FORMAT_GEXF;
 }
 
 void tearDown(void) {
@@ -44,3 +44,201 @@ void TEST_WRITE_GEXF() {
   TEST_ASSERT_TRUE(access("../TEST_OUT_FOLDER/file.gexf", F_OK ));
   TEST_ASSERT_TRUE(access("../TEST_OUT_FOLDER/file.gexf", R_OK ));
 }
+
+void TEST_ATTR_TABLE() {
+  load_graph("src/resources/cpp2.graphml");
+  struct AttrTable vtable, etable;
+  attr_table_init(&vtable, &g, IGRAPH_ATTRIBUTE_VERTEX);
+  attr_table_init(&etable, &g, IGRAPH_ATTRIBUTE_EDGE);
+  TEST_ASSERT_EQUAL_INT(igraph_vcount(&g), vtable.length);
+  TEST_ASSERT_NULL(attr_table_get(&vtable, "no-such-attribute"));
+  TEST_ASSERT_NULL(attr_table_numeric(&vtable, "label"));
+  igraph_strvector_t *labels = attr_table_string(&vtable, "label");
+  TEST_ASSERT_NOT_NULL(labels);
+  TEST_ASSERT_EQUAL_STRING(VAS(&g, "label", 0), STR(*labels, 0));
+  igraph_vector_t *weight = attr_table_numeric(&etable, "weight");
+  TEST_ASSERT_NOT_NULL(weight);
+  TEST_ASSERT_EQUAL_FLOAT(EAN(&g, "weight", igraph_ecount(&g) - 1),
+                          VECTOR(*weight)[igraph_ecount(&g) - 1]);
+  attr_table_destroy(&vtable);
+  attr_table_destroy(&etable);
+  igraph_destroy(&g);
+}
+
+void TEST_OUT_BUFFER() {
+  igraph_real_t values[] = {0, -0.0, 7, -42, 999999, 1e6, 0.5, 3.14159265, -1e-7, 1e20, NAN};
+  char expect[128];
+  struct OutBuffer buf;
+  for (unsigned long i=0; i<NELEMS(values); i++) {
+    out_buffer_init(&buf, NULL);
+    out_buffer_g(&buf, values[i]);
+    out_buffer_puts(&buf, "|");
+    out_buffer_f(&buf, values[i]);
+    out_buffer_write(&buf, "", 1);
+    snprintf(expect, sizeof(expect), "%g|%f", values[i], values[i]);
+    TEST_ASSERT_EQUAL_STRING(expect, buf.data);
+    out_buffer_destroy(&buf);
+  }
+  out_buffer_init(&buf, NULL);
+  out_buffer_long(&buf, -1234567);
+  TEST_ASSERT_EQUAL_INT(0, out_buffer_xml(&buf, " a.com & <b>"));
+  out_buffer_write(&buf, "", 1);
+  TEST_ASSERT_EQUAL_STRING("-1234567 a.com &amp; &lt;b&gt;", buf.data);
+  TEST_ASSERT_EQUAL_INT(0, out_buffer_destroy(&buf));
+}
+
+/** Reads back a whole output file. */
+static char* gexf_body(FILE *fp) {
+  long size = ftell(fp);
+  char *text = (char*) calloc(size + 1, 1);
+  rewind(fp);
+  TEST_ASSERT_EQUAL_INT(size, fread(text, 1, size, fp));
+  return text;
+}
+
+void TEST_WRITE_GEXF_THREADS() {
+  load_graph("src/resources/albertahealth.graphml");
+  igraph_vector_t v;
+  char *attrs[] = {"r", "g", "b", "size", "x", "y"};
+  igraph_vector_init_seq(&v, 0, igraph_vcount(&g) - 1);
+  for (unsigned long i=0; i<NELEMS(attrs); i++) {
+    SETVANV(&g, attrs[i], &v);
+  }
+  igraph_vector_destroy(&v);
+  char *body[2];
+  long threads[] = {1, 3};
+  for (int t=0; t<2; t++) {
+    FILE *fp = tmpfile();
+    ug_threads = threads[t];
+    TEST_ASSERT_EQUAL_INT(0, igraph_write_graph_gexf(&g, fp, 1));
+    body[t] = gexf_body(fp);
+    fclose(fp);
+  }
+  TEST_ASSERT_TRUE(strlen(body[0]) > 0);
+  TEST_ASSERT_EQUAL_STRING(strstr(body[0], "</meta>"), strstr(body[1], "</meta>"));
+  free(body[0]);
+  free(body[1]);
+  ug_threads = 0;
+  igraph_destroy(&g);
+}
+
+void TEST_WRITE_GRAPHML_THREADS() {
+  char *files[] = {"albertahealth", "anarchist", "cpp2", "idlenomore", "miserables"};
+  long threads[] = {1, 3};
+  char path[100];
+  for (unsigned long f=0; f<NELEMS(files); f++) {
+    snprintf(path, sizeof(path), "src/resources/%s.graphml", files[f]);
+    TEST_ASSERT_EQUAL_INT(0, load_graph(path));
+    /* every attribute type, on the graph too, NaNs and text to escape */
+    long n = igraph_vcount(&g);
+    igraph_vector_t third;
+    igraph_vector_bool_t even;
+    igraph_vector_init(&third, n);
+    igraph_vector_bool_init(&even, n);
+    for (long i=0; i<n; i++) {
+      VECTOR(third)[i] = i % 7 == 0 ? NAN : i / 3.0;
+      VECTOR(even)[i] = i % 2 == 0;
+    }
+    SETVANV(&g, "third", &third);
+    SETVABV(&g, "even", &even);
+    SETGAN(&g, "DENSITY", 0.125);
+    SETGAN(&g, "MISSING", NAN);
+    SETGAS(&g, "TITLE", "a & <b> \"c\"");
+    SETGAB(&g, "FILTERED", true);
+    igraph_vector_destroy(&third);
+    igraph_vector_bool_destroy(&even);
+    FILE *fp = tmpfile();
+    TEST_ASSERT_EQUAL_INT(0, igraph_write_graph_graphml(&g, fp, 1));
+    char *expected = gexf_body(fp);
+    fclose(fp);
+    for (int t=0; t<2; t++) {
+      fp = tmpfile();
+      ug_threads = threads[t];
+      TEST_ASSERT_EQUAL_INT(0, write_graph_graphml(&g, fp, 1));
+      char *body = gexf_body(fp);
+      fclose(fp);
+      TEST_ASSERT_EQUAL_STRING(expected, body);
+      free(body);
+    }
+    free(expected);
+    igraph_destroy(&g);
+  }
+  ug_threads = 0;
+}
+
+void TEST_WRITE_SIGMA() {
+  igraph_t graph;
+  igraph_i_set_attribute_table(&igraph_cattribute_table);
+  igraph_small(&graph, 3, IGRAPH_DIRECTED, 0, 1, 1, 2, -1);
+  SETVAS(&graph, "label", 0, "a.com");
+  SETVAS(&graph, "label", 1, "say \"hi\"\\");
+  SETVAS(&graph, "label", 2, "c.com");
+  for (long i=0; i<3; i++) {
+    SETVAN(&graph, "x", i, i * 1.5);
+    SETVAN(&graph, "y", i, -i);
+    SETVAN(&graph, "size", i, 10);
+    SETVAN(&graph, "r", i, 255);
+    SETVAN(&graph, "g", i, i);
+    SETVAN(&graph, "b", i, 0);
+    SETVAN(&graph, "PageRank", i, i == 1 ? NAN : 0.25);
+    SETVAN(&graph, "Degree", i, i);
+  }
+  SETEAN(&graph, "weight", 0, 2);
+  SETEAN(&graph, "weight", 1, 0.5);
+  FILE *fp = tmpfile();
+  TEST_ASSERT_EQUAL_INT(0, write_graph_sigma(&graph, fp, "PageRank,weight"));
+  char *text = gexf_body(fp);
+  fclose(fp);
+  TEST_ASSERT_EQUAL_STRING("{\"nodes\":[\n"
+    "{\"id\":\"n0\",\"label\":\"a.com\",\"x\":0,\"y\":0,\"size\":10,\"color\":\"rgb(255,0,0)\","
+    "\"attributes\":{\"PageRank\":0.25}},\n"
+    "{\"id\":\"n1\",\"label\":\"say \\\"hi\\\"\\\\\",\"x\":1.5,\"y\":-1,\"size\":10,"
+    "\"color\":\"rgb(255,1,0)\",\"attributes\":{}},\n"
+    "{\"id\":\"n2\",\"label\":\"c.com\",\"x\":3,\"y\":-2,\"size\":10,\"color\":\"rgb(255,2,0)\","
+    "\"attributes\":{\"PageRank\":0.25}}\n"
+    "],\"edges\":[\n"
+    "{\"id\":\"e0\",\"source\":\"n0\",\"target\":\"n1\",\"size\":2},\n"
+    "{\"id\":\"e1\",\"source\":\"n1\",\"target\":\"n2\",\"size\":0.5}\n"
+    "]}\n", text);
+  free(text);
+  igraph_destroy(&graph);
+}
+
+void TEST_PROJECT_ATTRIBUTES() {
+  load_graph("src/resources/cpp2.graphml");
+  igraph_vector_t v;
+  igraph_vector_init(&v, igraph_vcount(&g));
+  SETVANV(&g, "PageRank", &v);
+  SETVANV(&g, "Authority", &v);
+  SETVANV(&g, "x", &v);
+  igraph_vector_destroy(&v);
+  TEST_ASSERT_TRUE(attr_wanted(NULL, "Authority", IGRAPH_ATTRIBUTE_VERTEX));
+  TEST_ASSERT_TRUE(attr_wanted("viz,all", "Authority", IGRAPH_ATTRIBUTE_VERTEX));
+  TEST_ASSERT_TRUE(attr_wanted(ATTRS_VIZ, "weight", IGRAPH_ATTRIBUTE_EDGE));
+  TEST_ASSERT_FALSE(attr_wanted(ATTRS_VIZ, "weight", IGRAPH_ATTRIBUTE_VERTEX));
+  TEST_ASSERT_FALSE(attr_wanted("PageRankX", "PageRank", IGRAPH_ATTRIBUTE_VERTEX));
+  TEST_ASSERT_EQUAL_INT(-1, parse_attrs("viz,,PageRank"));
+  /* the copy is projected, and the packed ids of cpp2 are strings again */
+  igraph_t out;
+  TEST_ASSERT_EQUAL_INT(1, project_attributes(&g, &out, "viz,PageRank"));
+  TEST_ASSERT_TRUE(igraph_cattribute_has_attr(&out, IGRAPH_ATTRIBUTE_VERTEX, "label"));
+  TEST_ASSERT_TRUE(igraph_cattribute_has_attr(&out, IGRAPH_ATTRIBUTE_VERTEX, "x"));
+  TEST_ASSERT_TRUE(igraph_cattribute_has_attr(&out, IGRAPH_ATTRIBUTE_VERTEX, "PageRank"));
+  TEST_ASSERT_FALSE(igraph_cattribute_has_attr(&out, IGRAPH_ATTRIBUTE_VERTEX, "Authority"));
+  TEST_ASSERT_TRUE(igraph_cattribute_has_attr(&out, IGRAPH_ATTRIBUTE_EDGE, "weight"));
+  TEST_ASSERT_FALSE(has_node_keys(&out));
+  TEST_ASSERT_EQUAL_INT(igraph_ecount(&g), igraph_ecount(&out));
+  igraph_destroy(&out);
+  TEST_ASSERT_EQUAL_INT(1, project_attributes(&g, &out, ATTRS_FULL));
+  TEST_ASSERT_TRUE(igraph_cattribute_has_attr(&out, IGRAPH_ATTRIBUTE_VERTEX, "id"));
+  TEST_ASSERT_TRUE(igraph_cattribute_has_attr(&out, IGRAPH_ATTRIBUTE_VERTEX, "Authority"));
+  igraph_destroy(&out);
+  /* the graph itself is left as it was */
+  TEST_ASSERT_TRUE(igraph_cattribute_has_attr(&g, IGRAPH_ATTRIBUTE_VERTEX, "Authority"));
+  TEST_ASSERT_TRUE(has_node_keys(&g));
+  igraph_destroy(&g);
+  /* graphs with nothing to drop are written as they are */
+  load_graph("src/resources/albertahealth.graphml");
+  TEST_ASSERT_EQUAL_INT(0, project_attributes(&g, &out, ATTRS_FULL));
+  igraph_destroy(&g);
+}
@@ -23,6 +23,10 @@
 #include "graphpass.h"
 #include "unity.h"
 #include <math.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <signal.h>
 
 // Constants
 char samp[TEST_ARRAY_LENGTH][TEST_MAX_STRING_SIZE] = {
@@ -87,7 +91,7 @@ void TEST_WRITE_GRAPH() {
   ug_percent = 0.0;
   ug_DIRECTORY = "src/resources/";
   ug_OUTFILE = ug_FILENAME;
-  ug_gformat = false;
+  ug_format = FORMAT_GRAPHML;
   if (stat(ug_OUTPATH, &st) == -1) {
     mkdir(ug_OUTPATH, 0700);
   }
@@ -101,5 +105,662 @@ void TEST_WRITE_GRAPH() {
   int fail = write_graph(&graph, "hey");
   TEST_ASSERT_EQUAL_INT(fail, -1);
   TEST_ASSERT_EQUAL_INT(success, 0);
+  /* a writer that fails returns an error instead of aborting */
+  FILE *readonly = fopen("src/resources/cpp2.graphml", "r");
+  TEST_ASSERT_EQUAL_INT(-1, format_graph(&graph, readonly));
+  fclose(readonly);
   igraph_destroy(&graph);
 }
+
+void TEST_METRIC_CACHE() {
+  struct stat st = {0};
+  char *cache = "TEST_OUT_FOLDER/cpp2.graphml.gpcache";
+  if (stat("TEST_OUT_FOLDER/", &st) == -1) {
+    mkdir("TEST_OUT_FOLDER/", 0700);
+  }
+  remove(cache);
+  load_graph("src/resources/cpp2.graphml");
+  TEST_ASSERT_EQUAL_INT(load_metric_cache(&g, cache), 1);
+  calc_degree(&g, 'd');
+  calc_pagerank(&g);
+  SETGAN(&g, "DIAMETER", 7);
+  TEST_ASSERT_EQUAL_INT(save_metric_cache(&g, cache), 0);
+  igraph_real_t pagerank = VAN(&g, "PageRank", 10);
+  igraph_destroy(&g);
+  load_graph("src/resources/cpp2.graphml");
+  TEST_ASSERT_FALSE(igraph_cattribute_has_attr(&g, IGRAPH_ATTRIBUTE_VERTEX, "PageRank"));
+  TEST_ASSERT_EQUAL_INT(load_metric_cache(&g, cache), 0);
+  TEST_ASSERT_EQUAL_FLOAT(VAN(&g, "PageRank", 10), pagerank);
+  TEST_ASSERT_EQUAL_FLOAT(VAN(&g, "Degree", 100), 2.0);
+  TEST_ASSERT_EQUAL_FLOAT(GAN(&g, "DIAMETER"), 7.0);
+  /* a changed edge set must invalidate the cache */
+  igraph_add_edge(&g, 0, 1);
+  TEST_ASSERT_EQUAL_INT(load_metric_cache(&g, cache), 1);
+  igraph_destroy(&g);
+  remove(cache);
+}
+
+/** Asserts that two graphs have the same edges and the same attribute
+ columns, value for value. */
+static void assert_same_columns(igraph_t *a, igraph_t *b, igraph_attribute_elemtype_t kind) {
+  struct AttrTable ta, tb;
+  attr_table_init(&ta, a, kind);
+  attr_table_init(&tb, b, kind);
+  TEST_ASSERT_EQUAL_INT(ta.count, tb.count);
+  for (long i=0; i<ta.count; i++) {
+    struct AttrColumn *ca = &ta.cols[i];
+    struct AttrColumn *cb = &tb.cols[i];
+    TEST_ASSERT_EQUAL_STRING(ca->name, cb->name);
+    TEST_ASSERT_EQUAL_INT(ca->type, cb->type);
+    for (long j=0; j<ta.length; j++) {
+      if (ca->type == IGRAPH_ATTRIBUTE_NUMERIC) {
+        /* bit for bit, so NaN defaults count as equal */
+        TEST_ASSERT_EQUAL_MEMORY(&VECTOR(ca->num)[j], &VECTOR(cb->num)[j], sizeof(igraph_real_t));
+      } else if (ca->type == IGRAPH_ATTRIBUTE_STRING) {
+        TEST_ASSERT_EQUAL_STRING(STR(ca->str, j), STR(cb->str, j));
+      }
+    }
+  }
+  attr_table_destroy(&ta);
+  attr_table_destroy(&tb);
+}
+
+/** Asserts that two graphs have the same edges and attributes. */
+static void assert_same_graph(igraph_t *a, igraph_t *b) {
+  TEST_ASSERT_EQUAL_INT(igraph_vcount(a), igraph_vcount(b));
+  TEST_ASSERT_EQUAL_INT(igraph_ecount(a), igraph_ecount(b));
+  TEST_ASSERT_EQUAL_INT(igraph_is_directed(a), igraph_is_directed(b));
+  igraph_vector_t ea, eb;
+  igraph_vector_init(&ea, 0);
+  igraph_vector_init(&eb, 0);
+  igraph_get_edgelist(a, &ea, 0);
+  igraph_get_edgelist(b, &eb, 0);
+  TEST_ASSERT_TRUE(igraph_vector_all_e(&ea, &eb));
+  igraph_vector_destroy(&ea);
+  igraph_vector_destroy(&eb);
+  igraph_strvector_t names[2];
+  igraph_vector_t types[2];
+  igraph_t *graphs[2] = {a, b};
+  for (int k=0; k<2; k++) {
+    igraph_strvector_init(&names[k], 0);
+    igraph_vector_init(&types[k], 0);
+    igraph_cattribute_list(graphs[k], &names[k], &types[k], NULL, NULL, NULL, NULL);
+  }
+  TEST_ASSERT_EQUAL_INT(igraph_strvector_size(&names[0]), igraph_strvector_size(&names[1]));
+  for (long i=0; i<igraph_strvector_size(&names[0]); i++) {
+    const char *name = STR(names[0], i);
+    TEST_ASSERT_EQUAL_STRING(name, STR(names[1], i));
+    TEST_ASSERT_EQUAL_INT(VECTOR(types[0])[i], VECTOR(types[1])[i]);
+    if (VECTOR(types[0])[i] == IGRAPH_ATTRIBUTE_NUMERIC) {
+      igraph_real_t va = GAN(a, name), vb = GAN(b, name);
+      TEST_ASSERT_EQUAL_MEMORY(&va, &vb, sizeof(igraph_real_t));
+    } else if (VECTOR(types[0])[i] == IGRAPH_ATTRIBUTE_STRING) {
+      TEST_ASSERT_EQUAL_STRING(GAS(a, name), GAS(b, name));
+    }
+  }
+  for (int k=0; k<2; k++) {
+    igraph_strvector_destroy(&names[k]);
+    igraph_vector_destroy(&types[k]);
+  }
+  assert_same_columns(a, b, IGRAPH_ATTRIBUTE_VERTEX);
+  assert_same_columns(a, b, IGRAPH_ATTRIBUTE_EDGE);
+}
+
+void TEST_LOAD_GRAPHML_MMAP() {
+  char *files[] = {"albertahealth", "anarchist", "cpp2", "idlenomore", "miserables", "snowden"};
+  /* miserables has edge ids, which only igraph's reader keeps */
+  bool fallback[] = {false, false, false, false, true, false};
+  igraph_t slow, fast;
+  char file[100];
+  igraph_i_set_attribute_table(&igraph_cattribute_table);
+  for (size_t r=0; r<NELEMS(files); r++) {
+    snprintf(file, sizeof(file), "src/resources/%s.graphml", files[r]);
+    TEST_ASSERT_EQUAL_INT(load_graphml_libxml(file, &slow), 0);
+    if (fallback[r]) {
+      TEST_ASSERT_EQUAL_INT(GRAPHML_UNSUPPORTED, load_graphml_mmap(file, &fast));
+      igraph_destroy(&slow);
+      continue;
+    }
+    TEST_ASSERT_EQUAL_INT(0, load_graphml_mmap(file, &fast));
+    igraph_t out;
+    int projected = project_attributes(&fast, &out, ATTRS_FULL);
+    TEST_ASSERT_TRUE(projected >= 0);
+    assert_same_graph(&slow, projected ? &out : &fast);
+    if (projected) {
+      igraph_destroy(&out);
+    }
+    igraph_destroy(&slow);
+    igraph_destroy(&fast);
+  }
+  /* the MD5 ids are packed, and written back as the same text */
+  TEST_ASSERT_EQUAL_INT(load_graphml_mmap("src/resources/cpp2.graphml", &fast), 0);
+  TEST_ASSERT_TRUE(has_node_keys(&fast));
+  TEST_ASSERT_FALSE(igraph_cattribute_has_attr(&fast, IGRAPH_ATTRIBUTE_VERTEX, "id"));
+  igraph_destroy(&fast);
+  struct NodeKey key;
+  char text[NODE_KEY_DIGITS + 1];
+  TEST_ASSERT_EQUAL_INT(0, node_key_parse("0123456789abcdef00fedcba98765432", NODE_KEY_DIGITS, &key));
+  node_key_format(&key, text);
+  TEST_ASSERT_EQUAL_STRING("0123456789abcdef00fedcba98765432", text);
+  TEST_ASSERT_EQUAL_INT(-1, node_key_parse("0123456789ABCDEF00FEDCBA98765432", NODE_KEY_DIGITS, &key));
+  /* character references libxml refuses are left to it */
+  char *refused[] = {"&#0;", "&#-65;", "&#x;", "&#xD800;", "&#1114112;"};
+  char doc[512];
+  for (size_t i=0; i<NELEMS(refused); i++) {
+    snprintf(doc, sizeof(doc), "<graphml><key id=\"label\" for=\"node\" attr.name=\"label\""
+             " attr.type=\"string\"/><graph edgedefault=\"directed\"><node id=\"a\">"
+             "<data key=\"label\">x%sy</data></node></graph></graphml>", refused[i]);
+    TEST_ASSERT_EQUAL_INT(GRAPHML_UNSUPPORTED, load_graphml_buffer(doc, strlen(doc), &fast));
+  }
+  snprintf(doc, sizeof(doc), "<graphml><key id=\"label\" for=\"node\" attr.name=\"label\""
+           " attr.type=\"string\"/><graph edgedefault=\"directed\"><node id=\"a\">"
+           "<data key=\"label\">&#65;&#x42;&#xe9;</data></node></graph></graphml>");
+  TEST_ASSERT_EQUAL_INT(0, load_graphml_buffer(doc, strlen(doc), &fast));
+  TEST_ASSERT_EQUAL_STRING("AB\xc3\xa9", VAS(&fast, "label", 0));
+  igraph_destroy(&fast);
+  TEST_ASSERT_EQUAL_INT(load_graphml_mmap("fake/filepath.graphml", &fast), -1);
+}
+
+/** Reads a whole file into a NUL-terminated string. */
+static char* read_whole(const char *path) {
+  FILE *fp = fopen(path, "rb");
+  TEST_ASSERT_NOT_NULL(fp);
+  fseek(fp, 0, SEEK_END);
+  long size = ftell(fp);
+  char *text = (char*) calloc(size + 1, 1);
+  rewind(fp);
+  TEST_ASSERT_EQUAL_INT(size, fread(text, 1, size, fp));
+  fclose(fp);
+  return text;
+}
+
+void TEST_PACKED_IDS_OUTPUT() {
+  struct stat st = {0};
+  char *names[] = {"packed.graphml", "strings.graphml"};
+  char *written[][2] = {{"TEST_OUT_FOLDER/packed20Degree.graphml",
+                         "TEST_OUT_FOLDER/strings20Degree.graphml"},
+                        {"TEST_OUT_FOLDER/packed20Degree.gexf",
+                         "TEST_OUT_FOLDER/strings20Degree.gexf"}};
+  output_format_t formats[] = {FORMAT_GRAPHML, FORMAT_GEXF};
+  ug_save = true;
+  ug_quickrun = false;
+  ug_report = false;
+  ug_percent = 20.0;
+  ug_methods = "d";
+  ug_write_queue = 0;
+  ug_OUTPATH = "TEST_OUT_FOLDER/";
+  if (stat(ug_OUTPATH, &st) == -1) {
+    mkdir(ug_OUTPATH, 0700);
+  }
+  /* the same run on packed and on string ids writes the same files */
+  for (size_t f=0; f<NELEMS(formats); f++) {
+    ug_format = formats[f];
+    for (int i=0; i<2; i++) {
+      ug_OUTFILE = names[i];
+      if (i == 0) {
+        TEST_ASSERT_EQUAL_INT(0, load_graph("src/resources/cpp2.graphml"));
+        TEST_ASSERT_TRUE(has_node_keys(&g));
+      } else {
+        TEST_ASSERT_EQUAL_INT(0, load_graphml_libxml("src/resources/cpp2.graphml", &g));
+        TEST_ASSERT_FALSE(has_node_keys(&g));
+        NODESIZE = igraph_vcount(&g);
+        EDGESIZE = igraph_ecount(&g);
+      }
+      igraph_rng_seed(igraph_rng_default(), 42);
+      filter_graph();
+    }
+    char *packed = read_whole(written[f][0]);
+    char *strings = read_whole(written[f][1]);
+    if (ug_format == FORMAT_GEXF) {
+      /* the meta block carries the date */
+      TEST_ASSERT_EQUAL_STRING(strstr(strings, "</meta>"), strstr(packed, "</meta>"));
+    } else {
+      TEST_ASSERT_EQUAL_STRING(strings, packed);
+    }
+    free(packed);
+    free(strings);
+    remove(written[f][0]);
+    remove(written[f][1]);
+  }
+  ug_format = FORMAT_GRAPHML;
+  ug_percent = 0.0;
+}
+
+/** Whether the cut of a method at a cut size is the same for every way of
+ breaking ties, i.e. the scores either side of it differ. */
+static bool unambiguous_cut(const char *attr, int cutsize) {
+  igraph_vector_t v;
+  igraph_vector_init(&v, 0);
+  VANV(&g, attr, &v);
+  igraph_vector_sort(&v);
+  long n = igraph_vector_size(&v);
+  bool clear = cutsize <= 0 || cutsize >= n || VECTOR(v)[cutsize - 1] != VECTOR(v)[cutsize];
+  igraph_vector_destroy(&v);
+  return clear;
+}
+
+void TEST_SWEEP_MATCHES_RUNS() {
+  char *files[] = {"cpp2", "albertahealth", "snowden"};
+  int start = 10, end = 30, step = 10;
+  char file[100], line[1024], value[32];
+  int compared = 0;
+  ug_save = false;
+  ug_quickrun = false;
+  ug_jobs = 1;
+  for (size_t f=0; f<NELEMS(files); f++) {
+    snprintf(file, sizeof(file), "src/resources/%s.graphml", files[f]);
+    remove("GRAPH/graph_report.csv");
+    TEST_ASSERT_EQUAL_INT(0, load_graph(file));
+    TEST_ASSERT_EQUAL_INT(0, sweep_graph(start, end, step));
+    igraph_destroy(&g);
+    FILE *fs = fopen("GRAPH/graph_report.csv", "r");
+    TEST_ASSERT_NOT_NULL(fs);
+    TEST_ASSERT_NOT_NULL(fgets(line, sizeof(line), fs));
+    /* each row against a run of its own at that percentage */
+    for (int perc=start; perc<=end; perc+=step) {
+      TEST_ASSERT_NOT_NULL(fgets(line, sizeof(line), fs));
+      TEST_ASSERT_EQUAL_INT(0, load_graph(file));
+      ug_methods = ALL_METHODS;
+      ug_percent = perc;
+      plan_run(true);
+      analyze_base_graph();
+      int cutsize = filter_cutsize();
+      runFilters(&g, cutsize);
+      char *cell = strtok(line, "|");
+      TEST_ASSERT_EQUAL_INT(perc, atoi(cell));
+      for (struct Node *node = pv; node != NULL; node = node->next) {
+        cell = strtok(NULL, "| \n");
+        TEST_ASSERT_NOT_NULL(cell);
+        /* ties at the cut are broken at random, Random always is */
+        if (strcmp(node->abbrev, "Random") == 0 || !unambiguous_cut(node->abbrev, cutsize)) {
+          continue;
+        }
+        snprintf(value, sizeof(value), "%f", node->val);
+        TEST_ASSERT_EQUAL_STRING(value, cell);
+        ++compared;
+      }
+      clear_report();
+      igraph_destroy(&g);
+    }
+    fclose(fs);
+  }
+  TEST_ASSERT_TRUE(compared > 0);
+  remove("GRAPH/graph_report.csv");
+  arena_free(&ug_scratch);
+  ug_percent = 0.0;
+  ug_jobs = 0;
+}
+
+/* the graph-level values of every filter run so far, in report order */
+static int report_values(double *vals, int max) {
+  struct Node *lists[] = {asshead, edges, density, clustering, pv, ts};
+  int n = 0;
+  for (size_t l=0; l<NELEMS(lists); l++) {
+    for (struct Node *node = lists[l]; node != NULL && n < max; node = node->next) {
+      vals[n++] = node->val;
+    }
+  }
+  return n;
+}
+
+void TEST_PARALLEL_MATCHES_SEQUENTIAL() {
+  struct stat st = {0};
+  /* five methods on two workers, then with the first two workers failing */
+  long jobs[] = {1, 2, 3};
+  int failing[] = {0, 0, 2};
+  char *names[] = {"seq.graphml", "par.graphml", "rerun.graphml"};
+  char *methods[] = {"Betweenness", "Degree", "Eigenvector", "PageRank", "Random"};
+  double vals[NELEMS(jobs)][128];
+  int count[NELEMS(jobs)];
+  char path[100];
+  ug_save = true;
+  ug_quickrun = false;
+  ug_format = FORMAT_GRAPHML;
+  ug_write_queue = 0;
+  ug_percent = 20.0;
+  ug_methods = "bdepr";
+  ug_OUTPATH = "TEST_OUT_FOLDER/";
+  if (stat(ug_OUTPATH, &st) == -1) {
+    mkdir(ug_OUTPATH, 0700);
+  }
+  TEST_ASSERT_EQUAL_INT(0, load_graph("src/resources/cpp2.graphml"));
+  plan_run(true);
+  analyze_base_graph();
+  int cutsize = filter_cutsize();
+  for (size_t r=0; r<NELEMS(jobs); r++) {
+    ug_jobs = jobs[r];
+    ug_failing_workers = failing[r];
+    ug_OUTFILE = names[r];
+    TEST_ASSERT_EQUAL_INT(jobs[r], filter_jobs(5));
+    igraph_rng_seed(igraph_rng_default(), 42);
+    TEST_ASSERT_EQUAL_INT(0, runFilters(&g, cutsize));
+    count[r] = report_values(vals[r], 128);
+    clear_report();
+  }
+  ug_failing_workers = 0;
+  for (size_t r=1; r<NELEMS(jobs); r++) {
+    TEST_ASSERT_EQUAL_INT(count[0], count[r]);
+    TEST_ASSERT_EQUAL_MEMORY(vals[0], vals[r], count[0] * sizeof(double));
+  }
+  for (size_t m=0; m<NELEMS(methods); m++) {
+    snprintf(path, sizeof(path), "TEST_OUT_FOLDER/seq20%s.graphml", methods[m]);
+    char *seq = read_whole(path);
+    TEST_ASSERT_NOT_NULL(seq);
+    remove(path);
+    for (size_t r=1; r<NELEMS(jobs); r++) {
+      snprintf(path, sizeof(path), "TEST_OUT_FOLDER/%.*s20%s.graphml",
+               (int)(strlen(names[r]) - strlen(".graphml")), names[r], methods[m]);
+      char *par = read_whole(path);
+      TEST_ASSERT_NOT_NULL(par);
+      TEST_ASSERT_EQUAL_STRING(seq, par);
+      free(par);
+      remove(path);
+    }
+    free(seq);
+  }
+  igraph_destroy(&g);
+  arena_free(&ug_scratch);
+  ug_percent = 0.0;
+  ug_jobs = 0;
+}
+
+void TEST_COMPRESSED_ROUND_TRIP() {
+  struct stat st = {0};
+  ug_save = true;
+  ug_quickrun = false;
+  ug_format = FORMAT_GRAPHML;
+  ug_percent = 0.0;
+  ug_OUTPATH = "TEST_OUT_FOLDER/";
+  ug_OUTFILE = "cpp2.graphml";
+  if (stat(ug_OUTPATH, &st) == -1) {
+    mkdir(ug_OUTPATH, 0700);
+  }
+  TEST_ASSERT_EQUAL_INT(parse_compression("gz:6"), 0);
+  TEST_ASSERT_EQUAL_INT(parse_compression("gz:10"), -1);
+  TEST_ASSERT_EQUAL_INT(load_graph("src/resources/cpp2.graphml"), 0);
+  TEST_ASSERT_EQUAL_INT(write_graph(&g, "Gz"), 0);
+  igraph_destroy(&g);
+  ug_compress = COMPRESSION_NONE;
+  ug_compress_level = 0;
+  char *path = "TEST_OUT_FOLDER/cpp20Gz.graphml.gz";
+  TEST_ASSERT_EQUAL_INT(detect_compression(path), COMPRESSION_GZIP);
+  TEST_ASSERT_EQUAL_INT(load_graph(path), 0);
+  TEST_ASSERT_EQUAL_INT(NODESIZE, 218);
+  TEST_ASSERT_EQUAL_INT(EDGESIZE, 220);
+  igraph_destroy(&g);
+  remove(path);
+}
+
+void TEST_SNAPSHOT_ROUND_TRIP() {
+  struct stat st = {0};
+  char *files[] = {"albertahealth", "anarchist", "cpp2", "idlenomore", "miserables", "snowden"};
+  char *snapshot = "TEST_OUT_FOLDER/round_trip.gpsnap";
+  if (stat("TEST_OUT_FOLDER/", &st) == -1) {
+    mkdir("TEST_OUT_FOLDER/", 0700);
+  }
+  for (size_t f=0; f<NELEMS(files); f++) {
+    char input[100];
+    snprintf(input, sizeof(input), "src/resources/%s.graphml", files[f]);
+    TEST_ASSERT_EQUAL_INT(load_graph(input), 0);
+    TEST_ASSERT_EQUAL_INT(save_snapshot(&g, snapshot, false), 0);
+    igraph_t copy;
+    uint64_t metrics = 1;
+    TEST_ASSERT_EQUAL_INT(load_snapshot(snapshot, &copy, &metrics, false), 0);
+    TEST_ASSERT_TRUE(metrics == 0);
+    TEST_ASSERT_EQUAL_INT(igraph_vcount(&g), igraph_vcount(&copy));
+    TEST_ASSERT_EQUAL_INT(igraph_ecount(&g), igraph_ecount(&copy));
+    TEST_ASSERT_EQUAL_INT(igraph_is_directed(&g), igraph_is_directed(&copy));
+    igraph_vector_t ea, eb;
+    igraph_vector_init(&ea, 0);
+    igraph_vector_init(&eb, 0);
+    igraph_get_edgelist(&g, &ea, 0);
+    igraph_get_edgelist(&copy, &eb, 0);
+    TEST_ASSERT_TRUE(igraph_vector_all_e(&ea, &eb));
+    igraph_vector_destroy(&ea);
+    igraph_vector_destroy(&eb);
+    assert_same_columns(&g, &copy, IGRAPH_ATTRIBUTE_VERTEX);
+    assert_same_columns(&g, &copy, IGRAPH_ATTRIBUTE_EDGE);
+    igraph_destroy(&copy);
+    igraph_destroy(&g);
+  }
+  /* load_graph takes snapshots, and the analysis fingerprint survives */
+  TEST_ASSERT_EQUAL_INT(load_graph("src/resources/cpp2.graphml"), 0);
+  uint64_t fingerprint = graph_fingerprint(&g);
+  TEST_ASSERT_EQUAL_INT(save_snapshot(&g, snapshot, true), 0);
+  igraph_destroy(&g);
+  TEST_ASSERT_EQUAL_INT(load_graph(snapshot), 0);
+  TEST_ASSERT_EQUAL_INT(NODESIZE, 218);
+  TEST_ASSERT_EQUAL_INT(EDGESIZE, 220);
+  TEST_ASSERT_TRUE(fingerprint == ug_snapshot_metrics);
+  igraph_destroy(&g);
+  ug_snapshot_metrics = 0;
+  /* a flipped byte fails the checksum; this one also makes a vertex id
+     fractional, which a load without the checksum still rejects */
+  FILE *fp = fopen(snapshot, "r+b");
+  fseek(fp, 100, SEEK_SET);
+  int byte = fgetc(fp);
+  fseek(fp, 100, SEEK_SET);
+  fputc(byte ^ 0x01, fp);
+  fclose(fp);
+  igraph_t bad;
+  TEST_ASSERT_EQUAL_INT(load_snapshot(snapshot, &bad, NULL, true), -1);
+  TEST_ASSERT_EQUAL_INT(load_snapshot(snapshot, &bad, NULL, false), -1);
+  TEST_ASSERT_EQUAL_INT(load_graph(snapshot), -1);
+  /* GraphML is not a snapshot */
+  TEST_ASSERT_EQUAL_INT(load_snapshot("src/resources/cpp2.graphml", &bad, NULL, false), SNAPSHOT_NONE);
+  remove(snapshot);
+}
+
+void TEST_LOAD_CSV_SHARDS() {
+  struct stat st = {0};
+  if (stat("TEST_OUT_FOLDER/", &st) == -1) {
+    mkdir("TEST_OUT_FOLDER/", 0700);
+  }
+  mkdir("TEST_OUT_FOLDER/shards", 0700);
+  FILE *fp = fopen("TEST_OUT_FOLDER/shards/part-00000", "w");
+  fputs("crawl_date,src_domain,dest_domain,count\n"
+        "20080430,a.com,b.com,3\n"
+        "20080430,b.com,c.com,1\n", fp);
+  fclose(fp);
+  struct CompressStream cs;
+  fp = compress_stream_open(&cs, "TEST_OUT_FOLDER/shards/part-00001.gz", COMPRESSION_GZIP, 0);
+  fputs("20080501,a.com,c.com,2\r\n"
+        "broken\r\n"
+        "20080501,\"d,e.com\",a.com,5\r\n", fp);
+  TEST_ASSERT_EQUAL_INT(compress_stream_close(&cs), 0);
+  fp = fopen("TEST_OUT_FOLDER/shards/_SUCCESS", "w");
+  fclose(fp);
+  TEST_ASSERT_TRUE(is_csv_input("TEST_OUT_FOLDER/shards"));
+  TEST_ASSERT_TRUE(is_csv_input("links.tsv.gz"));
+  TEST_ASSERT_FALSE(is_csv_input("src/resources/cpp2.graphml"));
+  for (int threads=1; threads<=2; threads++) {
+    ug_threads = threads;
+    TEST_ASSERT_EQUAL_INT(load_graph("TEST_OUT_FOLDER/shards"), 0);
+    TEST_ASSERT_EQUAL_INT(NODESIZE, 4);
+    TEST_ASSERT_EQUAL_INT(EDGESIZE, 4);
+    TEST_ASSERT_EQUAL_STRING(VAS(&g, "label", 0), "a.com");
+    TEST_ASSERT_EQUAL_STRING(VAS(&g, "label", 3), "d,e.com");
+    TEST_ASSERT_EQUAL_STRING(VAS(&g, "id", 2), "c.com");
+    TEST_ASSERT_EQUAL_FLOAT(EAN(&g, "weight", 3), 5.0);
+    TEST_ASSERT_EQUAL_STRING(EAS(&g, "crawlDate", 2), "20080501");
+    igraph_integer_t from, to;
+    igraph_edge(&g, 3, &from, &to);
+    TEST_ASSERT_EQUAL_INT(from, 3);
+    TEST_ASSERT_EQUAL_INT(to, 0);
+    igraph_destroy(&g);
+  }
+  ug_threads = 0;
+  remove("TEST_OUT_FOLDER/shards/part-00000");
+  remove("TEST_OUT_FOLDER/shards/part-00001.gz");
+  remove("TEST_OUT_FOLDER/shards/_SUCCESS");
+  rmdir("TEST_OUT_FOLDER/shards");
+}
+
+void TEST_WRITE_QUEUE() {
+  struct stat st = {0};
+  ug_save = true;
+  ug_quickrun = false;
+  ug_format = FORMAT_GRAPHML;
+  ug_percent = 0.0;
+  ug_OUTPATH = "TEST_OUT_FOLDER/";
+  ug_OUTFILE = "queue.graphml";
+  ug_write_queue = 1;
+  if (stat(ug_OUTPATH, &st) == -1) {
+    mkdir(ug_OUTPATH, 0700);
+  }
+  /* a directory where the output file should go makes its write fail */
+  mkdir("TEST_OUT_FOLDER/queue0Bad.graphml", 0700);
+  TEST_ASSERT_EQUAL_INT(load_graph("src/resources/cpp2.graphml"), 0);
+  TEST_ASSERT_EQUAL_INT(write_graph(&g, "A"), 0);
+  TEST_ASSERT_EQUAL_INT(write_graph(&g, "Bad"), 0);
+  TEST_ASSERT_EQUAL_INT(write_graph(&g, "B"), 0);
+  /* writing leaves the packed ids of the graph as they are */
+  TEST_ASSERT_TRUE(has_node_keys(&g));
+  igraph_destroy(&g);
+  TEST_ASSERT_EQUAL_INT(1, write_queue_finish());
+  TEST_ASSERT_EQUAL_INT(0, write_queue_finish());
+  ug_write_queue = 0;
+  TEST_ASSERT_EQUAL_INT(load_graph("TEST_OUT_FOLDER/queue0B.graphml"), 0);
+  TEST_ASSERT_EQUAL_INT(NODESIZE, 218);
+  igraph_destroy(&g);
+  remove("TEST_OUT_FOLDER/queue0A.graphml");
+  remove("TEST_OUT_FOLDER/queue0B.graphml");
+  rmdir("TEST_OUT_FOLDER/queue0Bad.graphml");
+}
+
+void TEST_RUN_BATCH() {
+  struct stat st = {0};
+  FILE *fp;
+  ug_save = true;
+  ug_quickrun = true;
+  ug_format = FORMAT_GRAPHML;
+  ug_jobs = 2;
+  if (stat("TEST_OUT_FOLDER/", &st) == -1) {
+    mkdir("TEST_OUT_FOLDER/", 0700);
+  }
+  mkdir("TEST_OUT_FOLDER/batch", 0700);
+  fp = fopen("TEST_OUT_FOLDER/batch.txt", "w");
+  fprintf(fp, "# one good graph, one missing\nsrc/resources/cpp2.graphml\n\nsrc/resources/missing.graphml\n");
+  fclose(fp);
+  /* the missing graph fails the batch but not the graph beside it */
+  TEST_ASSERT_EQUAL_INT(-1, run_batch("TEST_OUT_FOLDER/batch.txt", "TEST_OUT_FOLDER/batch", false));
+  TEST_ASSERT_EQUAL_INT(0, stat("TEST_OUT_FOLDER/batch/" BATCH_REPORT, &st));
+  TEST_ASSERT_EQUAL_INT(load_graph("TEST_OUT_FOLDER/batch/cpp2.graphml"), 0);
+  TEST_ASSERT_EQUAL_INT(NODESIZE, 218);
+  igraph_destroy(&g);
+  ug_quickrun = false;
+  ug_jobs = 0;
+  remove("TEST_OUT_FOLDER/batch/cpp2.graphml");
+  remove("TEST_OUT_FOLDER/batch/" BATCH_REPORT);
+  remove("TEST_OUT_FOLDER/batch.txt");
+  rmdir("TEST_OUT_FOLDER/batch");
+}
+
+/* sends one request to a --serve socket and reads the whole reply */
+static void serve_request_test(const char *sock, const char *request, char *reply, size_t size) {
+  struct sockaddr_un addr = {0};
+  ssize_t n, got = 0;
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, sock);
+  for (int i=0; i<500 && connect(fd, (struct sockaddr*) &addr, sizeof(addr)) != 0; i++) {
+    usleep(10000);
+  }
+  write(fd, request, strlen(request));
+  shutdown(fd, SHUT_WR);
+  while ((n = read(fd, reply + got, size - 1 - got)) > 0) {
+    got += n;
+  }
+  reply[got] = '\0';
+  close(fd);
+}
+
+void TEST_SERVE() {
+  struct stat st = {0};
+  static char reply[1 << 20];
+  char *sock = "TEST_OUT_FOLDER/graphpass.sock";
+  char *request = "input=src/resources/cpp2.graphml\nmethods=d\npercent=10\nformat=sigma\n\n";
+  int status;
+  ug_format = FORMAT_GRAPHML;
+  if (stat("TEST_OUT_FOLDER/", &st) == -1) {
+    mkdir("TEST_OUT_FOLDER/", 0700);
+  }
+  pid_t pid = fork();
+  if (pid == 0) {
+    _exit(run_server(sock, 64, false) == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+  }
+  serve_request_test(sock, request, reply, sizeof(reply));
+  TEST_ASSERT_EQUAL_INT(0, strncmp(reply, "OK miss", 7));
+  TEST_ASSERT_NOT_NULL(strstr(reply, "FILE cpp210Degree.json "));
+  TEST_ASSERT_NOT_NULL(strstr(reply, "\"nodes\":["));
+  TEST_ASSERT_NOT_NULL(strstr(reply, "END ok"));
+  /* the second request reuses the loaded, analyzed graph */
+  serve_request_test(sock, request, reply, sizeof(reply));
+  TEST_ASSERT_EQUAL_INT(0, strncmp(reply, "OK hit", 6));
+  TEST_ASSERT_NOT_NULL(strstr(reply, "END ok"));
+  serve_request_test(sock, "input=src/resources/missing.graphml\n\n", reply, sizeof(reply));
+  TEST_ASSERT_EQUAL_INT(0, strncmp(reply, "ERR", 3));
+  kill(pid, SIGTERM);
+  waitpid(pid, &status, 0);
+  TEST_ASSERT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+  TEST_ASSERT_EQUAL_INT(-1, stat(sock, &st));
+}
+
+void TEST_CONTEXT() {
+  struct stat st = {0};
+  gp_context *a = gp_create(), *b = gp_create();
+  char *methods = "x";
+  ug_methods = methods;
+  ug_percent = 0.0;
+  if (stat("TEST_OUT_FOLDER/", &st) == -1) {
+    mkdir("TEST_OUT_FOLDER/", 0700);
+  }
+  mkdir("TEST_OUT_FOLDER/context", 0700);
+  TEST_ASSERT_EQUAL_INT(-1, gp_set(a, "bogus", NULL));
+  TEST_ASSERT_EQUAL_INT(-1, gp_set(b, "format", "xml"));
+  TEST_ASSERT_EQUAL_INT(0, gp_set(a, "methods", "d"));
+  TEST_ASSERT_EQUAL_INT(0, gp_set(a, "percent", "10"));
+  TEST_ASSERT_EQUAL_INT(0, gp_set(b, "methods", "p"));
+  TEST_ASSERT_EQUAL_INT(0, gp_set(b, "percent", "20"));
+  TEST_ASSERT_EQUAL_INT(0, gp_set(b, "gexf", NULL));
+  TEST_ASSERT_EQUAL_INT(-1, gp_filter(a));
+  TEST_ASSERT_NULL(gp_graph(a));
+  TEST_ASSERT_EQUAL_INT(0, gp_load(a, "src/resources/cpp2.graphml", "TEST_OUT_FOLDER/context/"));
+  TEST_ASSERT_EQUAL_INT(0, gp_load(b, "src/resources/cpp2.graphml", "TEST_OUT_FOLDER/context/"));
+  TEST_ASSERT_EQUAL_INT(218, igraph_vcount(gp_graph(a)));
+  TEST_ASSERT_TRUE(gp_graph(a) != gp_graph(b));
+  TEST_ASSERT_EQUAL_INT(0, gp_analyze(b));
+  TEST_ASSERT_EQUAL_INT(0, gp_analyze(a));
+  TEST_ASSERT_EQUAL_INT(0, gp_filter(a));
+  igraph_rng_seed(igraph_rng_default(), 42);
+  TEST_ASSERT_EQUAL_INT(0, gp_filter(b));
+  TEST_ASSERT_EQUAL_INT(0, stat("TEST_OUT_FOLDER/context/cpp210Degree.graphml", &st));
+  TEST_ASSERT_EQUAL_INT(0, stat("TEST_OUT_FOLDER/context/cpp220PageRank.gexf", &st));
+  TEST_ASSERT_EQUAL_INT(-1, stat("TEST_OUT_FOLDER/context/cpp210PageRank.gexf", &st));
+  /* the contexts never touch the caller's options */
+  TEST_ASSERT_EQUAL_PTR(methods, ug_methods);
+  TEST_ASSERT_EQUAL_FLOAT(0.0, ug_percent);
+  /* options and graphs can be set again any number of times */
+  for (int i=0; i<200; i++) {
+    TEST_ASSERT_EQUAL_INT(0, gp_set(a, "methods", i % 2 ? "dp" : "d"));
+    TEST_ASSERT_EQUAL_INT(0, gp_set(a, "attrs", ATTRS_VIZ));
+  }
+  for (int i=0; i<20; i++) {
+    TEST_ASSERT_EQUAL_INT(0, gp_load(a, "src/resources/cpp2.graphml", "TEST_OUT_FOLDER/context/"));
+  }
+  /* a sweep on one context between the calls of another changes nothing */
+  char *first = read_whole("TEST_OUT_FOLDER/context/cpp220PageRank.gexf");
+  remove("TEST_OUT_FOLDER/context/cpp220PageRank.gexf");
+  TEST_ASSERT_EQUAL_INT(0, gp_analyze(b));
+  TEST_ASSERT_EQUAL_INT(0, gp_sweep(a, 10, 20, 10));
+  igraph_rng_seed(igraph_rng_default(), 42);
+  TEST_ASSERT_EQUAL_INT(0, gp_filter(b));
+  TEST_ASSERT_EQUAL_INT(0, gp_write(b));
+  char *second = read_whole("TEST_OUT_FOLDER/context/cpp220PageRank.gexf");
+  TEST_ASSERT_EQUAL_STRING(strstr(first, "</meta>"), strstr(second, "</meta>"));
+  TEST_ASSERT_EQUAL_INT(-1, stat("TEST_OUT_FOLDER/context/cpp220Degree.gexf", &st));
+  free(first);
+  free(second);
+  gp_destroy(a);
+  gp_destroy(b);
+}
@@ -33,7 +33,7 @@ void setUp() {
   ug_percent = 0.0;
   ug_DIRECTORY = "src/resources/";
   ug_OUTFILE = ug_FILENAME;
-  ug_gformat = false;
+  ug_format = FORMAT_GRAPHML;
   if (stat(ug_OUTPATH, &st) == -1) {
     mkdir(ug_OUTPATH, 0700);
   }
@@ -89,7 +89,7 @@ void TEST_QUICKRUN_SIZE() {
 
 void TEST_QUICKRUN_GEXF () {
   ug_save = !ug_save;
-  ug_gformat = true;
+  ug_format = FORMAT_GEXF;
   quickrunGraph();
   TEST_ASSERT_TRUE(access("../TEST_OUT_FOLDER/cpp2.gexf", F_OK ));
   TEST_ASSERT_TRUE(access("../TEST_OUT_FOLDER/cpp2.gexf", R_OK ));
@@ -97,7 +97,7 @@ void TEST_QUICKRUN_GEXF () {
 
 void TEST_QUICKRUN_GRAPHML() {
   ug_save = true;
-  ug_gformat = false;
+  ug_format = FORMAT_GRAPHML;
   quickrunGraph();
   TEST_ASSERT_TRUE(access("../TEST_OUT_FOLDER/cpp2.graphml", F_OK ));
   TEST_ASSERT_TRUE(access("../TEST_OUT_FOLDER/cpp2.graphml", R_OK ));
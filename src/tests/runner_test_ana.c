@@ -43,8 +43,17 @@ extern void setUp(void);
 extern void tearDown(void);
 extern void TEST_DEGREE_ALGORITHM(void);
 extern void TEST_BETWEENNESS_ALGORITHM(void);
+extern void TEST_BETWEENNESS_APPROX(void);
+extern void TEST_ANF_DISTANCES(void);
 extern void TEST_AUTHORITY_ALGORITHM(void);
 extern void TEST_RANKORDER(void);
+extern void TEST_RANK_TIES(void);
+extern void TEST_RANK_ATTRIBUTE(void);
+extern void TEST_RANK_COMPARE(void);
+extern void TEST_PLANNER(void);
+extern void TEST_COST_ESTIMATE(void);
+extern void TEST_ARENA(void);
+extern void TEST_GRAPH_VIEW(void);
 extern void TEST_HUB_ALGORITHM(void);
 extern void TEST_EIGENVECTOR_ALGORITHM(void);
 extern void TEST_PAGERANK_ALGORITHM(void);
@@ -71,7 +80,7 @@ int main (void) {
   ug_OUTPUT = "TEST_OUT_FOLDER/";
   ug_percent = 0.0;
   ug_DIRECTORY = "src/resources/";
-  ug_gformat = false;
+  ug_format = FORMAT_GRAPHML;
   ug_save = true;
   load_graph("src/resources/cpp2.graphml");
   UnityBegin("src/tests/analyze_test.c");
@@ -79,12 +88,21 @@ int main (void) {
   RUN_TEST(TEST_INDEGREE_ALGORITHM, 25);
   RUN_TEST(TEST_OUTDEGREE_ALGORITHM, 36);
   RUN_TEST(TEST_BETWEENNESS_ALGORITHM, 47);
+  RUN_TEST(TEST_BETWEENNESS_APPROX, 76);
+  RUN_TEST(TEST_ANF_DISTANCES, 101);
   RUN_TEST(TEST_AUTHORITY_ALGORITHM, 58);
   RUN_TEST(TEST_HUB_ALGORITHM, 69);
   RUN_TEST(TEST_EIGENVECTOR_ALGORITHM, 80);
   RUN_TEST(TEST_PAGERANK_ALGORITHM, 91);
   RUN_TEST(TEST_MODULARITY, 102);
   RUN_TEST(TEST_RANKORDER, 113);
+  RUN_TEST(TEST_RANK_TIES, 156);
+  RUN_TEST(TEST_RANK_ATTRIBUTE, 184);
+  RUN_TEST(TEST_RANK_COMPARE, 269);
+  RUN_TEST(TEST_PLANNER, 206);
+  RUN_TEST(TEST_COST_ESTIMATE, 274);
+  RUN_TEST(TEST_ARENA, 308);
+  RUN_TEST(TEST_GRAPH_VIEW, 334);
   RUN_TEST(TEST_MEAN, 138);
   RUN_TEST(TEST_VARIANCE, 151);
   RUN_TEST(TEST_STD,164);
@@ -42,6 +42,12 @@ UnityConcludeTest(); \
 extern void setUp(void);
 extern void tearDown(void);
 extern void TEST_WRITE_GEXF(void);
+extern void TEST_ATTR_TABLE(void);
+extern void TEST_OUT_BUFFER(void);
+extern void TEST_WRITE_GEXF_THREADS(void);
+extern void TEST_WRITE_GRAPHML_THREADS(void);
+extern void TEST_WRITE_SIGMA(void);
+extern void TEST_PROJECT_ATTRIBUTES(void);
 
 void resetTest(void);
 void resetTest(void)
@@ -54,5 +60,11 @@ int main (void) {
   ug_TEST = true;
   UnityBegin("src/tests/gexf_test.c");
   RUN_TEST(TEST_WRITE_GEXF, 33);
+  RUN_TEST(TEST_ATTR_TABLE, 40);
+  RUN_TEST(TEST_OUT_BUFFER, 68);
+  RUN_TEST(TEST_WRITE_GEXF_THREADS, 99);
+  RUN_TEST(TEST_WRITE_GRAPHML_THREADS, 124);
+  RUN_TEST(TEST_WRITE_SIGMA, 125);
+  RUN_TEST(TEST_PROJECT_ATTRIBUTES, 163);
   return (UNITY_END());
 }
@@ -47,6 +47,18 @@ extern void TEST_GET_FILE(void);
 extern void TEST_STRIP_EXT(void);
 extern void TEST_LOAD_GRAPH(void);
 extern void TEST_WRITE_GRAPH(void);
+extern void TEST_METRIC_CACHE(void);
+extern void TEST_LOAD_GRAPHML_MMAP(void);
+extern void TEST_PACKED_IDS_OUTPUT(void);
+extern void TEST_SWEEP_MATCHES_RUNS(void);
+extern void TEST_PARALLEL_MATCHES_SEQUENTIAL(void);
+extern void TEST_COMPRESSED_ROUND_TRIP(void);
+extern void TEST_SNAPSHOT_ROUND_TRIP(void);
+extern void TEST_LOAD_CSV_SHARDS(void);
+extern void TEST_WRITE_QUEUE(void);
+extern void TEST_RUN_BATCH(void);
+extern void TEST_SERVE(void);
+extern void TEST_CONTEXT(void);
 
 void resetTest(void);
 void resetTest(void)
@@ -63,5 +75,17 @@ int main (void) {
   RUN_TEST(TEST_STRIP_EXT, 68);
   RUN_TEST(TEST_LOAD_GRAPH, 74);
   RUN_TEST(TEST_WRITE_GRAPH, 85);
+  RUN_TEST(TEST_METRIC_CACHE, 107);
+  RUN_TEST(TEST_LOAD_GRAPHML_MMAP, 135);
+  RUN_TEST(TEST_PACKED_IDS_OUTPUT, 268);
+  RUN_TEST(TEST_SWEEP_MATCHES_RUNS, 345);
+  RUN_TEST(TEST_PARALLEL_MATCHES_SEQUENTIAL, 406);
+  RUN_TEST(TEST_COMPRESSED_ROUND_TRIP, 173);
+  RUN_TEST(TEST_SNAPSHOT_ROUND_TRIP, 225);
+  RUN_TEST(TEST_LOAD_CSV_SHARDS, 282);
+  RUN_TEST(TEST_WRITE_QUEUE, 327);
+  RUN_TEST(TEST_RUN_BATCH, 361);
+  RUN_TEST(TEST_SERVE, 408);
+  RUN_TEST(TEST_CONTEXT, 439);
   return (UNITY_END());
 }